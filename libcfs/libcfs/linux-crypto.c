@@ -250,6 +250,28 @@ int cfs_crypto_hash_update_page(struct ahash_request *req,
 }
 EXPORT_SYMBOL(cfs_crypto_hash_update_page);
 
+/**
+ * Update hash digest computed on all the pages of a scatterlist
+ *
+ * Hashing several pages with one call lets the hash driver walk them in a
+ * single pass instead of paying the request setup and dispatch cost for
+ * every page, see CFS_CRYPTO_HASH_BATCH_PAGES.
+ *
+ * \param[in] req	ahash request
+ * \param[in] sg	scatterlist of the pages, terminated with sg_mark_end()
+ * \param[in] len	total length of data in \a sg on which to compute hash
+ *
+ * \retval		0 for success
+ * \retval		negative errno on failure
+ */
+int cfs_crypto_hash_update_sg(struct ahash_request *req,
+			      struct scatterlist *sg, unsigned int len)
+{
+	ahash_request_set_crypt(req, sg, NULL, len);
+	return crypto_ahash_update(req);
+}
+EXPORT_SYMBOL(cfs_crypto_hash_update_sg);
+
 /**
  * Update hash digest computed on the specified data
  *
@@ -323,7 +345,8 @@ EXPORT_SYMBOL(cfs_crypto_hash_final);
  * is available through the cfs_crypto_hash_speed() function.
  *
  * This function needs to stay the same as obd_t10_performance_test() so that
- * the speeds are comparable.
+ * the speeds are comparable.  The pages are hashed in batches of
+ * CFS_CRYPTO_HASH_BATCH_PAGES, as the bulk RPC checksums do.
  *
  * \param[in] hash_alg	hash algorithm id (CFS_HASH_ALG_*)
  * \param[in] buf	data buffer on which to compute the hash
@@ -336,9 +359,12 @@ static void cfs_crypto_performance_test(enum cfs_crypto_hash_alg hash_alg)
 	unsigned long		start, end;
 	int			err = 0;
 	unsigned long		bcount;
+	int			i;
 	struct page		*page;
 	unsigned char		hash[CFS_CRYPTO_HASH_DIGESTSIZE_MAX];
 	unsigned int		hash_len = sizeof(hash);
+	struct scatterlist	sg[CFS_CRYPTO_HASH_BATCH_PAGES];
+	int			batch;
 
 	page = alloc_page(GFP_KERNEL);
 	if (page == NULL) {
@@ -350,10 +376,14 @@ static void cfs_crypto_performance_test(enum cfs_crypto_hash_alg hash_alg)
 	memset(buf, 0xAD, PAGE_SIZE);
 	kunmap(page);
 
+	batch = min_t(int, CFS_CRYPTO_HASH_BATCH_PAGES, buf_len / PAGE_SIZE);
+	sg_init_table(sg, batch);
+	for (i = 0; i < batch; i++)
+		sg_set_page(&sg[i], page, PAGE_SIZE, 0);
+
 	for (start = jiffies, end = start + cfs_time_seconds(1) / 4,
 	     bcount = 0; time_before(jiffies, end) && err == 0; bcount++) {
 		struct ahash_request *req;
-		int i;
 
 		req = cfs_crypto_hash_init(hash_alg, NULL, 0);
 		if (IS_ERR(req)) {
@@ -361,9 +391,9 @@ static void cfs_crypto_performance_test(enum cfs_crypto_hash_alg hash_alg)
 			break;
 		}
 
-		for (i = 0; i < buf_len / PAGE_SIZE; i++) {
-			err = cfs_crypto_hash_update_page(req, page, 0,
-							  PAGE_SIZE);
+		for (i = 0; i < buf_len / PAGE_SIZE; i += batch) {
+			err = cfs_crypto_hash_update_sg(req, sg,
+							batch * PAGE_SIZE);
 			if (err != 0)
 				break;
 		}
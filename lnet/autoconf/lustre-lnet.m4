@@ -517,6 +517,8 @@ AS_IF([test $ENABLEO2IB != "no"], [
 
 	# 5.0
 	LN_IB_DEVICE_OPS_EXISTS
+	# 4.16
+	LN_RDMA_SET_CQ_MODERATION_EXISTS
 	# 5.1
 	LN_IB_SG_DMA_ADDRESS_EXISTS
 
@@ -699,6 +701,96 @@ kern_sock_getname_2args, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_CONFIG_SOCK_GETNAME
 
+#
+# LN_CONFIG_SOCK_ZEROCOPY
+#
+# 4.14 commit f214f915e7db99091f1312c48b30928c1e0c90b7
+# tcp: enable MSG_ZEROCOPY
+# ... completions are reported on the socket error queue with the
+# SO_EE_ORIGIN_ZEROCOPY origin ...
+#
+AC_DEFUN([LN_CONFIG_SOCK_ZEROCOPY], [
+tmp_flags="$EXTRA_KCFLAGS"
+EXTRA_KCFLAGS="-Werror"
+LB_CHECK_COMPILE([if TCP supports MSG_ZEROCOPY],
+sock_msg_zerocopy, [
+	#include <linux/errqueue.h>
+	#include <linux/net.h>
+	#include <net/sock.h>
+],[
+	struct sk_buff *skb = sock_dequeue_err_skb(NULL);
+	struct sock_exterr_skb *serr = SKB_EXT_ERR(skb);
+
+	serr->ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+	kernel_setsockopt(NULL, SOL_SOCKET, SO_ZEROCOPY, NULL, 0);
+	kernel_sendmsg(NULL, NULL, NULL, 0, MSG_ZEROCOPY);
+],[
+	AC_DEFINE(HAVE_SOCK_ZEROCOPY, 1,
+		[TCP supports MSG_ZEROCOPY])
+])
+EXTRA_KCFLAGS="$tmp_flags"
+]) # LN_CONFIG_SOCK_ZEROCOPY
+
+#
+# LN_CONFIG_SOCK_KTLS
+#
+# 4.17 commit c46234ebb4d1eee5e09819f49169e51cfc6eb909
+# tls: RX path for ktls
+# ... TLS_RX completes kernel TLS, which does TX since 4.13 ...
+#
+# 5.8 removed kernel_setsockopt(), and 5.9 passes a sockptr_t into
+# ->setsockopt(), so the TLS options are set through ->setsockopt() with
+# a kernel sockptr_t on newer kernels.  5.8 has neither.
+#
+AC_DEFUN([LN_CONFIG_SOCK_KTLS], [
+tmp_flags="$EXTRA_KCFLAGS"
+EXTRA_KCFLAGS="-Werror"
+LB_CHECK_COMPILE([if TCP supports kernel TLS transmit and receive],
+sock_ktls, [
+	#include <linux/net.h>
+	#include <linux/socket.h>
+	#include <linux/tcp.h>
+	#include <linux/tls.h>
+],[
+	struct tls12_crypto_info_aes_gcm_128 ci = {
+		.info.version = TLS_1_2_VERSION,
+		.info.cipher_type = TLS_CIPHER_AES_GCM_128,
+	};
+
+	kernel_setsockopt(NULL, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+	kernel_setsockopt(NULL, SOL_TLS, TLS_TX, (char *)&ci, sizeof(ci));
+	kernel_setsockopt(NULL, SOL_TLS, TLS_RX, (char *)&ci, sizeof(ci));
+],[
+	AC_DEFINE(HAVE_SOCK_KTLS, 1,
+		[TCP supports kernel TLS transmit and receive])
+],[
+	LB_CHECK_COMPILE([if kernel TLS is set up through sockptr_t setsockopt],
+	sock_ktls_sockptr, [
+		#include <linux/net.h>
+		#include <linux/sockptr.h>
+		#include <linux/tcp.h>
+		#include <linux/tls.h>
+	],[
+		struct tls12_crypto_info_aes_gcm_128 ci = {
+			.info.version = TLS_1_2_VERSION,
+			.info.cipher_type = TLS_CIPHER_AES_GCM_128,
+		};
+		struct socket *sock = NULL;
+
+		sock->ops->setsockopt(sock, SOL_TCP, TCP_ULP,
+				      KERNEL_SOCKPTR("tls"), sizeof("tls"));
+		sock->ops->setsockopt(sock, SOL_TLS, TLS_RX,
+				      KERNEL_SOCKPTR(&ci), sizeof(ci));
+	],[
+		AC_DEFINE(HAVE_SOCK_KTLS, 1,
+			[TCP supports kernel TLS transmit and receive])
+		AC_DEFINE(HAVE_SOCK_KTLS_SOCKPTR, 1,
+			[kernel TLS options are set with a sockptr_t])
+	])
+])
+EXTRA_KCFLAGS="$tmp_flags"
+]) # LN_CONFIG_SOCK_KTLS
+
 #
 # LN_IB_DEVICE_OPS_EXISTS
 #
@@ -724,6 +816,26 @@ ib_device_ops_test, [
 EXTRA_KCFLAGS="$tmp_flags"
 ]) # LN_IB_DEVICE_OPS_EXISTS
 
+#
+# LN_RDMA_SET_CQ_MODERATION_EXISTS
+#
+# kernel 4.16 renamed ib_modify_cq() to rdma_set_cq_moderation()
+#
+AC_DEFUN([LN_RDMA_SET_CQ_MODERATION_EXISTS], [
+tmp_flags="$EXTRA_KCFLAGS"
+EXTRA_KCFLAGS="-Werror"
+LB_CHECK_COMPILE([if rdma_set_cq_moderation exists],
+rdma_set_cq_moderation_test, [
+	#include <rdma/ib_verbs.h>
+],[
+	rdma_set_cq_moderation(NULL, 0, 0);
+],[
+	AC_DEFINE(HAVE_RDMA_SET_CQ_MODERATION, 1,
+		[if rdma_set_cq_moderation exists])
+])
+EXTRA_KCFLAGS="$tmp_flags"
+]) # LN_RDMA_SET_CQ_MODERATION_EXISTS
+
 #
 # LN_IB_SG_DMA_ADDRESS_EXISTS
 #
@@ -769,8 +881,10 @@ LN_CONFIG_SOCK_CREATE_KERN
 # 4.14
 LN_HAVE_HYPERVISOR_IS_TYPE
 LN_HAVE_ORACLE_OFED_EXTENSIONS
+LN_CONFIG_SOCK_ZEROCOPY
 # 4.17
 LN_CONFIG_SOCK_GETNAME
+LN_CONFIG_SOCK_KTLS
 ]) # LN_PROG_LINUX
 
 #
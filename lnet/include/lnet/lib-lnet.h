@@ -197,6 +197,9 @@ extern struct kmem_cache *lnet_small_mds_cachep; /* <= LNET_SMALL_MD_SIZE bytes
 extern struct kmem_cache *lnet_rspt_cachep;
 extern struct kmem_cache *lnet_msg_cachep;
 
+void *lnet_arena_alloc(enum lnet_arena_type type);
+void lnet_arena_free(enum lnet_arena_type type, void *obj);
+
 static inline struct lnet_eq *
 lnet_eq_alloc (void)
 {
@@ -229,8 +232,7 @@ lnet_md_alloc(struct lnet_md *umd)
 	}
 
 	if (size <= LNET_SMALL_MD_SIZE) {
-		md = kmem_cache_alloc(lnet_small_mds_cachep,
-				      GFP_NOFS | __GFP_ZERO);
+		md = lnet_arena_alloc(LNET_ARENA_MD);
 		if (md) {
 			CDEBUG(D_MALLOC, "slab-alloced 'md' of size %u at "
 			       "%p.\n", size, md);
@@ -267,7 +269,7 @@ lnet_md_free(struct lnet_libmd *md)
 
 	if (size <= LNET_SMALL_MD_SIZE) {
 		CDEBUG(D_MALLOC, "slab-freed 'md' at %p.\n", md);
-		kmem_cache_free(lnet_small_mds_cachep, md);
+		lnet_arena_free(LNET_ARENA_MD, md);
 	} else {
 		LIBCFS_FREE(md, size);
 	}
@@ -418,7 +420,7 @@ lnet_msg_alloc(void)
 {
 	struct lnet_msg *msg;
 
-	msg = kmem_cache_alloc(lnet_msg_cachep, GFP_NOFS | __GFP_ZERO);
+	msg = lnet_arena_alloc(LNET_ARENA_MSG);
 
 	return (msg);
 }
@@ -427,7 +429,7 @@ static inline void
 lnet_msg_free(struct lnet_msg *msg)
 {
 	LASSERT(!msg->msg_onactivelist);
-	kmem_cache_free(lnet_msg_cachep, msg);
+	lnet_arena_free(LNET_ARENA_MSG, msg);
 }
 
 static inline struct lnet_rsp_tracker *
@@ -541,6 +543,7 @@ void lnet_router_debugfs_fini(void);
 int  lnet_rtrpools_alloc(int im_a_router);
 void lnet_destroy_rtrbuf(struct lnet_rtrbuf *rb, int npages);
 int  lnet_rtrpools_adjust(int tiny, int small, int large);
+void lnet_rtrpools_autoscale(void);
 int lnet_rtrpools_enable(void);
 void lnet_rtrpools_disable(void);
 void lnet_rtrpools_free(int keep_pools);
@@ -574,6 +577,7 @@ int lnet_send_ping(lnet_nid_t dest_nid, struct lnet_handle_md *mdh, int nnis,
 		   void *user_ptr, struct lnet_eq *eq, bool recovery);
 void lnet_return_tx_credits_locked(struct lnet_msg *msg);
 void lnet_return_rx_credits_locked(struct lnet_msg *msg);
+void lnet_peer_adjust_rtrcredits(struct lnet_peer_ni *lpni, int delta);
 void lnet_schedule_blocked_locked(struct lnet_rtrbufpool *rbp);
 void lnet_drop_routed_msgs_locked(struct list_head *list, int cpt);
 
@@ -618,6 +622,10 @@ struct lnet_match_table *lnet_mt_of_attach(unsigned int index,
 					   struct lnet_process_id id,
 					   __u64 mbits, __u64 ignore_bits,
 					   enum lnet_ins_pos pos);
+void lnet_mt_iclass_add(struct lnet_match_table *mtable, struct lnet_me *me,
+			enum lnet_ins_pos pos);
+void lnet_mt_iclass_del(struct lnet_me *me);
+void lnet_mt_iclass_unlink(struct lnet_me *me);
 int lnet_mt_match_md(struct lnet_match_table *mtable,
 		     struct lnet_match_info *info, struct lnet_msg *msg);
 
@@ -665,6 +673,8 @@ int lnet_msg_container_setup(struct lnet_msg_container *container, int cpt);
 void lnet_msg_container_cleanup(struct lnet_msg_container *container);
 void lnet_msg_containers_destroy(void);
 int lnet_msg_containers_create(void);
+void lnet_arena_counters_get(struct lnet_counters_arena *counters);
+void lnet_arena_counters_reset(void);
 
 char *lnet_health_error2str(enum lnet_msg_hstatus hstatus);
 char *lnet_msgtyp2str(int type);
@@ -884,7 +894,8 @@ struct lnet_peer_net *lnet_peer_get_net_locked(struct lnet_peer *peer,
 					       __u32 net_id);
 bool lnet_peer_is_pref_nid_locked(struct lnet_peer_ni *lpni, lnet_nid_t nid);
 int lnet_peer_ni_set_non_mr_pref_nid(struct lnet_peer_ni *lpni, lnet_nid_t nid);
-int lnet_add_peer_ni(lnet_nid_t key_nid, lnet_nid_t nid, bool mr);
+int lnet_add_peer_ni(lnet_nid_t key_nid, lnet_nid_t nid, bool mr,
+		     bool seed);
 int lnet_del_peer_ni(lnet_nid_t key_nid, lnet_nid_t nid);
 int lnet_get_peer_info(struct lnet_ioctl_peer_cfg *cfg, void __user *bulk);
 int lnet_get_peer_ni_info(__u32 peer_index, __u64 *nid,
@@ -969,30 +980,74 @@ lnet_is_peer_ni_alive(struct lnet_peer_ni *lpni)
 	return halive && lpni->lpni_ns_status == LNET_NI_STATUS_UP;
 }
 
+/*
+ * Receivers on other CPTs raise the peer net health without our lock, see
+ * lnet_raise_peer_net_healthv(), so only store the recomputed value if
+ * nobody changed it since we read it.  Scan again after storing it: a
+ * peer NI raised after we read it may have seen the old, higher value
+ * and left it alone.
+ */
 static inline void
 lnet_update_peer_net_healthv(struct lnet_peer_ni *lpni)
 {
 	struct lnet_peer_net *lpn;
-	int best_healthv = 0;
+	int best_healthv;
+	int old;
+	int cur;
 
 	lpn = lpni->lpni_peer_net;
+	old = atomic_read(&lpn->lpn_healthv);
+
+	for (;;) {
+		best_healthv = 0;
+		list_for_each_entry(lpni, &lpn->lpn_peer_nis, lpni_peer_nis) {
+			int lpni_healthv = atomic_read(&lpni->lpni_healthv);
+			if (best_healthv < lpni_healthv)
+				best_healthv = lpni_healthv;
+		}
 
-	list_for_each_entry(lpni, &lpn->lpn_peer_nis, lpni_peer_nis) {
-		int lpni_healthv = atomic_read(&lpni->lpni_healthv);
-		if (best_healthv < lpni_healthv)
-			best_healthv = lpni_healthv;
+		if (best_healthv == old)
+			break;
+		cur = atomic_cmpxchg(&lpn->lpn_healthv, old, best_healthv);
+		old = cur == old ? best_healthv : cur;
 	}
+}
 
-	lpn->lpn_healthv = best_healthv;
+/*
+ * The health of one peer NI went up to @healthv, so the peer net health
+ * can only go up to it as well.  This doesn't walk lpn_peer_nis, and may
+ * race with other CPTs raising or recomputing it, hence the cmpxchg.
+ */
+static inline void
+lnet_raise_peer_net_healthv(struct lnet_peer_net *lpn, int healthv)
+{
+	int old = atomic_read(&lpn->lpn_healthv);
+	int cur;
+
+	while (old < healthv) {
+		cur = atomic_cmpxchg(&lpn->lpn_healthv, old, healthv);
+		if (cur == old)
+			break;
+		old = cur;
+	}
 }
 
+/*
+ * The caller must hold any of the CPT locks, which keeps lpni_peer_net
+ * and lpn_peer_nis from changing under us.
+ */
 static inline void
 lnet_set_lpni_healthv_locked(struct lnet_peer_ni *lpni, int value)
 {
-	if (atomic_read(&lpni->lpni_healthv) == value)
+	int old = atomic_read(&lpni->lpni_healthv);
+
+	if (old == value)
 		return;
 	atomic_set(&lpni->lpni_healthv, value);
-	lnet_update_peer_net_healthv(lpni);
+	if (value > old)
+		lnet_raise_peer_net_healthv(lpni->lpni_peer_net, value);
+	else
+		lnet_update_peer_net_healthv(lpni);
 }
 
 static inline void
@@ -1000,7 +1055,8 @@ lnet_inc_lpni_healthv_locked(struct lnet_peer_ni *lpni)
 {
 	/* only adjust the net health if the lpni health value changed */
 	if (atomic_add_unless(&lpni->lpni_healthv, 1, LNET_MAX_HEALTH_VALUE))
-		lnet_update_peer_net_healthv(lpni);
+		lnet_raise_peer_net_healthv(lpni->lpni_peer_net,
+					    atomic_read(&lpni->lpni_healthv));
 }
 
 static inline void
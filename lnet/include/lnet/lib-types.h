@@ -43,6 +43,7 @@
 #endif
 
 #include <linux/kthread.h>
+#include <linux/llist.h>
 #include <linux/uio.h>
 #include <linux/semaphore.h>
 #include <linux/types.h>
@@ -193,6 +194,9 @@ struct lnet_me {
 	struct lnet_process_id	me_match_id;
 	unsigned int		me_portal;
 	unsigned int		me_pos;		/* hash offset in mt_hash */
+	int			me_iclass;	/* ignore-bits class or -1 */
+	__s64			me_iseq;	/* order on the ignore-bits list */
+	struct list_head	me_iclass_list;	/* chain on ignore-bits class */
 	__u64			me_match_bits;
 	__u64			me_ignore_bits;
 	enum lnet_unlink	me_unlink;
@@ -546,6 +550,8 @@ struct lnet_peer_ni {
 	int			lpni_rtrcredits;
 	/* low water mark */
 	int			lpni_minrtrcredits;
+	/* router credits lent by the autoscaler on top of the default */
+	int			lpni_rtrcredits_extra;
 	/* bytes queued for sending */
 	long			lpni_txqnob;
 	/* network peer is on */
@@ -742,6 +748,13 @@ struct lnet_peer {
 /* gw has undergone discovery (does not indicate success or failure) */
 #define LNET_PEER_RTR_DISCOVERED (1 << 17)
 
+/*
+ * A peer is marked SEEDED when it was loaded from a saved peer cache.
+ * Messages are sent to its NIDs right away, while discovery revalidates
+ * it in the background, until it is DISCOVERED.
+ */
+#define LNET_PEER_SEEDED	(1 << 18)
+
 struct lnet_peer_net {
 	/* chain on lp_peer_nets */
 	struct list_head	lpn_peer_nets;
@@ -755,8 +768,8 @@ struct lnet_peer_net {
 	/* Net ID */
 	__u32			lpn_net_id;
 
-	/* peer net health */
-	int			lpn_healthv;
+	/* peer net health, the best health of lpn_peer_nis */
+	atomic_t		lpn_healthv;
 
 	/* time of last router net check attempt */
 	time64_t		lpn_rtrcheck_timestamp;
@@ -852,6 +865,15 @@ struct lnet_rtrbufpool {
 	int			rbp_credits;
 	/* low water mark */
 	int			rbp_mincredits;
+	/* low water mark since the last autoscaler check */
+	int			rbp_scan_mincredits;
+	/* # buffers configured, the autoscaler never goes below it */
+	int			rbp_cfg_nbuffers;
+	/* # autoscaler checks in a row which found the pool mostly idle */
+	int			rbp_idle_scans;
+	/* # times the autoscaler grew / shrank the pool */
+	__u32			rbp_grown;
+	__u32			rbp_shrunk;
 };
 
 struct lnet_rtrbuf {
@@ -905,6 +927,23 @@ struct lnet_match_info {
 #define LNET_MT_EXHAUSTED_BITS		(LNET_MT_HASH_BITS - LNET_MT_BITS_U64)
 #define LNET_MT_EXHAUSTED_BMAP		((1 << LNET_MT_EXHAUSTED_BITS) + 1)
 
+/* MEs with ignore-bits are also hashed by (match-bits & ~ignore-bits) in a
+ * per-class table, one class for each distinct ignore-bits, so matching only
+ * walks the MEs whose significant bits can match */
+#define LNET_MT_ICLASS_MAX		4
+#define LNET_MT_ICLASS_HASH_BITS	LNET_MT_HASH_BITS
+
+struct lnet_mt_iclass {
+	/* ignore-bits of this class, 0 if the slot is unused */
+	__u64			ic_ignore_bits;
+	/* number of MEs in this class */
+	unsigned int		ic_nmes;
+	/* chains of MEs with a usable MD, allocated with the slot, a single
+	 * one for MEs ignoring all bits */
+	unsigned int		ic_hash_bits;
+	struct list_head	*ic_hash;
+};
+
 /* portal match table */
 struct lnet_match_table {
 	/* reserved for upcoming patches, CPU partition ID */
@@ -916,6 +955,18 @@ struct lnet_match_table {
 	/* bitmap to flag whether MEs on mt_hash are exhausted or not */
 	__u64			mt_exhausted[LNET_MT_EXHAUSTED_BMAP];
 	struct list_head	*mt_mhash;	/* matching hash */
+	/* ignore-bits classes of MEs on mt_mhash[LNET_MT_HASH_IGNORE] */
+	struct lnet_mt_iclass	*mt_iclasses;
+	/* MEs with ignore-bits which didn't get a class because all of them
+	 * are in use, the classes are bypassed while it's non-zero */
+	unsigned int		mt_iclass_overflow;
+	/* MEs on the chains of the ignore-bits classes */
+	unsigned int		mt_iclass_nlive;
+	/* MEs tried by matching, checked by the kmatch test */
+	__u64			mt_me_tried;
+	/* next order of ME inserted before/after all MEs with ignore-bits */
+	__s64			mt_iseq_head;
+	__s64			mt_iseq_tail;
 };
 
 /* these are only useful for wildcard portal */
@@ -960,6 +1011,29 @@ struct lnet_res_container {
 };
 
 /* message container */
+/* objects recycled by struct lnet_arena */
+enum lnet_arena_type {
+	LNET_ARENA_MSG = 0,
+	LNET_ARENA_MD,		/* MDs of up to LNET_SMALL_MD_SIZE bytes */
+	LNET_ARENA_ME,
+	LNET_ARENA_NR,
+};
+
+/* per-CPT cache of freed objects in front of their kmem_cache, objects are
+ * pushed without locking, popping is serialized by la_lock */
+struct lnet_arena {
+	struct llist_head	la_free;
+	spinlock_t		la_lock;
+	/* # objects on la_free */
+	atomic_t		la_nfree;
+	/* max # objects on la_free */
+	int			la_size;
+	/* the most objects la_free has held */
+	int			la_hiwater;
+	/* # allocations which found la_free empty */
+	__u32			la_misses;
+};
+
 struct lnet_msg_container {
 	int			msc_init;	/* initialized or not */
 	/* max # threads finalizing */
@@ -973,6 +1047,8 @@ struct lnet_msg_container {
 	void			**msc_finalizers;
 	/* threads doing resends */
 	void			**msc_resenders;
+	/* recycled msgs, MDs and MEs */
+	struct lnet_arena	msc_arenas[LNET_ARENA_NR];
 };
 
 /* Peer Discovery states */
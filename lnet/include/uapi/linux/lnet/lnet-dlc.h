@@ -83,9 +83,18 @@ struct lnet_ioctl_config_o2iblnd_tunables {
 	__u16 lnd_ntx;
 };
 
+struct lnet_ioctl_config_socklnd_tunables {
+	__u32 lnd_version;
+	__u16 lnd_zerocopy;
+	__u16 lnd_rx_batch;
+	__u16 lnd_tls;
+	__u16 lnd_pad;
+};
+
 struct lnet_lnd_tunables {
 	union {
 		struct lnet_ioctl_config_o2iblnd_tunables lnd_o2ib;
+		struct lnet_ioctl_config_socklnd_tunables lnd_sock;
 	} lnd_tun_u;
 };
 
@@ -116,8 +125,25 @@ struct lnet_ioctl_pool_cfg {
 		__u32 pl_mincredits;
 	} pl_pools[LNET_NRBPOOLS];
 	__u32 pl_routing;
+	/* The fields below are only filled in when ioc_len covers them, and
+	 * pl_ext_flags then has LNET_POOL_CFG_EXT set. Older kernels and
+	 * tools use the structure up to pl_routing. */
+	__u32 pl_ext_flags;
+	/* router buffer autoscaler settings */
+	__u32 pl_autoscale;
+	__u32 pl_autoscale_max;
+	__u32 pl_autoscale_interval;
+	/* configured size of each pool, and how often it grew and shrank */
+	__u32 pl_cfg_nbuffers[LNET_NRBPOOLS];
+	__u32 pl_grown[LNET_NRBPOOLS];
+	__u32 pl_shrunk[LNET_NRBPOOLS];
+	/* peers of this CPT holding extra router credits, and how many */
+	__u32 pl_boosted_peers;
+	__u32 pl_boosted_credits;
 };
 
+#define LNET_POOL_CFG_EXT	0x1
+
 struct lnet_ioctl_ping_data {
 	struct libcfs_ioctl_hdr ping_hdr;
 
@@ -259,6 +285,9 @@ struct lnet_ioctl_peer {
 	} pr_lnd_u;
 };
 
+/* prcfg_state flags of IOC_LIBCFS_ADD_PEER_NI */
+#define LNET_PEER_ADD_SEED	(1 << 0)	/* loaded from a peer cache */
+
 struct lnet_ioctl_peer_cfg {
 	struct libcfs_ioctl_hdr prcfg_hdr;
 	lnet_nid_t prcfg_prim_nid;
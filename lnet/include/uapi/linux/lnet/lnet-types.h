@@ -253,9 +253,23 @@ struct lnet_counters_health {
 	__u32	lch_network_timeout_count;
 };
 
+/* per-CPT caches of freed msgs, MDs and MEs */
+struct lnet_counters_arena {
+	__u32	lca_msgs_cached;
+	__u32	lca_msgs_hiwater;
+	__u32	lca_msgs_misses;
+	__u32	lca_mds_cached;
+	__u32	lca_mds_hiwater;
+	__u32	lca_mds_misses;
+	__u32	lca_mes_cached;
+	__u32	lca_mes_hiwater;
+	__u32	lca_mes_misses;
+};
+
 struct lnet_counters {
 	struct lnet_counters_common lct_common;
 	struct lnet_counters_health lct_health;
+	struct lnet_counters_arena lct_arena;
 };
 
 #define LNET_NI_STATUS_UP	0x15aac0de
@@ -470,6 +484,10 @@ struct lnet_md {
 	 *   struct iovec.
 	 * - LNET_MD_MAX_SIZE: The max_size field is valid.
 	 * - LNET_MD_BULK_HANDLE: The bulk_handle field is valid.
+	 * - LNET_MD_MR_STRIPE: PUT and GET operations initiated on this MD
+	 *   to a Multi-Rail peer may use any healthy pair of local and peer
+	 *   NIs, even when the source NID is specified. Used on the MDs of
+	 *   a bulk transfer to spread it across rails.
 	 *
 	 * Note:
 	 * - LNET_MD_KIOV or LNET_MD_IOVEC allows for a scatter/gather
@@ -530,6 +548,8 @@ struct lnet_md {
 #define LNET_MD_KIOV		     (1 << 8)
 /** See struct lnet_md::options. */
 #define LNET_MD_BULK_HANDLE	     (1 << 9)
+/** See struct lnet_md::options. */
+#define LNET_MD_MR_STRIPE	     (1 << 10)
 
 /* For compatibility with Cray Portals */
 #define LNET_MD_PHYS			     0
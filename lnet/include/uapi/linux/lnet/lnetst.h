@@ -39,9 +39,11 @@
 
 #define LST_FEAT_NONE		(0)
 #define LST_FEAT_BULK_LEN	(1 << 0)	/* enable variable page size */
+#define LST_FEAT_LAT_HIST	(1 << 1)	/* RPC latency histograms */
 
 #define LST_FEATS_EMPTY		(LST_FEAT_NONE)
-#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN)
+#define LST_FEATS_MASK		(LST_FEAT_NONE | LST_FEAT_BULK_LEN | \
+				 LST_FEAT_LAT_HIST)
 
 #define LST_NAME_SIZE		32		/* max name buffer length */
 
@@ -64,6 +66,7 @@
 #define LSTIO_TEST_ADD		0xC26		/* add test (to batch) */
 #define LSTIO_BATCH_QUERY	0xC27		/* query batch status */
 #define LSTIO_STAT_QUERY	0xC30		/* get stats */
+#define LSTIO_HIST_QUERY	0xC31		/* get latency histograms */
 
 struct lst_sid {
 	lnet_nid_t	ses_nid;	/* nid of console node */
@@ -512,4 +515,28 @@ struct sfw_counters {
 	__u32 ping_errors;
 } WIRE_ATTR;
 
+/*
+ * Log-linear histogram of RPC latencies in microseconds: values below
+ * 2^LST_HIST_SUB_BITS have a bucket each, every power of two above is split
+ * into 2^LST_HIST_SUB_BITS buckets of equal width, and everything above
+ * 2^32us lands in the last bucket.
+ */
+#define LST_HIST_SUB_BITS	3
+#define LST_HIST_NBUCKETS	((32 - LST_HIST_SUB_BITS + 1) << LST_HIST_SUB_BITS)
+
+struct lst_lat_hist {
+	/** # of RPCs completed successfully */
+	__u64 lh_count;
+	/** sum and maximum of their latency */
+	__u64 lh_sum_us;
+	__u64 lh_max_us;
+	__u32 lh_buckets[LST_HIST_NBUCKETS];
+} WIRE_ATTR;
+
+/* latency of the test RPCs sent by a node since its session started */
+struct lst_lat_hists {
+	struct lst_lat_hist lhs_brw;
+	struct lst_lat_hist lhs_ping;
+} WIRE_ATTR;
+
 #endif
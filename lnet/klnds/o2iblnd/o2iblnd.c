@@ -828,6 +828,7 @@ kiblnd_create_conn(struct kib_peer_ni *peer_ni, struct rdma_cm_id *cmid,
 	conn->ibc_queue_depth = peer_ni->ibp_queue_depth;
 	conn->ibc_rxs = NULL;
 	conn->ibc_rx_pages = NULL;
+	conn->ibc_rx_batch_tail = &conn->ibc_rx_batch;
 
 	INIT_LIST_HEAD(&conn->ibc_early_rxs);
 	INIT_LIST_HEAD(&conn->ibc_tx_noops);
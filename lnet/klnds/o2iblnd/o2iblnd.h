@@ -101,6 +101,10 @@ struct kib_tunables {
 	int		 *kib_nscheds;
 	int		 *kib_wrq_sge;		/* # sg elements per wrq */
 	int		 *kib_use_fastreg_gaps; /* enable discontiguous fastreg fragment support */
+	int		 *kib_poll_batch;	/* # completions per CQ poll */
+	/* max # completions per CQ event */
+	int		 *kib_cq_moderation;
+	int		 *kib_cq_moderation_usec; /* max CQ event delay */
 };
 
 extern struct kib_tunables  kiblnd_tunables;
@@ -133,6 +137,10 @@ extern struct kib_tunables  kiblnd_tunables;
 #define IBLND_OOB_CAPABLE(v)       ((v) != IBLND_MSG_VERSION_1)
 #define IBLND_OOB_MSGS(v)           (IBLND_OOB_CAPABLE(v) ? 2 : 0)
 
+#define IBLND_POLL_BATCH_MAX        16                      /* max # completions per CQ poll */
+/* # consecutive full polls before coalescing more completions per CQ event */
+#define IBLND_CQ_MOD_BUSY            4
+
 #define IBLND_MSG_SIZE              (4<<10)                 /* max size of queued messages (inc hdr) */
 #define IBLND_MAX_RDMA_FRAGS         LNET_MAX_IOV           /* max # of fragments supported */
 
@@ -715,6 +723,18 @@ struct kib_conn {
 	struct rdma_cm_id	*ibc_cmid;
 	/* completion queue */
 	struct ib_cq		*ibc_cq;
+	/* current CQ moderation, # completions per event, -1 if unsupported */
+	int			ibc_cq_mod_count;
+	/* consecutive polls which filled a batch */
+	int			ibc_cq_busy;
+	/* scheduler thread reposting rxs in a batch, if any */
+	struct task_struct	*ibc_rx_batch_owner;
+	/* rxs to repost at the end of the batch */
+	struct ib_recv_wr	*ibc_rx_batch;
+	struct ib_recv_wr	**ibc_rx_batch_tail;
+	/* credits to return once the batch is posted */
+	int			ibc_rx_batch_credits;
+	int			ibc_rx_batch_rsrvd;
 
 	/* in-progress connection state */
 	struct kib_connvars	*ibc_connvars;
@@ -1133,6 +1153,11 @@ static inline void kiblnd_dma_unmap_sg(struct ib_device *dev,
         ib_dma_unmap_sg(dev, sg, nents, direction);
 }
 
+#ifndef HAVE_RDMA_SET_CQ_MODERATION
+#define rdma_set_cq_moderation(cq, count, period) \
+	ib_modify_cq(cq, count, period)
+#endif
+
 #ifndef HAVE_IB_SG_DMA_ADDRESS
 #include <linux/scatterlist.h>
 #define ib_sg_dma_address(dev, sg)	sg_dma_address(sg)
@@ -199,6 +199,17 @@ kiblnd_post_rx(struct kib_rx *rx, int credit)
 
         rx->rx_nob = -1;                        /* flag posted */
 
+	if (READ_ONCE(conn->ibc_rx_batch_owner) == current) {
+		/* the scheduler posts it with the rest of its batch */
+		*conn->ibc_rx_batch_tail = &rx->rx_wrq;
+		conn->ibc_rx_batch_tail = &rx->rx_wrq.next;
+		if (credit == IBLND_POSTRX_PEER_CREDIT)
+			conn->ibc_rx_batch_credits++;
+		else if (credit == IBLND_POSTRX_RSRVD_CREDIT)
+			conn->ibc_rx_batch_rsrvd++;
+		return 0;
+	}
+
 	/* NB: need an extra reference after ib_post_recv because we don't
 	 * own this rx (and rx::rx_conn) anymore, LU-5678.
 	 */
@@ -240,6 +251,57 @@ out:
 	return rc;
 }
 
+/* post the rxs queued by kiblnd_post_rx() while batching, and end the batch */
+static void
+kiblnd_post_rx_batch(struct kib_conn *conn)
+{
+	struct ib_recv_wr *wrq = conn->ibc_rx_batch;
+	struct ib_recv_wr *bad_wrq = NULL;
+	int credits = conn->ibc_rx_batch_credits;
+	int rsrvd = conn->ibc_rx_batch_rsrvd;
+	struct kib_rx *rx;
+	int rc;
+
+	conn->ibc_rx_batch = NULL;
+	conn->ibc_rx_batch_tail = &conn->ibc_rx_batch;
+	conn->ibc_rx_batch_credits = 0;
+	conn->ibc_rx_batch_rsrvd = 0;
+	smp_store_release(&conn->ibc_rx_batch_owner, NULL);
+
+	if (wrq == NULL)
+		return;
+
+#ifdef HAVE_IB_POST_SEND_RECV_CONST
+	rc = ib_post_recv(conn->ibc_cmid->qp, wrq,
+			  (const struct ib_recv_wr **)&bad_wrq);
+#else
+	rc = ib_post_recv(conn->ibc_cmid->qp, wrq, &bad_wrq);
+#endif
+	if (unlikely(rc != 0)) {
+		CERROR("Can't post rxs for %s: %d, bad_wrq: %p\n",
+		       libcfs_nid2str(conn->ibc_peer->ibp_nid), rc, bad_wrq);
+		kiblnd_close_conn(conn, rc);
+
+		/* the rxs ahead of bad_wrq were posted */
+		for (wrq = bad_wrq ?: wrq; wrq != NULL; ) {
+			rx = container_of(wrq, struct kib_rx, rx_wrq);
+			wrq = wrq->next;
+			rx->rx_nob = 0;
+			kiblnd_drop_rx(rx);	/* No more posts for this rx */
+		}
+		return;
+	}
+
+	if (credits == 0 && rsrvd == 0)
+		return;
+
+	spin_lock(&conn->ibc_lock);
+	conn->ibc_outstanding_credits += credits;
+	conn->ibc_reserved_credits += rsrvd;
+	kiblnd_check_sends_locked(conn);
+	spin_unlock(&conn->ibc_lock);
+}
+
 static struct kib_tx *
 kiblnd_find_waiting_tx_locked(struct kib_conn *conn, int txtype, u64 cookie)
 {
@@ -3707,6 +3769,52 @@ kiblnd_complete (struct ib_wc *wc)
         }
 }
 
+/*
+ * Adapt the CQ moderation of @conn after a poll which reaped @nwc of at most
+ * @batch work completions: when polls keep filling their batch, completions
+ * arrive faster than one event each can be handled, so let the HCA coalesce
+ * more of them per event, and back off as soon as the load drops to keep
+ * latency low.
+ */
+static void
+kiblnd_cq_moderate(struct kib_conn *conn, int nwc, int batch)
+{
+	int limit = max(*kiblnd_tunables.kib_cq_moderation, 0);
+	int count = conn->ibc_cq_mod_count;
+	int rc;
+
+	if (count < 0)
+		return;
+
+	if (nwc == batch && count < limit) {
+		if (++conn->ibc_cq_busy < IBLND_CQ_MOD_BUSY)
+			return;
+		count = min(max(count * 2, 2), limit);
+	} else if (count > 0 && (nwc == 1 || count > limit)) {
+		count = min(count / 2, limit);
+		if (count < 2)
+			count = 0;
+	} else {
+		if (nwc < batch)
+			conn->ibc_cq_busy = 0;
+		return;
+	}
+
+	conn->ibc_cq_busy = 0;
+	rc = rdma_set_cq_moderation(conn->ibc_cq, count,
+				    count == 0 ? 0 :
+				    clamp(*kiblnd_tunables.kib_cq_moderation_usec,
+					  0, U16_MAX));
+	if (rc != 0) {
+		CDEBUG(D_NET, "%s: can't moderate CQ: rc = %d\n",
+		       libcfs_nid2str(conn->ibc_peer->ibp_nid), rc);
+		conn->ibc_cq_mod_count = -1;
+		return;
+	}
+
+	conn->ibc_cq_mod_count = count;
+}
+
 void
 kiblnd_cq_completion(struct ib_cq *cq, void *arg)
 {
@@ -3756,10 +3864,13 @@ kiblnd_scheduler(void *arg)
 	struct kib_conn	*conn;
 	wait_queue_entry_t      wait;
 	unsigned long		flags;
-	struct ib_wc		wc;
+	struct ib_wc		wcs[IBLND_POLL_BATCH_MAX];
+	bool			batch;
 	int			did_something;
 	int			busy_loops = 0;
+	int			nwc;
 	int			rc;
+	int			i;
 
 	init_waitqueue_entry(&wait, current);
 
@@ -3797,10 +3908,13 @@ kiblnd_scheduler(void *arg)
 
 			spin_unlock_irqrestore(&sched->ibs_lock, flags);
 
-			wc.wr_id = IBLND_WID_INVAL;
+			nwc = clamp(*kiblnd_tunables.kib_poll_batch, 1,
+				    IBLND_POLL_BATCH_MAX);
+			for (i = 0; i < nwc; i++)
+				wcs[i].wr_id = IBLND_WID_INVAL;
 
-                        rc = ib_poll_cq(conn->ibc_cq, 1, &wc);
-                        if (rc == 0) {
+			rc = ib_poll_cq(conn->ibc_cq, nwc, wcs);
+			if (rc == 0) {
                                 rc = ib_req_notify_cq(conn->ibc_cq,
                                                       IB_CQ_NEXT_COMP);
                                 if (rc < 0) {
@@ -3814,20 +3928,25 @@ kiblnd_scheduler(void *arg)
 					continue;
 				}
 
-				rc = ib_poll_cq(conn->ibc_cq, 1, &wc);
+				rc = ib_poll_cq(conn->ibc_cq, nwc, wcs);
 			}
 
-			if (unlikely(rc > 0 && wc.wr_id == IBLND_WID_INVAL)) {
+			for (i = 0; i < rc; i++) {
+				if (likely(wcs[i].wr_id != IBLND_WID_INVAL))
+					continue;
+
 				LCONSOLE_ERROR(
 					"ib_poll_cq (rc: %d) returned invalid "
 					"wr_id, opcode %d, status: %d, "
 					"vendor_err: %d, conn: %s status: %d\n"
 					"please upgrade firmware and OFED or "
 					"contact vendor.\n", rc,
-					wc.opcode, wc.status, wc.vendor_err,
+					wcs[i].opcode, wcs[i].status,
+					wcs[i].vendor_err,
 					libcfs_nid2str(conn->ibc_peer->ibp_nid),
 					conn->ibc_state);
 				rc = -EINVAL;
+				break;
 			}
 
 			if (rc < 0) {
@@ -3859,10 +3978,24 @@ kiblnd_scheduler(void *arg)
 
 			if (rc != 0) {
 				spin_unlock_irqrestore(&sched->ibs_lock, flags);
-				kiblnd_complete(&wc);
+
+				/* Only one scheduler at a time batches the
+				 * reposts and adapts the moderation of a
+				 * conn, others handle theirs as they go */
+				batch = nwc > 1 &&
+					cmpxchg(&conn->ibc_rx_batch_owner,
+						NULL, current) == NULL;
+
+				for (i = 0; i < rc; i++)
+					kiblnd_complete(&wcs[i]);
+
+				if (batch) {
+					kiblnd_cq_moderate(conn, rc, nwc);
+					kiblnd_post_rx_batch(conn);
+				}
 
 				spin_lock_irqsave(&sched->ibs_lock, flags);
-                        }
+			}
 
                         kiblnd_conn_decref(conn); /* ...drop my ref from above */
                         did_something = 1;
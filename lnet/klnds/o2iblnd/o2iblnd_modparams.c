@@ -186,6 +186,20 @@ static unsigned int wrq_sge = 2;
 module_param(wrq_sge, uint, 0444);
 MODULE_PARM_DESC(wrq_sge, "# scatter/gather element per work request");
 
+/* Number of work completions a scheduler reaps per ib_poll_cq(); more than
+ * one also reposts the receive buffers of a batch together */
+static int poll_batch = 1;
+module_param(poll_batch, int, 0644);
+MODULE_PARM_DESC(poll_batch, "# work completions reaped per CQ poll (1-16)");
+
+static int cq_moderation;
+module_param(cq_moderation, int, 0644);
+MODULE_PARM_DESC(cq_moderation, "max # completions coalesced into a CQ event when busy, with poll_batch > 1 (0 to disable)");
+
+static int cq_moderation_usec = 16;
+module_param(cq_moderation_usec, int, 0644);
+MODULE_PARM_DESC(cq_moderation_usec, "max usecs a CQ event is delayed by moderation");
+
 struct kib_tunables kiblnd_tunables = {
         .kib_dev_failover           = &dev_failover,
         .kib_service                = &service,
@@ -201,6 +215,9 @@ struct kib_tunables kiblnd_tunables = {
 	.kib_nscheds		    = &nscheds,
 	.kib_wrq_sge		    = &wrq_sge,
 	.kib_use_fastreg_gaps       = &use_fastreg_gaps,
+	.kib_poll_batch		    = &poll_batch,
+	.kib_cq_moderation	    = &cq_moderation,
+	.kib_cq_moderation_usec	    = &cq_moderation_usec,
 };
 
 static struct lnet_ioctl_config_o2iblnd_tunables default_tunables;
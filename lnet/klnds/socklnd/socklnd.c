@@ -1007,6 +1007,7 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	int rc;
 	int rc2;
 	int active;
+	bool msg_zc = false;
 	char *warn = NULL;
 
         active = (route != NULL);
@@ -1038,6 +1039,12 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	conn->ksnc_tx_carrier = NULL;
 	atomic_set (&conn->ksnc_tx_nob, 0);
 
+	INIT_LIST_HEAD(&conn->ksnc_zc_txs);
+	spin_lock_init(&conn->ksnc_zc_lock);
+	conn->ksnc_zc_scheduled = 0;
+	conn->ksnc_zc_next_id = 0;
+	conn->ksnc_rx_batch = ni->ni_lnd_tunables.lnd_tun_u.lnd_sock.lnd_rx_batch;
+
 	LIBCFS_ALLOC(hello, offsetof(struct ksock_hello_msg,
 				     kshm_ips[LNET_INTERFACES_NUM]));
         if (hello == NULL) {
@@ -1301,6 +1308,11 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
 	LIBCFS_FREE(hello, offsetof(struct ksock_hello_msg,
 				    kshm_ips[LNET_INTERFACES_NUM]));
 
+	/* both HELLOs went out in the clear, everything after them is
+	 * encrypted by the socket if the NI asked for it */
+	if (rc == 0 && ni->ni_lnd_tunables.lnd_tun_u.lnd_sock.lnd_tls)
+		rc = ksocknal_lib_tls_setup(conn, active);
+
         /* setup the socket AFTER I've received hello (it disables
          * SO_LINGER).  I might call back to the acceptor who may want
          * to send a protocol version response and then close the
@@ -1309,10 +1321,22 @@ ksocknal_create_conn(struct lnet_ni *ni, struct ksock_route *route,
         if (rc == 0)
                 rc = ksocknal_lib_setup_sock(sock);
 
+	/* bulk goes out with MSG_ZEROCOPY if the NI asked for it and the
+	 * socket can do it, instead of waiting for ZC-ACKs from the peer;
+	 * kernel TLS sockets don't take MSG_ZEROCOPY */
+	if (rc == 0 && conn->ksnc_zc_capable && !conn->ksnc_tls &&
+	    ni->ni_lnd_tunables.lnd_tun_u.lnd_sock.lnd_zerocopy)
+		msg_zc = ksocknal_lib_msg_zc_setup(conn) == 0;
+
 	write_lock_bh(global_lock);
 
+	conn->ksnc_msg_zc = msg_zc;
+
         /* NB my callbacks block while I hold ksnd_global_lock */
-        ksocknal_lib_set_callback(sock, conn);
+	/* kernel TLS wraps the callbacks it found when it was set up, they
+	 * must stay in place */
+	if (!conn->ksnc_tls)
+		ksocknal_lib_set_callback(sock, conn);
 
         if (!active)
                 peer_ni->ksnp_accepting--;
@@ -1527,6 +1551,19 @@ ksocknal_finalize_zcreq(struct ksock_conn *conn)
 
 	spin_unlock(&peer_ni->ksnp_lock);
 
+	/* MSG_ZEROCOPY sends which the socket never reported complete */
+	spin_lock(&conn->ksnc_zc_lock);
+
+	list_for_each_entry_safe(tx, tmp, &conn->ksnc_zc_txs, tx_zc_list) {
+		LASSERT(tx->tx_zc_ids > 0);
+
+		tx->tx_zc_ids = 0;
+		tx->tx_zc_aborted = 1;
+		list_move(&tx->tx_zc_list, &zlist);
+	}
+
+	spin_unlock(&conn->ksnc_zc_lock);
+
 	while (!list_empty(&zlist)) {
 		tx = list_entry(zlist.next, struct ksock_tx, tx_zc_list);
 
@@ -1624,6 +1661,8 @@ ksocknal_destroy_conn(struct ksock_conn *conn)
 	LASSERT (!conn->ksnc_tx_scheduled);
 	LASSERT (!conn->ksnc_rx_scheduled);
 	LASSERT(list_empty(&conn->ksnc_tx_queue));
+	LASSERT(!conn->ksnc_zc_scheduled);
+	LASSERT(list_empty(&conn->ksnc_zc_txs));
 
         /* complete current receive if any */
         switch (conn->ksnc_rx_state) {
@@ -2291,6 +2330,7 @@ ksocknal_base_startup(void)
 		spin_lock_init(&sched->kss_lock);
 		INIT_LIST_HEAD(&sched->kss_rx_conns);
 		INIT_LIST_HEAD(&sched->kss_tx_conns);
+		INIT_LIST_HEAD(&sched->kss_zc_conns);
 		INIT_LIST_HEAD(&sched->kss_zombie_noop_txs);
 		init_waitqueue_head(&sched->kss_waitq);
         }
@@ -2591,6 +2631,10 @@ ksocknal_startup(struct lnet_ni *ni)
 		net_tunables->lct_peer_rtr_credits =
 			*ksocknal_tunables.ksnd_peerrtrcredits;
 
+	rc = ksocknal_tunables_setup(ni);
+	if (rc != 0)
+		goto fail_1;
+
 	rc = lnet_inet_enumerate(&ifaces, ni->ni_net_ns);
 	if (rc < 0)
 		goto fail_1;
@@ -67,6 +67,9 @@
 #define SOCKNAL_RESCHED		100	/* # scheduler loops before reschedule */
 #define SOCKNAL_INSANITY_RECONN	5000	/* connd is trying on reconn infinitely */
 #define SOCKNAL_ENOMEM_RETRY	1	/* seconds between retries */
+#define KSOCK_TLS_KEY_MIN	16	/* # bytes of the smallest TLS key */
+#define KSOCK_TLS_KEY_MAX	64	/* # bytes of the largest TLS key */
+#define KSOCK_TLS_NONCE_SIZE	32	/* # bytes of each side's TLS nonce */
 
 #define SOCKNAL_SINGLE_FRAG_TX      0	/* disable multi-fragment sends */
 #define SOCKNAL_SINGLE_FRAG_RX      0	/* disable multi-fragment receives */
@@ -88,6 +91,8 @@ struct ksock_sched {
 	/* conn waiting to be written */
 	struct list_head kss_rx_conns;
 	struct list_head kss_tx_conns;
+	/* conns with MSG_ZEROCOPY completions to reap */
+	struct list_head kss_zc_conns;
 	/* zombie noop tx list */
 	struct list_head kss_zombie_noop_txs;
 	/* where scheduler sleeps */
@@ -146,6 +151,11 @@ struct ksock_tunables {
         int              *ksnd_zc_recv;         /* enable ZC receive (for Chelsio TOE) */
         int              *ksnd_zc_recv_min_nfrags; /* minimum # of fragments to enable ZC receive */
         int              *ksnd_irq_affinity;    /* enable IRQ affinity? */
+	int		 *ksnd_msg_zerocopy;	/* MSG_ZEROCOPY bulk sends */
+	int		 *ksnd_rx_batch;	/* # messages received per wakeup */
+	int		 *ksnd_tls;		/* encrypt with kernel TLS */
+	__u8		 *ksnd_tls_key;		/* pre-shared kernel TLS key */
+	int		 *ksnd_tls_key_len;	/* # bytes of ksnd_tls_key */
 #ifdef SOCKNAL_BACKOFF
         int              *ksnd_backoff_init;    /* initial TCP backoff */
         int              *ksnd_backoff_max;     /* maximum TCP backoff */
@@ -249,7 +259,8 @@ struct ksock_proto;				/* forward ref */
 
 struct ksock_tx {			/* transmit packet */
 	struct list_head   tx_list;	/* queue on conn for transmission etc */
-	struct list_head   tx_zc_list;	/* queue on peer_ni for ZC request */
+	struct list_head   tx_zc_list;	/* queue on peer_ni for ZC request,
+					 * or on conn for ZC completion */
 	atomic_t       tx_refcount;    /* tx reference count */
 	int            tx_nob;         /* # packet bytes */
 	int            tx_resid;       /* residual bytes */
@@ -260,6 +271,11 @@ struct ksock_tx {			/* transmit packet */
         unsigned short tx_zc_capable:1; /* payload is large enough for ZC */
         unsigned short tx_zc_checked:1; /* Have I checked if I should ZC? */
         unsigned short tx_nonblk:1;    /* it's a non-blocking ACK */
+	/* MSG_ZEROCOPY sends not yet completed by the socket */
+	int		   tx_zc_ids;
+	/* first and last MSG_ZEROCOPY completion ids of this tx */
+	__u32		   tx_zc_first;
+	__u32		   tx_zc_last;
 	struct bio_vec *tx_kiov;        /* packet page frags */
 	struct ksock_conn *tx_conn;        /* owning conn */
 	struct lnet_msg	  *tx_lnetmsg;	/* lnet message for lnet_finalize() */
@@ -303,6 +319,7 @@ struct ksock_conn {
 	struct socket       *ksnc_sock;		/* actual socket */
 	void                *ksnc_saved_data_ready; /* socket's original data_ready() callback */
 	void                *ksnc_saved_write_space; /* socket's original write_space() callback */
+	void		    *ksnc_saved_error_report; /* socket's original error_report() callback */
 	atomic_t            ksnc_conn_refcount; /* conn refcount */
 	atomic_t            ksnc_sock_refcount; /* sock refcount */
 	struct ksock_sched *ksnc_scheduler;	/* who schedules this connection */
@@ -314,6 +331,9 @@ struct ksock_conn {
 	unsigned int	    ksnc_closing:1;  /* being shut down */
 	unsigned int	    ksnc_flip:1;     /* flip or not, only for V2.x */
 	unsigned int	    ksnc_zc_capable:1; /* enable to ZC */
+	unsigned int	    ksnc_msg_zc:1;   /* bulk sent with MSG_ZEROCOPY */
+	unsigned int	    ksnc_tls:1;      /* encrypted by kernel TLS */
+	unsigned int	    ksnc_tls_keying:1; /* kernel TLS being set up */
 	const struct ksock_proto *ksnc_proto; /* protocol for the connection */
 
 	/* READER */
@@ -361,6 +381,20 @@ struct ksock_conn {
 	int			ksnc_tx_scheduled;
 	/* time stamp of the last posted TX */
 	time64_t		ksnc_tx_last_post;
+
+	/* -- MSG_ZEROCOPY -- */
+	/* chain on kss_zc_conns */
+	struct list_head	ksnc_zc_list;
+	/* completions being reaped */
+	int			ksnc_zc_scheduled;
+	/* txs waiting for their MSG_ZEROCOPY completions */
+	struct list_head	ksnc_zc_txs;
+	/* serialise ksnc_zc_txs, sched lock unsafe */
+	spinlock_t		ksnc_zc_lock;
+	/* id the socket will give the next MSG_ZEROCOPY send */
+	__u32			ksnc_zc_next_id;
+	/* max # messages received before yielding to other conns */
+	int			ksnc_rx_batch;
 };
 
 struct ksock_route {
@@ -483,6 +517,11 @@ ksocknal_conn_addref(struct ksock_conn *conn)
 
 extern void ksocknal_queue_zombie_conn(struct ksock_conn *conn);
 extern void ksocknal_finalize_zcreq(struct ksock_conn *conn);
+extern void ksocknal_zc_track(struct ksock_conn *conn, struct ksock_tx *tx,
+			      __u32 id);
+extern void ksocknal_zc_untrack(struct ksock_conn *conn, struct ksock_tx *tx);
+extern void ksocknal_zc_complete(struct ksock_conn *conn, __u32 lo, __u32 hi);
+extern void ksocknal_zc_callback(struct ksock_conn *conn);
 
 static inline void
 ksocknal_conn_decref(struct ksock_conn *conn)
@@ -508,13 +547,15 @@ ksocknal_connsock_addref(struct ksock_conn *conn)
 	return (rc);
 }
 
+void ksocknal_lib_release_sock(struct ksock_conn *conn);
+
 static inline void
 ksocknal_connsock_decref(struct ksock_conn *conn)
 {
 	LASSERT(atomic_read(&conn->ksnc_sock_refcount) > 0);
 	if (atomic_dec_and_test(&conn->ksnc_sock_refcount)) {
 		LASSERT (conn->ksnc_closing);
-		sock_release(conn->ksnc_sock);
+		ksocknal_lib_release_sock(conn);
 		conn->ksnc_sock = NULL;
 		ksocknal_finalize_zcreq(conn);
 	}
@@ -638,6 +679,9 @@ extern void ksocknal_lib_reset_callback(struct socket *sock,
 extern void ksocknal_lib_push_conn(struct ksock_conn *conn);
 extern int ksocknal_lib_get_conn_addrs(struct ksock_conn *conn);
 extern int ksocknal_lib_setup_sock(struct socket *so);
+extern int ksocknal_lib_msg_zc_setup(struct ksock_conn *conn);
+extern void ksocknal_lib_zc_reap(struct ksock_conn *conn);
+extern int ksocknal_lib_tls_setup(struct ksock_conn *conn, int active);
 extern int ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx,
 				 struct kvec *scratch_iov);
 extern int ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
@@ -651,6 +695,7 @@ extern int ksocknal_lib_get_conn_tunables(struct ksock_conn *conn, int *txmem,
 					  int *rxmem, int *nagle);
 
 extern int ksocknal_tunables_init(void);
+extern int ksocknal_tunables_setup(struct lnet_ni *ni);
 
 extern void ksocknal_lib_csum_tx(struct ksock_tx *tx);
 
@@ -57,6 +57,7 @@ ksocknal_alloc_tx(int type, int size)
 	tx->tx_zc_aborted = 0;
 	tx->tx_zc_capable = 0;
 	tx->tx_zc_checked = 0;
+	tx->tx_zc_ids = 0;
 	tx->tx_hstatus = LNET_MSG_STATUS_OK;
 	tx->tx_desc_size  = size;
 
@@ -484,6 +485,11 @@ ksocknal_check_zc_req(struct ksock_tx *tx)
             !conn->ksnc_zc_capable)
                 return;
 
+	/* MSG_ZEROCOPY sends are completed by the local socket, see
+	 * ksocknal_zc_complete() */
+	if (conn->ksnc_msg_zc)
+		return;
+
         /* assign cookie and queue tx to pending list, it will be released when
          * a matching ack is received. See ksocknal_handle_zcack() */
 
@@ -533,6 +539,89 @@ ksocknal_uncheck_zc_req(struct ksock_tx *tx)
 	ksocknal_tx_decref(tx);
 }
 
+/*
+ * Pin \a tx until the socket reports MSG_ZEROCOPY send \a id complete.
+ * This is called before the send is posted, since the completion can be
+ * reaped by another scheduler before sock_sendmsg() returns.
+ */
+void
+ksocknal_zc_track(struct ksock_conn *conn, struct ksock_tx *tx, __u32 id)
+{
+	spin_lock(&conn->ksnc_zc_lock);
+
+	if (tx->tx_zc_ids == 0) {
+		ksocknal_tx_addref(tx);
+		tx->tx_zc_first = id;
+		list_add_tail(&tx->tx_zc_list, &conn->ksnc_zc_txs);
+	}
+
+	tx->tx_zc_last = id;
+	tx->tx_zc_ids++;
+
+	spin_unlock(&conn->ksnc_zc_lock);
+}
+
+/* The send tracked last didn't go out, so no completion will come for it */
+void
+ksocknal_zc_untrack(struct ksock_conn *conn, struct ksock_tx *tx)
+{
+	bool done;
+
+	spin_lock(&conn->ksnc_zc_lock);
+
+	LASSERT(tx->tx_zc_ids > 0);
+	tx->tx_zc_last--;
+	done = --tx->tx_zc_ids == 0;
+	if (done)
+		list_del(&tx->tx_zc_list);
+
+	spin_unlock(&conn->ksnc_zc_lock);
+
+	if (done)
+		ksocknal_tx_decref(tx);
+}
+
+/*
+ * The socket has finished with MSG_ZEROCOPY sends \a lo to \a hi, the
+ * txs which have no more sends in flight can complete.  Ids wrap, and a
+ * tx's sends always have consecutive ids because the conn sends one tx
+ * at a time.
+ */
+void
+ksocknal_zc_complete(struct ksock_conn *conn, __u32 lo, __u32 hi)
+{
+	struct ksock_tx *tx;
+	struct ksock_tx *tmp;
+	LIST_HEAD(zlist);
+
+	spin_lock(&conn->ksnc_zc_lock);
+
+	list_for_each_entry_safe(tx, tmp, &conn->ksnc_zc_txs, tx_zc_list) {
+		__u32 first = (__s32)(lo - tx->tx_zc_first) > 0 ?
+			      lo : tx->tx_zc_first;
+		__u32 last = (__s32)(hi - tx->tx_zc_last) < 0 ?
+			     hi : tx->tx_zc_last;
+
+		if ((__s32)(last - first) < 0)
+			continue;
+
+		tx->tx_zc_ids -= last - first + 1;
+		LASSERT(tx->tx_zc_ids >= 0);
+
+		if (tx->tx_zc_ids == 0)
+			list_move(&tx->tx_zc_list, &zlist);
+	}
+
+	spin_unlock(&conn->ksnc_zc_lock);
+
+	while (!list_empty(&zlist)) {
+		tx = list_entry(zlist.next, struct ksock_tx, tx_zc_list);
+
+		list_del(&tx->tx_zc_list);
+		ksocknal_tx_decref(tx);
+	}
+}
+
 static int
 ksocknal_process_transmit(struct ksock_conn *conn, struct ksock_tx *tx,
 			  struct kvec *scratch_iov)
@@ -1450,7 +1539,8 @@ ksocknal_sched_cansleep(struct ksock_sched *sched)
 
 	rc = (!ksocknal_data.ksnd_shuttingdown &&
 	      list_empty(&sched->kss_rx_conns) &&
-	      list_empty(&sched->kss_tx_conns));
+	      list_empty(&sched->kss_tx_conns) &&
+	      list_empty(&sched->kss_zc_conns));
 
 	spin_unlock_bh(&sched->kss_lock);
 	return rc;
@@ -1462,6 +1552,7 @@ int ksocknal_scheduler(void *arg)
 	struct ksock_conn *conn;
 	struct ksock_tx	*tx;
 	int rc;
+	int n;
 	int nloops = 0;
 	long id = (long)arg;
 	struct page **rx_scratch_pgs;
@@ -1511,8 +1602,16 @@ int ksocknal_scheduler(void *arg)
 			conn->ksnc_rx_ready = 0;
 			spin_unlock_bh(&sched->kss_lock);
 
-			rc = ksocknal_process_receive(conn, rx_scratch_pgs,
-						      scratch_iov);
+			/* Take up to ksnc_rx_batch messages off the socket
+			 * before requeueing the conn behind the others,
+			 * stopping if lnet_parse() deferred the receive */
+			n = 0;
+			do {
+				rc = ksocknal_process_receive(conn,
+							      rx_scratch_pgs,
+							      scratch_iov);
+			} while (rc == 0 && ++n < conn->ksnc_rx_batch &&
+				 conn->ksnc_rx_state != SOCKNAL_RX_PARSE);
 
 			spin_lock_bh(&sched->kss_lock);
 
@@ -1608,6 +1707,26 @@ int ksocknal_scheduler(void *arg)
 
 			did_something = 1;
 		}
+
+		if (!list_empty(&sched->kss_zc_conns)) {
+			conn = list_entry(sched->kss_zc_conns.next,
+					  struct ksock_conn, ksnc_zc_list);
+			list_del(&conn->ksnc_zc_list);
+
+			/* Clear it BEFORE reaping, the socket can report
+			 * more completions any time after kss_lock is
+			 * released. */
+			conn->ksnc_zc_scheduled = 0;
+			spin_unlock_bh(&sched->kss_lock);
+
+			ksocknal_lib_zc_reap(conn);
+			/* drop the ref ksocknal_zc_callback() took */
+			ksocknal_conn_decref(conn);
+
+			spin_lock_bh(&sched->kss_lock);
+			did_something = 1;
+		}
+
 		if (!did_something ||           /* nothing to do */
 		    ++nloops == SOCKNAL_RESCHED) { /* hogging CPU? */
 			spin_unlock_bh(&sched->kss_lock);
@@ -1693,6 +1812,28 @@ void ksocknal_write_callback(struct ksock_conn *conn)
 	EXIT;
 }
 
+/*
+ * The socket has MSG_ZEROCOPY completions on its error queue; add the
+ * connection to kss_zc_conns of its scheduler to reap them.
+ */
+void ksocknal_zc_callback(struct ksock_conn *conn)
+{
+	struct ksock_sched *sched = conn->ksnc_scheduler;
+
+	spin_lock_bh(&sched->kss_lock);
+
+	if (!conn->ksnc_zc_scheduled) {
+		list_add_tail(&conn->ksnc_zc_list, &sched->kss_zc_conns);
+		conn->ksnc_zc_scheduled = 1;
+		/* extra ref for scheduler */
+		ksocknal_conn_addref(conn);
+
+		wake_up(&sched->kss_waitq);
+	}
+
+	spin_unlock_bh(&sched->kss_lock);
+}
+
 static const struct ksock_proto *
 ksocknal_parse_proto_version(struct ksock_hello_msg *hello)
 {
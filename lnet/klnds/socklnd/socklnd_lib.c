@@ -30,6 +30,15 @@
  * Lustre is a trademark of Sun Microsystems, Inc.
  */
 
+#ifdef HAVE_SOCK_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
+#ifdef HAVE_SOCK_KTLS
+#include <crypto/hash.h>
+#include <linux/random.h>
+#include <linux/tls.h>
+#endif
+
 #include "socklnd.h"
 
 int
@@ -112,6 +121,52 @@ ksocknal_lib_send_iov(struct ksock_conn *conn, struct ksock_tx *tx,
 	return rc;
 }
 
+#ifdef HAVE_SOCK_ZEROCOPY
+/*
+ * Send the remaining pages of \a tx with a single MSG_ZEROCOPY sendmsg.
+ * The socket references the pages rather than copying them, and queues a
+ * completion on its error queue once it is done with them.  Handing all
+ * the pages to TCP at once also lets it build full sized segments, which
+ * the receiver can coalesce with GRO.
+ */
+static int
+ksocknal_lib_send_kiov_zc(struct ksock_conn *conn, struct ksock_tx *tx)
+{
+	struct msghdr msg = { .msg_flags = MSG_DONTWAIT | MSG_ZEROCOPY };
+	__u32 id = conn->ksnc_zc_next_id;
+	int nob = 0;
+	int rc;
+	int i;
+
+	for (i = 0; i < tx->tx_nkiov; i++)
+		nob += tx->tx_kiov[i].bv_len;
+
+	if (!list_empty(&conn->ksnc_tx_queue) ||
+	    nob < tx->tx_resid)
+		msg.msg_flags |= MSG_MORE;
+
+#ifdef HAVE_IOV_ITER_TYPE
+	iov_iter_bvec(&msg.msg_iter, WRITE, tx->tx_kiov, tx->tx_nkiov, nob);
+#else
+	iov_iter_bvec(&msg.msg_iter, ITER_BVEC | WRITE, tx->tx_kiov,
+		      tx->tx_nkiov, nob);
+#endif
+
+	ksocknal_zc_track(conn, tx, id);
+
+	/* Each sendmsg which sends anything uses up one completion id.
+	 * Scheduler threads have CAP_IPC_LOCK, so the pages aren't charged
+	 * to a locked memory limit. */
+	rc = sock_sendmsg(conn->ksnc_sock, &msg);
+	if (rc > 0)
+		conn->ksnc_zc_next_id++;
+	else
+		ksocknal_zc_untrack(conn, tx);
+
+	return rc;
+}
+#endif
+
 int
 ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
 		       struct kvec *scratchiov)
@@ -124,6 +179,11 @@ ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
 	/* Not NOOP message */
 	LASSERT(tx->tx_lnetmsg != NULL);
 
+#ifdef HAVE_SOCK_ZEROCOPY
+	if (conn->ksnc_msg_zc && tx->tx_zc_capable)
+		return ksocknal_lib_send_kiov_zc(conn, tx);
+#endif
+
 	/* NB we can't trust socket ops to either consume our iovs
 	 * or leave them alone. */
 	if (tx->tx_msg.ksm_zc_cookies[0] != 0) {
@@ -179,6 +239,212 @@ ksocknal_lib_send_kiov(struct ksock_conn *conn, struct ksock_tx *tx,
 	return rc;
 }
 
+int
+ksocknal_lib_msg_zc_setup(struct ksock_conn *conn)
+{
+#ifdef HAVE_SOCK_ZEROCOPY
+	int opt = 1;
+	int rc;
+
+	rc = kernel_setsockopt(conn->ksnc_sock, SOL_SOCKET, SO_ZEROCOPY,
+			       (char *)&opt, sizeof(opt));
+	if (rc != 0)
+		CWARN("Can't enable MSG_ZEROCOPY to %pI4h, using ZC-ACK: %d\n",
+		      &conn->ksnc_ipaddr, rc);
+	return rc;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
+/*
+ * Complete the MSG_ZEROCOPY sends the socket has reported done on its
+ * error queue.  Each report covers a range of ids, several sends may be
+ * reported at once.
+ */
+void
+ksocknal_lib_zc_reap(struct ksock_conn *conn)
+{
+#ifdef HAVE_SOCK_ZEROCOPY
+	struct sock_exterr_skb *serr;
+	struct sk_buff *skb;
+
+	/* the socket is gone, ksocknal_finalize_zcreq() aborts the txs */
+	if (ksocknal_connsock_addref(conn) != 0)
+		return;
+
+	while ((skb = sock_dequeue_err_skb(conn->ksnc_sock->sk)) != NULL) {
+		serr = SKB_EXT_ERR(skb);
+
+		/* real errors are also set in sk_err, and seen by the next
+		 * send or receive */
+		if (serr->ee.ee_errno == 0 &&
+		    serr->ee.ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+			if (serr->ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				CDEBUG(D_NET, "%pI4h: zero copy sends %u-%u were copied\n",
+				       &conn->ksnc_ipaddr, serr->ee.ee_info,
+				       serr->ee.ee_data);
+
+			ksocknal_zc_complete(conn, serr->ee.ee_info,
+					     serr->ee.ee_data);
+		}
+
+		kfree_skb(skb);
+	}
+
+	ksocknal_connsock_decref(conn);
+#endif
+}
+
+#ifdef HAVE_SOCK_KTLS
+/*
+ * Derive the key, salt and IV of one direction of a connection from the
+ * pre-shared key and the nonces both sides sent:
+ * HMAC-SHA256(tls_key, "lnet tls" | active nonce | passive nonce | dir)
+ */
+static int
+ksocknal_lib_tls_derive(__u8 *nonces, __u8 dir,
+			struct tls12_crypto_info_aes_gcm_128 *ci)
+{
+	static const char label[] = "lnet tls";
+	struct crypto_shash *tfm;
+	__u8 out[32];
+	int rc;
+
+	tfm = crypto_alloc_shash("hmac(sha256)", 0, 0);
+	if (IS_ERR(tfm))
+		return PTR_ERR(tfm);
+
+	rc = crypto_shash_setkey(tfm, ksocknal_tunables.ksnd_tls_key,
+				 *ksocknal_tunables.ksnd_tls_key_len);
+	if (rc == 0) {
+		SHASH_DESC_ON_STACK(desc, tfm);
+
+		desc->tfm = tfm;
+		rc = crypto_shash_init(desc) ?:
+		     crypto_shash_update(desc, (const __u8 *)label,
+					     sizeof(label) - 1) ?:
+		     crypto_shash_update(desc, nonces,
+					 2 * KSOCK_TLS_NONCE_SIZE) ?:
+		     crypto_shash_update(desc, &dir, sizeof(dir)) ?:
+		     crypto_shash_final(desc, out);
+		shash_desc_zero(desc);
+	}
+	crypto_free_shash(tfm);
+	if (rc != 0)
+		return rc;
+
+	BUILD_BUG_ON(TLS_CIPHER_AES_GCM_128_KEY_SIZE +
+		     TLS_CIPHER_AES_GCM_128_SALT_SIZE +
+		     TLS_CIPHER_AES_GCM_128_IV_SIZE > sizeof(out));
+
+	memset(ci, 0, sizeof(*ci));
+	ci->info.version = TLS_1_2_VERSION;
+	ci->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+	memcpy(ci->key, out, TLS_CIPHER_AES_GCM_128_KEY_SIZE);
+	memcpy(ci->salt, out + TLS_CIPHER_AES_GCM_128_KEY_SIZE,
+	       TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+	memcpy(ci->iv, out + TLS_CIPHER_AES_GCM_128_KEY_SIZE +
+	       TLS_CIPHER_AES_GCM_128_SALT_SIZE,
+	       TLS_CIPHER_AES_GCM_128_IV_SIZE);
+	memzero_explicit(out, sizeof(out));
+
+	return 0;
+}
+
+static int
+ksocknal_lib_tls_setsockopt(struct socket *sock, int level, int optname,
+			    void *optval, unsigned int optlen)
+{
+#ifdef HAVE_SOCK_KTLS_SOCKPTR
+	return sock->ops->setsockopt(sock, level, optname,
+				     KERNEL_SOCKPTR(optval), optlen);
+#else
+	return kernel_setsockopt(sock, level, optname, optval, optlen);
+#endif
+}
+#endif
+
+/*
+ * Switch the socket of a newly connected conn to kernel TLS, so the socket
+ * encrypts everything sent after the HELLOs with AES-GCM.  There is no TLS
+ * handshake: both sides exchange random nonces in the clear, and derive
+ * fresh keys for each direction from them and the pre-shared tls_key.
+ * Nodes must agree on using TLS, a mismatch fails the first message.
+ *
+ * Our socket callbacks are installed before kernel TLS, which wraps them:
+ * data_ready is only called once a whole record can be decrypted, and
+ * write_space once TLS pushed the records it held back.
+ */
+int
+ksocknal_lib_tls_setup(struct ksock_conn *conn, int active)
+{
+#ifdef HAVE_SOCK_KTLS
+	struct tls12_crypto_info_aes_gcm_128 ci;
+	struct socket *sock = conn->ksnc_sock;
+	__u8 nonces[2 * KSOCK_TLS_NONCE_SIZE];
+	__u8 *mine = active ? nonces : nonces + KSOCK_TLS_NONCE_SIZE;
+	__u8 *theirs = active ? nonces + KSOCK_TLS_NONCE_SIZE : nonces;
+	bool ulp = false;
+	int rc;
+
+	get_random_bytes(mine, KSOCK_TLS_NONCE_SIZE);
+
+	rc = lnet_sock_write(sock, mine, KSOCK_TLS_NONCE_SIZE,
+			     lnet_acceptor_timeout());
+	if (rc == 0)
+		rc = lnet_sock_read(sock, theirs, KSOCK_TLS_NONCE_SIZE,
+				    lnet_acceptor_timeout());
+	if (rc != 0) {
+		CERROR("Can't exchange TLS nonces with %pI4h: %d\n",
+		       &conn->ksnc_ipaddr, rc);
+		return rc;
+	}
+
+	/* the callbacks don't start any I/O until the keys are set,
+	 * ksocknal_create_conn() does once the conn is ready */
+	write_lock_bh(&ksocknal_data.ksnd_global_lock);
+	conn->ksnc_tls_keying = 1;
+	ksocknal_lib_set_callback(sock, conn);
+	write_unlock_bh(&ksocknal_data.ksnd_global_lock);
+
+	rc = ksocknal_lib_tls_setsockopt(sock, SOL_TCP, TCP_ULP, "tls",
+					 sizeof("tls"));
+	if (rc != 0) {
+		CERROR("Can't enable kernel TLS to %pI4h: %d\n",
+		       &conn->ksnc_ipaddr, rc);
+		goto out;
+	}
+	ulp = true;
+
+	/* the active side transmits with the keys of direction 0 */
+	rc = ksocknal_lib_tls_derive(nonces, !active, &ci);
+	if (rc == 0)
+		rc = ksocknal_lib_tls_setsockopt(sock, SOL_TLS, TLS_TX, &ci,
+						 sizeof(ci));
+	if (rc == 0)
+		rc = ksocknal_lib_tls_derive(nonces, !!active, &ci);
+	if (rc == 0)
+		rc = ksocknal_lib_tls_setsockopt(sock, SOL_TLS, TLS_RX, &ci,
+						 sizeof(ci));
+	memzero_explicit(&ci, sizeof(ci));
+	if (rc != 0)
+		CERROR("Can't set kernel TLS keys to %pI4h: %d\n",
+		       &conn->ksnc_ipaddr, rc);
+out:
+	write_lock_bh(&ksocknal_data.ksnd_global_lock);
+	conn->ksnc_tls_keying = 0;
+	/* set even if the keys failed, the socket is wrapped all the same
+	 * and the conn is about to be closed */
+	conn->ksnc_tls = ulp;
+	write_unlock_bh(&ksocknal_data.ksnd_global_lock);
+
+	return rc;
+#else
+	return -EOPNOTSUPP;
+#endif
+}
+
 void
 ksocknal_lib_eager_ack(struct ksock_conn *conn)
 {
@@ -630,14 +896,17 @@ ksocknal_data_ready(struct sock *sk, int n)
 
 	conn = sk->sk_user_data;
 	if (conn == NULL) {	/* raced with ksocknal_terminate_conn */
-		LASSERT(sk->sk_data_ready != &ksocknal_data_ready);
+		/* or kernel TLS put us back while the socket was released,
+		 * until ksocknal_lib_release_sock() replaces us */
+		if (sk->sk_data_ready != &ksocknal_data_ready)
 #ifdef HAVE_SK_DATA_READY_ONE_ARG
-		sk->sk_data_ready(sk);
+			sk->sk_data_ready(sk);
 #else
-		sk->sk_data_ready(sk, n);
+			sk->sk_data_ready(sk, n);
 #endif
-	} else
+	} else if (!conn->ksnc_tls_keying) {
 		ksocknal_read_callback(conn);
+	}
 
 	read_unlock(&ksocknal_data.ksnd_global_lock);
 
@@ -669,13 +938,19 @@ ksocknal_write_space (struct sock *sk)
                                       " empty" : " queued"));
 
         if (conn == NULL) {             /* raced with ksocknal_terminate_conn */
-                LASSERT (sk->sk_write_space != &ksocknal_write_space);
-                sk->sk_write_space (sk);
+		/* see ksocknal_data_ready() */
+		if (sk->sk_write_space != &ksocknal_write_space)
+			sk->sk_write_space(sk);
 
 		read_unlock(&ksocknal_data.ksnd_global_lock);
                 return;
         }
 
+	if (conn->ksnc_tls_keying) {
+		read_unlock(&ksocknal_data.ksnd_global_lock);
+		return;
+	}
+
         if (wspace >= min_wpace) {              /* got enough space */
                 ksocknal_write_callback(conn);
 
@@ -689,11 +964,39 @@ ksocknal_write_space (struct sock *sk)
 	read_unlock(&ksocknal_data.ksnd_global_lock);
 }
 
+#ifdef HAVE_SOCK_ZEROCOPY
+static void
+ksocknal_error_report(struct sock *sk)
+{
+	struct ksock_conn *conn;
+	void (*error_report)(struct sock *sk);
+
+	/* interleave correctly with closing sockets... */
+	LASSERT(!in_irq());
+	read_lock(&ksocknal_data.ksnd_global_lock);
+
+	conn = sk->sk_user_data;
+	if (conn == NULL) {	/* raced with ksocknal_terminate_conn */
+		LASSERT(sk->sk_error_report != &ksocknal_error_report);
+		sk->sk_error_report(sk);
+	} else {
+		error_report = conn->ksnc_saved_error_report;
+		error_report(sk);
+
+		/* MSG_ZEROCOPY completions are reaped by the scheduler */
+		ksocknal_zc_callback(conn);
+	}
+
+	read_unlock(&ksocknal_data.ksnd_global_lock);
+}
+#endif
+
 void
 ksocknal_lib_save_callback(struct socket *sock, struct ksock_conn *conn)
 {
         conn->ksnc_saved_data_ready = sock->sk->sk_data_ready;
         conn->ksnc_saved_write_space = sock->sk->sk_write_space;
+	conn->ksnc_saved_error_report = sock->sk->sk_error_report;
 }
 
 void
@@ -702,6 +1005,10 @@ ksocknal_lib_set_callback(struct socket *sock,  struct ksock_conn *conn)
         sock->sk->sk_user_data = conn;
         sock->sk->sk_data_ready = ksocknal_data_ready;
         sock->sk->sk_write_space = ksocknal_write_space;
+#ifdef HAVE_SOCK_ZEROCOPY
+	if (conn->ksnc_msg_zc)
+		sock->sk->sk_error_report = ksocknal_error_report;
+#endif
 }
 
 void
@@ -712,6 +1019,7 @@ ksocknal_lib_reset_callback(struct socket *sock, struct ksock_conn *conn)
          * since the socket could survive past this module being unloaded!! */
         sock->sk->sk_data_ready = conn->ksnc_saved_data_ready;
         sock->sk->sk_write_space = conn->ksnc_saved_write_space;
+	sock->sk->sk_error_report = conn->ksnc_saved_error_report;
 
         /* A callback could be in progress already; they hold a read lock
          * on ksnd_global_lock (to serialise with me) and NOOP if
@@ -721,6 +1029,31 @@ ksocknal_lib_reset_callback(struct socket *sock, struct ksock_conn *conn)
         return ;
 }
 
+void
+ksocknal_lib_release_sock(struct ksock_conn *conn)
+{
+	struct socket *sock = conn->ksnc_sock;
+	struct sock *sk = sock->sk;
+
+	if (!conn->ksnc_tls) {
+		sock_release(sock);
+		return;
+	}
+
+	/* Closing kernel TLS puts back the callbacks it wrapped, which are
+	 * ours, and the socket could survive past this module being
+	 * unloaded. */
+	sock_hold(sk);
+	sock_release(sock);
+	write_lock_bh(&sk->sk_callback_lock);
+	if (sk->sk_data_ready == ksocknal_data_ready)
+		sk->sk_data_ready = conn->ksnc_saved_data_ready;
+	if (sk->sk_write_space == ksocknal_write_space)
+		sk->sk_write_space = conn->ksnc_saved_write_space;
+	write_unlock_bh(&sk->sk_callback_lock);
+	sock_put(sk);
+}
+
 int
 ksocknal_lib_memory_pressure(struct ksock_conn *conn)
 {
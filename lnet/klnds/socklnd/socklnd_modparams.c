@@ -142,6 +142,25 @@ static unsigned int zc_recv_min_nfrags = 16;
 module_param(zc_recv_min_nfrags, int, 0644);
 MODULE_PARM_DESC(zc_recv_min_nfrags, "minimum # of fragments to enable ZC recv");
 
+static int msg_zerocopy;
+module_param(msg_zerocopy, int, 0444);
+MODULE_PARM_DESC(msg_zerocopy, "send bulk with MSG_ZEROCOPY instead of ZC-ACK");
+
+static int rx_batch = 1;
+module_param(rx_batch, int, 0444);
+MODULE_PARM_DESC(rx_batch, "# messages received per connection per scheduler pass");
+
+static int tls;
+module_param(tls, int, 0444);
+MODULE_PARM_DESC(tls, "encrypt connections with kernel TLS");
+
+static char *tls_key = "";
+module_param(tls_key, charp, 0400);
+MODULE_PARM_DESC(tls_key, "kernel TLS pre-shared key, 32-128 hex digits, the same on all nodes");
+
+static __u8 tls_key_bin[KSOCK_TLS_KEY_MAX];
+static int tls_key_len;
+
 #ifdef SOCKNAL_BACKOFF
 static int backoff_init = 3;
 module_param(backoff_init, int, 0644);
@@ -201,6 +220,11 @@ int ksocknal_tunables_init(void)
 	ksocknal_tunables.ksnd_zc_min_payload     = &zc_min_payload;
 	ksocknal_tunables.ksnd_zc_recv            = &zc_recv;
 	ksocknal_tunables.ksnd_zc_recv_min_nfrags = &zc_recv_min_nfrags;
+	ksocknal_tunables.ksnd_msg_zerocopy       = &msg_zerocopy;
+	ksocknal_tunables.ksnd_rx_batch           = &rx_batch;
+	ksocknal_tunables.ksnd_tls                = &tls;
+	ksocknal_tunables.ksnd_tls_key            = tls_key_bin;
+	ksocknal_tunables.ksnd_tls_key_len        = &tls_key_len;
 
 	if (enable_irq_affinity) {
 		CWARN("irq_affinity is removed from socklnd because modern "
@@ -228,5 +252,69 @@ int ksocknal_tunables_init(void)
 	if (!is_native_host())
 		*ksocknal_tunables.ksnd_zc_min_payload = (16 << 20) + 1;
 
+	if (*ksocknal_tunables.ksnd_rx_batch < 1)
+		*ksocknal_tunables.ksnd_rx_batch = 1;
+
+	tls_key_len = strlen(tls_key) / 2;
+	if (tls_key_len != 0 &&
+	    (strlen(tls_key) % 2 != 0 || tls_key_len < KSOCK_TLS_KEY_MIN ||
+	     tls_key_len > KSOCK_TLS_KEY_MAX ||
+	     hex2bin(tls_key_bin, tls_key, tls_key_len) != 0)) {
+		CERROR("tls_key must be %d to %d hex digits\n",
+		       KSOCK_TLS_KEY_MIN * 2, KSOCK_TLS_KEY_MAX * 2);
+		tls_key_len = 0;
+	}
+
 	return 0;
 };
+
+#define CURRENT_LND_VERSION 1
+
+int
+ksocknal_tunables_setup(struct lnet_ni *ni)
+{
+	struct lnet_ioctl_config_socklnd_tunables *tunables;
+
+	tunables = &ni->ni_lnd_tunables.lnd_tun_u.lnd_sock;
+
+	/* if there was no tunables specified, use the module defaults;
+	 * lnetctl leaves the version zero when only the common tunables
+	 * were given */
+	if (!ni->ni_lnd_tunables_set || tunables->lnd_version == 0) {
+		tunables->lnd_zerocopy = !!msg_zerocopy;
+		tunables->lnd_rx_batch = 0;
+		tunables->lnd_tls = !!tls;
+	}
+
+	/* Current API version */
+	tunables->lnd_version = CURRENT_LND_VERSION;
+
+#ifndef HAVE_SOCK_ZEROCOPY
+	if (tunables->lnd_zerocopy) {
+		CWARN("%s: MSG_ZEROCOPY is not supported by this kernel\n",
+		      libcfs_net2str(LNET_NIDNET(ni->ni_nid)));
+		tunables->lnd_zerocopy = 0;
+	}
+#endif
+
+	if (tunables->lnd_rx_batch == 0)
+		tunables->lnd_rx_batch = *ksocknal_tunables.ksnd_rx_batch;
+
+	/* unlike the other tunables, don't quietly fall back to sending in
+	 * the clear */
+	if (tunables->lnd_tls) {
+#ifndef HAVE_SOCK_KTLS
+		CERROR("%s: kernel TLS is not supported by this kernel\n",
+		       libcfs_net2str(LNET_NIDNET(ni->ni_nid)));
+		return -EOPNOTSUPP;
+#else
+		if (tls_key_len == 0) {
+			CERROR("%s: kernel TLS needs the tls_key parameter\n",
+			       libcfs_net2str(LNET_NIDNET(ni->ni_nid)));
+			return -EINVAL;
+		}
+#endif
+	}
+
+	return 0;
+}
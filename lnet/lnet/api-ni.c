@@ -933,6 +933,8 @@ lnet_counters_get(struct lnet_counters *counters)
 				ctr->lct_health.lch_network_timeout_count;
 	}
 	lnet_net_unlock(LNET_LOCK_EX);
+
+	lnet_arena_counters_get(&counters->lct_arena);
 }
 EXPORT_SYMBOL(lnet_counters_get);
 
@@ -948,6 +950,8 @@ lnet_counters_reset(void)
 		memset(counters, 0, sizeof(struct lnet_counters));
 
 	lnet_net_unlock(LNET_LOCK_EX);
+
+	lnet_arena_counters_reset();
 }
 
 static char *
@@ -3774,19 +3778,22 @@ LNetCtl(unsigned int cmd, void *arg)
 	}
 
 	case IOC_LIBCFS_GET_BUF: {
-		struct lnet_ioctl_pool_cfg *pool_cfg;
-		size_t total = sizeof(*config) + sizeof(*pool_cfg);
+		struct lnet_ioctl_pool_cfg pool_cfg = { { { 0 } } };
+		size_t size = sizeof(pool_cfg);
 
 		config = arg;
 
-		if (config->cfg_hdr.ioc_len < total)
+		/* older tools only know the fields up to pl_routing */
+		if (config->cfg_hdr.ioc_len < sizeof(*config) + size)
+			size = offsetof(struct lnet_ioctl_pool_cfg,
+					pl_ext_flags);
+		if (config->cfg_hdr.ioc_len < sizeof(*config) + size)
 			return -EINVAL;
 
-		pool_cfg = (struct lnet_ioctl_pool_cfg *)config->cfg_bulk;
-
 		mutex_lock(&the_lnet.ln_api_mutex);
-		rc = lnet_get_rtr_pool_cfg(config->cfg_count, pool_cfg);
+		rc = lnet_get_rtr_pool_cfg(config->cfg_count, &pool_cfg);
 		mutex_unlock(&the_lnet.ln_api_mutex);
+		memcpy(config->cfg_bulk, &pool_cfg, size);
 		return rc;
 	}
 
@@ -3826,7 +3833,8 @@ LNetCtl(unsigned int cmd, void *arg)
 		mutex_lock(&the_lnet.ln_api_mutex);
 		rc = lnet_add_peer_ni(cfg->prcfg_prim_nid,
 				      cfg->prcfg_cfg_nid,
-				      cfg->prcfg_mr);
+				      cfg->prcfg_mr,
+				      cfg->prcfg_state & LNET_PEER_ADD_SEED);
 		mutex_unlock(&the_lnet.ln_api_mutex);
 		return rc;
 	}
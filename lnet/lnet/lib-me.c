@@ -85,7 +85,7 @@ LNetMEAttach(unsigned int portal,
 	if (mtable == NULL) /* can't match portal type */
 		return ERR_PTR(-EPERM);
 
-	me = kmem_cache_alloc(lnet_mes_cachep, GFP_NOFS | __GFP_ZERO);
+	me = lnet_arena_alloc(LNET_ARENA_ME);
 	if (me == NULL) {
 		CDEBUG(D_MALLOC, "failed to allocate 'me'\n");
 		return ERR_PTR(-ENOMEM);
@@ -114,6 +114,11 @@ LNetMEAttach(unsigned int portal,
 	else
 		list_add(&me->me_list, head);
 
+	if (ignore_bits != 0)
+		lnet_mt_iclass_add(mtable, me, pos);
+	else
+		me->me_iclass = -1;
+
 	lnet_res_unlock(mtable->mt_cpt);
 	return me;
 }
@@ -165,6 +170,8 @@ void
 lnet_me_unlink(struct lnet_me *me)
 {
 	list_del(&me->me_list);
+	if (me->me_ignore_bits != 0)
+		lnet_mt_iclass_del(me);
 
 	if (me->me_md != NULL) {
 		struct lnet_libmd *md = me->me_md;
@@ -175,7 +182,7 @@ lnet_me_unlink(struct lnet_me *me)
 	}
 
 	CDEBUG(D_MALLOC, "slab-freed 'me' at %p.\n", me);
-	kmem_cache_free(lnet_mes_cachep, me);
+	lnet_arena_free(LNET_ARENA_ME, me);
 }
 
 #if 0
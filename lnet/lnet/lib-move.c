@@ -46,6 +46,10 @@ static int local_nid_dist_zero = 1;
 module_param(local_nid_dist_zero, int, 0444);
 MODULE_PARM_DESC(local_nid_dist_zero, "Reserved");
 
+static int lnet_bulk_stripe = 1;
+module_param(lnet_bulk_stripe, int, 0644);
+MODULE_PARM_DESC(lnet_bulk_stripe, "Spread bulk transfers across the NIs of Multi-Rail peers (0 to disable)");
+
 struct lnet_send_data {
 	struct lnet_ni *sd_best_ni;
 	struct lnet_peer_ni *sd_best_lpni;
@@ -1043,6 +1047,8 @@ lnet_post_routed_recv_locked(struct lnet_msg *msg, int do_recv)
 		rbp->rbp_credits--;
 		if (rbp->rbp_credits < rbp->rbp_mincredits)
 			rbp->rbp_mincredits = rbp->rbp_credits;
+		if (rbp->rbp_credits < rbp->rbp_scan_mincredits)
+			rbp->rbp_scan_mincredits = rbp->rbp_credits;
 
 		if (rbp->rbp_credits < 0) {
 			/* must have checked eager_recv before here */
@@ -1313,6 +1319,43 @@ routing_off:
 	}
 }
 
+/*
+ * Give @lpni @delta more router buffer credits, or take them back if @delta
+ * is negative, and post as many of the routed messages blocked on its peer
+ * as the credits added allow.  Called w/o lnet_net_lock.
+ */
+void
+lnet_peer_adjust_rtrcredits(struct lnet_peer_ni *lpni, int delta)
+{
+	struct lnet_peer *lp = lpni->lpni_peer_net->lpn_peer;
+	struct lnet_msg *msg;
+	int blocked = 0;
+	int cpt;
+
+	spin_lock(&lpni->lpni_lock);
+	if (delta > 0 && lpni->lpni_rtrcredits < 0)
+		blocked = min(delta, -lpni->lpni_rtrcredits);
+	lpni->lpni_rtrcredits += delta;
+	lpni->lpni_rtrcredits_extra += delta;
+	spin_unlock(&lpni->lpni_lock);
+
+	while (blocked-- > 0) {
+		spin_lock(&lp->lp_lock);
+		if (list_empty(&lp->lp_rtrq)) {
+			spin_unlock(&lp->lp_lock);
+			break;
+		}
+		msg = list_entry(lp->lp_rtrq.next, struct lnet_msg, msg_list);
+		list_del(&msg->msg_list);
+		cpt = msg->msg_rx_cpt;
+		spin_unlock(&lp->lp_lock);
+
+		lnet_net_lock(cpt);
+		(void) lnet_post_routed_recv_locked(msg, 1);
+		lnet_net_unlock(cpt);
+	}
+}
+
 static int
 lnet_compare_gw_lpnis(struct lnet_peer_ni *p1, struct lnet_peer_ni *p2)
 {
@@ -1963,6 +2006,17 @@ lnet_initiate_peer_discovery(struct lnet_peer_ni *lpni, struct lnet_msg *msg,
 		return 0;
 	}
 
+	/*
+	 * The NIDs of a peer seeded from the peer cache are trusted until
+	 * discovery, which is only kicked off here, says otherwise. This
+	 * keeps a restart of many nodes from waiting on discovery storms.
+	 */
+	if (peer->lp_state & LNET_PEER_SEEDED) {
+		rc = lnet_discover_peer_locked(lpni, cpt, false);
+		lnet_peer_ni_decref_locked(lpni);
+		return rc;
+	}
+
 	rc = lnet_discover_peer_locked(lpni, cpt, false);
 	if (rc) {
 		lnet_peer_ni_decref_locked(lpni);
@@ -2211,6 +2265,7 @@ lnet_find_best_ni_on_local_net(struct lnet_peer *peer, int md_cpt,
 	struct lnet_peer_net *peer_net = NULL;
 	struct lnet_ni *best_ni = NULL;
 	int lpn_healthv = 0;
+	int healthv;
 
 	/*
 	 * The peer can have multiple interfaces, some of them can be on
@@ -2229,8 +2284,9 @@ lnet_find_best_ni_on_local_net(struct lnet_peer *peer, int md_cpt,
 			continue;
 
 		/* always select the lpn with the best health */
-		if (lpn_healthv <= peer_net->lpn_healthv)
-			lpn_healthv = peer_net->lpn_healthv;
+		healthv = atomic_read(&peer_net->lpn_healthv);
+		if (lpn_healthv <= healthv)
+			lpn_healthv = healthv;
 		else
 			continue;
 
@@ -2736,6 +2792,20 @@ again:
 	if (lnet_msg_is_response(msg))
 		send_case |= SND_RESP;
 
+	/*
+	 * The messages of a bulk transfer are sent with the source NID
+	 * the request came in on, but nothing ties them to that pair of
+	 * NIs. Select the best pair for each of them instead, as if no
+	 * source was specified, so a bulk made of several MDs is spread
+	 * across all the healthy rails to the peer.
+	 */
+	if (send_case == SRC_SPEC_LOCAL_MR_DST && lnet_bulk_stripe &&
+	    msg->msg_md != NULL &&
+	    (msg->msg_md->md_options & LNET_MD_MR_STRIPE)) {
+		send_case = SRC_ANY_LOCAL_MR_DST;
+		src_nid = LNET_NID_ANY;
+	}
+
 	/* assign parameters to the send_data */
 	send_data.sd_rtr_nid = rtr_nid;
 	send_data.sd_src_nid = src_nid;
@@ -3518,6 +3588,8 @@ lnet_monitor_thread(void *arg)
 			recovery_timeout = now + lnet_recovery_interval;
 		}
 
+		lnet_rtrpools_autoscale();
+
 		/*
 		 * TODO do we need to check if we should sleep without
 		 * timeout?  Technically, an active system will always
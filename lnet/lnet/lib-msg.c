@@ -38,6 +38,11 @@
 
 #include <lnet/lib-lnet.h>
 
+static int lnet_arena_size = 64;
+module_param(lnet_arena_size, int, 0444);
+MODULE_PARM_DESC(lnet_arena_size,
+		 "# of freed msgs, MDs and MEs kept for reuse per CPU, 0 to disable");
+
 void
 lnet_build_unlink_event(struct lnet_libmd *md, struct lnet_event *ev)
 {
@@ -534,14 +539,15 @@ lnet_handle_remote_failure(struct lnet_peer_ni *lpni)
 	lnet_net_unlock(0);
 }
 
+/* the per-CPT counters are summed up by lnet_counters_get() */
 static void
-lnet_incr_hstats(struct lnet_msg *msg, enum lnet_msg_hstatus hstatus)
+lnet_incr_hstats(struct lnet_msg *msg, enum lnet_msg_hstatus hstatus, int cpt)
 {
 	struct lnet_ni *ni = msg->msg_txni;
 	struct lnet_peer_ni *lpni = msg->msg_txpeer;
 	struct lnet_counters_health *health;
 
-	health = &the_lnet.ln_counters[0]->lct_health;
+	health = &the_lnet.ln_counters[cpt]->lct_health;
 
 	switch (hstatus) {
 	case LNET_MSG_STATUS_LOCAL_INTERRUPT:
@@ -777,6 +783,7 @@ lnet_health_check(struct lnet_msg *msg)
 	struct lnet_peer_ni *lpni;
 	struct lnet_ni *ni;
 	bool lo = false;
+	int cpt;
 
 	/* if we're shutting down no point in handling health. */
 	if (the_lnet.ln_mt_state != LNET_MT_STATE_RUNNING)
@@ -804,9 +811,10 @@ lnet_health_check(struct lnet_msg *msg)
 	 * incrementing statistics if there is no error.
 	 */
 	if (hstatus != LNET_MSG_STATUS_OK) {
-		lnet_net_lock(0);
-		lnet_incr_hstats(msg, hstatus);
-		lnet_net_unlock(0);
+		cpt = msg->msg_tx_committed ? msg->msg_tx_cpt : msg->msg_rx_cpt;
+		lnet_net_lock(cpt);
+		lnet_incr_hstats(msg, hstatus, cpt);
+		lnet_net_unlock(cpt);
 	}
 
 	/*
@@ -847,20 +855,28 @@ lnet_health_check(struct lnet_msg *msg)
 		 * If this interface is part of a router, then take that
 		 * as indication that the router is fully healthy.
 		 */
-		if (lpni && msg->msg_rx_committed) {
+		if (lpni && msg->msg_rx_committed &&
+		    atomic_read(&lpni->lpni_healthv) < LNET_MAX_HEALTH_VALUE) {
 			/*
+			 * A healthy peer NI, which is the common case, needs
+			 * no update at all. Otherwise the lock of the CPT
+			 * the message is committed on is enough to keep the
+			 * peer NI attached to its peer net, so receivers on
+			 * different CPTs don't serialize here.
+			 *
 			 * If we're receiving a message from the router or
 			 * I'm a router, then set that lpni's health to
 			 * maximum so we can commence communication
 			 */
-			lnet_net_lock(0);
+			cpt = msg->msg_rx_cpt;
+			lnet_net_lock(cpt);
 			if (lnet_isrouter(lpni) || the_lnet.ln_routing) {
 				lnet_set_lpni_healthv_locked(lpni,
 					LNET_MAX_HEALTH_VALUE);
 			} else {
 				lnet_inc_lpni_healthv_locked(lpni);
 			}
-			lnet_net_unlock(0);
+			lnet_net_unlock(cpt);
 		}
 
 		/* we can finalize this message */
@@ -1138,10 +1154,171 @@ again:
 }
 EXPORT_SYMBOL(lnet_finalize);
 
+static struct kmem_cache *
+lnet_arena_cachep(enum lnet_arena_type type)
+{
+	switch (type) {
+	case LNET_ARENA_MSG:
+		return lnet_msg_cachep;
+	case LNET_ARENA_MD:
+		return lnet_small_mds_cachep;
+	default:
+		LASSERT(type == LNET_ARENA_ME);
+		return lnet_mes_cachep;
+	}
+}
+
+static struct lnet_arena *
+lnet_arena_current(enum lnet_arena_type type)
+{
+	struct lnet_msg_container *container;
+
+	if (the_lnet.ln_msg_containers == NULL)
+		return NULL;
+
+	container = the_lnet.ln_msg_containers[lnet_cpt_current()];
+	if (container->msc_init == 0 ||
+	    container->msc_arenas[type].la_size == 0)
+		return NULL;
+
+	return &container->msc_arenas[type];
+}
+
+/* allocate a zeroed object of @type, reusing one freed on this CPT if
+ * possible */
+void *
+lnet_arena_alloc(enum lnet_arena_type type)
+{
+	struct kmem_cache *cachep = lnet_arena_cachep(type);
+	struct lnet_arena *arena = lnet_arena_current(type);
+	struct llist_node *node = NULL;
+
+	if (arena != NULL) {
+		/* llist_del_first() needs to be serialized against itself */
+		spin_lock(&arena->la_lock);
+		node = llist_del_first(&arena->la_free);
+		if (node == NULL)
+			arena->la_misses++;
+		spin_unlock(&arena->la_lock);
+	}
+
+	if (node == NULL)
+		return kmem_cache_alloc(cachep, GFP_NOFS | __GFP_ZERO);
+
+	atomic_dec(&arena->la_nfree);
+	memset(node, 0, kmem_cache_size(cachep));
+
+	return node;
+}
+
+void
+lnet_arena_free(enum lnet_arena_type type, void *obj)
+{
+	struct lnet_arena *arena = lnet_arena_current(type);
+	int nfree;
+
+	if (arena != NULL) {
+		nfree = atomic_inc_return(&arena->la_nfree);
+		if (nfree <= arena->la_size) {
+			/* racy, but it's only a statistic */
+			if (nfree > arena->la_hiwater)
+				arena->la_hiwater = nfree;
+			llist_add(obj, &arena->la_free);
+			return;
+		}
+		atomic_dec(&arena->la_nfree);
+	}
+
+	kmem_cache_free(lnet_arena_cachep(type), obj);
+}
+
+void
+lnet_arena_counters_get(struct lnet_counters_arena *counters)
+{
+	struct lnet_msg_container *container;
+	struct lnet_arena *arena;
+	int i;
+
+	memset(counters, 0, sizeof(*counters));
+
+	if (the_lnet.ln_msg_containers == NULL)
+		return;
+
+	cfs_percpt_for_each(container, i, the_lnet.ln_msg_containers) {
+		if (container->msc_init == 0)
+			continue;
+
+		arena = &container->msc_arenas[LNET_ARENA_MSG];
+		counters->lca_msgs_cached += atomic_read(&arena->la_nfree);
+		counters->lca_msgs_hiwater += arena->la_hiwater;
+		counters->lca_msgs_misses += arena->la_misses;
+
+		arena = &container->msc_arenas[LNET_ARENA_MD];
+		counters->lca_mds_cached += atomic_read(&arena->la_nfree);
+		counters->lca_mds_hiwater += arena->la_hiwater;
+		counters->lca_mds_misses += arena->la_misses;
+
+		arena = &container->msc_arenas[LNET_ARENA_ME];
+		counters->lca_mes_cached += atomic_read(&arena->la_nfree);
+		counters->lca_mes_hiwater += arena->la_hiwater;
+		counters->lca_mes_misses += arena->la_misses;
+	}
+}
+
+void
+lnet_arena_counters_reset(void)
+{
+	struct lnet_msg_container *container;
+	int i;
+	int j;
+
+	if (the_lnet.ln_msg_containers == NULL)
+		return;
+
+	cfs_percpt_for_each(container, i, the_lnet.ln_msg_containers) {
+		if (container->msc_init == 0)
+			continue;
+
+		for (j = 0; j < LNET_ARENA_NR; j++) {
+			struct lnet_arena *arena = &container->msc_arenas[j];
+
+			spin_lock(&arena->la_lock);
+			arena->la_hiwater = atomic_read(&arena->la_nfree);
+			arena->la_misses = 0;
+			spin_unlock(&arena->la_lock);
+		}
+	}
+}
+
+static void
+lnet_arena_setup(struct lnet_arena *arena, int size)
+{
+	init_llist_head(&arena->la_free);
+	spin_lock_init(&arena->la_lock);
+	atomic_set(&arena->la_nfree, 0);
+	arena->la_size = size;
+}
+
+static void
+lnet_arena_cleanup(struct lnet_arena *arena, enum lnet_arena_type type)
+{
+	struct llist_node *node = llist_del_all(&arena->la_free);
+	struct llist_node *next;
+
+	for (; node != NULL; node = next) {
+		next = node->next;
+		kmem_cache_free(lnet_arena_cachep(type), node);
+	}
+
+	atomic_set(&arena->la_nfree, 0);
+	arena->la_size = 0;
+}
+
 void
 lnet_msg_container_cleanup(struct lnet_msg_container *container)
 {
 	int	count = 0;
+	int	i;
 
 	if (container->msc_init == 0)
 		return;
@@ -1161,6 +1338,9 @@ lnet_msg_container_cleanup(struct lnet_msg_container *container)
 	if (count > 0)
 		CERROR("%d active msg on exit\n", count);
 
+	for (i = 0; i < LNET_ARENA_NR; i++)
+		lnet_arena_cleanup(&container->msc_arenas[i], i);
+
 	if (container->msc_finalizers != NULL) {
 		CFS_FREE_PTR_ARRAY(container->msc_finalizers,
 				   container->msc_nfinalizers);
@@ -1179,6 +1359,7 @@ int
 lnet_msg_container_setup(struct lnet_msg_container *container, int cpt)
 {
 	int rc = 0;
+	int i;
 
 	container->msc_init = 1;
 
@@ -1191,6 +1372,13 @@ lnet_msg_container_setup(struct lnet_msg_container *container, int cpt)
 	if (container->msc_nfinalizers == 0)
 		container->msc_nfinalizers = 1;
 
+	/* the arenas hold up to lnet_arena_size objects of each type for
+	 * every CPU of this partition */
+	for (i = 0; i < LNET_ARENA_NR; i++)
+		lnet_arena_setup(&container->msc_arenas[i],
+				 max(lnet_arena_size, 0) *
+				 container->msc_nfinalizers);
+
 	LIBCFS_CPT_ALLOC(container->msc_finalizers, lnet_cpt_table(), cpt,
 			 container->msc_nfinalizers *
 			 sizeof(*container->msc_finalizers));
@@ -205,6 +205,8 @@ lnet_try_match_md(struct lnet_libmd *md,
 	if (!lnet_md_exhausted(md))
 		return LNET_MATCHMD_OK;
 
+	lnet_mt_iclass_unlink(me);
+
 	/* Auto-unlink NOW, so the ME gets unlinked if required.
 	 * We bumped md->md_refcount above so the MD just gets flagged
 	 * for unlink when it is finalized. */
@@ -371,6 +373,219 @@ lnet_mt_match_head(struct lnet_match_table *mtable,
 	}
 }
 
+static struct list_head *
+lnet_mt_iclass_head(struct lnet_mt_iclass *ic, __u64 mbits)
+{
+	if (ic->ic_hash_bits == 0)
+		return &ic->ic_hash[0];
+
+	return &ic->ic_hash[hash_64(mbits & ~ic->ic_ignore_bits,
+				    ic->ic_hash_bits)];
+}
+
+/* Claim the free class slot @ic for @ignore_bits. MEs ignoring all bits, such
+ * as ptlrpc request buffers, can't be told apart by their match bits, so
+ * their class has a single chain. */
+static int
+lnet_mt_iclass_claim(struct lnet_mt_iclass *ic, __u64 ignore_bits)
+{
+	unsigned int bits = ignore_bits == ~0ULL ? 0 : LNET_MT_ICLASS_HASH_BITS;
+	int i;
+
+	/* called under lnet_res_lock, a failure only disables the classes */
+	LIBCFS_ALLOC_ATOMIC(ic->ic_hash, sizeof(*ic->ic_hash) << bits);
+	if (ic->ic_hash == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < 1 << bits; i++)
+		INIT_LIST_HEAD(&ic->ic_hash[i]);
+	ic->ic_hash_bits = bits;
+	ic->ic_ignore_bits = ignore_bits;
+
+	return 0;
+}
+
+static void
+lnet_mt_iclass_release(struct lnet_mt_iclass *ic)
+{
+	LIBCFS_FREE(ic->ic_hash, sizeof(*ic->ic_hash) << ic->ic_hash_bits);
+	ic->ic_hash = NULL;
+	ic->ic_ignore_bits = 0;
+}
+
+/* call with lnet_res_lock please, @me is already on
+ * mt_mhash[LNET_MT_HASH_IGNORE] */
+void
+lnet_mt_iclass_add(struct lnet_match_table *mtable, struct lnet_me *me,
+		   enum lnet_ins_pos pos)
+{
+	struct lnet_mt_iclass	*ic;
+	int			free = -1;
+	int			i;
+
+	LASSERT(me->me_ignore_bits != 0);
+
+	INIT_LIST_HEAD(&me->me_iclass_list);
+	if (pos == LNET_INS_AFTER || pos == LNET_INS_LOCAL)
+		me->me_iseq = mtable->mt_iseq_tail++;
+	else
+		me->me_iseq = --mtable->mt_iseq_head;
+
+	for (i = 0; i < LNET_MT_ICLASS_MAX; i++) {
+		ic = &mtable->mt_iclasses[i];
+		if (ic->ic_ignore_bits == me->me_ignore_bits)
+			break;
+		if (ic->ic_ignore_bits == 0 && free < 0)
+			free = i;
+	}
+
+	if (i == LNET_MT_ICLASS_MAX) {
+		if (free < 0 ||
+		    lnet_mt_iclass_claim(&mtable->mt_iclasses[free],
+					 me->me_ignore_bits) != 0) {
+			me->me_iclass = -1;
+			mtable->mt_iclass_overflow++;
+			return;
+		}
+		i = free;
+		ic = &mtable->mt_iclasses[i];
+	}
+
+	/* chained by lnet_mt_iclass_link() once it has a usable MD */
+	me->me_iclass = i;
+	ic->ic_nmes++;
+}
+
+/* call with lnet_res_lock please */
+void
+lnet_mt_iclass_del(struct lnet_me *me)
+{
+	struct lnet_portal	*ptl = the_lnet.ln_portals[me->me_portal];
+	struct lnet_match_table	*mtable = ptl->ptl_mtables[me->me_cpt];
+	struct lnet_mt_iclass	*ic;
+
+	if (me->me_iclass < 0) {
+		LASSERT(mtable->mt_iclass_overflow > 0);
+		mtable->mt_iclass_overflow--;
+		return;
+	}
+
+	ic = &mtable->mt_iclasses[me->me_iclass];
+	LASSERT(ic->ic_ignore_bits == me->me_ignore_bits);
+	LASSERT(ic->ic_nmes > 0);
+
+	lnet_mt_iclass_unlink(me);
+	if (--ic->ic_nmes == 0)
+		lnet_mt_iclass_release(ic);
+}
+
+/* Put @me on the chain of its class once its MD can take messages. The
+ * chain is kept in the order of mt_mhash[LNET_MT_HASH_IGNORE], MDs are
+ * nearly always attached in that order so the walk back is short. */
+static void
+lnet_mt_iclass_link(struct lnet_me *me)
+{
+	struct lnet_portal	*ptl = the_lnet.ln_portals[me->me_portal];
+	struct lnet_match_table	*mtable = ptl->ptl_mtables[me->me_cpt];
+	struct list_head	*head;
+	struct list_head	*prev;
+
+	if (me->me_ignore_bits == 0 || me->me_iclass < 0 ||
+	    lnet_md_exhausted(me->me_md))
+		return;
+
+	head = lnet_mt_iclass_head(&mtable->mt_iclasses[me->me_iclass],
+				   me->me_match_bits);
+	for (prev = head->prev; prev != head; prev = prev->prev) {
+		if (list_entry(prev, struct lnet_me,
+			       me_iclass_list)->me_iseq < me->me_iseq)
+			break;
+	}
+	list_add(&me->me_iclass_list, prev);
+	mtable->mt_iclass_nlive++;
+}
+
+/* Take @me off its class chain when its MD is detached or exhausted. */
+void
+lnet_mt_iclass_unlink(struct lnet_me *me)
+{
+	struct lnet_portal	*ptl = the_lnet.ln_portals[me->me_portal];
+	struct lnet_match_table	*mtable = ptl->ptl_mtables[me->me_cpt];
+
+	if (me->me_ignore_bits == 0 || list_empty(&me->me_iclass_list))
+		return;
+
+	LASSERT(mtable->mt_iclass_nlive > 0);
+	list_del_init(&me->me_iclass_list);
+	mtable->mt_iclass_nlive--;
+}
+
+/* Match MEs with ignore-bits by walking the chains of all classes which can
+ * match @info->mi_mbits, merged in the order of mt_mhash[LNET_MT_HASH_IGNORE],
+ * so the first ME taking the message is the same as with a full scan.
+ * Chains only hold MEs with an MD which isn't exhausted, so after a miss
+ * the list is exhausted if and only if no ME is chained at all. */
+static int
+lnet_mt_match_iclass(struct lnet_match_table *mtable,
+		     struct lnet_match_info *info, struct lnet_msg *msg,
+		     int *exhausted)
+{
+	struct list_head	*heads[LNET_MT_ICLASS_MAX];
+	struct lnet_me		*cursors[LNET_MT_ICLASS_MAX];
+	struct lnet_me		*me;
+	int			ncursors = 0;
+	int			rc;
+	int			i;
+
+	for (i = 0; i < LNET_MT_ICLASS_MAX; i++) {
+		struct lnet_mt_iclass *ic = &mtable->mt_iclasses[i];
+		struct list_head *head;
+
+		if (ic->ic_nmes == 0)
+			continue;
+
+		head = lnet_mt_iclass_head(ic, info->mi_mbits);
+		if (list_empty(head))
+			continue;
+
+		heads[ncursors] = head;
+		cursors[ncursors] = list_entry(head->next, struct lnet_me,
+					       me_iclass_list);
+		ncursors++;
+	}
+
+	while (ncursors > 0) {
+		int next = 0;
+
+		for (i = 1; i < ncursors; i++) {
+			if (cursors[i]->me_iseq < cursors[next]->me_iseq)
+				next = i;
+		}
+
+		me = cursors[next];
+		if (me->me_iclass_list.next == heads[next]) {
+			ncursors--;
+			heads[next] = heads[ncursors];
+			cursors[next] = cursors[ncursors];
+		} else {
+			cursors[next] = list_entry(me->me_iclass_list.next,
+						   struct lnet_me,
+						   me_iclass_list);
+		}
+
+		LASSERT(me->me_md != NULL && me == me->me_md->md_me);
+
+		mtable->mt_me_tried++;
+		rc = lnet_try_match_md(me->me_md, info, msg);
+		if ((rc & LNET_MATCHMD_FINISH) != 0)
+			return rc;
+	}
+
+	if (mtable->mt_iclass_nlive != 0)
+		*exhausted = 0;
+	return LNET_MATCHMD_NONE;
+}
+
 int
 lnet_mt_match_md(struct lnet_match_table *mtable,
 		 struct lnet_match_info *info, struct lnet_msg *msg)
@@ -391,6 +606,14 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 	if (lnet_ptl_is_wildcard(the_lnet.ln_portals[mtable->mt_portal]))
 		exhausted = LNET_MATCHMD_EXHAUSTED;
 
+	if (head == &mtable->mt_mhash[LNET_MT_HASH_IGNORE] &&
+	    mtable->mt_iclass_overflow == 0) {
+		rc = lnet_mt_match_iclass(mtable, info, msg, &exhausted);
+		if ((rc & LNET_MATCHMD_FINISH) != 0)
+			return rc & ~LNET_MATCHMD_EXHAUSTED;
+		goto checked;
+	}
+
 	list_for_each_entry_safe(me, tmp, head, me_list) {
 		/* ME attached but MD not attached yet */
 		if (me->me_md == NULL)
@@ -398,6 +621,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 
 		LASSERT(me == me->me_md->md_me);
 
+		mtable->mt_me_tried++;
 		rc = lnet_try_match_md(me->me_md, info, msg);
 		if ((rc & LNET_MATCHMD_EXHAUSTED) == 0)
 			exhausted = 0; /* mlist is not empty */
@@ -409,6 +633,7 @@ lnet_mt_match_md(struct lnet_match_table *mtable,
 		}
 	}
 
+ checked:
 	if (exhausted == LNET_MATCHMD_EXHAUSTED) { /* @head is exhausted */
 		lnet_mt_set_exhausted(mtable, head - mtable->mt_mhash, 1);
 		if (!lnet_mt_test_exhausted(mtable, -1))
@@ -641,6 +866,7 @@ lnet_ptl_detach_md(struct lnet_me *me, struct lnet_libmd *md)
 {
 	LASSERT(me->me_md == md && md->md_me == me);
 
+	lnet_mt_iclass_unlink(me);
 	me->me_md = NULL;
 	md->md_me = NULL;
 }
@@ -662,6 +888,7 @@ lnet_ptl_attach_md(struct lnet_me *me, struct lnet_libmd *md,
 
 	me->me_md = md;
 	md->md_me = me;
+	lnet_mt_iclass_link(me);
 
 	cpt = lnet_cpt_of_cookie(md->md_lh.lh_cookie);
 	mtable = ptl->ptl_mtables[cpt];
@@ -776,6 +1003,16 @@ lnet_ptl_cleanup(struct lnet_portal *ptl)
 		}
 		/* the extra entry is for MEs with ignore bits */
 		CFS_FREE_PTR_ARRAY(mhash, LNET_MT_HASH_SIZE + 1);
+
+		if (mtable->mt_iclasses != NULL) {
+			for (j = 0; j < LNET_MT_ICLASS_MAX; j++) {
+				if (mtable->mt_iclasses[j].ic_hash != NULL)
+					lnet_mt_iclass_release(
+						&mtable->mt_iclasses[j]);
+			}
+			CFS_FREE_PTR_ARRAY(mtable->mt_iclasses,
+					   LNET_MT_ICLASS_MAX);
+		}
 	}
 
 	cfs_percpt_free(ptl->ptl_mtables);
@@ -818,6 +1055,15 @@ lnet_ptl_setup(struct lnet_portal *ptl, int index)
 		for (j = 0; j < LNET_MT_HASH_SIZE + 1; j++)
 			INIT_LIST_HEAD(&mhash[j]);
 
+		LIBCFS_CPT_ALLOC(mtable->mt_iclasses, lnet_cpt_table(), i,
+				 sizeof(*mtable->mt_iclasses) *
+				 LNET_MT_ICLASS_MAX);
+		if (mtable->mt_iclasses == NULL) {
+			CERROR("Failed to create ignore-bits classes for portal %d\n",
+			       index);
+			goto failed;
+		}
+
 		mtable->mt_portal = index;
 		mtable->mt_cpt = i;
 	}
@@ -1288,6 +1288,8 @@ lnet_peer_attach_peer_ni(struct lnet_peer *lp,
 		if (!(lp->lp_state & LNET_PEER_CONFIGURED))
 			lp->lp_state |= LNET_PEER_CONFIGURED;
 	}
+	if (flags & LNET_PEER_SEEDED)
+		lp->lp_state |= LNET_PEER_SEEDED;
 	if (flags & LNET_PEER_MULTI_RAIL) {
 		if (!(lp->lp_state & LNET_PEER_MULTI_RAIL)) {
 			lp->lp_state |= LNET_PEER_MULTI_RAIL;
@@ -1330,6 +1332,11 @@ lnet_peer_add(lnet_nid_t nid, unsigned flags)
 		/* A peer with this NID already exists. */
 		lp = lpni->lpni_peer_net->lpn_peer;
 		lnet_peer_ni_decref_locked(lpni);
+		/* What we know of a peer is newer than the peer cache. */
+		if (flags & LNET_PEER_SEEDED) {
+			rc = -EEXIST;
+			goto out;
+		}
 		/*
 		 * This is an error if the peer was configured and the
 		 * primary NID differs or an attempt is made to change
@@ -1578,7 +1585,7 @@ out:
  * being created/modified/deleted by a different thread.
  */
 int
-lnet_add_peer_ni(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr)
+lnet_add_peer_ni(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr, bool seed)
 {
 	struct lnet_peer *lp = NULL;
 	struct lnet_peer_ni *lpni;
@@ -1588,7 +1595,11 @@ lnet_add_peer_ni(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr)
 	if (prim_nid == LNET_NID_ANY)
 		return -EINVAL;
 
-	flags = LNET_PEER_CONFIGURED;
+	/*
+	 * A peer seeded from the peer cache isn't configured: discovery
+	 * may change its NIDs like those of any other discovered peer.
+	 */
+	flags = seed ? LNET_PEER_SEEDED : LNET_PEER_CONFIGURED;
 	if (mr)
 		flags |= LNET_PEER_MULTI_RAIL;
 
@@ -1606,13 +1617,24 @@ lnet_add_peer_ni(lnet_nid_t prim_nid, lnet_nid_t nid, bool mr)
 	lnet_peer_ni_decref_locked(lpni);
 	lp = lpni->lpni_peer_net->lpn_peer;
 
-	/* Peer must have been configured. */
-	if (!(lp->lp_state & LNET_PEER_CONFIGURED)) {
-		CDEBUG(D_NET, "peer %s was not configured\n",
-		       libcfs_nid2str(prim_nid));
+	/* Peer must have been configured, or seeded and not discovered. */
+	if (!(lp->lp_state & (seed ? LNET_PEER_SEEDED : LNET_PEER_CONFIGURED))) {
+		CDEBUG(D_NET, "peer %s was not %s\n",
+		       libcfs_nid2str(prim_nid),
+		       seed ? "seeded" : "configured");
 		return -ENOENT;
 	}
 
+	/* Seeding never takes a NID away from a known peer. */
+	if (seed) {
+		lpni = lnet_find_peer_ni_locked(nid);
+		if (lpni) {
+			lnet_peer_ni_decref_locked(lpni);
+			if (lpni->lpni_peer_net->lpn_peer != lp)
+				return -EEXIST;
+		}
+	}
+
 	/* Primary NID must match */
 	if (lp->lp_primary_nid != prim_nid) {
 		CDEBUG(D_NET, "prim_nid %s is not primary for peer %s\n",
@@ -3151,7 +3173,8 @@ __must_hold(&lp->lp_lock)
 {
 	lp->lp_state |= LNET_PEER_DISCOVERED;
 	lp->lp_state &= ~(LNET_PEER_DISCOVERING |
-			  LNET_PEER_REDISCOVER);
+			  LNET_PEER_REDISCOVER |
+			  LNET_PEER_SEEDED);
 
 	CDEBUG(D_NET, "peer %s\n", libcfs_nid2str(lp->lp_primary_nid));
 
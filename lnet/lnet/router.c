@@ -51,6 +51,15 @@ MODULE_PARM_DESC(large_router_buffers, "# of large messages to buffer in the rou
 static int peer_buffer_credits;
 module_param(peer_buffer_credits, int, 0444);
 MODULE_PARM_DESC(peer_buffer_credits, "# router buffer credits per peer");
+static int router_buffer_autoscale;
+module_param(router_buffer_autoscale, int, 0644);
+MODULE_PARM_DESC(router_buffer_autoscale, "Grow and shrink router buffer pools and peer router credits with demand (0 to disable)");
+static int router_buffer_autoscale_max = 4;
+module_param(router_buffer_autoscale_max, int, 0644);
+MODULE_PARM_DESC(router_buffer_autoscale_max, "Max factor the autoscaler grows router buffer pools and peer router credits by");
+static int router_buffer_autoscale_interval = 10;
+module_param(router_buffer_autoscale_interval, int, 0644);
+MODULE_PARM_DESC(router_buffer_autoscale_interval, "Seconds between router buffer autoscaler checks");
 
 static int auto_down = 1;
 module_param(auto_down, int, 0444);
@@ -911,6 +920,29 @@ lnet_destroy_routes (void)
 	lnet_del_route(LNET_NIDNET(LNET_NID_ANY), LNET_NID_ANY);
 }
 
+static void
+lnet_peer_rtrcredits_boosted(int cpt, __u32 *peers, __u32 *credits)
+{
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_ni *lpni;
+	int i;
+
+	*peers = 0;
+	*credits = 0;
+
+	lnet_net_lock(cpt);
+	ptable = the_lnet.ln_peer_tables[cpt];
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++) {
+		list_for_each_entry(lpni, &ptable->pt_hash[i], lpni_hashlist) {
+			if (lpni->lpni_rtrcredits_extra <= 0)
+				continue;
+			(*peers)++;
+			*credits += lpni->lpni_rtrcredits_extra;
+		}
+	}
+	lnet_net_unlock(cpt);
+}
+
 int lnet_get_rtr_pool_cfg(int cpt, struct lnet_ioctl_pool_cfg *pool_cfg)
 {
 	struct lnet_rtrbufpool *rbp;
@@ -930,16 +962,28 @@ int lnet_get_rtr_pool_cfg(int cpt, struct lnet_ioctl_pool_cfg *pool_cfg)
 			pool_cfg->pl_pools[j].pl_nbuffers = rbp[j].rbp_nbuffers;
 			pool_cfg->pl_pools[j].pl_credits = rbp[j].rbp_credits;
 			pool_cfg->pl_pools[j].pl_mincredits = rbp[j].rbp_mincredits;
+			pool_cfg->pl_cfg_nbuffers[j] = rbp[j].rbp_cfg_nbuffers;
+			pool_cfg->pl_grown[j] = rbp[j].rbp_grown;
+			pool_cfg->pl_shrunk[j] = rbp[j].rbp_shrunk;
 		}
 		lnet_net_unlock(i);
 		rc = 0;
 		break;
 	}
 
+	if (rc == 0)
+		lnet_peer_rtrcredits_boosted(cpt, &pool_cfg->pl_boosted_peers,
+					     &pool_cfg->pl_boosted_credits);
+
 	lnet_net_lock(LNET_LOCK_EX);
 	pool_cfg->pl_routing = the_lnet.ln_routing;
 	lnet_net_unlock(LNET_LOCK_EX);
 
+	pool_cfg->pl_ext_flags = LNET_POOL_CFG_EXT;
+	pool_cfg->pl_autoscale = router_buffer_autoscale;
+	pool_cfg->pl_autoscale_max = router_buffer_autoscale_max;
+	pool_cfg->pl_autoscale_interval = router_buffer_autoscale_interval;
+
 	return rc;
 }
 
@@ -1290,6 +1334,8 @@ lnet_rtrpool_free_bufs(struct lnet_rtrbufpool *rbp, int cpt)
 	rbp->rbp_req_nbuffers = 0;
 	rbp->rbp_nbuffers = rbp->rbp_credits = 0;
 	rbp->rbp_mincredits = 0;
+	rbp->rbp_scan_mincredits = 0;
+	rbp->rbp_cfg_nbuffers = 0;
 	lnet_net_unlock(cpt);
 
 	/* Free buffers on the free list. */
@@ -1377,6 +1423,238 @@ failed:
 	return -ENOMEM;
 }
 
+/* set the configured size of @rbp, the autoscaler keeps it at least as big */
+static int
+lnet_rtrpool_config_bufs(struct lnet_rtrbufpool *rbp, int nbufs, int cpt)
+{
+	int rc;
+
+	rc = lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt);
+	if (rc != 0)
+		return rc;
+
+	lnet_net_lock(cpt);
+	rbp->rbp_cfg_nbuffers = nbufs;
+	rbp->rbp_idle_scans = 0;
+	lnet_net_unlock(cpt);
+
+	return 0;
+}
+
+/* # autoscaler checks in a row a pool must be mostly idle to shrink */
+#define LNET_RTRPOOL_IDLE_SCANS	3
+
+static void
+lnet_rtrpool_autoscale(struct lnet_rtrbufpool *rbp, int cpt)
+{
+	struct lnet_rtrbuf *rb;
+	LIST_HEAD(tmp);
+	int scan_min;
+	int max_nbufs;
+	int nbufs;
+
+	lnet_net_lock(cpt);
+	if (rbp->rbp_cfg_nbuffers == 0) {
+		lnet_net_unlock(cpt);
+		return;
+	}
+
+	scan_min = rbp->rbp_scan_mincredits;
+	rbp->rbp_scan_mincredits = rbp->rbp_credits;
+	nbufs = rbp->rbp_req_nbuffers;
+	max_nbufs = rbp->rbp_cfg_nbuffers *
+		    max(router_buffer_autoscale_max, 1);
+
+	if (scan_min < 0) {
+		/* messages waited for buffers, grow by at least as many */
+		rbp->rbp_idle_scans = 0;
+		nbufs = min(nbufs + max(-scan_min, nbufs / 4), max_nbufs);
+		lnet_net_unlock(cpt);
+
+		if (nbufs <= rbp->rbp_req_nbuffers ||
+		    lnet_rtrpool_adjust_bufs(rbp, nbufs, cpt) != 0)
+			return;
+
+		CDEBUG(D_NET, "grew %d page router buffer pool of CPT %d to %d buffers\n",
+		       rbp->rbp_npages, cpt, nbufs);
+		lnet_net_lock(cpt);
+		rbp->rbp_grown++;
+		lnet_net_unlock(cpt);
+		return;
+	}
+
+	/* shrink once more than half of the buffers have stayed unused for
+	 * a few checks in a row */
+	if (nbufs <= rbp->rbp_cfg_nbuffers || scan_min <= nbufs / 2) {
+		rbp->rbp_idle_scans = 0;
+		lnet_net_unlock(cpt);
+		return;
+	}
+
+	if (++rbp->rbp_idle_scans < LNET_RTRPOOL_IDLE_SCANS) {
+		lnet_net_unlock(cpt);
+		return;
+	}
+
+	rbp->rbp_idle_scans = 0;
+	nbufs = max(nbufs - scan_min / 2, rbp->rbp_cfg_nbuffers);
+	rbp->rbp_req_nbuffers = nbufs;
+	rbp->rbp_shrunk++;
+
+	/* free idle buffers now rather than as they are returned */
+	while (rbp->rbp_nbuffers > nbufs && rbp->rbp_credits > 0) {
+		rb = list_entry(rbp->rbp_bufs.next, struct lnet_rtrbuf, rb_list);
+		list_move(&rb->rb_list, &tmp);
+		rbp->rbp_nbuffers--;
+		rbp->rbp_credits--;
+	}
+	rbp->rbp_mincredits = min(rbp->rbp_mincredits, rbp->rbp_credits);
+	rbp->rbp_scan_mincredits = rbp->rbp_credits;
+	lnet_net_unlock(cpt);
+
+	CDEBUG(D_NET, "shrank %d page router buffer pool of CPT %d to %d buffers\n",
+	       rbp->rbp_npages, cpt, nbufs);
+
+	while (!list_empty(&tmp)) {
+		rb = list_entry(tmp.next, struct lnet_rtrbuf, rb_list);
+		list_del(&rb->rb_list);
+		lnet_destroy_rtrbuf(rb, rbp->rbp_npages);
+	}
+}
+
+/* # peers of a CPT which may be given extra credits per autoscaler check */
+#define LNET_RTR_BOOST_BATCH	32
+
+/*
+ * Lend extra router credits to peers with routed messages blocked on their
+ * credits when the buffer pools of @cpt have some to spare, and take them
+ * back from peers which don't use them, or from all peers if @enabled is
+ * false.  Returns the number of peers still holding extra credits.
+ */
+static int
+lnet_peer_rtrcredits_rebalance(int cpt, bool enabled, bool spare)
+{
+	struct lnet_peer_ni *boost[LNET_RTR_BOOST_BATCH];
+	struct lnet_peer_table *ptable;
+	struct lnet_peer_ni *lpni;
+	int factor = max(router_buffer_autoscale_max, 1);
+	int nboost = 0;
+	int nextra = 0;
+	int credits;
+	int extra;
+	int base;
+	int i;
+
+	lnet_net_lock(cpt);
+	ptable = the_lnet.ln_peer_tables[cpt];
+	for (i = 0; i < LNET_PEER_HASH_SIZE; i++) {
+		list_for_each_entry(lpni, &ptable->pt_hash[i], lpni_hashlist) {
+			if (lpni->lpni_net == NULL)
+				continue;
+
+			spin_lock(&lpni->lpni_lock);
+			credits = lpni->lpni_rtrcredits;
+			extra = lpni->lpni_rtrcredits_extra;
+			spin_unlock(&lpni->lpni_lock);
+
+			if (extra > 0 && (!enabled || credits > extra)) {
+				/* no message needs them */
+				lnet_peer_adjust_rtrcredits(lpni, -extra);
+				continue;
+			}
+
+			if (extra > 0)
+				nextra++;
+
+			base = lnet_peer_buffer_credits(lpni->lpni_net);
+			if (!enabled || !spare || credits >= 0 ||
+			    extra >= base * (factor - 1) ||
+			    nboost == LNET_RTR_BOOST_BATCH)
+				continue;
+
+			lnet_peer_ni_addref_locked(lpni);
+			boost[nboost++] = lpni;
+		}
+	}
+	lnet_net_unlock(cpt);
+
+	for (i = 0; i < nboost; i++) {
+		lpni = boost[i];
+		base = lnet_peer_buffer_credits(lpni->lpni_net);
+		extra = min(max(base / 2, 1),
+			    base * (factor - 1) - lpni->lpni_rtrcredits_extra);
+		if (extra <= 0)
+			continue;
+
+		CDEBUG(D_NET, "lending %d router credits to %s\n",
+		       extra, libcfs_nid2str(lpni->lpni_nid));
+		if (lpni->lpni_rtrcredits_extra == 0)
+			nextra++;
+		lnet_peer_adjust_rtrcredits(lpni, extra);
+	}
+
+	lnet_net_lock(cpt);
+	for (i = 0; i < nboost; i++)
+		lnet_peer_ni_decref_locked(boost[i]);
+	lnet_net_unlock(cpt);
+
+	return nextra;
+}
+
+static time64_t lnet_rtr_autoscale_next;
+/* some peers hold extra router credits */
+static bool lnet_rtr_boosted;
+
+/*
+ * Called by the monitor thread: grow the router buffer pools messages had
+ * to wait for, shrink the ones which stay mostly idle, never going below
+ * the configured sizes nor above router_buffer_autoscale_max times them,
+ * and move peer router credits to the peers which need them.
+ */
+void
+lnet_rtrpools_autoscale(void)
+{
+	struct lnet_rtrbufpool *rtrp;
+	time64_t now = ktime_get_seconds();
+	bool enabled;
+	bool spare;
+	int nextra = 0;
+	int i;
+	int j;
+
+	if (now < lnet_rtr_autoscale_next)
+		return;
+	lnet_rtr_autoscale_next = now +
+				  max(router_buffer_autoscale_interval, 1);
+
+	enabled = router_buffer_autoscale && the_lnet.ln_routing;
+	if (!enabled && !lnet_rtr_boosted)
+		return;
+
+	/* buffers are also configured, and the pools freed when routing
+	 * is disabled, with ln_api_mutex held; just retry next time */
+	if (!mutex_trylock(&the_lnet.ln_api_mutex))
+		return;
+
+	for (i = 0; i < LNET_CPT_NUMBER; i++) {
+		spare = false;
+		if (enabled && the_lnet.ln_rtrpools != NULL) {
+			rtrp = the_lnet.ln_rtrpools[i];
+			spare = true;
+			for (j = 0; j < LNET_NRBPOOLS; j++) {
+				lnet_rtrpool_autoscale(&rtrp[j], i);
+				if (rtrp[j].rbp_credits <= 0)
+					spare = false;
+			}
+		}
+
+		nextra += lnet_peer_rtrcredits_rebalance(i, enabled, spare);
+	}
+	lnet_rtr_boosted = nextra > 0;
+
+	mutex_unlock(&the_lnet.ln_api_mutex);
+}
+
 static void
 lnet_rtrpool_init(struct lnet_rtrbufpool *rbp, int npages)
 {
@@ -1514,21 +1792,21 @@ lnet_rtrpools_alloc(int im_a_router)
 
 	cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
 		lnet_rtrpool_init(&rtrp[LNET_TINY_BUF_IDX], 0);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
+		rc = lnet_rtrpool_config_bufs(&rtrp[LNET_TINY_BUF_IDX],
 					      nrb_tiny, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_SMALL_BUF_IDX],
 				  LNET_NRB_SMALL_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+		rc = lnet_rtrpool_config_bufs(&rtrp[LNET_SMALL_BUF_IDX],
 					      nrb_small, i);
 		if (rc != 0)
 			goto failed;
 
 		lnet_rtrpool_init(&rtrp[LNET_LARGE_BUF_IDX],
 				  LNET_NRB_LARGE_PAGES);
-		rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+		rc = lnet_rtrpool_config_bufs(&rtrp[LNET_LARGE_BUF_IDX],
 					      nrb_large, i);
 		if (rc != 0)
 			goto failed;
@@ -1559,7 +1837,7 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		tiny_router_buffers = tiny;
 		nrb = lnet_nrb_tiny_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_TINY_BUF_IDX],
+			rc = lnet_rtrpool_config_bufs(&rtrp[LNET_TINY_BUF_IDX],
 						      nrb, i);
 			if (rc != 0)
 				return rc;
@@ -1569,7 +1847,7 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		small_router_buffers = small;
 		nrb = lnet_nrb_small_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_SMALL_BUF_IDX],
+			rc = lnet_rtrpool_config_bufs(&rtrp[LNET_SMALL_BUF_IDX],
 						      nrb, i);
 			if (rc != 0)
 				return rc;
@@ -1579,7 +1857,7 @@ lnet_rtrpools_adjust_helper(int tiny, int small, int large)
 		large_router_buffers = large;
 		nrb = lnet_nrb_large_calculate();
 		cfs_percpt_for_each(rtrp, i, the_lnet.ln_rtrpools) {
-			rc = lnet_rtrpool_adjust_bufs(&rtrp[LNET_LARGE_BUF_IDX],
+			rc = lnet_rtrpool_config_bufs(&rtrp[LNET_LARGE_BUF_IDX],
 						      nrb, i);
 			if (rc != 0)
 				return rc;
@@ -224,6 +224,9 @@ lstcon_rpc_trans_name(int transop)
         if (transop == LST_TRANS_STATQRY)
                 return "STATQRY";
 
+	if (transop == LST_TRANS_HISTQRY)
+		return "HISTQRY";
+
         return "Unknown";
 }
 
@@ -695,6 +698,36 @@ lstcon_statrpc_prep(struct lstcon_node *nd, unsigned int feats,
         return 0;
 }
 
+int
+lstcon_histrpc_prep(struct lstcon_node *nd, unsigned int feats,
+		    struct lstcon_rpc **crpc)
+{
+	struct srpc_hist_reqst *hqr;
+	struct srpc_bulk *bulk;
+	int rc;
+
+	rc = lstcon_rpc_prep(nd, SRPC_SERVICE_QUERY_HIST, feats, 1,
+			     sizeof(struct lst_lat_hists), crpc);
+	if (rc != 0)
+		return rc;
+
+	/* the node PUTs its histograms into this page */
+	bulk = &(*crpc)->crp_rpc->crpc_bulk;
+	bulk->bk_iovs[0].bv_offset = 0;
+	bulk->bk_iovs[0].bv_len	   = sizeof(struct lst_lat_hists);
+	bulk->bk_iovs[0].bv_page   = alloc_page(GFP_KERNEL);
+	if (bulk->bk_iovs[0].bv_page == NULL) {
+		lstcon_rpc_put(*crpc);
+		return -ENOMEM;
+	}
+	bulk->bk_sink = 1;
+
+	hqr = &(*crpc)->crp_rpc->crpc_reqstmsg.msg_body.hist_reqst;
+	hqr->hqr_sid = console_session.ses_id;
+
+	return 0;
+}
+
 static struct lnet_process_id_packed *
 lstcon_next_id(int idx, int nkiov, struct bio_vec *kiov)
 {
@@ -968,6 +1001,7 @@ lstcon_rpc_stat_reply(struct lstcon_rpc_trans *trans, struct srpc_msg *msg,
 	struct srpc_batch_reply *bat_rep;
 	struct srpc_test_reply *test_rep;
 	struct srpc_stat_reply *stat_rep;
+	struct srpc_hist_reply *hist_rep;
 	int rc = 0;
 
 	switch (trans->tas_opc) {
@@ -1069,6 +1103,18 @@ lstcon_rpc_stat_reply(struct lstcon_rpc_trans *trans, struct srpc_msg *msg,
                 rc = stat_rep->str_status;
                 break;
 
+	case LST_TRANS_HISTQRY:
+		hist_rep = &msg->msg_body.hist_reply;
+
+		if (hist_rep->hqr_status == 0) {
+			lstcon_statqry_stat_success(stat, 1);
+			return;
+		}
+
+		lstcon_statqry_stat_failure(stat, 1);
+		rc = hist_rep->hqr_status;
+		break;
+
         default:
                 LBUG();
         }
@@ -1140,6 +1186,9 @@ lstcon_rpc_trans_ndlist(struct list_head *ndlist,
 		case LST_TRANS_STATQRY:
 			rc = lstcon_statrpc_prep(nd, feats, &rpc);
                         break;
+		case LST_TRANS_HISTQRY:
+			rc = lstcon_histrpc_prep(nd, feats, &rpc);
+			break;
                 default:
                         rc = -EINVAL;
                         break;
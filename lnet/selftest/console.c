@@ -1485,16 +1485,60 @@ lstcon_statrpc_readent(int transop, struct srpc_msg *msg,
         return 0;
 }
 
+static void
+lstcon_lat_hist_swab(struct lst_lat_hist *lh)
+{
+	int i;
+
+	__swab64s(&lh->lh_count);
+	__swab64s(&lh->lh_sum_us);
+	__swab64s(&lh->lh_max_us);
+	for (i = 0; i < LST_HIST_NBUCKETS; i++)
+		__swab32s(&lh->lh_buckets[i]);
+}
+
 static int
-lstcon_ndlist_stat(struct list_head *ndlist,
+lstcon_histrpc_readent(int transop, struct srpc_msg *msg,
+		       struct lstcon_rpc_ent __user *ent_up)
+{
+	struct srpc_hist_reply *rep = &msg->msg_body.hist_reply;
+	struct srpc_client_rpc *rpc;
+	struct lst_lat_hists *hists;
+
+	if (rep->hqr_status != 0)
+		return 0;
+
+	/* the histograms landed in the bulk page of the RPC */
+	rpc = container_of(msg, struct srpc_client_rpc, crpc_replymsg);
+	hists = page_address(rpc->crpc_bulk.bk_iovs[0].bv_page);
+
+	/* sfw_unpack_message() leaves the magic alone, flip the bulk once */
+	if (msg->msg_magic != SRPC_MSG_MAGIC) {
+		msg->msg_magic = SRPC_MSG_MAGIC;
+		lstcon_lat_hist_swab(&hists->lhs_brw);
+		lstcon_lat_hist_swab(&hists->lhs_ping);
+	}
+
+	if (copy_to_user(&ent_up->rpe_payload[0], hists, sizeof(*hists)))
+		return -EFAULT;
+
+	return 0;
+}
+
+static int
+lstcon_ndlist_stat(struct list_head *ndlist, int transop,
 		   int timeout, struct list_head __user *result_up)
 {
 	LIST_HEAD(head);
 	struct lstcon_rpc_trans *trans;
 	int rc;
 
-        rc = lstcon_rpc_trans_ndlist(ndlist, &head,
-                                     LST_TRANS_STATQRY, NULL, NULL, &trans);
+	if (transop == LST_TRANS_HISTQRY &&
+	    (console_session.ses_features & LST_FEAT_LAT_HIST) == 0)
+		return -EOPNOTSUPP;
+
+	rc = lstcon_rpc_trans_ndlist(ndlist, &head,
+				     transop, NULL, NULL, &trans);
         if (rc != 0) {
                 CERROR("Can't create transaction: %d\n", rc);
                 return rc;
@@ -1502,15 +1546,17 @@ lstcon_ndlist_stat(struct list_head *ndlist,
 
         lstcon_rpc_trans_postwait(trans, LST_VALIDATE_TIMEOUT(timeout));
 
-        rc = lstcon_rpc_trans_interpreter(trans, result_up,
-                                          lstcon_statrpc_readent);
+	rc = lstcon_rpc_trans_interpreter(trans, result_up,
+					  transop == LST_TRANS_HISTQRY ?
+					  lstcon_histrpc_readent :
+					  lstcon_statrpc_readent);
         lstcon_rpc_trans_destroy(trans);
 
         return rc;
 }
 
 int
-lstcon_group_stat(char *grp_name, int timeout,
+lstcon_group_stat(char *grp_name, int transop, int timeout,
 		  struct list_head __user *result_up)
 {
 	struct lstcon_group *grp;
@@ -1522,7 +1568,8 @@ lstcon_group_stat(char *grp_name, int timeout,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&grp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&grp->grp_ndl_list, transop, timeout,
+				result_up);
 
 	lstcon_group_decref(grp);
 
@@ -1531,7 +1578,7 @@ lstcon_group_stat(char *grp_name, int timeout,
 
 int
 lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
-		  int timeout, struct list_head __user *result_up)
+		  int transop, int timeout, struct list_head __user *result_up)
 {
 	struct lstcon_ndlink *ndl;
 	struct lstcon_group *tmp;
@@ -1566,7 +1613,8 @@ lstcon_nodes_stat(int count, struct lnet_process_id __user *ids_up,
                 return rc;
         }
 
-        rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, timeout, result_up);
+	rc = lstcon_ndlist_stat(&tmp->grp_ndl_list, transop, timeout,
+				result_up);
 
 	lstcon_group_decref(tmp);
 
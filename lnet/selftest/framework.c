@@ -408,6 +408,44 @@ sfw_get_stats(struct srpc_stat_reqst *request, struct srpc_stat_reply *reply)
 	return 0;
 }
 
+static int
+sfw_get_hists(struct srpc_server_rpc *rpc)
+{
+	struct sfw_session *sn = sfw_data.fw_session;
+	struct srpc_hist_reqst *request;
+	struct srpc_hist_reply *reply;
+	struct lst_lat_hists *hists;
+	int rc;
+
+	request = &rpc->srpc_reqstbuf->buf_msg.msg_body.hist_reqst;
+	reply = &rpc->srpc_replymsg.msg_body.hist_reply;
+	reply->hqr_sid = (sn == NULL) ? LST_INVALID_SID : sn->sn_id;
+
+	if (request->hqr_sid.ses_nid == LNET_NID_ANY) {
+		reply->hqr_status = EINVAL;
+		return 0;
+	}
+
+	if (sn == NULL || !sfw_sid_equal(request->hqr_sid, sn->sn_id)) {
+		reply->hqr_status = ESRCH;
+		return 0;
+	}
+
+	/* the histograms are PUT to the console once this returns */
+	rc = sfw_alloc_pages(rpc, CFS_CPT_ANY, 1, sizeof(*hists), 0);
+	if (rc != 0) {
+		reply->hqr_status = -rc;
+		return 0;
+	}
+
+	hists = page_address(rpc->srpc_bulk->bk_iovs[0].bv_page);
+	sfw_lat_hist_get(&sn->sn_brw_lat, &hists->lhs_brw);
+	sfw_lat_hist_get(&sn->sn_ping_lat, &hists->lhs_ping);
+
+	reply->hqr_status = 0;
+	return 0;
+}
+
 int
 sfw_make_session(struct srpc_mksn_reqst *request, struct srpc_mksn_reply *reply)
 {
@@ -867,15 +905,70 @@ sfw_test_unit_done(struct sfw_test_unit *tsu)
 	sfw_destroy_session(sn);
 }
 
+static void
+sfw_lat_hist_add(struct sfw_lat_hist *hist, s64 usec)
+{
+	unsigned int idx;
+	s64 max;
+
+	if (usec < 0)
+		usec = 0;
+
+	if (usec < (1 << LST_HIST_SUB_BITS)) {
+		idx = usec;
+	} else if (usec >= (1LL << 32)) {
+		idx = LST_HIST_NBUCKETS - 1;
+	} else {
+		int order = fls64(usec) - 1;
+
+		/* the top LST_HIST_SUB_BITS bits below the leading one */
+		idx = ((order - LST_HIST_SUB_BITS + 1) << LST_HIST_SUB_BITS) +
+		      ((usec >> (order - LST_HIST_SUB_BITS)) &
+		       ((1 << LST_HIST_SUB_BITS) - 1));
+	}
+
+	atomic_inc(&hist->slh_buckets[idx]);
+	atomic64_inc(&hist->slh_count);
+	atomic64_add(usec, &hist->slh_sum_us);
+
+	max = atomic64_read(&hist->slh_max_us);
+	while (usec > max) {
+		s64 old = atomic64_cmpxchg(&hist->slh_max_us, max, usec);
+
+		if (old == max)
+			break;
+		max = old;
+	}
+}
+
+static void
+sfw_lat_hist_get(struct sfw_lat_hist *hist, struct lst_lat_hist *lh)
+{
+	int i;
+
+	lh->lh_count = atomic64_read(&hist->slh_count);
+	lh->lh_sum_us = atomic64_read(&hist->slh_sum_us);
+	lh->lh_max_us = atomic64_read(&hist->slh_max_us);
+	for (i = 0; i < LST_HIST_NBUCKETS; i++)
+		lh->lh_buckets[i] = atomic_read(&hist->slh_buckets[i]);
+}
+
 static void
 sfw_test_rpc_done(struct srpc_client_rpc *rpc)
 {
 	struct sfw_test_unit *tsu = rpc->crpc_priv;
 	struct sfw_test_instance *tsi = tsu->tsu_instance;
+	struct sfw_session *sn = tsi->tsi_batch->bat_session;
+	s64 usec = ktime_us_delta(ktime_get(), rpc->crpc_posted);
         int                  done = 0;
 
         tsi->tsi_ops->tso_done_rpc(tsu, rpc);
 
+	/* only the RPCs which passed the checks of the test count */
+	if (rpc->crpc_status == 0)
+		sfw_lat_hist_add(tsi->tsi_service == SRPC_SERVICE_BRW ?
+				 &sn->sn_brw_lat : &sn->sn_ping_lat, usec);
+
 	spin_lock(&tsi->tsi_lock);
 
 	LASSERT(sfw_test_active(tsi));
@@ -1304,6 +1397,10 @@ sfw_handle_server_rpc(struct srpc_server_rpc *rpc)
                                    &reply->msg_body.stat_reply);
                 break;
 
+	case SRPC_SERVICE_QUERY_HIST:
+		rc = sfw_get_hists(rpc);
+		break;
+
         case SRPC_SERVICE_DEBUG:
                 rc = sfw_debug_session(&request->msg_body.dbg_reqst,
                                        &reply->msg_body.dbg_reply);
@@ -1449,6 +1546,23 @@ sfw_unpack_message(struct srpc_msg *msg)
                 return;
         }
 
+	if (msg->msg_type == SRPC_MSG_HIST_REQST) {
+		struct srpc_hist_reqst *req = &msg->msg_body.hist_reqst;
+
+		__swab64s(&req->hqr_rpyid);
+		__swab64s(&req->hqr_bulkid);
+		sfw_unpack_sid(req->hqr_sid);
+		return;
+	}
+
+	if (msg->msg_type == SRPC_MSG_HIST_REPLY) {
+		struct srpc_hist_reply *rep = &msg->msg_body.hist_reply;
+
+		__swab32s(&rep->hqr_status);
+		sfw_unpack_sid(rep->hqr_sid);
+		return;
+	}
+
         if (msg->msg_type == SRPC_MSG_MKSN_REQST) {
 		struct srpc_mksn_reqst *req = &msg->msg_body.mksn_reqst;
 
@@ -1593,6 +1707,7 @@ sfw_post_rpc(struct srpc_client_rpc *rpc)
 static struct srpc_service sfw_services[] = {
 	{ .sv_id = SRPC_SERVICE_DEBUG,		.sv_name = "debug", },
 	{ .sv_id = SRPC_SERVICE_QUERY_STAT,	.sv_name = "query stats", },
+	{ .sv_id = SRPC_SERVICE_QUERY_HIST,	.sv_name = "query histograms", },
 	{ .sv_id = SRPC_SERVICE_MAKE_SESSION,	.sv_name = "make session", },
 	{ .sv_id = SRPC_SERVICE_REMOVE_SESSION,	.sv_name = "remove session", },
 	{ .sv_id = SRPC_SERVICE_BATCH,		.sv_name = "batch service", },
@@ -876,7 +876,9 @@ srpc_do_bulk(struct srpc_server_rpc *rpc)
 	LASSERT(bk != NULL);
 
 	opt = bk->bk_sink ? LNET_MD_OP_GET : LNET_MD_OP_PUT;
-	opt |= LNET_MD_KIOV;
+	/* the client matches the bulk by id whichever NIs it comes over,
+	 * same as the bulk transfers of ptlrpc */
+	opt |= LNET_MD_KIOV | LNET_MD_MR_STRIPE;
 
 	ev->ev_fired = 0;
 	ev->ev_data  = rpc;
@@ -1353,6 +1355,7 @@ srpc_post_rpc(struct srpc_client_rpc *rpc)
 	       libcfs_id2str(rpc->crpc_dest), rpc->crpc_service,
 	       rpc->crpc_timeout);
 
+	rpc->crpc_posted = ktime_get();
 	srpc_add_client_rpc_timer(rpc);
 	swi_schedule_workitem(&rpc->crpc_wi);
 }
@@ -59,6 +59,8 @@ enum srpc_msg_type {
         SRPC_MSG_PING_REPLY     = 15,
         SRPC_MSG_JOIN_REQST     = 16,
         SRPC_MSG_JOIN_REPLY     = 17,
+	SRPC_MSG_HIST_REQST	= 18,
+	SRPC_MSG_HIST_REPLY	= 19,
 };
 
 /* CAVEAT EMPTOR:
@@ -164,6 +166,18 @@ struct srpc_stat_reply {
 	struct lnet_counters_common str_lnet;
 } WIRE_ATTR;
 
+struct srpc_hist_reqst {
+	__u64			hqr_rpyid;	/* reply buffer matchbits */
+	__u64			hqr_bulkid;	/* bulk buffer matchbits */
+	struct lst_sid		hqr_sid;
+} WIRE_ATTR;
+
+/* struct lst_lat_hists is PUT to the bulk buffer of the request */
+struct srpc_hist_reply {
+	__u32			hqr_status;
+	struct lst_sid		hqr_sid;
+} WIRE_ATTR;
+
 struct test_bulk_req {
         __u32                   blk_opc;        /* bulk operation code */
         __u32                   blk_npg;        /* # of pages */
@@ -270,6 +284,8 @@ struct srpc_msg {
 		struct srpc_test_reply		tes_reply;
 		struct srpc_join_reqst		join_reqst;
 		struct srpc_join_reply		join_reply;
+		struct srpc_hist_reqst		hist_reqst;
+		struct srpc_hist_reply		hist_reply;
 
 		struct srpc_ping_reqst		ping_reqst;
 		struct srpc_ping_reply		ping_reply;
@@ -77,6 +77,7 @@ struct sfw_test_instance;
 #define SRPC_SERVICE_TEST               4
 #define SRPC_SERVICE_QUERY_STAT         5
 #define SRPC_SERVICE_JOIN               6
+#define SRPC_SERVICE_QUERY_HIST		7
 #define SRPC_FRAMEWORK_SERVICE_MAX_ID   10
 /* other services start from SRPC_FRAMEWORK_SERVICE_MAX_ID+1 */
 #define SRPC_SERVICE_BRW                11
@@ -121,6 +122,9 @@ srpc_service2request (int service)
 
         case SRPC_SERVICE_JOIN:
                 return SRPC_MSG_JOIN_REQST;
+
+	case SRPC_SERVICE_QUERY_HIST:
+		return SRPC_MSG_HIST_REQST;
         }
 }
 
@@ -212,6 +216,7 @@ struct srpc_client_rpc {
         void               (*crpc_fini)(struct srpc_client_rpc *);
         int                  crpc_status;    /* completion status */
         void                *crpc_priv;      /* caller data */
+	ktime_t			crpc_posted;	/* time of posting */
 
         /* state flags */
         unsigned int         crpc_aborted:1; /* being given up */
@@ -319,6 +324,14 @@ struct srpc_service {
 	int              (*sv_bulk_ready)(struct srpc_server_rpc *, int);
 };
 
+/* in-memory struct lst_lat_hist, updated locklessly by test RPCs */
+struct sfw_lat_hist {
+	atomic64_t		slh_count;
+	atomic64_t		slh_sum_us;
+	atomic64_t		slh_max_us;
+	atomic_t		slh_buckets[LST_HIST_NBUCKETS];
+};
+
 struct sfw_session {
 	/* chain on fw_zombie_sessions */
 	struct list_head	sn_list;
@@ -334,6 +347,9 @@ struct sfw_session {
 	atomic_t		sn_brw_errors;
 	atomic_t		sn_ping_errors;
 	ktime_t			sn_started;
+	/* latency of the RPCs of client tests */
+	struct sfw_lat_hist	sn_brw_lat;
+	struct sfw_lat_hist	sn_ping_lat;
 };
 
 #define sfw_sid_equal(sid0, sid1)     ((sid0).ses_nid == (sid1).ses_nid && \
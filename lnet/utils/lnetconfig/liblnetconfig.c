@@ -671,7 +671,7 @@ int lustre_lnet_discover_nid(char *ping_nids, int force, int seq_no,
 }
 
 static int lustre_lnet_handle_peer_nidlist(lnet_nid_t *nidlist, int num_nids,
-					   bool is_mr, __u32 cmd,
+					   bool is_mr, bool seed, __u32 cmd,
 					   char *cmd_type, char *err_str)
 {
 	struct lnet_ioctl_peer_cfg data;
@@ -686,9 +686,13 @@ static int lustre_lnet_handle_peer_nidlist(lnet_nid_t *nidlist, int num_nids,
 		data.prcfg_mr = is_mr;
 		data.prcfg_prim_nid = nidlist[0];
 		data.prcfg_cfg_nid = LNET_NID_ANY;
+		data.prcfg_state = seed ? LNET_PEER_ADD_SEED : 0;
 
 		rc = dispatch_peer_ni_cmd(cmd, &data, err_str, cmd_type);
 
+		/* A peer LNet already knows is fresher than the cached one */
+		if (seed && rc == -EEXIST)
+			return LUSTRE_CFG_RC_NO_ERR;
 		if (rc)
 			return rc;
 	}
@@ -701,9 +705,14 @@ static int lustre_lnet_handle_peer_nidlist(lnet_nid_t *nidlist, int num_nids,
 		data.prcfg_mr = is_mr;
 		data.prcfg_prim_nid = nidlist[0];
 		data.prcfg_cfg_nid = nidlist[nid_idx];
+		if (cmd == IOC_LIBCFS_ADD_PEER_NI)
+			data.prcfg_state = seed ? LNET_PEER_ADD_SEED : 0;
 
 		rc = dispatch_peer_ni_cmd(cmd, &data, err_str, cmd_type);
 
+		/* the NID has moved to another peer since it was cached */
+		if (seed && rc == -EEXIST)
+			rc = LUSTRE_CFG_RC_NO_ERR;
 		if (rc)
 			return rc;
 	}
@@ -723,9 +732,10 @@ static int lustre_lnet_handle_peer_nidlist(lnet_nid_t *nidlist, int num_nids,
 	return rc;
 }
 
-int lustre_lnet_config_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
-				    int num_nids, bool is_mr, int seq_no,
-				    struct cYAML **err_rc)
+static int lustre_lnet_add_peer_nidlist(char *pnidstr,
+					lnet_nid_t *lnet_nidlist,
+					int num_nids, bool is_mr, bool seed,
+					int seq_no, struct cYAML **err_rc)
 {
 	int rc = LUSTRE_CFG_RC_NO_ERR;
 	char err_str[LNET_MAX_STR_LEN];
@@ -756,7 +766,7 @@ int lustre_lnet_config_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
 
 	rc = lustre_lnet_handle_peer_nidlist((pnidstr) ? lnet_nidlist2 :
 							 lnet_nidlist,
-					     num_nids, is_mr,
+					     num_nids, is_mr, seed,
 					     IOC_LIBCFS_ADD_PEER_NI, ADD_CMD,
 					     err_str);
 out:
@@ -767,6 +777,22 @@ out:
 	return rc;
 }
 
+int lustre_lnet_config_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
+				    int num_nids, bool is_mr, int seq_no,
+				    struct cYAML **err_rc)
+{
+	return lustre_lnet_add_peer_nidlist(pnidstr, lnet_nidlist, num_nids,
+					    is_mr, false, seq_no, err_rc);
+}
+
+int lustre_lnet_seed_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
+				  int num_nids, bool is_mr, int seq_no,
+				  struct cYAML **err_rc)
+{
+	return lustre_lnet_add_peer_nidlist(pnidstr, lnet_nidlist, num_nids,
+					    is_mr, true, seq_no, err_rc);
+}
+
 int lustre_lnet_del_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
 				 int num_nids, int seq_no,
 				 struct cYAML **err_rc)
@@ -805,7 +831,8 @@ int lustre_lnet_del_peer_nidlist(char *pnidstr, lnet_nid_t *lnet_nidlist,
 						(num_nids - 1));
 
 	rc = lustre_lnet_handle_peer_nidlist(lnet_nidlist2, num_nids, false,
-					     IOC_LIBCFS_DEL_PEER_NI, DEL_CMD,
+					     false, IOC_LIBCFS_DEL_PEER_NI,
+					     DEL_CMD,
 					     err_str);
 out:
 	if (lnet_nidlist2)
@@ -1965,7 +1992,7 @@ int lustre_lnet_show_net(char *nw, int detail, int seq_no,
 		*net_node = NULL, *interfaces = NULL,
 		*item = NULL, *first_seq = NULL,
 		*tmp = NULL, *statistics = NULL,
-		*yhstats = NULL;
+		*yhstats = NULL, *lnd_tunables = NULL;
 	int str_buf_len = LNET_MAX_SHOW_NUM_CPT * 2;
 	char str_buf[str_buf_len];
 	char *pos;
@@ -2207,16 +2234,21 @@ continue_without_msg_stats:
 			if (rc != LUSTRE_CFG_RC_NO_ERR)
 				goto out;
 
-			rc = lustre_ni_show_tunables(tunables, LNET_NETTYP(rc_net),
-						     &lnd->lt_tun);
-			if (rc != LUSTRE_CFG_RC_NO_ERR &&
-			    rc != LUSTRE_CFG_RC_NO_MATCH)
+			/* only added if the LND has tunables of its own, in
+			 * the form yaml_extract_tunables() reads them back */
+			lnd_tunables = cYAML_create_object(NULL,
+							   "lnd tunables");
+			if (lnd_tunables == NULL)
 				goto out;
 
-			if (rc != LUSTRE_CFG_RC_NO_MATCH) {
-				tunables = cYAML_create_object(item,
-							       "lnd tunables");
-				if (tunables == NULL)
+			rc = lustre_ni_show_tunables(lnd_tunables,
+						     LNET_NETTYP(rc_net),
+						     &lnd->lt_tun);
+			if (rc == LUSTRE_CFG_RC_NO_ERR) {
+				cYAML_insert_child(item, lnd_tunables);
+			} else {
+				cYAML_free_tree(lnd_tunables);
+				if (rc != LUSTRE_CFG_RC_NO_MATCH)
 					goto out;
 			}
 
@@ -2592,6 +2624,7 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 	char err_str[LNET_MAX_STR_LEN];
 	char node_name[LNET_MAX_STR_LEN];
 	bool exist = false;
+	bool ext = false;
 
 	snprintf(err_str, sizeof(err_str), "\"out of memory\"");
 
@@ -2627,6 +2660,7 @@ int lustre_lnet_show_routing(int seq_no, struct cYAML **show_rc,
 		exist = true;
 
 		pool_cfg = (struct lnet_ioctl_pool_cfg *)data->cfg_bulk;
+		ext = pool_cfg->pl_ext_flags & LNET_POOL_CFG_EXT;
 
 		if (backup)
 			goto calculate_buffers;
@@ -2671,10 +2705,39 @@ calculate_buffers:
 						pool_cfg->pl_pools[j].
 						   pl_mincredits) == NULL)
 				goto out;
+			if (!ext) {
+				/* the kernel has no autoscaler */
+				buf_count[j] += pool_cfg->pl_pools[j].
+						pl_nbuffers;
+				continue;
+			}
+			if (!backup &&
+			    cYAML_create_number(type_node, "configured",
+						pool_cfg->pl_cfg_nbuffers[j]) ==
+			    NULL)
+				goto out;
+			if (!backup &&
+			    cYAML_create_number(type_node, "grown",
+						pool_cfg->pl_grown[j]) == NULL)
+				goto out;
+			if (!backup &&
+			    cYAML_create_number(type_node, "shrunk",
+						pool_cfg->pl_shrunk[j]) == NULL)
+				goto out;
 			/* keep track of the total count for each of the
-			 * tiny, small and large buffers */
-			buf_count[j] += pool_cfg->pl_pools[j].pl_nbuffers;
+			 * tiny, small and large buffers, as configured
+			 * rather than as grown by the autoscaler */
+			buf_count[j] += pool_cfg->pl_cfg_nbuffers[j];
 		}
+
+		if (!backup && ext &&
+		    cYAML_create_number(cpt, "boosted_peers",
+					pool_cfg->pl_boosted_peers) == NULL)
+			goto out;
+		if (!backup && ext &&
+		    cYAML_create_number(cpt, "boosted_credits",
+					pool_cfg->pl_boosted_credits) == NULL)
+			goto out;
 	}
 
 	if (pool_cfg != NULL) {
@@ -2694,6 +2757,20 @@ calculate_buffers:
 		if (cYAML_create_number(item, "enable", pool_cfg->pl_routing) ==
 		    NULL)
 			goto out;
+
+		if (!ext)
+			goto add_buffer_section;
+
+		if (cYAML_create_number(item, "autoscale",
+					pool_cfg->pl_autoscale) == NULL)
+			goto out;
+		if (cYAML_create_number(item, "autoscale_max",
+					pool_cfg->pl_autoscale_max) == NULL)
+			goto out;
+		if (cYAML_create_number(item, "autoscale_interval",
+					pool_cfg->pl_autoscale_interval) ==
+		    NULL)
+			goto out;
 	}
 
 add_buffer_section:
@@ -3705,6 +3782,42 @@ int lustre_lnet_show_stats(int seq_no, struct cYAML **show_rc,
 				 cntrs->lct_common.lcc_drop_length))
 		goto out;
 
+	if (!cYAML_create_number(stats, "msgs_arena_cached",
+				 cntrs->lct_arena.lca_msgs_cached))
+		goto out;
+
+	if (!cYAML_create_number(stats, "msgs_arena_hiwater",
+				 cntrs->lct_arena.lca_msgs_hiwater))
+		goto out;
+
+	if (!cYAML_create_number(stats, "msgs_arena_misses",
+				 cntrs->lct_arena.lca_msgs_misses))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mds_arena_cached",
+				 cntrs->lct_arena.lca_mds_cached))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mds_arena_hiwater",
+				 cntrs->lct_arena.lca_mds_hiwater))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mds_arena_misses",
+				 cntrs->lct_arena.lca_mds_misses))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mes_arena_cached",
+				 cntrs->lct_arena.lca_mes_cached))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mes_arena_hiwater",
+				 cntrs->lct_arena.lca_mes_hiwater))
+		goto out;
+
+	if (!cYAML_create_number(stats, "mes_arena_misses",
+				 cntrs->lct_arena.lca_mes_misses))
+		goto out;
+
 	if (!show_rc)
 		cYAML_print_tree(root);
 
@@ -4190,7 +4303,7 @@ static int yaml_nids2nidstr(struct cYAML *nids_entry, char **nidstr,
 }
 
 static int handle_yaml_peer_common(struct cYAML *tree, struct cYAML **show_rc,
-				   struct cYAML **err_rc, int cmd)
+				   struct cYAML **err_rc, int cmd, bool seed)
 {
 	int rc, num_nids = 0, seqn;
 	bool mr_value;
@@ -4253,9 +4366,16 @@ static int handle_yaml_peer_common(struct cYAML *tree, struct cYAML **show_rc,
 			}
 		}
 
-		rc = lustre_lnet_config_peer_nidlist(prim_nidstr, lnet_nidlist,
-						     num_nids, mr_value, seqn,
-						     err_rc);
+		if (seed)
+			rc = lustre_lnet_seed_peer_nidlist(prim_nidstr,
+							   lnet_nidlist,
+							   num_nids, mr_value,
+							   seqn, err_rc);
+		else
+			rc = lustre_lnet_config_peer_nidlist(prim_nidstr,
+							     lnet_nidlist,
+							     num_nids, mr_value,
+							     seqn, err_rc);
 	} else
 		rc = lustre_lnet_del_peer_nidlist(prim_nidstr, lnet_nidlist,
 						  num_nids, seqn, err_rc);
@@ -4275,13 +4395,22 @@ failed:
 static int handle_yaml_config_peer(struct cYAML *tree, struct cYAML **show_rc,
 				   struct cYAML **err_rc)
 {
-	return handle_yaml_peer_common(tree, show_rc, err_rc, LNETCTL_ADD_CMD);
+	return handle_yaml_peer_common(tree, show_rc, err_rc, LNETCTL_ADD_CMD,
+				       false);
+}
+
+static int handle_yaml_seed_peer(struct cYAML *tree, struct cYAML **show_rc,
+				 struct cYAML **err_rc)
+{
+	return handle_yaml_peer_common(tree, show_rc, err_rc, LNETCTL_ADD_CMD,
+				       true);
 }
 
 static int handle_yaml_del_peer(struct cYAML *tree, struct cYAML **show_rc,
 				struct cYAML **err_rc)
 {
-	return handle_yaml_peer_common(tree, show_rc, err_rc, LNETCTL_DEL_CMD);
+	return handle_yaml_peer_common(tree, show_rc, err_rc, LNETCTL_DEL_CMD,
+				       false);
 }
 
 static int handle_yaml_config_buffers(struct cYAML *tree,
@@ -4743,6 +4872,20 @@ static struct lookup_cmd_hdlr_tbl lookup_exec_tbl[] = {
 	{ .name = "discover",	.cb = handle_yaml_discover },
 	{ .name = NULL } };
 
+static struct lookup_cmd_hdlr_tbl lookup_seed_tbl[] = {
+	{ .name = "route",	.cb = handle_yaml_no_op },
+	{ .name = "net",	.cb = handle_yaml_no_op },
+	{ .name = "peer",	.cb = handle_yaml_seed_peer },
+	{ .name = "ip2nets",	.cb = handle_yaml_no_op },
+	{ .name = "routing",	.cb = handle_yaml_no_op },
+	{ .name = "buffers",	.cb = handle_yaml_no_op },
+	{ .name = "statistics",	.cb = handle_yaml_no_op },
+	{ .name = "global",	.cb = handle_yaml_no_op },
+	{ .name = "numa",	.cb = handle_yaml_no_op },
+	{ .name = "ping",	.cb = handle_yaml_no_op },
+	{ .name = "discover",	.cb = handle_yaml_no_op },
+	{ .name = NULL } };
+
 static cmd_handler_t lookup_fn(char *key,
 			       struct lookup_cmd_hdlr_tbl *tbl)
 {
@@ -4827,3 +4970,9 @@ int lustre_yaml_exec(char *f, struct cYAML **show_rc, struct cYAML **err_rc)
 	return lustre_yaml_cb_helper(f, lookup_exec_tbl,
 				     show_rc, err_rc);
 }
+
+int lustre_yaml_seed(char *f, struct cYAML **err_rc)
+{
+	return lustre_yaml_cb_helper(f, lookup_seed_tbl,
+				     NULL, err_rc);
+}
@@ -535,6 +535,23 @@ int lustre_lnet_config_peer_nidlist(char *pnid, lnet_nid_t *lnet_nidlist,
 				    int num_nids, bool mr, int seq_no,
 				    struct cYAML **err_rc);
 
+/*
+ * lustre_lnet_seed_peer_nidlist
+ *  Add a peer loaded from a peer cache. Unlike a configured peer, a seeded
+ *  peer is used right away but revalidated by discovery, which may change
+ *  its NIDs. Peers and NIDs LNet already knows of are left untouched.
+ *
+ *	pnid - The primary NID of the peer
+ *	lnet_nidlist - List of LNet NIDs to add to the peer
+ *	num_nids - The number of LNet NIDs in the lnet_nidlist array
+ *	mr - Specifies whether this peer is MR capable.
+ *	seq_no - sequence number of the command
+ *	err_rc - YAML structure of the resultant return code
+ */
+int lustre_lnet_seed_peer_nidlist(char *pnid, lnet_nid_t *lnet_nidlist,
+				  int num_nids, bool mr, int seq_no,
+				  struct cYAML **err_rc);
+
 /*
  * lustre_lnet_del_peer_nidlist
  *  Delete the NIDs given in the NID list from the peer with the primary NID
@@ -651,6 +668,16 @@ int lustre_yaml_show(char *f, struct cYAML **show_rc,
 int lustre_yaml_exec(char *f, struct cYAML **show_rc,
 		     struct cYAML **err_rc);
 
+/*
+ * lustre_yaml_seed
+ *   Parses the provided YAML file, as written by "lnetctl peer save" or
+ *   "lnetctl export --backup", and seeds the peers found in it
+ *
+ *   f - YAML file
+ *   err_rc - [OUT] struct cYAML tree describing the error. Freed by caller
+ */
+int lustre_yaml_seed(char *f, struct cYAML **err_rc);
+
 /*
  * lustre_lnet_init_nw_descr
  *	initialize the network descriptor structure for use
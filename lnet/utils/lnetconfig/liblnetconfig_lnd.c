@@ -73,6 +73,25 @@ lustre_o2iblnd_show_tun(struct cYAML *lndparams,
 	return LUSTRE_CFG_RC_NO_ERR;
 }
 
+static int
+lustre_socklnd_show_tun(struct cYAML *lndparams,
+			struct lnet_ioctl_config_socklnd_tunables *lnd_cfg)
+{
+	if (cYAML_create_number(lndparams, "zerocopy",
+				lnd_cfg->lnd_zerocopy) == NULL)
+		return LUSTRE_CFG_RC_OUT_OF_MEM;
+
+	if (cYAML_create_number(lndparams, "rx_batch",
+				lnd_cfg->lnd_rx_batch) == NULL)
+		return LUSTRE_CFG_RC_OUT_OF_MEM;
+
+	if (cYAML_create_number(lndparams, "tls",
+				lnd_cfg->lnd_tls) == NULL)
+		return LUSTRE_CFG_RC_OUT_OF_MEM;
+
+	return LUSTRE_CFG_RC_NO_ERR;
+}
+
 int
 lustre_net_show_tunables(struct cYAML *tunables,
 			 struct lnet_ioctl_config_lnd_cmn_tunables *cmn)
@@ -116,6 +135,9 @@ lustre_ni_show_tunables(struct cYAML *lnd_tunables,
 	if (net_type == O2IBLND)
 		rc = lustre_o2iblnd_show_tun(lnd_tunables,
 					     &lnd->lnd_tun_u.lnd_o2ib);
+	else if (net_type == SOCKLND)
+		rc = lustre_socklnd_show_tun(lnd_tunables,
+					     &lnd->lnd_tun_u.lnd_sock);
 
 	return rc;
 }
@@ -162,6 +184,29 @@ yaml_extract_o2ib_tun(struct cYAML *tree,
 		(conns_per_peer) ? conns_per_peer->cy_valueint : 1;
 }
 
+static void
+yaml_extract_sock_tun(struct cYAML *tree,
+		      struct lnet_ioctl_config_socklnd_tunables *lnd_cfg)
+{
+	struct cYAML *zerocopy = NULL, *rx_batch = NULL, *tls = NULL;
+	struct cYAML *lndparams = NULL;
+
+	lndparams = cYAML_get_object_item(tree, "lnd tunables");
+	if (!lndparams)
+		return;
+
+	/* a zero version tells ksocklnd to use its module parameters */
+	lnd_cfg->lnd_version = 1;
+
+	zerocopy = cYAML_get_object_item(lndparams, "zerocopy");
+	lnd_cfg->lnd_zerocopy = (zerocopy) ? !!zerocopy->cy_valueint : 0;
+
+	rx_batch = cYAML_get_object_item(lndparams, "rx_batch");
+	lnd_cfg->lnd_rx_batch = (rx_batch) ? rx_batch->cy_valueint : 0;
+
+	tls = cYAML_get_object_item(lndparams, "tls");
+	lnd_cfg->lnd_tls = (tls) ? !!tls->cy_valueint : 0;
+}
 
 void
 lustre_yaml_extract_lnd_tunables(struct cYAML *tree,
@@ -171,6 +216,9 @@ lustre_yaml_extract_lnd_tunables(struct cYAML *tree,
 	if (net_type == O2IBLND)
 		yaml_extract_o2ib_tun(tree,
 				      &tun->lnd_tun_u.lnd_o2ib);
+	else if (net_type == SOCKLND)
+		yaml_extract_sock_tun(tree,
+				      &tun->lnd_tun_u.lnd_sock);
 
 }
 
@@ -23,11 +23,13 @@
  * Author:
  *   Amir Shehata <amir.shehata@intel.com>
  */
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <unistd.h>
 #include <libcfs/util/ioctl.h>
 #include <libcfs/util/parser.h>
 #include <cyaml.h>
@@ -65,6 +67,8 @@ static int jt_set_max_intf(int argc, char **argv);
 static int jt_set_discovery(int argc, char **argv);
 static int jt_set_drop_asym_route(int argc, char **argv);
 static int jt_list_peer(int argc, char **argv);
+static int jt_save_peer(int argc, char **argv);
+static int jt_load_peer(int argc, char **argv);
 /*static int jt_show_peer(int argc, char **argv);*/
 static int lnetctl_list_commands(int argc, char **argv);
 static int jt_import(int argc, char **argv);
@@ -235,6 +239,11 @@ command_t peer_cmds[] = {
 	 "\t--verbose: display detailed output per peer."
 		       " Optional argument of '2' outputs more stats\n"},
 	{"list", jt_list_peer, 0, "list all peers\n"},
+	{"save", jt_save_peer, 0, "save the known peers to a peer cache\n"
+	 "\tFILE: peer cache to write\n"},
+	{"load", jt_load_peer, 0, "seed the peers from a peer cache\n"
+	 "\tFILE: peer cache written by 'peer save' or 'export --backup'\n"
+	 "\tSeeded peers are used right away and revalidated by discovery\n"},
 	{"set", jt_set_peer_ni_value, 0, "set peer ni specific parameter\n"
 	 "\t--nid: Peer NI NID to set the\n"
 	 "\t--health: specify health value to set\n"
@@ -1850,6 +1859,64 @@ static int jt_list_peer(int argc, char **argv)
 	return rc;
 }
 
+static int jt_save_peer(int argc, char **argv)
+{
+	struct cYAML *err_rc = NULL, *show_rc = NULL;
+	char tmp[PATH_MAX];
+	FILE *f;
+	int rc;
+
+	rc = check_cmd(peer_cmds, "peer", "save", 2, argc, argv);
+	if (rc)
+		return rc;
+
+	rc = lustre_lnet_show_peer(NULL, 0, -1, &show_rc, &err_rc, true);
+	if (rc != LUSTRE_CFG_RC_NO_ERR) {
+		cYAML_print_tree2file(stderr, err_rc);
+		goto out;
+	}
+
+	/* don't leave a truncated cache behind for the next load */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", argv[1]);
+	f = fopen(tmp, "w");
+	if (f == NULL) {
+		rc = -errno;
+		fprintf(stderr, "cannot open %s: %s\n", tmp, strerror(errno));
+		goto out;
+	}
+	if (show_rc)
+		cYAML_print_tree2file(f, show_rc);
+	if (fclose(f) != 0 || rename(tmp, argv[1]) != 0) {
+		rc = -errno;
+		fprintf(stderr, "cannot write %s: %s\n", argv[1],
+			strerror(errno));
+		unlink(tmp);
+	}
+out:
+	cYAML_free_tree(err_rc);
+	cYAML_free_tree(show_rc);
+
+	return rc;
+}
+
+static int jt_load_peer(int argc, char **argv)
+{
+	struct cYAML *err_rc = NULL;
+	int rc;
+
+	rc = check_cmd(peer_cmds, "peer", "load", 2, argc, argv);
+	if (rc)
+		return rc;
+
+	rc = lustre_yaml_seed(argv[1], &err_rc);
+	if (rc != LUSTRE_CFG_RC_NO_ERR)
+		cYAML_print_tree2file(stderr, err_rc);
+
+	cYAML_free_tree(err_rc);
+
+	return rc;
+}
+
 static int jt_ping(int argc, char **argv)
 {
 	struct cYAML *err_rc = NULL;
@@ -51,6 +51,7 @@
 #include <linux/lnet/lnetctl.h>
 #include <linux/lnet/lnetst.h>
 #include <linux/lnet/nidstr.h>
+#include <cyaml.h>
 #include "lnetconfig/liblnetconfig.h"
 
 struct lst_sid LST_INVALID_SID = { .ses_nid = LNET_NID_ANY, .ses_stamp = -1 };
@@ -58,7 +59,8 @@ static struct lst_sid session_id;
 static int                 session_key;
 static int lst_list_commands(int argc, char **argv);
 
-/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN */
+/* All nodes running 2.6.50 or later understand feature LST_FEAT_BULK_LEN,
+ * sessions with older nodes than LST_FEAT_LAT_HIST need LST_FEATURES=1 */
 static unsigned		session_features = LST_FEATS_MASK;
 static struct lstcon_trans_stat	trans_stat;
 
@@ -1485,8 +1487,9 @@ jt_lst_list_group(int argc, char **argv)
 }
 
 int
-lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
-	       int timeout, struct list_head *resultp)
+lst_stat_ioctl(unsigned int opc, char *name, int count,
+	       struct lnet_process_id *idsp, int timeout,
+	       struct list_head *resultp)
 {
 	struct lstio_stat_args args = { 0 };
 
@@ -1498,7 +1501,7 @@ lst_stat_ioctl(char *name, int count, struct lnet_process_id *idsp,
 	args.lstio_sta_idsp    = idsp;
 	args.lstio_sta_resultp = resultp;
 
-	return lst_ioctl(LSTIO_STAT_QUERY, &args, sizeof(args));
+	return lst_ioctl(opc, &args, sizeof(args));
 }
 
 typedef struct {
@@ -1524,7 +1527,8 @@ lst_stat_req_param_free(lst_stat_req_param_t *srp)
 }
 
 static int
-lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
+lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old,
+			 int hist)
 {
         lst_stat_req_param_t *srp = NULL;
         int                   count = save_old ? 2 : 1;
@@ -1559,6 +1563,7 @@ lst_stat_req_param_alloc(char *name, lst_stat_req_param_t **srpp, int save_old)
 
 	for (i = 0; i < count; i++) {
 		rc = lst_alloc_rpcent(&srp->srp_result[i], srp->srp_count,
+				      hist ? sizeof(struct lst_lat_hists) :
 				      sizeof(struct sfw_counters)  +
 				      sizeof(struct srpc_counters) +
 				      sizeof(struct lnet_counters_common));
@@ -1870,6 +1875,166 @@ lst_print_stat(char *name, struct list_head *resultp,
 	lst_print_lnet_stat(name, bwrt, rdwr, type, mbs);
 }
 
+/* lowest and highest latency counted by bucket @idx of struct lst_lat_hist */
+static void
+lst_hist_bucket_range(int idx, __u64 *lo, __u64 *hi)
+{
+	int sub = 1 << LST_HIST_SUB_BITS;
+	int shift;
+
+	if (idx < sub) {
+		*lo = *hi = idx;
+		return;
+	}
+
+	shift = idx / sub - 1;
+	*lo = (__u64)(sub + idx % sub) << shift;
+	*hi = *lo + (1ULL << shift) - 1;
+}
+
+/* latency within which @permille of the RPCs counted by @lh completed */
+static __u64
+lst_hist_percentile(struct lst_lat_hist *lh, int permille)
+{
+	__u64 rank = (lh->lh_count * permille + 999) / 1000;
+	__u64 sum = 0;
+	__u64 lo;
+	__u64 hi;
+	int i;
+
+	if (lh->lh_count == 0)
+		return 0;
+
+	for (i = 0; i < LST_HIST_NBUCKETS - 1; i++) {
+		sum += lh->lh_buckets[i];
+		if (sum >= rank)
+			break;
+	}
+
+	lst_hist_bucket_range(i, &lo, &hi);
+	return hi < lh->lh_max_us ? hi : lh->lh_max_us;
+}
+
+static void
+lst_hist_add(struct lst_lat_hist *sum, struct lst_lat_hist *lh)
+{
+	int i;
+
+	sum->lh_count += lh->lh_count;
+	sum->lh_sum_us += lh->lh_sum_us;
+	if (lh->lh_max_us > sum->lh_max_us)
+		sum->lh_max_us = lh->lh_max_us;
+	for (i = 0; i < LST_HIST_NBUCKETS; i++)
+		sum->lh_buckets[i] += lh->lh_buckets[i];
+}
+
+/* @new - @old, the maximum of the interval is only known to a bucket */
+static void
+lst_hist_delta(struct lst_lat_hist *delta, struct lst_lat_hist *new,
+	       struct lst_lat_hist *old)
+{
+	__u64 lo;
+	__u64 hi = 0;
+	int i;
+
+	delta->lh_count = new->lh_count - old->lh_count;
+	delta->lh_sum_us = new->lh_sum_us - old->lh_sum_us;
+	for (i = 0; i < LST_HIST_NBUCKETS; i++) {
+		delta->lh_buckets[i] = new->lh_buckets[i] - old->lh_buckets[i];
+		if (delta->lh_buckets[i] != 0)
+			lst_hist_bucket_range(i, &lo, &hi);
+	}
+	delta->lh_max_us = hi < new->lh_max_us ? hi : new->lh_max_us;
+}
+
+static void
+lst_print_hist(char *type, struct lst_lat_hist *lh)
+{
+	fprintf(stdout, "[%s] RPCs: %llu, avg: %llu us, p50: %llu us, "
+		"p99: %llu us, p999: %llu us, max: %llu us\n", type,
+		(unsigned long long)lh->lh_count,
+		(unsigned long long)(lh->lh_count == 0 ? 0 :
+				     lh->lh_sum_us / lh->lh_count),
+		(unsigned long long)lst_hist_percentile(lh, 500),
+		(unsigned long long)lst_hist_percentile(lh, 990),
+		(unsigned long long)lst_hist_percentile(lh, 999),
+		(unsigned long long)lh->lh_max_us);
+}
+
+static void
+lst_print_latency(char *name, struct list_head *resultp, int idx)
+{
+	struct list_head tmp[2];
+	struct lstcon_rpc_ent *new;
+	struct lstcon_rpc_ent *old;
+	struct lst_lat_hists *hists_new;
+	struct lst_lat_hists *hists_old;
+	struct lst_lat_hists delta;
+	struct lst_lat_hists sum;
+	int errcount = 0;
+	int count = 0;
+
+	INIT_LIST_HEAD(&tmp[0]);
+	INIT_LIST_HEAD(&tmp[1]);
+
+	memset(&sum, 0, sizeof(sum));
+
+	while (!list_empty(&resultp[idx])) {
+		if (list_empty(&resultp[1 - idx])) {
+			fprintf(stderr, "Group is changed, re-run stat\n");
+			break;
+		}
+
+		new = list_entry(resultp[idx].next, struct lstcon_rpc_ent,
+				 rpe_link);
+		old = list_entry(resultp[1 - idx].next, struct lstcon_rpc_ent,
+				 rpe_link);
+
+		/* first time get stats result, can't calculate diff */
+		if (new->rpe_peer.nid == LNET_NID_ANY)
+			break;
+
+		if (new->rpe_peer.nid != old->rpe_peer.nid ||
+		    new->rpe_peer.pid != old->rpe_peer.pid) {
+			/* Something wrong. i.e, somebody change the group */
+			break;
+		}
+
+		list_move_tail(&new->rpe_link, &tmp[idx]);
+		list_move_tail(&old->rpe_link, &tmp[1 - idx]);
+
+		if (new->rpe_rpc_errno != 0 || new->rpe_fwk_errno != 0 ||
+		    old->rpe_rpc_errno != 0 || old->rpe_fwk_errno != 0) {
+			errcount++;
+			continue;
+		}
+
+		hists_new = (struct lst_lat_hists *)&new->rpe_payload[0];
+		hists_old = (struct lst_lat_hists *)&old->rpe_payload[0];
+
+		lst_hist_delta(&delta.lhs_brw, &hists_new->lhs_brw,
+			       &hists_old->lhs_brw);
+		lst_hist_delta(&delta.lhs_ping, &hists_new->lhs_ping,
+			       &hists_old->lhs_ping);
+		lst_hist_add(&sum.lhs_brw, &delta.lhs_brw);
+		lst_hist_add(&sum.lhs_ping, &delta.lhs_ping);
+		count++;
+	}
+
+	list_splice(&tmp[idx], &resultp[idx]);
+	list_splice(&tmp[1 - idx], &resultp[1 - idx]);
+
+	if (errcount > 0)
+		fprintf(stdout, "Failed to stat on %d nodes\n", errcount);
+
+	if (count == 0)
+		return;
+
+	fprintf(stdout, "[LNet Latency of %s]\n", name);
+	lst_print_hist("BRW", &sum.lhs_brw);
+	lst_print_hist("PING", &sum.lhs_ping);
+}
+
 int
 jt_lst_stat(int argc, char **argv)
 {
@@ -1888,6 +2053,7 @@ jt_lst_stat(int argc, char **argv)
 	int		      rc;
 	int		      c;
 	int		      mbs     = 0; /* report as MB/s */
+	int		      latency = 0;
 
 	static const struct option stat_opts[] = {
 		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
@@ -1903,6 +2069,7 @@ jt_lst_stat(int argc, char **argv)
 		{ .name = "min",     .has_arg = no_argument,       .val = 'n' },
 		{ .name = "max",     .has_arg = no_argument,       .val = 'x' },
 		{ .name = "mbs",     .has_arg = no_argument,       .val = 'm' },
+		{ .name = "latency", .has_arg = no_argument,       .val = 'L' },
 		{ .name = NULL } };
 
         if (session_key == 0) {
@@ -1912,7 +2079,7 @@ jt_lst_stat(int argc, char **argv)
         }
 
         while (1) {
-		c = getopt_long(argc, argv, "t:d:lcbarwgnxm", stat_opts,
+		c = getopt_long(argc, argv, "t:d:lcbarwgnxmL", stat_opts,
 				&optidx);
 
                 if (c == -1)
@@ -1970,6 +2137,9 @@ jt_lst_stat(int argc, char **argv)
 		case 'm':
 			mbs = 1;
 			break;
+		case 'L':
+			latency = 1;
+			break;
 
 		default:
 			lst_print_usage(argv[0]);
@@ -1999,7 +2169,8 @@ jt_lst_stat(int argc, char **argv)
 	INIT_LIST_HEAD(&head);
 
         while (optind < argc) {
-                rc = lst_stat_req_param_alloc(argv[optind++], &srp, 1);
+		rc = lst_stat_req_param_alloc(argv[optind++], &srp, 1,
+					      latency);
                 if (rc != 0)
                         goto out;
 
@@ -2016,17 +2187,23 @@ jt_lst_stat(int argc, char **argv)
 		last = now;
 
 		list_for_each_entry(srp, &head, srp_link) {
-                        rc = lst_stat_ioctl(srp->srp_name,
-                                            srp->srp_count, srp->srp_ids,
-                                            timeout, &srp->srp_result[idx]);
+			rc = lst_stat_ioctl(latency ? LSTIO_HIST_QUERY :
+					    LSTIO_STAT_QUERY, srp->srp_name,
+					    srp->srp_count, srp->srp_ids,
+					    timeout, &srp->srp_result[idx]);
                         if (rc == -1) {
                                 lst_print_error("stat", "Failed to stat %s: %s\n",
                                                 srp->srp_name, strerror(errno));
                                 goto out;
                         }
 
-			lst_print_stat(srp->srp_name, srp->srp_result,
-				       idx, lnet, bwrt, rdwr, type, mbs);
+			if (latency)
+				lst_print_latency(srp->srp_name,
+						  srp->srp_result, idx);
+			else
+				lst_print_stat(srp->srp_name, srp->srp_result,
+					       idx, lnet, bwrt, rdwr, type,
+					       mbs);
 
 			lst_reset_rpcent(&srp->srp_result[1 - idx]);
 		}
@@ -2097,7 +2274,7 @@ jt_lst_show_error(int argc, char **argv)
 	INIT_LIST_HEAD(&head);
 
         while (optind < argc) {
-                rc = lst_stat_req_param_alloc(argv[optind++], &srp, 0);
+		rc = lst_stat_req_param_alloc(argv[optind++], &srp, 0, 0);
                 if (rc != 0)
                         goto out;
 
@@ -2105,8 +2282,9 @@ jt_lst_show_error(int argc, char **argv)
         }
 
 	list_for_each_entry(srp, &head, srp_link) {
-                rc = lst_stat_ioctl(srp->srp_name, srp->srp_count,
-                                    srp->srp_ids, 10, &srp->srp_result[0]);
+		rc = lst_stat_ioctl(LSTIO_STAT_QUERY, srp->srp_name,
+				    srp->srp_count, srp->srp_ids, 10,
+				    &srp->srp_result[0]);
 
                 if (rc == -1) {
                         lst_print_error(srp->srp_name, "Failed to show errors of %s: %s\n",
@@ -2171,6 +2349,243 @@ out:
         return rc;
 }
 
+static void
+lst_json_print(struct cYAML *node, int level, bool key)
+{
+	struct cYAML *child;
+	bool object = node->cy_type == CYAML_TYPE_OBJECT;
+
+	fprintf(stdout, "%*s", level * 2, "");
+	if (key)
+		fprintf(stdout, "\"%s\": ", node->cy_string);
+
+	switch (node->cy_type) {
+	case CYAML_TYPE_NUMBER:
+		fprintf(stdout, "%.0f", node->cy_valuedouble);
+		return;
+	case CYAML_TYPE_STRING:
+		fprintf(stdout, "\"%s\"", node->cy_valuestring);
+		return;
+	case CYAML_TYPE_ARRAY:
+	case CYAML_TYPE_OBJECT:
+		break;
+	default:
+		fprintf(stdout, "null");
+		return;
+	}
+
+	fprintf(stdout, "%c", object ? '{' : '[');
+	for (child = node->cy_child; child != NULL; child = child->cy_next) {
+		fprintf(stdout, "\n");
+		lst_json_print(child, level + 1, object);
+		if (child->cy_next != NULL)
+			fprintf(stdout, ",");
+	}
+	fprintf(stdout, "\n%*s%c", level * 2, "", object ? '}' : ']');
+}
+
+static int
+lst_hist_yaml(struct cYAML *parent, char *type, struct lst_lat_hist *lh,
+	      bool buckets)
+{
+	struct cYAML *node;
+	struct cYAML *bkt;
+	char key[24];
+	__u64 lo;
+	__u64 hi;
+	int i;
+
+	node = cYAML_create_object(parent, type);
+	if (node == NULL ||
+	    cYAML_create_number(node, "rpcs", lh->lh_count) == NULL ||
+	    cYAML_create_number(node, "avg_us", lh->lh_count == 0 ? 0 :
+				lh->lh_sum_us / lh->lh_count) == NULL ||
+	    cYAML_create_number(node, "p50_us",
+				lst_hist_percentile(lh, 500)) == NULL ||
+	    cYAML_create_number(node, "p99_us",
+				lst_hist_percentile(lh, 990)) == NULL ||
+	    cYAML_create_number(node, "p999_us",
+				lst_hist_percentile(lh, 999)) == NULL ||
+	    cYAML_create_number(node, "max_us", lh->lh_max_us) == NULL)
+		return -ENOMEM;
+
+	if (!buckets)
+		return 0;
+
+	/* non-empty buckets, keyed by their lowest latency */
+	bkt = cYAML_create_object(node, "buckets");
+	if (bkt == NULL)
+		return -ENOMEM;
+
+	for (i = 0; i < LST_HIST_NBUCKETS; i++) {
+		if (lh->lh_buckets[i] == 0)
+			continue;
+
+		lst_hist_bucket_range(i, &lo, &hi);
+		snprintf(key, sizeof(key), "%llu", (unsigned long long)lo);
+		if (cYAML_create_number(bkt, key, lh->lh_buckets[i]) == NULL)
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static int
+lst_results_yaml(struct cYAML *seq, lst_stat_req_param_t *srp)
+{
+	struct lstcon_rpc_ent *ent;
+	struct lst_lat_hists *hists;
+	struct lst_lat_hists sum;
+	struct cYAML *item;
+	struct cYAML *nodes;
+	struct cYAML *node;
+	int rc;
+
+	memset(&sum, 0, sizeof(sum));
+
+	item = cYAML_create_seq_item(seq);
+	if (item == NULL ||
+	    cYAML_create_string(item, "name", srp->srp_name) == NULL)
+		return -ENOMEM;
+
+	nodes = cYAML_create_seq(item, "nodes");
+	if (nodes == NULL)
+		return -ENOMEM;
+
+	list_for_each_entry(ent, &srp->srp_result[0], rpe_link) {
+		node = cYAML_create_seq_item(nodes);
+		if (node == NULL ||
+		    cYAML_create_string(node, "id",
+					libcfs_id2str(ent->rpe_peer)) == NULL)
+			return -ENOMEM;
+
+		if (ent->rpe_rpc_errno != 0 || ent->rpe_fwk_errno != 0) {
+			if (cYAML_create_string(node, "error",
+					strerror(ent->rpe_rpc_errno != 0 ?
+						 ent->rpe_rpc_errno :
+						 ent->rpe_fwk_errno)) == NULL)
+				return -ENOMEM;
+			continue;
+		}
+
+		hists = (struct lst_lat_hists *)&ent->rpe_payload[0];
+		lst_hist_add(&sum.lhs_brw, &hists->lhs_brw);
+		lst_hist_add(&sum.lhs_ping, &hists->lhs_ping);
+
+		rc = lst_hist_yaml(node, "brw", &hists->lhs_brw, false);
+		if (rc == 0)
+			rc = lst_hist_yaml(node, "ping", &hists->lhs_ping,
+					   false);
+		if (rc != 0)
+			return rc;
+	}
+
+	rc = lst_hist_yaml(item, "brw", &sum.lhs_brw, true);
+	if (rc == 0)
+		rc = lst_hist_yaml(item, "ping", &sum.lhs_ping, true);
+
+	return rc;
+}
+
+int
+jt_lst_results(int argc, char **argv)
+{
+	lst_stat_req_param_t *srp;
+	struct cYAML *root;
+	struct cYAML *seq;
+	int		      optidx  = 0;
+	int		      timeout = 5; /* default timeout, 5 sec */
+	int		      json    = 0;
+	int		      rc      = -ENOMEM;
+	int		      c;
+
+	static const struct option results_opts[] = {
+		{ .name = "timeout", .has_arg = required_argument, .val = 't' },
+		{ .name = "format",  .has_arg = required_argument, .val = 'f' },
+		{ .name = NULL } };
+
+	if (session_key == 0) {
+		fprintf(stderr,
+			"Can't find env LST_SESSION or value is not valid\n");
+		return -1;
+	}
+
+	while (1) {
+		c = getopt_long(argc, argv, "t:f:", results_opts, &optidx);
+
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 't':
+			timeout = atoi(optarg);
+			break;
+		case 'f':
+			if (strcmp(optarg, "json") == 0) {
+				json = 1;
+				break;
+			}
+			if (strcmp(optarg, "yaml") == 0) {
+				json = 0;
+				break;
+			}
+			/* fallthrough */
+		default:
+			lst_print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (optind == argc || timeout <= 0) {
+		lst_print_usage(argv[0]);
+		return -1;
+	}
+
+	root = cYAML_create_object(NULL, NULL);
+	if (root == NULL)
+		goto oom;
+
+	seq = cYAML_create_seq(root, "results");
+	if (seq == NULL)
+		goto oom;
+
+	while (optind < argc) {
+		rc = lst_stat_req_param_alloc(argv[optind++], &srp, 0, 1);
+		if (rc != 0)
+			goto out;
+
+		rc = lst_stat_ioctl(LSTIO_HIST_QUERY, srp->srp_name,
+				    srp->srp_count, srp->srp_ids, timeout,
+				    &srp->srp_result[0]);
+		if (rc == -1) {
+			lst_print_error(srp->srp_name,
+					"Failed to get results of %s: %s\n",
+					srp->srp_name, strerror(errno));
+			lst_stat_req_param_free(srp);
+			goto out;
+		}
+
+		rc = lst_results_yaml(seq, srp);
+		lst_stat_req_param_free(srp);
+		if (rc != 0)
+			goto oom;
+	}
+
+	if (json) {
+		lst_json_print(root, 0, false);
+		fprintf(stdout, "\n");
+	} else {
+		cYAML_print_tree(root);
+	}
+	goto out;
+oom:
+	fprintf(stderr, "Out of memory\n");
+	rc = -1;
+out:
+	cYAML_free_tree(root);
+	return rc;
+}
+
 int
 lst_add_batch_ioctl(char *name)
 {
@@ -3259,7 +3674,9 @@ static command_t lst_cmdlist[] = {
           "Usage: lst list_group [--active] [--busy] [--down] [--unknown] GROUP ..."    },
 	{"stat",                jt_lst_stat,            NULL,
 	 "Usage: lst stat [--bw] [--rate] [--read] [--write] [--max] [--min] [--avg] "
-	 " [--mbs] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"                 },
+	 " [--mbs] [--latency] [--timeout #] [--delay #] [--count #] GROUP [GROUP]"     },
+	{"results",		jt_lst_results,		NULL,
+	 "Usage: lst results [--format yaml|json] [--timeout #] GROUP|IDS ..."        },
         {"show_error",          jt_lst_show_error,      NULL,
          "Usage: lst show_error NAME | IDS ..."                                         },
         {"add_batch",           jt_lst_add_batch,       NULL,
@@ -209,15 +209,19 @@ enum lprocfs_fields_flags {
 struct lprocfs_stats {
 	/* # of counters */
 	unsigned short			ls_num;
-	/* 1 + the biggest cpu # whose ls_percpu slot has been allocated */
-	unsigned short			ls_biggest_alloc_num;
 	enum lprocfs_stats_flags	ls_flags;
-	/* Lock used when there are no percpu stats areas; For percpu stats,
-	 * it is used to protect ls_biggest_alloc_num change */
+	/* 1 + the biggest cpu # whose ls_percpu slot has been allocated,
+	 * only ever increased, with cmpxchg() */
+	unsigned int			ls_biggest_alloc_num;
+	/* Lock used when there are no percpu stats areas */
 	spinlock_t			ls_lock;
 
 	/* has ls_num of counter headers */
 	struct lprocfs_counter_header	*ls_cnt_header;
+	/* Per-CPU counter areas, each padded to a cache line multiple. They
+	 * are allocated by the first update on that CPU and published with
+	 * cmpxchg(), and only freed with the stats, so readers walk them
+	 * without taking a lock. */
 	struct lprocfs_percpu		*ls_percpu[0];
 };
 
@@ -406,6 +410,8 @@ struct obd_job_stats {
 	cntr_init_callback	ojs_cntr_init_fn;/* lprocfs_stats initializer */
 	unsigned short		ojs_cntr_num;	/* number of stats in struct */
 	bool			ojs_cleaning;	/* currently expiring stats */
+	atomic_long_t		ojs_lat_bytes;	/* memory of latency histograms */
+	u64			ojs_lat_max;	/* limit of ojs_lat_bytes */
 };
 
 #ifdef CONFIG_PROC_FS
@@ -437,12 +443,12 @@ lprocfs_stats_counter_size(struct lprocfs_stats *stats)
 }
 
 static inline struct lprocfs_counter *
-lprocfs_stats_counter_get(struct lprocfs_stats *stats, unsigned int cpuid,
-			  int index)
+lprocfs_percpu_counter(struct lprocfs_stats *stats,
+		       struct lprocfs_percpu *percpu, int index)
 {
 	struct lprocfs_counter *cntr;
 
-	cntr = &stats->ls_percpu[cpuid]->lp_cntr[index];
+	cntr = &percpu->lp_cntr[index];
 
 	if ((stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0)
 		cntr = (void *)cntr + index * sizeof(__s64);
@@ -450,6 +456,22 @@ lprocfs_stats_counter_get(struct lprocfs_stats *stats, unsigned int cpuid,
 	return cntr;
 }
 
+static inline struct lprocfs_counter *
+lprocfs_stats_counter_get(struct lprocfs_stats *stats, unsigned int cpuid,
+			  int index)
+{
+	return lprocfs_percpu_counter(stats, READ_ONCE(stats->ls_percpu[cpuid]),
+				      index);
+}
+
+/* per-CPU area of \a cpuid for readers, under lprocfs_stats_lock() with
+ * LPROCFS_GET_NUM_CPU, or NULL if that CPU never updated the stats */
+static inline struct lprocfs_percpu *
+lprocfs_stats_percpu(struct lprocfs_stats *stats, unsigned int cpuid)
+{
+	return READ_ONCE(stats->ls_percpu[cpuid]);
+}
+
 /* Two optimized LPROCFS counter increment functions are provided:
  *     lprocfs_counter_incr(cntr, value) - optimized for by-one counters
  *     lprocfs_counter_add(cntr) - use for multi-valued counters
@@ -807,7 +829,9 @@ extern void target_print_req(void *seq_file, struct ptlrpc_request *req);
 #ifdef HAVE_SERVER_SUPPORT
 /* lprocfs_jobstats.c */
 int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
-			  int event, long amount);
+			  int event, long amount, ktime_t start);
+int lprocfs_job_stats_latency(struct obd_device *obd, char *jobid,
+			      int event, ktime_t start);
 void lprocfs_job_stats_fini(struct obd_device *obd);
 int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 			   cntr_init_callback fn);
@@ -816,6 +840,10 @@ ssize_t job_cleanup_interval_show(struct kobject *kobj, struct attribute *attr,
 ssize_t job_cleanup_interval_store(struct kobject *kobj,
 				   struct attribute *attr,
 				   const char *buffer, size_t count);
+ssize_t job_latency_max_show(struct kobject *kobj, struct attribute *attr,
+			     char *buf);
+ssize_t job_latency_max_store(struct kobject *kobj, struct attribute *attr,
+			      const char *buffer, size_t count);
 /* lproc_status_server.c */
 ssize_t recovery_time_soft_show(struct kobject *kobj, struct attribute *attr,
 				char *buf);
@@ -1038,7 +1066,11 @@ u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
 /* lprocfs_jobstats.c */
 static inline
 int lprocfs_job_stats_log(struct obd_device *obd, char *jobid, int event,
-			  long amount)
+			  long amount, ktime_t start)
+{ return 0; }
+static inline
+int lprocfs_job_stats_latency(struct obd_device *obd, char *jobid,
+			      int event, ktime_t start)
 { return 0; }
 static inline
 void lprocfs_job_stats_fini(struct obd_device *obd)
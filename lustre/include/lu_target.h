@@ -385,6 +385,15 @@ static inline struct ptlrpc_request *tgt_ses_req(struct tgt_session_info *tsi)
 	return tsi->tsi_pill ? tsi->tsi_pill->rc_req : NULL;
 }
 
+/* Arrival time of the request being handled, zero if there is none */
+static inline ktime_t tgt_ses_arrival(struct tgt_session_info *tsi)
+{
+	struct ptlrpc_request *req = tgt_ses_req(tsi);
+
+	return req ? timespec64_to_ktime(req->rq_arrival_time) :
+		     ktime_set(0, 0);
+}
+
 static inline __u64 tgt_conn_flags(struct tgt_session_info *tsi)
 {
 	LASSERT(tsi->tsi_exp);
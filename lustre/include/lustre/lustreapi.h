@@ -348,7 +348,11 @@ struct find_param {
 	unsigned long long	 fp_blocks_units;
 
 	unsigned long		 fp_got_uuids:1,
-				 fp_obds_printed:1;
+				 fp_obds_printed:1,
+				 /* read dirs with LL_IOC_READDIR_PLUS */
+				 fp_lmd_prefetch:1,
+				 /* fp_lmd of the current file is valid */
+				 fp_lmd_prefetched:1;
 	unsigned int		 fp_depth;
 	unsigned int		 fp_hash_type;
 	unsigned int		 fp_time_margin; /* time margin in seconds */
@@ -367,6 +371,9 @@ int llapi_ostlist(char *path, struct find_param *param);
 int llapi_uuid_match(char *real_uuid, char *search_uuid);
 int llapi_getstripe(char *path, struct find_param *param);
 int llapi_find(char *path, struct find_param *param);
+int llapi_readdir_plus(int dirfd, struct ll_readdir_plus *lrp);
+int llapi_find_parallel(char *path, struct find_param *param,
+			unsigned int nthreads);
 
 int llapi_file_fget_mdtidx(int fd, int *mdtidx);
 int llapi_dir_set_default_lmv(const char *name,
@@ -513,6 +520,30 @@ int llapi_changelog_clear(const char *mdtname, const char *idstr,
 extern int llapi_changelog_set_xflags(void *priv,
 				    enum changelog_send_extra_flag extra_flags);
 
+/* Parallel changelog consumer, records of the same target FID are always
+ * handed to the same worker, in changelog order. */
+typedef int (*llapi_changelog_worker_cb)(struct changelog_rec *rec,
+					 unsigned int worker, void *data);
+
+struct llapi_changelog_parallel {
+	const char			*lcp_mdtname;
+	/* changelog user to clear records for, or NULL to never clear */
+	const char			*lcp_clear_id;
+	long long			 lcp_startrec;
+	enum changelog_send_flag	 lcp_flags;
+	enum changelog_send_extra_flag	 lcp_xflags;
+	unsigned int			 lcp_workers;
+	/* records queued per worker, 0 for the default */
+	unsigned int			 lcp_queue_depth;
+	/* records between two clears, 0 for the default */
+	unsigned int			 lcp_clear_interval;
+	llapi_changelog_worker_cb	 lcp_cb;
+	void				*lcp_cb_data;
+};
+
+int llapi_changelog_parallel(const struct llapi_changelog_parallel *param,
+			     long long *endrec);
+
 /* HSM copytool interface.
  * priv is private state, managed internally by these functions
  */
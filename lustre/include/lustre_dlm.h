@@ -68,6 +68,12 @@ extern struct kset *ldlm_svc_kset;
  * client shows interest in that lock, e.g. glimpse is occured. */
 #define LDLM_DIRTY_AGE_LIMIT (10)
 #define LDLM_DEFAULT_PARALLEL_AST_LIMIT 1024
+/* default share, in percent, of the client LRU kept on the protected list */
+#define LDLM_DEFAULT_LRU_PROTECTED_RATIO 50
+/* number of resources remembered by the LRU ghost cache, as a power of 2 */
+#define LDLM_LRU_GHOST_BITS		9
+/* number of slots of the lock match cache, as a power of 2 */
+#define LDLM_MATCH_CACHE_BITS		9
 
 /**
  * LDLM non-error return states
@@ -183,7 +189,7 @@ static inline int lockmode_compat(enum ldlm_mode exist_mode,
  * lr_lock
  *
  * lr_lock
- *     waiting_locks_spinlock
+ *     lww_lock (per-CPT lock callback timer wheel)
  *
  * lr_lock
  *     led_lock
@@ -340,6 +346,8 @@ struct ldlm_ns_bucket {
 enum {
 	/** LDLM namespace lock stats */
 	LDLM_NSS_LOCKS          = 0,
+	/** Locks matched through the match cache */
+	LDLM_NSS_MATCH_CACHE_HITS,
 	LDLM_NSS_LAST
 };
 
@@ -422,11 +430,40 @@ struct ldlm_namespace {
 	 * us to release some locks due to e.g. memory pressure, we take locks
 	 * to release from the head of this list.
 	 * Locks are linked via l_lru field in \see struct ldlm_lock.
+	 *
+	 * The LRU is segmented: locks enter this list, the probation list,
+	 * and move to ns_protected_list once they are reused while unused.
+	 * A scan of unused locks, e.g. by find(1), then only flushes other
+	 * probation locks and leaves the working set alone.
 	 */
 	struct list_head	ns_unused_list;
-	/** Number of locks in the LRU list above */
+	/** Number of locks in both LRU lists */
 	int			ns_nr_unused;
 	struct list_head	*ns_last_pos;
+	/**
+	 * Protected LRU list of unused locks which were reused at least once
+	 * since they were last cancelled. Canceling starts from the probation
+	 * list, the oldest protected locks are moved back to its tail when
+	 * the protected list grows past ns_lru_protected_ratio of the LRU or
+	 * when the probation list has no more locks.
+	 */
+	struct list_head	ns_protected_list;
+	/** Number of locks in the protected list, also in ns_nr_unused */
+	int			ns_nr_protected;
+	/** Maximum share of the LRU on the protected list, in percent */
+	unsigned int		ns_lru_protected_ratio;
+	/**
+	 * Ghost cache: hashes of the resources of the locks recently
+	 * cancelled from the LRU, direct-mapped, client namespaces only.
+	 * A new lock on such a resource goes to the protected list.
+	 */
+	__u32			*ns_lru_ghost;
+	/** Locks reused while in the LRU */
+	__u64			ns_lru_hits;
+	/** Locks added to the LRU for the first time */
+	__u64			ns_lru_misses;
+	/** Misses on a resource found in the ghost cache */
+	__u64			ns_lru_ghost_hits;
 
 	/**
 	 * Maximum number of locks permitted in the LRU. If 0, means locks
@@ -519,6 +556,17 @@ struct ldlm_namespace {
 	 */
 	ldlm_cancel_cbt		ns_cancel;
 
+	/**
+	 * Match cache: the granted PR, PW or CR lock last matched on a
+	 * resource, direct-mapped by resource name hash, client namespaces
+	 * only. ldlm_lock_match() takes a reference on a cached lock which is
+	 * already in use w/o taking lr_lock. Slots are RCU-protected, set
+	 * under lr_lock and cleared when the lock is destroyed.
+	 */
+	struct ldlm_lock __rcu	**ns_match_cache;
+	/** Whether ldlm_lock_match() looks up ns_match_cache first */
+	bool			ns_match_cache_on;
+
 	/** LDLM lock stats */
 	struct lprocfs_stats	*ns_stats;
 
@@ -615,6 +663,13 @@ struct ldlm_bl_desc {
 		     bl_cos_incompat:1;
 };
 
+/**
+ * Maximum number of locks revoked by one blocking AST RPC to a client which
+ * supports OBD_CONNECT2_BATCH_BL_AST, the reply listing the locks the client
+ * no longer has must fit in LDLM_MAXREPSIZE.
+ */
+#define LDLM_BL_BATCH_MAX	64
+
 struct ldlm_cb_set_arg {
 	struct ptlrpc_request_set	*set;
 	int				 type; /* LDLM_{CP,BL,GL}_CALLBACK */
@@ -624,11 +679,18 @@ struct ldlm_cb_set_arg {
 	ptlrpc_interpterer_t		 gl_interpret_reply;
 	void				*gl_interpret_data;
 	struct ldlm_bl_desc		*bl_desc;
+	/* blocking ASTs not sent yet, collected per client export */
+	struct list_head		 bl_batches;
+	int				 bl_batch_count;
 };
 
+struct ldlm_bl_batch;
+
 struct ldlm_cb_async_args {
 	struct ldlm_cb_set_arg	*ca_set_arg;
 	struct ldlm_lock	*ca_lock;
+	/* set instead of ca_lock for a multi-lock blocking AST */
+	struct ldlm_bl_batch	*ca_batch;
 };
 
 /** The ldlm_glimpse_work was slab allocated & must be freed accordingly.*/
@@ -639,6 +701,8 @@ struct ldlm_interval {
 	struct interval_node	li_node;  /* node for tree management */
 	struct list_head	li_group; /* the locks which have the same
 					   * policy - group of the policy */
+	__u64			li_seq;   /* order of the lock in lr_waiting,
+					   * while it is waiting */
 };
 #define to_ldlm_interval(n) container_of(n, struct ldlm_interval, li_node)
 
@@ -653,6 +717,10 @@ struct ldlm_interval_tree {
 	int			lit_size;
 	enum ldlm_mode		lit_mode;  /* lock mode */
 	struct interval_node	*lit_root; /* actual ldlm_interval */
+	/** Number of waiting locks of this mode, server side only. */
+	int			lit_waiting_size;
+	/** Waiting locks of this mode, indexed by extent. */
+	struct interval_node	*lit_waiting_root;
 };
 
 /**
@@ -750,6 +818,16 @@ struct ldlm_lock {
 	 * Protected by ns_lock in struct ldlm_namespace.
 	 */
 	struct list_head	l_lru;
+	/**
+	 * LRU state, protected by ns_lock: the lock is on the protected
+	 * list, it was reused since it was last added to the LRU, it was
+	 * spared once by a LRU scan for its cached data, and it has been in
+	 * the LRU before.
+	 */
+	unsigned int		l_lru_protected:1,
+				l_lru_referenced:1,
+				l_lru_spared:1,
+				l_lru_seen:1;
 	/**
 	 * Linkage to resource's lock queues according to current lock state.
 	 * (could be granted or waiting)
@@ -835,7 +913,9 @@ struct ldlm_lock {
 
 	/**
 	 * Lock r/w usage counters.
-	 * Protected by lr_lock.
+	 * Protected by lr_lock, but updated atomically: ldlm_lock_match()
+	 * takes a reference from a non-zero counter w/o lr_lock on a client,
+	 * so a counter only ever goes from or to zero under lr_lock.
 	 */
 	__u32			l_readers;
 	__u32			l_writers;
@@ -897,17 +977,24 @@ struct ldlm_lock {
 	/**
 	 * List item for locks waiting for cancellation from clients.
 	 * The lists this could be linked into are:
-	 * waiting_locks_list (protected by waiting_locks_spinlock),
-	 * then if the lock timed out, it is moved to
-	 * expired_lock_list for further processing.
+	 * a slot of the timer wheel of CPT l_pending_cpt, then if the lock
+	 * timed out, it is moved to the expired list of that wheel for
+	 * further processing. Both are protected by the wheel lock.
 	 */
 	struct list_head	l_pending_chain;
+	/**
+	 * CPT of the timer wheel l_pending_chain is linked into, -1 until
+	 * the lock is first added to one. Protected by lr_lock.
+	 */
+	int			l_pending_cpt;
 
 	/**
 	 * Set when lock is sent a blocking AST. Time in seconds when timeout
 	 * is reached and client holding this lock could be evicted.
 	 * This timeout could be further extended by e.g. certain IO activity
-	 * under this lock.
+	 * under this lock, without taking any lock: it only ever moves
+	 * forward, and the timer wheel files the lock again when it finds
+	 * the deadline has moved.
 	 * \see ost_rw_prolong_locks
 	 */
 	time64_t		l_callback_timeout;
@@ -1027,6 +1114,12 @@ struct ldlm_resource {
 	 * List of locks that could not be granted due to conflicts and
 	 * that are waiting for conflicts to go away */
 	struct list_head	lr_waiting;
+	/** Sequence of the last extent lock added to lr_waiting */
+	__u64			lr_waiting_seq;
+	/**
+	 * Some waiting extent locks may have been skipped by the last
+	 * reprocess, the next one must look at all of them */
+	bool			lr_waiting_rescan;
 	/** @} */
 
 	/** Resource name */
@@ -0,0 +1,168 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ *
+ * Network Request Scheduler (NRS) Deadline policy
+ *
+ */
+
+#ifndef _LUSTRE_NRS_DEADLINE_H
+#define _LUSTRE_NRS_DEADLINE_H
+
+/* \name deadline
+ *
+ * Deadline (earliest deadline first) policy
+ * @{
+ */
+
+/** Maximum number of user-defined deadline classes */
+#define NRS_DL_CLASS_MAX	8
+/** Index of the statistics of requests which matched no class */
+#define NRS_DL_CLASS_DEFAULT	NRS_DL_CLASS_MAX
+#define NRS_DL_CLASS_NAME_LEN	16
+
+enum nrs_dl_class_type {
+	NRS_DL_CLASS_UNUSED = 0,
+	NRS_DL_CLASS_UID,
+	NRS_DL_CLASS_JOBID,
+};
+
+/**
+ * A deadline class; requests matching it are due \a dc_target_ms
+ * milliseconds after their arrival.
+ */
+struct nrs_deadline_class {
+	enum nrs_dl_class_type	dc_type;
+	char			dc_name[NRS_DL_CLASS_NAME_LEN];
+	/** jobid to match, a trailing '*' matches any suffix */
+	char			dc_jobid[LUSTRE_JOBID_SIZE];
+	__u32			dc_uid;
+	__u32			dc_target_ms;
+};
+
+/**
+ * Per-class counters, updated as requests are dispatched and finished.
+ */
+struct nrs_deadline_class_stats {
+	/** requests dispatched */
+	__u64	dcs_requests;
+	/** total and maximum time spent queued, in microseconds */
+	__u64	dcs_wait_sum;
+	__u64	dcs_wait_max;
+	/** requests which finished after their deadline */
+	__u64	dcs_missed;
+	/** requests dispatched ahead of their turn by starvation protection */
+	__u64	dcs_starved;
+};
+
+/**
+ * Private data structure for the deadline policy
+ */
+struct nrs_deadline_data {
+	struct ptlrpc_nrs_resource	 dd_res;
+
+	/**
+	 * Queued requests, sorted by deadline.
+	 */
+	struct cfs_binheap		*dd_binheap;
+
+	/**
+	 * Queued requests in arrival order, the head of which is the
+	 * candidate for starvation protection.
+	 */
+	struct list_head		 dd_fifo;
+
+	/**
+	 * Protects the class table and statistics, which are also changed
+	 * by the ctl interface outside of the service partition lock.
+	 */
+	spinlock_t			 dd_lock;
+
+	/**
+	 * Breaks ties between requests with the same deadline.
+	 */
+	__u64				 dd_sequence;
+
+	/**
+	 * Requests queued for longer than this, in milliseconds, are served
+	 * in arrival order on every other dispatch.
+	 */
+	__u32				 dd_max_wait;
+
+	/**
+	 * The last dispatched request was picked by starvation protection.
+	 */
+	bool				 dd_last_starved;
+
+	/**
+	 * Number of uid classes, when zero the request uid is not looked up.
+	 */
+	int				 dd_nr_uid_classes;
+
+	struct nrs_deadline_class	 dd_classes[NRS_DL_CLASS_MAX];
+	struct nrs_deadline_class_stats	 dd_stats[NRS_DL_CLASS_MAX + 1];
+};
+
+struct nrs_deadline_req {
+	/**
+	 * Time at which the request is due, in nanoseconds of real time
+	 */
+	__u64			dr_deadline;
+	__u64			dr_sequence;
+	/**
+	 * Linkage into nrs_deadline_data::dd_fifo
+	 */
+	struct list_head	dr_list;
+	/**
+	 * Index of the matched class, or NRS_DL_CLASS_DEFAULT
+	 */
+	unsigned int		dr_class;
+};
+
+/**
+ * Argument of NRS_CTL_DEADLINE_WR_CLASS
+ */
+struct nrs_deadline_class_cmd {
+	/** add or replace \a dcc_class when set, remove it otherwise */
+	bool				dcc_start;
+	struct nrs_deadline_class	dcc_class;
+};
+
+/**
+ * Argument of NRS_CTL_DEADLINE_RD_STATS; statistics are summed over all
+ * the service partitions the policy is queried on.
+ */
+struct nrs_deadline_stats {
+	struct nrs_deadline_class	ds_classes[NRS_DL_CLASS_MAX];
+	struct nrs_deadline_class_stats	ds_stats[NRS_DL_CLASS_MAX + 1];
+};
+
+enum nrs_ctl_deadline {
+	NRS_CTL_DEADLINE_RD_MAX_WAIT = PTLRPC_NRS_CTL_1ST_POL_SPEC,
+	NRS_CTL_DEADLINE_WR_MAX_WAIT,
+	NRS_CTL_DEADLINE_WR_CLASS,
+	NRS_CTL_DEADLINE_RD_STATS,
+	NRS_CTL_DEADLINE_CLEAR_STATS,
+};
+
+/** @} deadline */
+
+#endif
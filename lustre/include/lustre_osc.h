@@ -538,6 +538,8 @@ struct osc_brw_async_args {
 	struct client_obd	*aa_cli;
 	struct list_head	 aa_oaps;
 	struct list_head	 aa_exts;
+	/* CPT of the extents in this RPC */
+	int			 aa_cpt;
 };
 
 extern struct kmem_cache *osc_lock_kmem;
@@ -952,6 +954,8 @@ struct osc_extent {
 	unsigned int		oe_mppr;
 	/** FLR: layout version when this osc_extent is publised */
 	__u32			oe_layout_version;
+	/** CPT of the thread which created this extent */
+	int			oe_cpt;
 };
 
 /** @} osc */
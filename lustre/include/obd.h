@@ -165,6 +165,17 @@ enum obd_cl_sem_lock_class {
 	OBD_CLI_SEM_MDCOSC,
 };
 
+/* BRW RPCs whose pages were dirtied or read on one CPT, see cpt_stats */
+struct client_obd_cpt_stats {
+	atomic_long_t		ccs_read_rpcs;
+	atomic_long_t		ccs_read_pages;
+	/* RPCs completed by a ptlrpcd thread running on the same CPT */
+	atomic_long_t		ccs_read_local;
+	atomic_long_t		ccs_write_rpcs;
+	atomic_long_t		ccs_write_pages;
+	atomic_long_t		ccs_write_local;
+};
+
 struct mdc_rpc_lock;
 struct obd_import;
 struct client_obd {
@@ -271,6 +282,11 @@ struct client_obd {
 	struct obd_histogram	cl_write_page_hist;
 	struct obd_histogram	cl_read_offset_hist;
 	struct obd_histogram	cl_write_offset_hist;
+	/* keep extents, BRW RPCs and ptlrpcd threads on the CPT of the
+	 * thread that dirtied or read the pages */
+	bool			cl_cpt_affinity;
+	/* per-CPT BRW locality, cfs_cpt_number(cfs_cpt_tab) entries */
+	struct client_obd_cpt_stats *cl_cpt_stats;
 
 	/** LRU for osc caching pages */
 	struct cl_client_cache  *cl_cache;
@@ -1064,6 +1080,32 @@ struct obd_client_handle {
 
 #define OBD_CLIENT_HANDLE_MAGIC 0xd15ea5ed
 
+/* maximum number of FIDs in one MDS_BATCH_GETATTR request */
+#define MD_BATCH_GETATTR_MAX		256
+/* maximum size of all layouts returned by one MDS_BATCH_GETATTR reply */
+#define MD_BATCH_GETATTR_EASIZE_MAX	(1024 * 1024)
+
+/**
+ * Batched getattr request, see md_batch_getattr().
+ *
+ * \a mgb_cb is called once for every FID in \a mgb_fids with the index of
+ * that FID, the per-FID result and, on success, the attributes and layout
+ * returned by the MDT. The reply is released after the callbacks are done,
+ * so anything needed later has to be copied out. md_batch_getattr() only
+ * returns an error if no callback was called at all.
+ */
+struct md_getattr_batch {
+	struct lu_fid	*mgb_fids;
+	int		 mgb_nr;
+	/* OBD_MD_* flags requested for every FID */
+	__u64		 mgb_valid;
+	/* layout buffer budget for the whole batch */
+	__u32		 mgb_easize;
+	void		(*mgb_cb)(struct md_getattr_batch *mgb, int idx, int rc,
+				  struct mdt_body *body, void *ea, int easize);
+	void		*mgb_cbdata;
+};
+
 struct lookup_intent;
 struct cl_attr;
 
@@ -1167,6 +1209,8 @@ struct md_ops {
 			  const union lmv_mds_md *lmv, size_t lmv_size);
 	int (*m_rmfid)(struct obd_export *exp, struct fid_array *fa, int *rcs,
 		       struct ptlrpc_request_set *set);
+	int (*m_batch_getattr)(struct obd_export *exp,
+			       struct md_getattr_batch *mgb);
 };
 
 static inline struct md_open_data *obd_mod_alloc(void)
@@ -32,6 +32,7 @@
 
 #ifndef __OBD_CKSUM
 #define __OBD_CKSUM
+#include <linux/scatterlist.h>
 #include <libcfs/libcfs.h>
 #include <libcfs/libcfs_crypto.h>
 #include <uapi/linux/lustre/lustre_idl.h>
@@ -57,6 +58,21 @@ static inline unsigned char cksum_obd2cfs(enum cksum_types cksum_type)
 
 u32 obd_cksum_type_pack(const char *obd_name, enum cksum_types cksum_type);
 
+/* Bulk pages queued for hashing, CFS_CRYPTO_HASH_BATCH_PAGES at a time */
+struct obd_cksum_batch {
+	struct ahash_request	*ocb_req;
+	unsigned int		 ocb_count;
+	unsigned int		 ocb_nob;
+	int			 ocb_rc;
+	struct scatterlist	 ocb_sg[CFS_CRYPTO_HASH_BATCH_PAGES];
+};
+
+void obd_cksum_batch_init(struct obd_cksum_batch *ocb,
+			  struct ahash_request *req);
+void obd_cksum_batch_add_page(struct obd_cksum_batch *ocb, struct page *page,
+			      unsigned int offset, unsigned int len);
+int obd_cksum_batch_flush(struct obd_cksum_batch *ocb);
+
 static inline enum cksum_types obd_cksum_type_unpack(u32 o_flags)
 {
 	switch (o_flags & OBD_FL_CKSUM_ALL) {
@@ -1796,6 +1796,18 @@ static inline int md_rmfid(struct obd_export *exp, struct fid_array *fa,
 	return MDP(exp->exp_obd, rmfid)(exp, fa, rcs, set);
 }
 
+static inline int md_batch_getattr(struct obd_export *exp,
+				   struct md_getattr_batch *mgb)
+{
+	int rc;
+
+	rc = exp_check_ops(exp);
+	if (rc)
+		return rc;
+
+	return MDP(exp->exp_obd, batch_getattr)(exp, mgb);
+}
+
 /* OBD Metadata Support */
 
 extern int obd_init_caches(void);
@@ -245,6 +245,8 @@ extern char obd_jobid_var[];
 #define OBD_FAIL_MDS_ORPHAN_DELETE	 0x165
 #define OBD_FAIL_MDS_RMFID_NET		 0x166
 #define OBD_FAIL_MDS_CREATE_RACE	 0x167
+#define OBD_FAIL_MDS_BATCH_GETATTR_NET	 0x168
+#define OBD_FAIL_MDS_NO_BATCH_GETATTR	 0x169
 
 /* layout lock */
 #define OBD_FAIL_MDS_NO_LL_GETATTR	 0x170
@@ -839,6 +839,8 @@ struct ptlrpc_body_v2 {
 #define OBD_CONNECT2_CRUSH		0x2000ULL /* crush hash striped directory */
 #define OBD_CONNECT2_ASYNC_DISCARD	0x4000ULL /* support async DoM data discard */
 #define OBD_CONNECT2_ENCRYPT		0x8000ULL /* client-to-disk encrypt */
+#define OBD_CONNECT2_BATCH_GETATTR	0x10000ULL /* MDS_BATCH_GETATTR RPC */
+#define OBD_CONNECT2_BATCH_BL_AST	0x20000ULL /* multi-lock blocking AST */
 /* XXX README XXX:
  * Please DO NOT add flag values here before first ensuring that this same
  * flag value is not in use on some other branch.  Please clear any such
@@ -900,7 +902,9 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT2_SELINUX_POLICY | \
 				OBD_CONNECT2_LSOM | \
 				OBD_CONNECT2_ASYNC_DISCARD | \
-				OBD_CONNECT2_PCC)
+				OBD_CONNECT2_PCC | \
+				OBD_CONNECT2_BATCH_GETATTR | \
+				OBD_CONNECT2_BATCH_BL_AST)
 
 #define OST_CONNECT_SUPPORTED  (OBD_CONNECT_SRVLOCK | OBD_CONNECT_GRANT | \
 				OBD_CONNECT_REQPORTAL | OBD_CONNECT_VERSION | \
@@ -921,7 +925,8 @@ struct ptlrpc_body_v2 {
 				OBD_CONNECT_GRANT_PARAM | \
 				OBD_CONNECT_SHORTIO | OBD_CONNECT_FLAGS2)
 
-#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID)
+#define OST_CONNECT_SUPPORTED2 (OBD_CONNECT2_LOCKAHEAD | OBD_CONNECT2_INC_XID | \
+				OBD_CONNECT2_BATCH_BL_AST)
 
 #define ECHO_CONNECT_SUPPORTED (OBD_CONNECT_FID)
 #define ECHO_CONNECT_SUPPORTED2 0
@@ -1650,6 +1655,7 @@ enum mds_cmd {
 	MDS_HSM_CT_UNREGISTER	= 60,
 	MDS_SWAP_LAYOUTS	= 61,
 	MDS_RMFID		= 62,
+	MDS_BATCH_GETATTR	= 63,
 	MDS_LAST_OPC
 };
 
@@ -626,6 +626,7 @@ struct ll_ioc_lease_id {
 #define LL_IOC_PCC_DETACH		_IOW('f', 252, struct lu_pcc_detach)
 #define LL_IOC_PCC_DETACH_BY_FID	_IOW('f', 252, struct lu_pcc_detach_fid)
 #define LL_IOC_PCC_STATE		_IOR('f', 252, struct lu_pcc_state)
+#define LL_IOC_READDIR_PLUS		_IOWR('f', 253, struct ll_readdir_plus)
 
 #ifndef	FS_IOC_FSGETXATTR
 /*
@@ -2602,6 +2603,37 @@ struct fid_array {
 };
 #define OBD_MAX_FIDS_IN_ARRAY	4096
 
+enum ll_readdir_plus_flags {
+	LRP_F_EOF	= 0x0001, /* the end of the directory was reached */
+};
+
+/* LL_IOC_READDIR_PLUS: read directory entries with their attributes */
+struct ll_readdir_plus {
+	__u64	lrp_hash;	/* in: position to start reading at, 0 at
+				 * first, out: position to continue from */
+	__u32	lrp_bufsize;	/* in: size of lrp_buf */
+	__u32	lrp_count;	/* out: number of records in lrp_buf */
+	__u32	lrp_flags;	/* out: enum ll_readdir_plus_flags */
+	__u32	lrp_padding;
+	char	lrp_buf[0];	/* out: struct ll_readdir_plus_ent records */
+};
+
+/*
+ * One directory entry returned by LL_IOC_READDIR_PLUS, followed at
+ * \a lrpe_lmdoff by a struct lov_user_mds_data that has lmd_fid set, and,
+ * if \a lrpe_rc is 0, also the attributes and layout of the entry just as
+ * returned by IOC_MDC_GETFILEINFO. Otherwise the caller has to get them
+ * on its own.
+ */
+struct ll_readdir_plus_ent {
+	__u32	lrpe_reclen;	/* size of the record, 8-byte aligned */
+	__s32	lrpe_rc;	/* 0 or -errno, see above */
+	__u16	lrpe_namelen;	/* length of lrpe_name without NUL */
+	__u16	lrpe_type;	/* DT_* type of the entry */
+	__u32	lrpe_lmdoff;	/* offset of struct lov_user_mds_data */
+	char	lrpe_name[0];	/* NUL-terminated name of the entry */
+};
+
 #if defined(__cplusplus)
 }
 #endif
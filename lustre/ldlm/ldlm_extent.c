@@ -56,6 +56,40 @@
 
 #include "ldlm_internal.h"
 
+static inline int ldlm_mode_to_index(enum ldlm_mode mode)
+{
+	int index;
+
+	LASSERT(mode != 0);
+	LASSERT(is_power_of_2(mode));
+	index = ilog2(mode);
+	LASSERT(index < LCK_MODE_NUM);
+	return index;
+}
+
+/**
+ * Whether \a lock is in the waiting trees of its resource.
+ *
+ * A waiting lock uses its own interval node there, or shares the node of
+ * the first waiting lock with the same mode and extent, in which case its
+ * own node has an empty group. The node only goes into the granted tree
+ * when the lock is granted.
+ */
+static inline bool ldlm_extent_is_waiting(struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+
+	return node != NULL && !ldlm_is_granted(lock) &&
+	       (interval_is_intree(&node->li_node) ||
+		list_empty(&node->li_group));
+}
+
+/** Whether a group lock is waiting on \a res */
+static inline bool ldlm_extent_group_waiting(struct ldlm_resource *res)
+{
+	return res->lr_itree[ldlm_mode_to_index(LCK_GROUP)].lit_waiting_size;
+}
+
 #ifdef HAVE_SERVER_SUPPORT
 # define LDLM_MAX_GROWN_EXTENT (32 * 1024 * 1024 - 1)
 
@@ -661,7 +695,7 @@ ldlm_extent_compat_queue(struct list_head *queue, struct ldlm_lock *req,
 
         RETURN(compat);
 destroylock:
-	list_del_init(&req->l_res_link);
+	ldlm_resource_unlink_lock(req);
         ldlm_lock_destroy_nolock(req);
         *err = compat;
         RETURN(compat);
@@ -773,6 +807,68 @@ void ldlm_resource_prolong(struct ldlm_prolong_args *arg)
 }
 EXPORT_SYMBOL(ldlm_resource_prolong);
 
+struct ldlm_extent_waiting_args {
+	__u64	ewa_seq;
+	bool	ewa_conflict;
+};
+
+static enum interval_iter ldlm_extent_waiting_cb(struct interval_node *n,
+						 void *data)
+{
+	struct ldlm_extent_waiting_args *args = data;
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct ldlm_lock *lock;
+
+	list_for_each_entry(lock, &node->li_group, l_sl_policy) {
+		if (lock->l_tree_node->li_seq < args->ewa_seq) {
+			args->ewa_conflict = true;
+			return INTERVAL_ITER_STOP;
+		}
+	}
+
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Determine if the waiting lock \a req is compatible with all the locks
+ * waiting ahead of it, using the waiting trees instead of walking
+ * lr_waiting up to \a req like ldlm_extent_compat_queue() does.
+ *
+ * Only valid when no group lock is waiting, the waiting list may not be in
+ * sequence order then.
+ *
+ * \retval 0 if the lock is not compatible
+ * \retval 1 if the lock is compatible
+ */
+static int ldlm_extent_waiting_compat(struct ldlm_lock *req)
+{
+	struct ldlm_resource *res = req->l_resource;
+	struct ldlm_extent_waiting_args args = {
+		.ewa_seq = req->l_tree_node->li_seq,
+		.ewa_conflict = false,
+	};
+	struct interval_node_extent ex = {
+		.start = req->l_req_extent.start,
+		.end = req->l_req_extent.end,
+	};
+	struct ldlm_interval_tree *tree;
+	int idx;
+
+	for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+		tree = &res->lr_itree[idx];
+		if (tree->lit_waiting_root == NULL ||
+		    lockmode_compat(tree->lit_mode, req->l_req_mode))
+			continue;
+
+		interval_search(tree->lit_waiting_root, &ex,
+				ldlm_extent_waiting_cb, &args);
+		if (args.ewa_conflict)
+			return 0;
+	}
+
+	return 1;
+}
+
 /**
  * Process a granting attempt for extent lock.
  * Must be called with ns lock held.
@@ -807,11 +903,14 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
                 LASSERT(*flags == 0);
                 rc = ldlm_extent_compat_queue(&res->lr_granted, lock, flags,
                                               err, NULL, &contended_locks);
-                if (rc == 1) {
-                        rc = ldlm_extent_compat_queue(&res->lr_waiting, lock,
-                                                      flags, err, NULL,
-                                                      &contended_locks);
-                }
+		if (rc == 1 && ldlm_extent_is_waiting(lock) &&
+		    !ldlm_extent_group_waiting(res)) {
+			rc = ldlm_extent_waiting_compat(lock);
+		} else if (rc == 1) {
+			rc = ldlm_extent_compat_queue(&res->lr_waiting, lock,
+						      flags, err, NULL,
+						      &contended_locks);
+		}
                 if (rc == 0)
                         RETURN(LDLM_ITER_STOP);
 
@@ -853,6 +952,107 @@ int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 out_rpc_list:
 	RETURN(rc);
 }
+
+static enum interval_iter ldlm_extent_reprocess_cb(struct interval_node *n,
+						   void *data)
+{
+	struct ldlm_interval *node = to_ldlm_interval(n);
+	struct list_head *candidates = data;
+	struct ldlm_lock *lock;
+
+	/* l_sl_mode isn't used by extent locks otherwise */
+	list_for_each_entry(lock, &node->li_group, l_sl_policy)
+		list_add_tail(&lock->l_sl_mode, candidates);
+
+	return INTERVAL_ITER_CONT;
+}
+
+/**
+ * Try to grant the waiting extent locks of a resource.
+ *
+ * Waiting locks are indexed by extent, so after \a hint is cancelled or
+ * downgraded only the waiting locks overlapping it are looked at, and each
+ * of them is checked against the waiting trees rather than the part of the
+ * waiting list ahead of it. A lock conflicting with an older waiting lock
+ * still isn't granted, but unlike ldlm_reprocess_queue() the scan doesn't
+ * stop at the first lock which can't be granted, which would leave any
+ * lock behind it waiting for no reason.
+ *
+ * Group locks are compatible regardless of the extent and reorder the
+ * waiting list, so the generic code is used while any of them is waiting,
+ * and for recovery.
+ *
+ * Must be called with resource lock held.
+ */
+int ldlm_reprocess_extent_queue(struct ldlm_resource *res,
+				struct list_head *queue,
+				struct list_head *work_list,
+				enum ldlm_process_intention intention,
+				struct ldlm_lock *hint)
+{
+	struct ldlm_lock *pending;
+	LIST_HEAD(candidates);
+	enum ldlm_error err;
+	__u64 flags;
+	int idx;
+
+	ENTRY;
+
+	check_res_locked(res);
+
+	LASSERT(res->lr_type == LDLM_EXTENT);
+	LASSERT(intention == LDLM_PROCESS_RESCAN ||
+		intention == LDLM_PROCESS_RECOVERY);
+
+	if (intention == LDLM_PROCESS_RECOVERY ||
+	    ldlm_extent_group_waiting(res)) {
+		/* this may stop at a lock which can't be granted, so
+		 * the next reprocess has to look at all the locks */
+		res->lr_waiting_rescan = true;
+		RETURN(ldlm_reprocess_queue(res, queue, work_list, intention,
+					    hint));
+	}
+
+	CDEBUG(D_DLMTRACE, "--- Reprocess resource "DLDLMRES" (%p)\n",
+	       PLDLMRES(res), res);
+
+	if (hint == NULL || hint->l_req_mode == LCK_GROUP ||
+	    hint->l_granted_mode == LCK_GROUP || res->lr_waiting_rescan) {
+		res->lr_waiting_rescan = false;
+		list_for_each_entry(pending, queue, l_res_link)
+			list_add_tail(&pending->l_sl_mode, &candidates);
+	} else {
+		struct interval_node_extent ex = {
+			.start = hint->l_policy_data.l_extent.start,
+			.end = hint->l_policy_data.l_extent.end,
+		};
+
+		for (idx = 0; idx < LCK_MODE_NUM; idx++) {
+			struct ldlm_interval_tree *tree = &res->lr_itree[idx];
+
+			if (tree->lit_waiting_root == NULL)
+				continue;
+			interval_search(tree->lit_waiting_root, &ex,
+					ldlm_extent_reprocess_cb, &candidates);
+		}
+	}
+
+	while (!list_empty(&candidates)) {
+		pending = list_entry(candidates.next, struct ldlm_lock,
+				     l_sl_mode);
+		list_del_init(&pending->l_sl_mode);
+
+		LDLM_DEBUG(pending, "Reprocessing lock");
+
+		/* extent locks are checked without a work list on rescan,
+		 * so only the completion AST can be queued here */
+		flags = 0;
+		ldlm_process_extent_lock(pending, &flags, intention, &err,
+					 work_list);
+	}
+
+	RETURN(LDLM_ITER_CONTINUE);
+}
 #endif /* HAVE_SERVER_SUPPORT */
 
 struct ldlm_kms_shift_args {
@@ -1015,17 +1215,6 @@ struct ldlm_interval *ldlm_interval_detach(struct ldlm_lock *l)
 	return list_empty(&n->li_group) ? n : NULL;
 }
 
-static inline int ldlm_mode_to_index(enum ldlm_mode mode)
-{
-	int index;
-
-	LASSERT(mode != 0);
-	LASSERT(is_power_of_2(mode));
-	index = ilog2(mode);
-	LASSERT(index < LCK_MODE_NUM);
-	return index;
-}
-
 int ldlm_extent_alloc_lock(struct ldlm_lock *lock)
 {
 	lock->l_tree_node = NULL;
@@ -1094,6 +1283,86 @@ void ldlm_extent_add_lock(struct ldlm_resource *res,
 	}
 }
 
+/**
+ * Add a lock just put on the waiting list into the waiting tree of its mode.
+ *
+ * Locks are only indexed on the server, where the waiting list is
+ * reprocessed. Group locks conflict with other modes regardless of the
+ * extent, so they cover the whole object there.
+ */
+void ldlm_extent_add_waiting(struct ldlm_resource *res,
+			     struct ldlm_lock *lock)
+{
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval_tree *tree;
+	struct interval_node *found;
+	__u64 start = 0;
+	__u64 end = OBD_OBJECT_EOF;
+	int rc;
+
+	if (node == NULL || ns_is_client(ldlm_res_to_ns(res)) ||
+	    ldlm_extent_is_waiting(lock))
+		return;
+
+	LASSERT(!ldlm_is_granted(lock));
+
+	tree = &res->lr_itree[ldlm_mode_to_index(lock->l_req_mode)];
+	if (lock->l_req_mode != LCK_GROUP) {
+		start = lock->l_policy_data.l_extent.start;
+		end = lock->l_policy_data.l_extent.end;
+	}
+
+	rc = interval_set(&node->li_node, start, end);
+	LASSERT(!rc);
+
+	/* Group locks are inserted ahead of other waiting locks, so the
+	 * sequence follows the waiting list only for the other locks. That
+	 * is enough, waiting trees aren't used while a group lock waits. */
+	node->li_seq = ++res->lr_waiting_seq;
+	found = interval_insert(&node->li_node, &tree->lit_waiting_root);
+	if (found) /* keep our node, it's needed once the lock is granted */
+		list_move_tail(&lock->l_sl_policy,
+			       &to_ldlm_interval(found)->li_group);
+	tree->lit_waiting_size++;
+}
+
+/** Remove a lock leaving the waiting list from its waiting tree. */
+static void ldlm_extent_del_waiting(struct ldlm_lock *lock)
+{
+	struct ldlm_resource *res = lock->l_resource;
+	struct ldlm_interval *node = lock->l_tree_node;
+	struct ldlm_interval_tree *tree;
+
+	tree = &res->lr_itree[ldlm_mode_to_index(lock->l_req_mode)];
+	LASSERT(tree->lit_waiting_size > 0);
+
+	if (interval_is_intree(&node->li_node)) {
+		interval_erase(&node->li_node, &tree->lit_waiting_root);
+		list_del_init(&lock->l_sl_policy);
+		if (!list_empty(&node->li_group)) {
+			struct ldlm_interval *next;
+			int rc;
+
+			/* the next lock of the group takes over with its
+			 * own node */
+			next = list_entry(node->li_group.next,
+					  struct ldlm_lock,
+					  l_sl_policy)->l_tree_node;
+			rc = interval_set(&next->li_node,
+					  interval_low(&node->li_node),
+					  interval_high(&node->li_node));
+			LASSERT(!rc);
+			list_splice_init(&node->li_group, &next->li_group);
+			interval_insert(&next->li_node,
+					&tree->lit_waiting_root);
+		}
+		list_add_tail(&lock->l_sl_policy, &node->li_group);
+	} else {
+		list_move_tail(&lock->l_sl_policy, &node->li_group);
+	}
+	tree->lit_waiting_size--;
+}
+
 /** Remove cancelled lock from resource interval tree. */
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 {
@@ -1102,6 +1371,11 @@ void ldlm_extent_unlink_lock(struct ldlm_lock *lock)
 	struct ldlm_interval_tree *tree;
 	int idx;
 
+	if (ldlm_extent_is_waiting(lock)) {
+		ldlm_extent_del_waiting(lock);
+		return;
+	}
+
 	if (!node || !interval_is_intree(&node->li_node)) /* duplicate unlink */
 		return;
 
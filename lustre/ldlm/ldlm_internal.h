@@ -109,6 +109,7 @@ enum ldlm_lru_flags {
 					 * discarded momentarily */
 };
 
+int ldlm_request_bufsize(int count, int type);
 int ldlm_cancel_lru(struct ldlm_namespace *ns, int nr,
 		    enum ldlm_cancel_flags cancel_flags,
 		    enum ldlm_lru_flags lru_flags);
@@ -175,6 +176,10 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock);
 void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock);
 void ldlm_lock_add_to_lru(struct ldlm_lock *lock);
 void ldlm_lock_touch_in_lru(struct ldlm_lock *lock);
+int ldlm_lock_lru_demote_nolock(struct ldlm_namespace *ns, bool head);
+void ldlm_lock_lru_balance_nolock(struct ldlm_namespace *ns);
+void ldlm_lock_lru_ghost_add(struct ldlm_lock *lock);
+void ldlm_match_cache_clear(struct ldlm_namespace *ns);
 void ldlm_lock_destroy_nolock(struct ldlm_lock *lock);
 
 int ldlm_export_cancel_blocked_locks(struct obd_export *exp);
@@ -193,6 +198,9 @@ int ldlm_bl_thread_wakeup(void);
 void ldlm_handle_bl_callback(struct ldlm_namespace *ns,
                              struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
 void ldlm_bl_desc2lock(const struct ldlm_lock_desc *ld, struct ldlm_lock *lock);
+#ifdef HAVE_SERVER_SUPPORT
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg);
+#endif
 
 #ifdef HAVE_SERVER_SUPPORT
 /* ldlm_plain.c */
@@ -214,9 +222,16 @@ int ldlm_reprocess_inodebits_queue(struct ldlm_resource *res,
 int ldlm_process_extent_lock(struct ldlm_lock *lock, __u64 *flags,
 			     enum ldlm_process_intention intention,
 			     enum ldlm_error *err, struct list_head *work_list);
+int ldlm_reprocess_extent_queue(struct ldlm_resource *res,
+				struct list_head *queue,
+				struct list_head *work_list,
+				enum ldlm_process_intention intention,
+				struct ldlm_lock *hint);
 #endif
 int ldlm_extent_alloc_lock(struct ldlm_lock *lock);
 void ldlm_extent_add_lock(struct ldlm_resource *res, struct ldlm_lock *lock);
+void ldlm_extent_add_waiting(struct ldlm_resource *res,
+			     struct ldlm_lock *lock);
 void ldlm_extent_unlink_lock(struct ldlm_lock *lock);
 
 int ldlm_inodebits_alloc_lock(struct ldlm_lock *lock);
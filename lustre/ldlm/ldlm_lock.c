@@ -37,6 +37,7 @@
 
 #define DEBUG_SUBSYSTEM S_LDLM
 
+#include <linux/jhash.h>
 #include <libcfs/libcfs.h>
 
 #include <lustre_swab.h>
@@ -152,7 +153,7 @@ EXPORT_SYMBOL(ldlm_get_processing_policy);
 
 static ldlm_reprocessing_policy ldlm_reprocessing_policy_table[] = {
 	[LDLM_PLAIN]	= ldlm_reprocess_queue,
-	[LDLM_EXTENT]	= ldlm_reprocess_queue,
+	[LDLM_EXTENT]	= ldlm_reprocess_extent_queue,
 	[LDLM_FLOCK]	= ldlm_reprocess_queue,
 	[LDLM_IBITS]	= ldlm_reprocess_inodebits_queue,
 };
@@ -263,6 +264,11 @@ int ldlm_lock_remove_from_lru_nolock(struct ldlm_lock *lock)
 		if (ns->ns_last_pos == &lock->l_lru)
 			ns->ns_last_pos = lock->l_lru.prev;
 		list_del_init(&lock->l_lru);
+		if (lock->l_lru_protected) {
+			LASSERT(ns->ns_nr_protected > 0);
+			ns->ns_nr_protected--;
+			lock->l_lru_protected = 0;
+		}
 		LASSERT(ns->ns_nr_unused > 0);
 		ns->ns_nr_unused--;
 		rc = 1;
@@ -301,19 +307,149 @@ int ldlm_lock_remove_from_lru_check(struct ldlm_lock *lock, ktime_t last_use)
 	RETURN(rc);
 }
 
+static inline __u32 ldlm_res_name_hash(const struct ldlm_res_id *name)
+{
+	return jhash2((const u32 *)name->name, sizeof(name->name) / sizeof(u32),
+		      0);
+}
+
+static inline __u32 ldlm_lru_ghost_key(const struct ldlm_resource *res)
+{
+	return ldlm_res_name_hash(&res->lr_name) ?: 1;
+}
+
+/**
+ * Remembers the resource of LDLM lock \a lock cancelled from namespace LRU
+ * in the ghost cache. This is lockless, a lost update only costs a ghost
+ * hit.
+ */
+void ldlm_lock_lru_ghost_add(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	__u32 key;
+
+	if (ns->ns_lru_ghost == NULL)
+		return;
+
+	key = ldlm_lru_ghost_key(lock->l_resource);
+	WRITE_ONCE(ns->ns_lru_ghost[key & (BIT(LDLM_LRU_GHOST_BITS) - 1)],
+		   key);
+}
+
+/**
+ * Checks whether the resource of LDLM lock \a lock is in the ghost cache,
+ * and forgets it if so.
+ */
+static bool ldlm_lock_lru_ghost_hit(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	__u32 key;
+	__u32 *slot;
+
+	if (ns->ns_lru_ghost == NULL)
+		return false;
+
+	key = ldlm_lru_ghost_key(lock->l_resource);
+	slot = &ns->ns_lru_ghost[key & (BIT(LDLM_LRU_GHOST_BITS) - 1)];
+	if (READ_ONCE(*slot) != key)
+		return false;
+
+	WRITE_ONCE(*slot, 0);
+	return true;
+}
+
+/**
+ * Moves the oldest lock of namespace \a ns protected LRU list to the
+ * probation list, to its head if \a head is set, to its tail otherwise.
+ * Assumes LRU is already locked.
+ *
+ * \retval 1 a lock was moved
+ * \retval 0 the protected list is empty
+ */
+int ldlm_lock_lru_demote_nolock(struct ldlm_namespace *ns, bool head)
+{
+	struct ldlm_lock *lock;
+
+	if (list_empty(&ns->ns_protected_list))
+		return 0;
+
+	lock = list_entry(ns->ns_protected_list.next, struct ldlm_lock, l_lru);
+	LASSERT(lock->l_lru_protected);
+	lock->l_lru_protected = 0;
+	ns->ns_nr_protected--;
+	if (head)
+		list_move(&lock->l_lru, &ns->ns_unused_list);
+	else
+		list_move_tail(&lock->l_lru, &ns->ns_unused_list);
+
+	return 1;
+}
+
+/**
+ * Moves the locks of namespace \a ns protected LRU list which have been
+ * unused for more than ns_max_age to the head of the probation list, and
+ * the oldest ones past ns_lru_protected_ratio to its tail. Assumes LRU is
+ * already locked.
+ */
+void ldlm_lock_lru_balance_nolock(struct ldlm_namespace *ns)
+{
+	ktime_t now = ktime_get();
+
+	while (!list_empty(&ns->ns_protected_list)) {
+		struct ldlm_lock *lock;
+
+		lock = list_entry(ns->ns_protected_list.next, struct ldlm_lock,
+				  l_lru);
+		if (ktime_before(now, ktime_add(lock->l_last_used,
+						ns->ns_max_age)))
+			break;
+		ldlm_lock_lru_demote_nolock(ns, true);
+	}
+
+	while ((__u64)ns->ns_nr_protected * 100 >
+	       (__u64)ns->ns_lru_protected_ratio * ns->ns_nr_unused)
+		ldlm_lock_lru_demote_nolock(ns, false);
+}
+
 /**
  * Adds LDLM lock \a lock to namespace LRU. Assumes LRU is already locked.
+ *
+ * The lock goes to the protected list if it was reused since it was last
+ * added to the LRU, or if it is new and a lock on the same resource was
+ * recently cancelled from the LRU. Otherwise it goes to the probation list.
  */
 void ldlm_lock_add_to_lru_nolock(struct ldlm_lock *lock)
 {
 	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	bool protect = false;
 
 	lock->l_last_used = ktime_get();
 	LASSERT(list_empty(&lock->l_lru));
 	LASSERT(lock->l_resource->lr_type != LDLM_FLOCK);
-	list_add_tail(&lock->l_lru, &ns->ns_unused_list);
+
+	if (lock->l_lru_referenced) {
+		lock->l_lru_referenced = 0;
+		protect = true;
+	} else if (!lock->l_lru_seen) {
+		lock->l_lru_seen = 1;
+		ns->ns_lru_misses++;
+		if (ldlm_lock_lru_ghost_hit(lock)) {
+			ns->ns_lru_ghost_hits++;
+			protect = true;
+		}
+	}
+	lock->l_lru_spared = 0;
+
 	LASSERT(ns->ns_nr_unused >= 0);
 	ns->ns_nr_unused++;
+	if (protect && ns->ns_lru_protected_ratio > 0) {
+		lock->l_lru_protected = 1;
+		list_add_tail(&lock->l_lru, &ns->ns_protected_list);
+		ns->ns_nr_protected++;
+		ldlm_lock_lru_balance_nolock(ns);
+	} else {
+		list_add_tail(&lock->l_lru, &ns->ns_unused_list);
+	}
 }
 
 /**
@@ -349,12 +485,97 @@ void ldlm_lock_touch_in_lru(struct ldlm_lock *lock)
 	spin_lock(&ns->ns_lock);
 	if (!list_empty(&lock->l_lru)) {
 		ldlm_lock_remove_from_lru_nolock(lock);
+		lock->l_lru_referenced = 1;
+		ns->ns_lru_hits++;
 		ldlm_lock_add_to_lru_nolock(lock);
 	}
 	spin_unlock(&ns->ns_lock);
 	EXIT;
 }
 
+/**
+ * Removes LDLM lock \a lock which is being reused from namespace LRU, and
+ * counts a LRU hit if it was there. Performs necessary LRU locking.
+ */
+static void ldlm_lock_reuse_from_lru(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+
+	if (ldlm_is_ns_srv(lock)) {
+		LASSERT(list_empty(&lock->l_lru));
+		return;
+	}
+
+	spin_lock(&ns->ns_lock);
+	if (ldlm_lock_remove_from_lru_nolock(lock)) {
+		lock->l_lru_referenced = 1;
+		ns->ns_lru_hits++;
+	}
+	spin_unlock(&ns->ns_lock);
+}
+
+static inline struct ldlm_lock __rcu **
+ldlm_match_cache_slot(struct ldlm_namespace *ns, const struct ldlm_res_id *name)
+{
+	return &ns->ns_match_cache[ldlm_res_name_hash(name) &
+				   (BIT(LDLM_MATCH_CACHE_BITS) - 1)];
+}
+
+/**
+ * Makes LDLM lock \a lock, just matched, the cached lock of its resource.
+ * Only granted PR, PW and CR locks are cached.
+ * Assumes the resource is already locked.
+ */
+static void ldlm_match_cache_set(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lock __rcu **slot;
+
+	if (ns->ns_match_cache == NULL || !READ_ONCE(ns->ns_match_cache_on))
+		return;
+
+	if (!ldlm_is_granted(lock) ||
+	    !(lock->l_granted_mode & (LCK_PR | LCK_PW | LCK_CR)) ||
+	    ldlm_is_destroyed(lock))
+		return;
+
+	slot = ldlm_match_cache_slot(ns, &lock->l_resource->lr_name);
+	if (rcu_access_pointer(*slot) != lock)
+		rcu_assign_pointer(*slot, lock);
+}
+
+/**
+ * Removes LDLM lock \a lock from the match cache, it is being destroyed.
+ * Assumes the resource is already locked.
+ */
+static void ldlm_match_cache_del(struct ldlm_lock *lock)
+{
+	struct ldlm_namespace *ns = ldlm_lock_to_ns(lock);
+	struct ldlm_lock __rcu **slot;
+
+	if (ns->ns_match_cache == NULL)
+		return;
+
+	/* the slot may hold a lock of another resource set meanwhile */
+	slot = ldlm_match_cache_slot(ns, &lock->l_resource->lr_name);
+	if (rcu_access_pointer(*slot) == lock)
+		cmpxchg(slot, lock, NULL);
+}
+
+/**
+ * Clears all slots of namespace \a ns match cache.
+ */
+void ldlm_match_cache_clear(struct ldlm_namespace *ns)
+{
+	int i;
+
+	if (ns->ns_match_cache == NULL)
+		return;
+
+	for (i = 0; i < BIT(LDLM_MATCH_CACHE_BITS); i++)
+		RCU_INIT_POINTER(ns->ns_match_cache[i], NULL);
+}
+
 /**
  * Helper to destroy a locked lock.
  *
@@ -406,6 +627,7 @@ static int ldlm_lock_destroy_internal(struct ldlm_lock *lock)
 	}
 
         ldlm_lock_remove_from_lru(lock);
+	ldlm_match_cache_del(lock);
         class_handle_unhash(&lock->l_handle);
 
         EXIT;
@@ -477,6 +699,7 @@ static struct ldlm_lock *ldlm_lock_new(struct ldlm_resource *resource)
 	INIT_LIST_HEAD(&lock->l_res_link);
 	INIT_LIST_HEAD(&lock->l_lru);
 	INIT_LIST_HEAD(&lock->l_pending_chain);
+	lock->l_pending_cpt = -1;
 	INIT_LIST_HEAD(&lock->l_bl_ast);
 	INIT_LIST_HEAD(&lock->l_cp_ast);
 	INIT_LIST_HEAD(&lock->l_rk_ast);
@@ -743,6 +966,19 @@ void ldlm_lock_addref(const struct lustre_handle *lockh, enum ldlm_mode mode)
 }
 EXPORT_SYMBOL(ldlm_lock_addref);
 
+/**
+ * Adds \a delta to reader or writer counter \a users of a lock atomically,
+ * ldlm_match_cache_get() may add to it w/o lr_lock.
+ */
+static inline void ldlm_lock_users_add(__u32 *users, int delta)
+{
+	__u32 old = READ_ONCE(*users);
+	__u32 cur;
+
+	while ((cur = cmpxchg(users, old, old + delta)) != old)
+		old = cur;
+}
+
 /**
  * Helper function.
  * Add specified reader/writer reference to LDLM lock \a lock.
@@ -753,15 +989,15 @@ EXPORT_SYMBOL(ldlm_lock_addref);
 void ldlm_lock_addref_internal_nolock(struct ldlm_lock *lock,
 				      enum ldlm_mode mode)
 {
-        ldlm_lock_remove_from_lru(lock);
-        if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
-                lock->l_readers++;
-                lu_ref_add_atomic(&lock->l_reference, "reader", lock);
-        }
-        if (mode & (LCK_EX | LCK_CW | LCK_PW | LCK_GROUP | LCK_COS)) {
-                lock->l_writers++;
-                lu_ref_add_atomic(&lock->l_reference, "writer", lock);
-        }
+	ldlm_lock_reuse_from_lru(lock);
+	if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
+		ldlm_lock_users_add(&lock->l_readers, 1);
+		lu_ref_add_atomic(&lock->l_reference, "reader", lock);
+	}
+	if (mode & (LCK_EX | LCK_CW | LCK_PW | LCK_GROUP | LCK_COS)) {
+		ldlm_lock_users_add(&lock->l_writers, 1);
+		lu_ref_add_atomic(&lock->l_reference, "writer", lock);
+	}
         LDLM_LOCK_GET(lock);
         lu_ref_add_atomic(&lock->l_reference, "user", lock);
         LDLM_DEBUG(lock, "ldlm_lock_addref(%s)", ldlm_lockname[mode]);
@@ -819,16 +1055,16 @@ void ldlm_lock_decref_internal_nolock(struct ldlm_lock *lock,
 				      enum ldlm_mode mode)
 {
         LDLM_DEBUG(lock, "ldlm_lock_decref(%s)", ldlm_lockname[mode]);
-        if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
-                LASSERT(lock->l_readers > 0);
-                lu_ref_del(&lock->l_reference, "reader", lock);
-                lock->l_readers--;
-        }
-        if (mode & (LCK_EX | LCK_CW | LCK_PW | LCK_GROUP | LCK_COS)) {
-                LASSERT(lock->l_writers > 0);
-                lu_ref_del(&lock->l_reference, "writer", lock);
-                lock->l_writers--;
-        }
+	if (mode & (LCK_NL | LCK_CR | LCK_PR)) {
+		LASSERT(lock->l_readers > 0);
+		lu_ref_del(&lock->l_reference, "reader", lock);
+		ldlm_lock_users_add(&lock->l_readers, -1);
+	}
+	if (mode & (LCK_EX | LCK_CW | LCK_PW | LCK_GROUP | LCK_COS)) {
+		LASSERT(lock->l_writers > 0);
+		lu_ref_del(&lock->l_reference, "writer", lock);
+		ldlm_lock_users_add(&lock->l_writers, -1);
+	}
 
         lu_ref_del(&lock->l_reference, "user", lock);
         LDLM_LOCK_RELEASE(lock);    /* matches the LDLM_LOCK_GET() in addref */
@@ -1326,6 +1562,135 @@ static struct ldlm_lock *search_queue(struct list_head *queue,
 	return NULL;
 }
 
+/**
+ * Lockless check of cached \a lock against the match parameters \a data,
+ * like lock_matches() but also requires the lock to be granted, on
+ * resource \a res_id of type \a type, and with its LVB ready if asked.
+ * The lock can change meanwhile, so it is checked again once referenced.
+ */
+static bool ldlm_match_cache_check(struct ldlm_lock *lock,
+				   const struct ldlm_res_id *res_id,
+				   enum ldlm_type type,
+				   struct ldlm_match_data *data)
+{
+	union ldlm_policy_data *lpol = &lock->l_policy_data;
+	__u64 flags = READ_ONCE(lock->l_flags);
+	enum ldlm_mode mode = READ_ONCE(lock->l_granted_mode);
+
+	if (mode != lock->l_req_mode || !(mode & *data->lmd_mode) ||
+	    !(mode & (LCK_PR | LCK_PW | LCK_CR)))
+		return false;
+
+	if (lock->l_resource->lr_type != type ||
+	    !ldlm_res_eq(&lock->l_resource->lr_name, res_id))
+		return false;
+
+	if (flags & (LDLM_FL_EXCL | LDLM_FL_GONE_MASK))
+		return false;
+	if ((flags & LDLM_FL_CBPENDING) &&
+	    !(data->lmd_flags & LDLM_FL_CBPENDING))
+		return false;
+	if ((data->lmd_flags & LDLM_FL_LVB_READY) &&
+	    !(flags & LDLM_FL_LVB_READY))
+		return false;
+	if (!equi(data->lmd_flags & LDLM_FL_LOCAL_ONLY, flags & LDLM_FL_LOCAL))
+		return false;
+	if (data->lmd_skip_flags & flags)
+		return false;
+
+	switch (type) {
+	case LDLM_EXTENT:
+		return lpol->l_extent.start <= data->lmd_policy->l_extent.start &&
+		       lpol->l_extent.end >= data->lmd_policy->l_extent.end;
+	case LDLM_IBITS:
+		return (lpol->l_inodebits.bits &
+			data->lmd_policy->l_inodebits.bits) ==
+		       data->lmd_policy->l_inodebits.bits;
+	default:
+		return true;
+	}
+}
+
+/**
+ * Lockless fast path of ldlm_lock_match(): looks up the cached lock of
+ * resource \a res_id in namespace \a ns match cache and, if it matches
+ * \a data, references it like lock_matches() does.
+ *
+ * A reader or writer reference is only taken from a non-zero counter, i.e.
+ * on a lock already in use, which can't be cancelled nor destroyed until
+ * its counters drop to zero under lr_lock, so no resource lock is needed.
+ * A LDLM_FL_TEST_LOCK match is only done on a lock in use for the same
+ * reason, and not to have to touch it in the LRU.
+ *
+ * \retval a referenced lock or NULL, the caller falls back to the resource
+ *	   queues then.
+ */
+static struct ldlm_lock *ldlm_match_cache_get(struct ldlm_namespace *ns,
+					      const struct ldlm_res_id *res_id,
+					      enum ldlm_type type,
+					      struct ldlm_match_data *data)
+{
+	struct ldlm_lock *lock;
+	enum ldlm_mode mode;
+	__u32 *users;
+	__u32 old;
+	__u32 cur;
+
+	if (ns->ns_match_cache == NULL || !READ_ONCE(ns->ns_match_cache_on) ||
+	    data->lmd_unref)
+		return NULL;
+
+	rcu_read_lock();
+	lock = rcu_dereference(*ldlm_match_cache_slot(ns, res_id));
+	if (lock && !refcount_inc_not_zero(&lock->l_handle.h_ref))
+		lock = NULL;
+	rcu_read_unlock();
+	if (!lock)
+		return NULL;
+
+	/* the lock can't be freed now, but can be cancelled any time */
+	if (!ldlm_match_cache_check(lock, res_id, type, data))
+		goto out_put;
+
+	mode = lock->l_granted_mode;
+	users = (mode & LCK_PW) ? &lock->l_writers : &lock->l_readers;
+	if (data->lmd_flags & LDLM_FL_TEST_LOCK) {
+		if (READ_ONCE(lock->l_readers) == 0 &&
+		    READ_ONCE(lock->l_writers) == 0)
+			goto out_put;
+		*data->lmd_mode = mode;
+		return lock;
+	}
+
+	for (old = READ_ONCE(*users); old != 0; old = cur) {
+		cur = cmpxchg(users, old, old + 1);
+		if (cur == old)
+			break;
+	}
+	if (old == 0)
+		goto out_put;
+
+	/* the lock reference taken above is the one addref takes */
+	lu_ref_add_atomic(&lock->l_reference,
+			  (mode & LCK_PW) ? "writer" : "reader", lock);
+	lu_ref_add_atomic(&lock->l_reference, "user", lock);
+	LDLM_DEBUG(lock, "ldlm_lock_addref(%s)", ldlm_lockname[mode]);
+
+	/* cmpxchg() above is a full barrier */
+	if (!ldlm_match_cache_check(lock, res_id, type, data)) {
+		/* the lock was called back or converted meanwhile */
+		ldlm_lock_decref_internal(lock, mode);
+		return NULL;
+	}
+
+	*data->lmd_mode = mode;
+	return lock;
+
+out_put:
+	LDLM_LOCK_RELEASE(lock);
+	return NULL;
+}
+
 void ldlm_lock_fail_match_locked(struct ldlm_lock *lock)
 {
 	if ((lock->l_flags & LDLM_FL_FAIL_NOTIFIED) == 0) {
@@ -1432,6 +1797,13 @@ enum ldlm_mode ldlm_lock_match_with_skip(struct ldlm_namespace *ns,
 		*data.lmd_mode = data.lmd_old->l_req_mode;
 	}
 
+	lock = data.lmd_old ? NULL :
+	       ldlm_match_cache_get(ns, res_id, type, &data);
+	if (lock) {
+		lprocfs_counter_incr(ns->ns_stats, LDLM_NSS_MATCH_CACHE_HITS);
+		GOTO(found, matched = mode);
+	}
+
 	res = ldlm_resource_get(ns, NULL, res_id, type, 0);
 	if (IS_ERR(res)) {
 		LASSERT(data.lmd_old == NULL);
@@ -1446,11 +1818,15 @@ enum ldlm_mode ldlm_lock_match_with_skip(struct ldlm_namespace *ns,
 		lock = search_queue(&res->lr_granted, &data);
 	if (!lock && !(flags & LDLM_FL_BLOCK_GRANTED))
 		lock = search_queue(&res->lr_waiting, &data);
+	if (lock && !data.lmd_old && !unref && !(flags & LDLM_FL_TEST_LOCK))
+		ldlm_match_cache_set(lock);
 	matched = lock ? mode : 0;
 	unlock_res(res);
 	LDLM_RESOURCE_DELREF(res);
 	ldlm_resource_putref(res);
 
+found:
+
 	if (lock) {
 		ldlm_lock2handle(lock, lockh);
 		if ((flags & LDLM_FL_LVB_READY) &&
@@ -2101,8 +2477,9 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 
 	ENTRY;
 
+	/* send the blocking ASTs batched for some clients */
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg) ? 0 : -ENOENT);
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_bl_ast);
 
@@ -2123,6 +2500,8 @@ ldlm_work_bl_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	}
 
 	LASSERT(lock->l_blocking_lock);
+	/* compared as a whole to batch the ASTs with the same descriptor */
+	memset(&d, 0, sizeof(d));
 	ldlm_lock2desc(lock->l_blocking_lock, &d);
 	/* copy blocking lock ibits in cancel_bits as well,
 	 * new client may use them for lock convert and it is
@@ -2167,12 +2546,13 @@ ldlm_work_revoke_ast_lock(struct ptlrpc_request_set *rqset, void *opaq)
 	ENTRY;
 
 	if (list_empty(arg->list))
-		RETURN(-ENOENT);
+		RETURN(ldlm_bl_batch_flush(arg) ? 0 : -ENOENT);
 
 	lock = list_entry(arg->list->next, struct ldlm_lock, l_rk_ast);
 	list_del_init(&lock->l_rk_ast);
 
 	/* the desc just pretend to exclusive */
+	memset(&desc, 0, sizeof(desc));
 	ldlm_lock2desc(lock, &desc);
 	desc.l_req_mode = LCK_EX;
 	desc.l_granted_mode = 0;
@@ -2293,6 +2673,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	atomic_set(&arg->restart, 0);
 	arg->list = rpc_list;
+	INIT_LIST_HEAD(&arg->bl_batches);
 
 	switch (ast_type) {
 	case LDLM_WORK_CP_AST:
@@ -2328,6 +2709,7 @@ int ldlm_run_ast_work(struct ldlm_namespace *ns, struct list_head *rpc_list,
 
 	ptlrpc_set_wait(NULL, arg->set);
 	ptlrpc_set_destroy(arg->set);
+	LASSERT(list_empty(&arg->bl_batches));
 
 	rc = atomic_read(&arg->restart) ? -ERESTART : 0;
 	GOTO(out, rc);
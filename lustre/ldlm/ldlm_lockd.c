@@ -120,25 +120,44 @@ struct ldlm_bl_work_item {
 
 #ifdef HAVE_SERVER_SUPPORT
 
-/**
- * Protects both waiting_locks_list and expired_lock_thread.
- */
-static DEFINE_SPINLOCK(waiting_locks_spinlock); /* BH lock (timer) */
-
-/**
- * List for contended locks.
+/*
+ * Contended locks.
  *
- * As soon as a lock is contended, it gets placed on this list and
- * expected time to get a response is filled in the lock. A special
- * thread walks the list looking for locks that should be released and
- * schedules client evictions for those that have not been released in
- * time.
+ * As soon as a lock is contended, it gets placed on the timer wheel of the
+ * current CPT and expected time to get a response is filled in the lock.
+ * The wheel timer moves the locks which have not been released in time to
+ * the expired list of the wheel, and a special thread walks these lists and
+ * schedules client evictions for them.
  *
- * All access to it should be under waiting_locks_spinlock.
+ * Each wheel has LDLM_WHEEL_LEVELS levels of LDLM_WHEEL_SIZE slots, level N
+ * slots cover LDLM_WHEEL_SIZE^N seconds each. The locks in a slot of level
+ * N > 0 are filed again one level down when the wheel gets to the start of
+ * that slot. The deadline of a lock on a wheel may be moved forward without
+ * the wheel lock (see ldlm_refresh_waiting_lock()), the timer files the lock
+ * again when it finds the deadline has moved instead of expiring it.
  */
-static LIST_HEAD(waiting_locks_list);
-static void waiting_locks_callback(TIMER_DATA_TYPE unused);
-static CFS_DEFINE_TIMER(waiting_locks_timer, waiting_locks_callback, 0, 0);
+#define LDLM_WHEEL_BITS		6
+#define LDLM_WHEEL_SIZE		(1 << LDLM_WHEEL_BITS)
+#define LDLM_WHEEL_MASK		(LDLM_WHEEL_SIZE - 1)
+#define LDLM_WHEEL_LEVELS	3
+
+struct ldlm_waiting_wheel {
+	/** BH lock (timer), protects everything below */
+	spinlock_t		lww_lock;
+	/** next second the timer has to expire the locks of */
+	time64_t		lww_now;
+	/** when the timer fires, if lww_armed */
+	time64_t		lww_expires;
+	struct timer_list	lww_timer;
+	bool			lww_armed;
+	/** group locks, which never time out */
+	struct list_head	lww_group;
+	/** timed out locks, for expired_lock_main() */
+	struct list_head	lww_expired;
+	struct list_head	lww_slots[LDLM_WHEEL_LEVELS][LDLM_WHEEL_SIZE];
+};
+
+static struct ldlm_waiting_wheel **ldlm_wheels;
 
 enum elt_state {
 	ELT_STOPPED,
@@ -149,31 +168,128 @@ enum elt_state {
 static DECLARE_WAIT_QUEUE_HEAD(expired_lock_wait_queue);
 static enum elt_state expired_lock_thread_state = ELT_STOPPED;
 static int expired_lock_dump;
-static LIST_HEAD(expired_lock_list);
 
 static int ldlm_lock_busy(struct ldlm_lock *lock);
 static int ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t timeout);
-static int __ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t seconds);
 
 static inline int have_expired_locks(void)
 {
-	int need_to_run;
+	struct ldlm_waiting_wheel *wheel;
+	int need_to_run = 0;
+	int i;
 
 	ENTRY;
-	spin_lock_bh(&waiting_locks_spinlock);
-	need_to_run = !list_empty(&expired_lock_list);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	cfs_percpt_for_each(wheel, i, ldlm_wheels) {
+		spin_lock_bh(&wheel->lww_lock);
+		need_to_run = !list_empty(&wheel->lww_expired);
+		spin_unlock_bh(&wheel->lww_lock);
+		if (need_to_run)
+			break;
+	}
 
 	RETURN(need_to_run);
 }
 
 /**
- * Check expired lock list for expired locks and time them out.
+ * Time out the expired locks of \a wheel.
+ *
+ * \retval number of clients evicted
+ */
+static int expired_lock_process(struct ldlm_waiting_wheel *wheel)
+{
+	struct list_head *expired = &wheel->lww_expired;
+	int do_dump = 0;
+
+	spin_lock_bh(&wheel->lww_lock);
+	while (!list_empty(expired)) {
+		struct obd_export *export;
+		struct ldlm_lock *lock;
+
+		lock = list_entry(expired->next, struct ldlm_lock,
+				  l_pending_chain);
+		if ((void *)lock < LP_POISON + PAGE_SIZE &&
+		    (void *)lock >= LP_POISON) {
+			spin_unlock_bh(&wheel->lww_lock);
+			CERROR("free lock on elt list %p\n", lock);
+			LBUG();
+		}
+		list_del_init(&lock->l_pending_chain);
+		if ((void *)lock->l_export <
+		     LP_POISON + PAGE_SIZE &&
+		    (void *)lock->l_export >= LP_POISON) {
+			CERROR("lock with free export on elt list %p\n",
+			       lock->l_export);
+			lock->l_export = NULL;
+			LDLM_ERROR(lock, "free export");
+			/*
+			 * release extra ref grabbed by
+			 * ldlm_add_waiting_lock() or
+			 * ldlm_failed_ast()
+			 */
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+
+		if (ldlm_is_destroyed(lock)) {
+			/*
+			 * release the lock refcount where
+			 * ldlm_wheel_timer() founds
+			 */
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+		export = class_export_lock_get(lock->l_export, lock);
+		spin_unlock_bh(&wheel->lww_lock);
+
+		/*
+		 * Check if we need to prolong timeout, the lock may also
+		 * have been refreshed since it timed out
+		 */
+		if (!OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT) &&
+		    (READ_ONCE(lock->l_callback_timeout) > ktime_get_seconds() ||
+		     (lock->l_callback_timeout != 0 && /* not AST error */
+		      ldlm_lock_busy(lock)))) {
+			LDLM_DEBUG(lock, "prolong the busy lock");
+			lock_res_and_lock(lock);
+			ldlm_add_waiting_lock(lock,
+					      ldlm_bl_timeout(lock) >> 1);
+			unlock_res_and_lock(lock);
+		} else {
+			spin_lock_bh(&export->exp_bl_list_lock);
+			list_del_init(&lock->l_exp_list);
+			spin_unlock_bh(&export->exp_bl_list_lock);
+
+			LDLM_ERROR(lock,
+				   "lock callback timer expired after %llds: evicting client at %s ",
+				   ktime_get_real_seconds() -
+				   lock->l_blast_sent,
+				   obd_export_nid2str(export));
+			ldlm_lock_to_ns(lock)->ns_timeouts++;
+			do_dump++;
+			class_fail_export(export);
+		}
+		class_export_lock_put(export, lock);
+		/*
+		 * release extra ref grabbed by ldlm_add_waiting_lock()
+		 * or ldlm_failed_ast()
+		 */
+		LDLM_LOCK_RELEASE(lock);
+
+		spin_lock_bh(&wheel->lww_lock);
+	}
+	spin_unlock_bh(&wheel->lww_lock);
+
+	return do_dump;
+}
+
+/**
+ * Check expired lock lists for expired locks and time them out.
  */
 static int expired_lock_main(void *arg)
 {
-	struct list_head *expired = &expired_lock_list;
+	struct ldlm_waiting_wheel *wheel;
 	int do_dump;
+	int i;
 
 	ENTRY;
 
@@ -185,92 +301,15 @@ static int expired_lock_main(void *arg)
 				have_expired_locks() ||
 				expired_lock_thread_state == ELT_TERMINATE);
 
-		spin_lock_bh(&waiting_locks_spinlock);
-		if (expired_lock_dump) {
-			spin_unlock_bh(&waiting_locks_spinlock);
-
-			/* from waiting_locks_callback, but not in timer */
+		if (READ_ONCE(expired_lock_dump)) {
+			/* from ldlm_wheel_timer(), but not in timer */
 			libcfs_debug_dumplog();
-
-			spin_lock_bh(&waiting_locks_spinlock);
-			expired_lock_dump = 0;
+			WRITE_ONCE(expired_lock_dump, 0);
 		}
 
 		do_dump = 0;
-
-		while (!list_empty(expired)) {
-			struct obd_export *export;
-			struct ldlm_lock *lock;
-
-			lock = list_entry(expired->next, struct ldlm_lock,
-					  l_pending_chain);
-			if ((void *)lock < LP_POISON + PAGE_SIZE &&
-			    (void *)lock >= LP_POISON) {
-				spin_unlock_bh(&waiting_locks_spinlock);
-				CERROR("free lock on elt list %p\n", lock);
-				LBUG();
-			}
-			list_del_init(&lock->l_pending_chain);
-			if ((void *)lock->l_export <
-			     LP_POISON + PAGE_SIZE &&
-			    (void *)lock->l_export >= LP_POISON) {
-				CERROR("lock with free export on elt list %p\n",
-				       lock->l_export);
-				lock->l_export = NULL;
-				LDLM_ERROR(lock, "free export");
-				/*
-				 * release extra ref grabbed by
-				 * ldlm_add_waiting_lock() or
-				 * ldlm_failed_ast()
-				 */
-				LDLM_LOCK_RELEASE(lock);
-				continue;
-			}
-
-			if (ldlm_is_destroyed(lock)) {
-				/*
-				 * release the lock refcount where
-				 * waiting_locks_callback() founds
-				 */
-				LDLM_LOCK_RELEASE(lock);
-				continue;
-			}
-			export = class_export_lock_get(lock->l_export, lock);
-			spin_unlock_bh(&waiting_locks_spinlock);
-
-			/* Check if we need to prolong timeout */
-			if (!OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT) &&
-			    lock->l_callback_timeout != 0 && /* not AST error */
-			    ldlm_lock_busy(lock)) {
-				LDLM_DEBUG(lock, "prolong the busy lock");
-				lock_res_and_lock(lock);
-				ldlm_add_waiting_lock(lock,
-						ldlm_bl_timeout(lock) >> 1);
-				unlock_res_and_lock(lock);
-			} else {
-				spin_lock_bh(&export->exp_bl_list_lock);
-				list_del_init(&lock->l_exp_list);
-				spin_unlock_bh(&export->exp_bl_list_lock);
-
-				LDLM_ERROR(lock,
-					   "lock callback timer expired after %llds: evicting client at %s ",
-					   ktime_get_real_seconds() -
-					   lock->l_blast_sent,
-					   obd_export_nid2str(export));
-				ldlm_lock_to_ns(lock)->ns_timeouts++;
-				do_dump++;
-				class_fail_export(export);
-			}
-			class_export_lock_put(export, lock);
-			/*
-			 * release extra ref grabbed by ldlm_add_waiting_lock()
-			 * or ldlm_failed_ast()
-			 */
-			LDLM_LOCK_RELEASE(lock);
-
-			spin_lock_bh(&waiting_locks_spinlock);
-		}
-		spin_unlock_bh(&waiting_locks_spinlock);
+		cfs_percpt_for_each(wheel, i, ldlm_wheels)
+			do_dump += expired_lock_process(wheel);
 
 		if (do_dump && obd_dump_on_eviction) {
 			CERROR("dump the log upon eviction\n");
@@ -313,98 +352,281 @@ static int ldlm_lock_busy(struct ldlm_lock *lock)
 	RETURN(match);
 }
 
+/**
+ * File \a lock into the slot of \a wheel its deadline falls in.
+ *
+ * \retval time at which the wheel timer has to look at that slot
+ */
+static time64_t ldlm_wheel_file(struct ldlm_waiting_wheel *wheel,
+				struct ldlm_lock *lock, time64_t deadline)
+{
+	time64_t delta = deadline - wheel->lww_now;
+	int level;
+	int index;
+
+	if (delta < 0)
+		delta = 0;
+	for (level = 0; level < LDLM_WHEEL_LEVELS - 1; level++) {
+		if (delta < 1 << ((level + 1) * LDLM_WHEEL_BITS))
+			break;
+	}
+	/* longer than the wheel, we'll look at it again on the way */
+	delta = min_t(time64_t, delta,
+		      (1 << (LDLM_WHEEL_LEVELS * LDLM_WHEEL_BITS)) - 1);
+	deadline = wheel->lww_now + delta;
+
+	index = (deadline >> (level * LDLM_WHEEL_BITS)) & LDLM_WHEEL_MASK;
+	list_add_tail(&lock->l_pending_chain, &wheel->lww_slots[level][index]);
+
+	return deadline & ~((1LL << (level * LDLM_WHEEL_BITS)) - 1);
+}
+
+/* File the locks of slot \a index of \a level one level down. */
+static void ldlm_wheel_cascade(struct ldlm_waiting_wheel *wheel, int level,
+			       int index)
+{
+	struct ldlm_lock *lock;
+	LIST_HEAD(slot);
+
+	list_splice_init(&wheel->lww_slots[level][index], &slot);
+	while (!list_empty(&slot)) {
+		lock = list_entry(slot.next, struct ldlm_lock, l_pending_chain);
+		list_del(&lock->l_pending_chain);
+		ldlm_wheel_file(wheel, lock,
+				READ_ONCE(lock->l_callback_timeout));
+	}
+}
+
+/* Arm the timer of \a wheel for the next slot to look at, if any. */
+static void ldlm_wheel_arm(struct ldlm_waiting_wheel *wheel)
+{
+	time64_t now = ktime_get_seconds();
+	time64_t next = 0;
+	int level;
+	int i;
+
+	for (i = 0; i < LDLM_WHEEL_SIZE; i++) {
+		if (!list_empty(&wheel->lww_slots[0][(wheel->lww_now + i) &
+						     LDLM_WHEEL_MASK])) {
+			next = wheel->lww_now + i;
+			break;
+		}
+	}
+
+	for (level = 1; level < LDLM_WHEEL_LEVELS; level++) {
+		time64_t mask = (1LL << (level * LDLM_WHEEL_BITS)) - 1;
+
+		for (i = 0; i < LDLM_WHEEL_SIZE; i++) {
+			if (!list_empty(&wheel->lww_slots[level][i]))
+				break;
+		}
+		/* cascade at the start of the next slot of this level */
+		if (i < LDLM_WHEEL_SIZE &&
+		    (next == 0 || next > ((wheel->lww_now + mask) & ~mask))) {
+			next = (wheel->lww_now + mask) & ~mask;
+			break;
+		}
+	}
+
+	wheel->lww_armed = next != 0;
+	if (!wheel->lww_armed)
+		return;
+
+	wheel->lww_expires = next;
+	mod_timer(&wheel->lww_timer,
+		  jiffies + cfs_time_seconds(max_t(time64_t, next - now, 0)));
+}
+
 /* This is called from within a timer interrupt and cannot schedule */
-static void waiting_locks_callback(TIMER_DATA_TYPE unused)
+static void ldlm_wheel_timer(cfs_timer_cb_arg_t data)
 {
+	struct ldlm_waiting_wheel *wheel;
+	time64_t now = ktime_get_seconds();
 	struct ldlm_lock *lock;
 	int need_dump = 0;
+	LIST_HEAD(slot);
 
-	spin_lock_bh(&waiting_locks_spinlock);
-	while (!list_empty(&waiting_locks_list)) {
-		lock = list_entry(waiting_locks_list.next, struct ldlm_lock,
-				  l_pending_chain);
-		if (lock->l_callback_timeout > ktime_get_seconds() ||
-		    lock->l_req_mode == LCK_GROUP)
-			break;
+	wheel = cfs_from_timer(wheel, data, lww_timer);
 
-		/*
-		 * no needs to take an extra ref on the lock since it was in
-		 * the waiting_locks_list and ldlm_add_waiting_lock()
-		 * already grabbed a ref
-		 */
-		list_move(&lock->l_pending_chain, &expired_lock_list);
-		need_dump = 1;
+	spin_lock_bh(&wheel->lww_lock);
+	for (; wheel->lww_now <= now; wheel->lww_now++) {
+		time64_t second = wheel->lww_now;
+		int level;
+
+		for (level = LDLM_WHEEL_LEVELS - 1; level > 0; level--) {
+			time64_t mask = (1LL << (level * LDLM_WHEEL_BITS)) - 1;
+
+			if ((second & mask) == 0)
+				ldlm_wheel_cascade(wheel, level,
+					(second >> (level * LDLM_WHEEL_BITS)) &
+					LDLM_WHEEL_MASK);
+		}
+
+		list_splice_init(&wheel->lww_slots[0][second & LDLM_WHEEL_MASK],
+				 &slot);
+		while (!list_empty(&slot)) {
+			time64_t deadline;
+
+			lock = list_entry(slot.next, struct ldlm_lock,
+					  l_pending_chain);
+			deadline = READ_ONCE(lock->l_callback_timeout);
+			if (deadline > second) {
+				/* refreshed since it was filed */
+				list_del(&lock->l_pending_chain);
+				ldlm_wheel_file(wheel, lock, deadline);
+				continue;
+			}
+
+			if (lock->l_req_mode == LCK_GROUP) {
+				list_move(&lock->l_pending_chain,
+					  &wheel->lww_group);
+				continue;
+			}
+
+			/*
+			 * no needs to take an extra ref on the lock since it
+			 * was on the wheel and ldlm_add_waiting_lock()
+			 * already grabbed a ref
+			 */
+			list_move(&lock->l_pending_chain, &wheel->lww_expired);
+			need_dump = 1;
+		}
 	}
 
-	if (!list_empty(&expired_lock_list)) {
+	if (!list_empty(&wheel->lww_expired)) {
 		if (obd_dump_on_timeout && need_dump)
-			expired_lock_dump = __LINE__;
+			WRITE_ONCE(expired_lock_dump, __LINE__);
 
 		wake_up(&expired_lock_wait_queue);
 	}
 
-	/*
-	 * Make sure the timer will fire again if we have any locks
-	 * left.
-	 */
-	if (!list_empty(&waiting_locks_list)) {
-		time64_t now = ktime_get_seconds();
-		time_t delta = 0;
+	/* Make sure the timer will fire again if we have any locks left. */
+	ldlm_wheel_arm(wheel);
+	spin_unlock_bh(&wheel->lww_lock);
+}
 
-		lock = list_entry(waiting_locks_list.next, struct ldlm_lock,
-				  l_pending_chain);
-		if (lock->l_callback_timeout - now > 0)
-			delta = lock->l_callback_timeout - now;
-		mod_timer(&waiting_locks_timer,
-			  jiffies + cfs_time_seconds(delta));
+static int ldlm_waiting_wheels_init(void)
+{
+	struct ldlm_waiting_wheel *wheel;
+	int level;
+	int i;
+	int j;
+
+	ldlm_wheels = cfs_percpt_alloc(cfs_cpt_tab, sizeof(*wheel));
+	if (ldlm_wheels == NULL)
+		return -ENOMEM;
+
+	cfs_percpt_for_each(wheel, i, ldlm_wheels) {
+		spin_lock_init(&wheel->lww_lock);
+		cfs_timer_setup(&wheel->lww_timer, ldlm_wheel_timer,
+				(unsigned long)wheel, 0);
+		INIT_LIST_HEAD(&wheel->lww_group);
+		INIT_LIST_HEAD(&wheel->lww_expired);
+		for (level = 0; level < LDLM_WHEEL_LEVELS; level++) {
+			for (j = 0; j < LDLM_WHEEL_SIZE; j++)
+				INIT_LIST_HEAD(&wheel->lww_slots[level][j]);
+		}
 	}
-	spin_unlock_bh(&waiting_locks_spinlock);
+
+	return 0;
+}
+
+static void ldlm_waiting_wheels_fini(void)
+{
+	struct ldlm_waiting_wheel *wheel;
+	int i;
+
+	if (ldlm_wheels == NULL)
+		return;
+
+	cfs_percpt_for_each(wheel, i, ldlm_wheels)
+		del_timer_sync(&wheel->lww_timer);
+
+	cfs_percpt_free(ldlm_wheels);
+	ldlm_wheels = NULL;
+}
+
+/* Wheel \a lock is on, or was last on, NULL if it never was on one. */
+static inline struct ldlm_waiting_wheel *ldlm_lock_wheel(struct ldlm_lock *lock)
+{
+	return lock->l_pending_cpt < 0 ? NULL : ldlm_wheels[lock->l_pending_cpt];
 }
 
 /**
- * Add lock to the list of contended locks.
+ * Move the deadline of \a lock \a seconds from now, unless it is already
+ * later. This doesn't need any lock, see ldlm_wheel_timer().
+ *
+ * \retval the deadline of the lock
+ */
+static time64_t ldlm_lock_extend_deadline(struct ldlm_lock *lock,
+					  time64_t seconds)
+{
+	time64_t deadline;
+	time64_t old;
+	time64_t prev;
+
+	if (OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_NOTIMEOUT) ||
+	    OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT))
+		seconds = 1;
+
+	deadline = ktime_get_seconds() + seconds;
+	old = READ_ONCE(lock->l_callback_timeout);
+	while (likely(deadline > old)) {
+		prev = cmpxchg64(&lock->l_callback_timeout, old, deadline);
+		if (prev == old)
+			return deadline;
+		old = prev;
+	}
+
+	return old;
+}
+
+/**
+ * Add lock to the timer wheel of the current CPT.
  *
  * Indicate that we're waiting for a client to call us back cancelling a given
- * lock.  We add it to the pending-callback chain, and schedule the lock-timeout
- * timer to fire appropriately.  (We round up to the next second, to avoid
+ * lock.  We file it into the slot of its deadline, and schedule the wheel
+ * timer to fire appropriately.  (Deadlines are in whole seconds, to avoid
  * floods of timer firings during periods of high lock contention and traffic).
  * As done by ldlm_add_waiting_lock(), the caller must grab a lock reference
- * if it has been added to the waiting list (1 is returned).
+ * if it has been added to the wheel (1 is returned).
  *
- * Called with the namespace lock held.
+ * Called with the resource lock held.
  */
 static int __ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t seconds)
 {
-	unsigned long timeout_jiffies = jiffies;
-	time64_t now = ktime_get_seconds();
+	struct ldlm_waiting_wheel *wheel = ldlm_lock_wheel(lock);
 	time64_t deadline;
-	time_t timeout;
+	time64_t when;
 
-	if (!list_empty(&lock->l_pending_chain))
-		return 0;
+	if (wheel != NULL) {
+		spin_lock_bh(&wheel->lww_lock);
+		if (!list_empty(&lock->l_pending_chain)) {
+			spin_unlock_bh(&wheel->lww_lock);
+			return 0;
+		}
+		spin_unlock_bh(&wheel->lww_lock);
+	}
 
-	if (OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_NOTIMEOUT) ||
-	    OBD_FAIL_CHECK(OBD_FAIL_PTLRPC_HPREQ_TIMEOUT))
-		seconds = 1;
+	lock->l_pending_cpt = cfs_cpt_current(cfs_cpt_tab, 0);
+	wheel = ldlm_wheels[lock->l_pending_cpt];
 
-	deadline = now + seconds;
-	if (likely(deadline > lock->l_callback_timeout))
-		lock->l_callback_timeout = deadline;
+	deadline = ldlm_lock_extend_deadline(lock, seconds);
 
-	timeout = clamp_t(time_t, lock->l_callback_timeout - now,
-			  0, seconds);
-	timeout_jiffies += cfs_time_seconds(timeout);
+	spin_lock_bh(&wheel->lww_lock);
+	if (!wheel->lww_armed)
+		wheel->lww_now = ktime_get_seconds();
 
-	if (time_before(timeout_jiffies, waiting_locks_timer.expires) ||
-	    !timer_pending(&waiting_locks_timer))
-		mod_timer(&waiting_locks_timer, timeout_jiffies);
+	when = ldlm_wheel_file(wheel, lock, deadline);
+	if (!wheel->lww_armed || when < wheel->lww_expires) {
+		wheel->lww_armed = true;
+		wheel->lww_expires = when;
+		mod_timer(&wheel->lww_timer, jiffies +
+			  cfs_time_seconds(max_t(time64_t, when -
+						 ktime_get_seconds(), 0)));
+	}
+	spin_unlock_bh(&wheel->lww_lock);
 
-	/*
-	 * if the new lock has a shorter timeout than something earlier on
-	 * the list, we'll wait the longer amount of time; no big deal.
-	 */
-	/* FIFO */
-	list_add_tail(&lock->l_pending_chain, &waiting_locks_list);
 	return 1;
 }
 
@@ -448,16 +670,12 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t timeout)
 	    (exp_connect_flags(lock->l_export) & OBD_CONNECT_MDS_MDS))
 		return 0;
 
-	spin_lock_bh(&waiting_locks_spinlock);
-	if (ldlm_is_cancel(lock)) {
-		spin_unlock_bh(&waiting_locks_spinlock);
+	if (ldlm_is_cancel(lock))
 		return 0;
-	}
 
 	if (ldlm_is_destroyed(lock)) {
 		static time64_t next;
 
-		spin_unlock_bh(&waiting_locks_spinlock);
 		LDLM_ERROR(lock, "not waiting on destroyed lock (b=5653)");
 		if (ktime_get_seconds() > next) {
 			next = ktime_get_seconds() + 14400;
@@ -475,11 +693,8 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t timeout)
 		 * waiting list
 		 */
 		LDLM_LOCK_GET(lock);
-	}
-	spin_unlock_bh(&waiting_locks_spinlock);
-
-	if (ret)
 		ldlm_add_blocked_lock(lock);
+	}
 
 	LDLM_DEBUG(lock, "%sadding to wait list(timeout: %lld, AT: %s)",
 		   ret == 0 ? "not re-" : "", timeout,
@@ -488,44 +703,34 @@ static int ldlm_add_waiting_lock(struct ldlm_lock *lock, time64_t timeout)
 }
 
 /**
- * Remove a lock from the pending list, likely because it had its cancellation
- * callback arrive without incident.  This adjusts the lock-timeout timer if
- * needed.  Returns 0 if the lock wasn't pending after all, 1 if it was.
+ * Remove a lock from the timer wheel or the expired list it is on, likely
+ * because it had its cancellation callback arrive without incident.
+ * Returns 0 if the lock wasn't pending after all, 1 if it was.
  * As done by ldlm_del_waiting_lock(), the caller must release the lock
  * reference when the lock is removed from any list (1 is returned).
  *
- * Called with namespace lock held.
+ * Called with the resource lock held.
  */
 static int __ldlm_del_waiting_lock(struct ldlm_lock *lock)
 {
-	struct list_head *list_next;
+	struct ldlm_waiting_wheel *wheel = ldlm_lock_wheel(lock);
+	int ret = 0;
 
-	if (list_empty(&lock->l_pending_chain))
+	if (wheel == NULL)
 		return 0;
 
-	list_next = lock->l_pending_chain.next;
-	if (lock->l_pending_chain.prev == &waiting_locks_list) {
-		/* Removing the head of the list, adjust timer. */
-		if (list_next == &waiting_locks_list) {
-			/* No more, just cancel. */
-			del_timer(&waiting_locks_timer);
-		} else {
-			time64_t now = ktime_get_seconds();
-			struct ldlm_lock *next;
-			time_t delta = 0;
-
-			next = list_entry(list_next, struct ldlm_lock,
-					  l_pending_chain);
-			if (next->l_callback_timeout - now > 0)
-				delta = lock->l_callback_timeout - now;
-
-			mod_timer(&waiting_locks_timer,
-				  jiffies + cfs_time_seconds(delta));
-		}
+	/*
+	 * The wheel timer is left alone, it stops by itself when it finds
+	 * the wheel empty.
+	 */
+	spin_lock_bh(&wheel->lww_lock);
+	if (!list_empty(&lock->l_pending_chain)) {
+		list_del_init(&lock->l_pending_chain);
+		ret = 1;
 	}
-	list_del_init(&lock->l_pending_chain);
+	spin_unlock_bh(&wheel->lww_lock);
 
-	return 1;
+	return ret;
 }
 
 int ldlm_del_waiting_lock(struct ldlm_lock *lock)
@@ -538,10 +743,8 @@ int ldlm_del_waiting_lock(struct ldlm_lock *lock)
 		return 0;
 	}
 
-	spin_lock_bh(&waiting_locks_spinlock);
 	ret = __ldlm_del_waiting_lock(lock);
 	ldlm_clear_waited(lock);
-	spin_unlock_bh(&waiting_locks_spinlock);
 
 	/* remove the lock out of export blocking list */
 	spin_lock_bh(&lock->l_export->exp_bl_list_lock);
@@ -563,7 +766,11 @@ int ldlm_del_waiting_lock(struct ldlm_lock *lock)
 /**
  * Prolong the contended lock waiting time.
  *
- * Called with namespace lock held.
+ * This only moves the deadline of the lock forward, without any lock,
+ * since the lock is usually refreshed again and again by ongoing I/O:
+ * the wheel timer files the lock again when it gets to its old deadline,
+ * and the expired lock thread puts a lock refreshed since it timed out
+ * back on a wheel.
  */
 int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, time64_t timeout)
 {
@@ -579,21 +786,12 @@ int ldlm_refresh_waiting_lock(struct ldlm_lock *lock, time64_t timeout)
 		return 0;
 	}
 
-	spin_lock_bh(&waiting_locks_spinlock);
-
-	if (list_empty(&lock->l_pending_chain)) {
-		spin_unlock_bh(&waiting_locks_spinlock);
+	if (!ldlm_is_waited(lock)) {
 		LDLM_DEBUG(lock, "wasn't waiting");
 		return 0;
 	}
 
-	/*
-	 * we remove/add the lock to the waiting list, so no needs to
-	 * release/take a lock reference
-	 */
-	__ldlm_del_waiting_lock(lock);
-	__ldlm_add_waiting_lock(lock, timeout);
-	spin_unlock_bh(&waiting_locks_spinlock);
+	ldlm_lock_extend_deadline(lock, timeout);
 
 	LDLM_DEBUG(lock, "refreshed");
 	return 1;
@@ -649,6 +847,8 @@ EXPORT_SYMBOL(ldlm_bl_timeout);
 static void ldlm_failed_ast(struct ldlm_lock *lock, int rc,
 			    const char *ast_type)
 {
+	struct ldlm_waiting_wheel *wheel;
+
 	LCONSOLE_ERROR_MSG(0x138,
 			   "%s: A client on nid %s was evicted due to a lock %s callback time out: rc %d\n",
 			   lock->l_export->exp_obd->obd_name,
@@ -656,17 +856,25 @@ static void ldlm_failed_ast(struct ldlm_lock *lock, int rc,
 
 	if (obd_dump_on_timeout)
 		libcfs_debug_dumplog();
-	spin_lock_bh(&waiting_locks_spinlock);
+	lock_res_and_lock(lock);
 	if (__ldlm_del_waiting_lock(lock) == 0)
 		/*
 		 * the lock was not in any list, grab an extra ref before adding
 		 * the lock to the expired list
 		 */
 		LDLM_LOCK_GET(lock);
-	lock->l_callback_timeout = 0; /* differentiate it from expired locks */
-	list_add(&lock->l_pending_chain, &expired_lock_list);
+	if (lock->l_pending_cpt < 0)
+		lock->l_pending_cpt = cfs_cpt_current(cfs_cpt_tab, 0);
+	wheel = ldlm_lock_wheel(lock);
+
+	spin_lock_bh(&wheel->lww_lock);
+	/* differentiate it from expired locks */
+	WRITE_ONCE(lock->l_callback_timeout, 0);
+	list_add(&lock->l_pending_chain, &wheel->lww_expired);
+	spin_unlock_bh(&wheel->lww_lock);
+	unlock_res_and_lock(lock);
+
 	wake_up(&expired_lock_wait_queue);
-	spin_unlock_bh(&waiting_locks_spinlock);
 }
 
 /**
@@ -744,6 +952,83 @@ static int ldlm_handle_ast_error(struct ldlm_lock *lock,
 	return rc;
 }
 
+/*
+ * Blocking ASTs to locks of one client export, collected in
+ * ldlm_cb_set_arg::bl_batches to be sent in a single RPC. All locks of a
+ * batch share the AST flags sent to the client, each lock has its own
+ * descriptor of the blocking lock in RMF_DLM_BL_DESCS.
+ */
+struct ldlm_bl_batch {
+	struct list_head	 lbb_list;
+	struct ptlrpc_request	*lbb_req;
+	struct obd_export	*lbb_export;
+	__u64			 lbb_flags;
+	int			 lbb_count;
+	struct ldlm_lock	*lbb_locks[LDLM_BL_BATCH_MAX];
+};
+
+/* maximum number of batches collected at the same time for one AST set */
+#define LDLM_BL_BATCH_OPEN	16
+
+/**
+ * Reply to a multi-lock blocking AST. The client lists the locks it doesn't
+ * have anymore in the reply, these are handled as if the client returned
+ * -EINVAL for a single-lock AST.
+ */
+static int ldlm_cb_batch_interpret(struct ptlrpc_request *req,
+				   struct ldlm_cb_async_args *ca, int rc)
+{
+	struct ldlm_bl_batch *batch = ca->ca_batch;
+	struct ldlm_cb_set_arg *arg = ca->ca_set_arg;
+	struct ldlm_request *reply = NULL;
+	int i;
+	int j;
+
+	ENTRY;
+
+	/* a batch of one lock is handled by the client as a single-lock AST */
+	if (rc == 0 && batch->lbb_count > 1) {
+		if (req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ,
+					 RCL_SERVER) >= sizeof(*reply))
+			reply = req_capsule_server_get(&req->rq_pill,
+						       &RMF_DLM_REQ);
+		if (reply == NULL || reply->lock_count > batch->lbb_count ||
+		    req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ,
+					 RCL_SERVER) <
+		    ldlm_request_bufsize(reply->lock_count, LDLM_BL_CALLBACK)) {
+			DEBUG_REQ(D_ERROR, req, "bad blocking AST reply");
+			reply = NULL;
+			rc = -EPROTO;
+		}
+	}
+
+	for (i = 0; i < batch->lbb_count; i++) {
+		struct ldlm_lock *lock = batch->lbb_locks[i];
+		int lock_rc = rc;
+
+		for (j = 0; reply != NULL && j < reply->lock_count; j++) {
+			if (reply->lock_handle[j].cookie ==
+			    lock->l_remote_handle.cookie) {
+				lock_rc = -EINVAL;
+				break;
+			}
+		}
+
+		if (lock_rc != 0)
+			lock_rc = ldlm_handle_ast_error(lock, req, lock_rc,
+							"blocking");
+		if (lock_rc == -ERESTART)
+			atomic_inc(&arg->restart);
+
+		/* release extra reference taken in ldlm_bl_batch_add() */
+		LDLM_LOCK_RELEASE(lock);
+	}
+
+	OBD_FREE_PTR(batch);
+
+	RETURN(0);
+}
+
 static int ldlm_cb_interpret(const struct lu_env *env,
 			     struct ptlrpc_request *req, void *args, int rc)
 {
@@ -753,6 +1038,9 @@ static int ldlm_cb_interpret(const struct lu_env *env,
 
 	ENTRY;
 
+	if (ca->ca_batch != NULL)
+		RETURN(ldlm_cb_batch_interpret(req, ca, rc));
+
 	LASSERT(lock != NULL);
 
 	switch (arg->type) {
@@ -806,6 +1094,15 @@ static void ldlm_update_resend(struct ptlrpc_request *req, void *data)
 {
 	struct ldlm_cb_async_args *ca = data;
 	struct ldlm_lock *lock = ca->ca_lock;
+	int i;
+
+	if (ca->ca_batch != NULL) {
+		for (i = 0; i < ca->ca_batch->lbb_count; i++) {
+			lock = ca->ca_batch->lbb_locks[i];
+			ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
+		}
+		return;
+	}
 
 	ldlm_refresh_waiting_lock(lock, ldlm_bl_timeout(lock));
 }
@@ -866,6 +1163,225 @@ static void ldlm_lock_reorder_req(struct ldlm_lock *lock)
 	EXIT;
 }
 
+/**
+ * Send the blocking AST RPC of \a batch, or just drop the batch if none of
+ * its locks needed the AST after all.
+ */
+static void ldlm_bl_batch_send(struct ldlm_cb_set_arg *arg,
+			       struct ldlm_bl_batch *batch)
+{
+	struct ptlrpc_request *req = batch->lbb_req;
+	struct obd_export *exp = batch->lbb_export;
+	struct ldlm_lock *lock = batch->lbb_locks[0];
+	struct ldlm_lock_desc *descs;
+	struct ldlm_request *body;
+	time64_t now;
+	int size;
+	int i;
+
+	ENTRY;
+
+	list_del(&batch->lbb_list);
+	arg->bl_batch_count--;
+
+	if (batch->lbb_count == 0) {
+		ptlrpc_req_finished(req);
+		OBD_FREE_PTR(batch);
+		RETURN_EXIT;
+	}
+
+	/* a batch of one lock is handled by the client as a single-lock AST */
+	descs = req_capsule_client_get(&req->rq_pill, &RMF_DLM_BL_DESCS);
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_desc = descs[0];
+	body->lock_count = batch->lbb_count;
+
+	size = ldlm_request_bufsize(batch->lbb_count, LDLM_BL_CALLBACK);
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_REQ, size, RCL_CLIENT);
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_BL_DESCS,
+			   batch->lbb_count * sizeof(*descs), RCL_CLIENT);
+	/* the reply lists the locks the client doesn't have anymore */
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER, size);
+	ptlrpc_request_set_replen(req);
+
+	req->rq_send_state = LUSTRE_IMP_FULL;
+	/* ptlrpc_request_pack already set timeout */
+	if (AT_OFF)
+		req->rq_timeout = ldlm_get_rq_timeout();
+
+	/* Do not resend after lock callback timeout */
+	req->rq_delay_limit = ldlm_bl_timeout(lock);
+	req->rq_resend_cb = ldlm_update_resend;
+
+	if (exp->exp_nid_stats && exp->exp_nid_stats->nid_ldlm_stats)
+		lprocfs_counter_incr(exp->exp_nid_stats->nid_ldlm_stats,
+				     LDLM_BL_CALLBACK - LDLM_FIRST_OPC);
+
+	/*
+	 * The locks were put on the waiting list when they were added to the
+	 * batch, the client only gets the whole callback timeout to cancel
+	 * them from now on.
+	 */
+	now = ktime_get_real_seconds();
+	for (i = 0; i < batch->lbb_count; i++) {
+		batch->lbb_locks[i]->l_blast_sent = now;
+		ldlm_refresh_waiting_lock(batch->lbb_locks[i],
+					  ldlm_bl_timeout(batch->lbb_locks[i]));
+	}
+
+	LDLM_DEBUG(lock, "server sending blocking AST for %d locks",
+		   batch->lbb_count);
+	ptlrpc_set_add_req(arg->set, req);
+
+	EXIT;
+}
+
+/**
+ * Send one of the blocking AST batches collected for \a arg.
+ *
+ * Called by the AST set producers once there are no more locks to process.
+ *
+ * \retval 1 if a batch was sent
+ * \retval 0 if there are no more batches
+ */
+int ldlm_bl_batch_flush(struct ldlm_cb_set_arg *arg)
+{
+	if (list_empty(&arg->bl_batches))
+		return 0;
+
+	ldlm_bl_batch_send(arg, list_first_entry(&arg->bl_batches,
+						 struct ldlm_bl_batch,
+						 lbb_list));
+	return 1;
+}
+
+/**
+ * Find the batch for blocking ASTs of \a lock, or start a new one. The
+ * oldest batch is sent if too many are collected.
+ *
+ * Batches are per client export and AST flags only, the locks of a batch
+ * may be on any resource and blocked by any lock.
+ */
+static struct ldlm_bl_batch *ldlm_bl_batch_get(struct ldlm_cb_set_arg *arg,
+					       struct ldlm_lock *lock)
+{
+	struct obd_export *exp = lock->l_export;
+	struct ldlm_cb_async_args *ca;
+	struct ldlm_bl_batch *batch;
+	struct ldlm_request *body;
+	struct ptlrpc_request *req;
+	__u64 flags;
+	int rc;
+
+	flags = ldlm_flags_to_wire(lock->l_flags & LDLM_FL_AST_MASK);
+	list_for_each_entry(batch, &arg->bl_batches, lbb_list) {
+		if (batch->lbb_export == exp && batch->lbb_flags == flags)
+			return batch;
+	}
+
+	if (arg->bl_batch_count >= LDLM_BL_BATCH_OPEN)
+		ldlm_bl_batch_flush(arg);
+
+	OBD_ALLOC_PTR(batch);
+	if (batch == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	req = ptlrpc_request_alloc(exp->exp_imp_reverse,
+				   &RQF_LDLM_BL_CALLBACK_BATCH);
+	if (req == NULL) {
+		OBD_FREE_PTR(batch);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT,
+			     ldlm_request_bufsize(LDLM_BL_BATCH_MAX,
+						  LDLM_BL_CALLBACK));
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_BL_DESCS, RCL_CLIENT,
+			     LDLM_BL_BATCH_MAX * sizeof(struct ldlm_lock_desc));
+	rc = ptlrpc_request_pack(req, LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
+	if (rc) {
+		ptlrpc_request_free(req);
+		OBD_FREE_PTR(batch);
+		return ERR_PTR(rc);
+	}
+
+	body = req_capsule_client_get(&req->rq_pill, &RMF_DLM_REQ);
+	body->lock_flags = flags;
+
+	ca = ptlrpc_req_async_args(ca, req);
+	ca->ca_set_arg = arg;
+	ca->ca_batch = batch;
+
+	req->rq_interpret_reply = ldlm_cb_interpret;
+
+	batch->lbb_req = req;
+	batch->lbb_export = exp;
+	batch->lbb_flags = flags;
+	list_add_tail(&batch->lbb_list, &arg->bl_batches);
+	arg->bl_batch_count++;
+
+	return batch;
+}
+
+/**
+ * Add the blocking AST of \a lock to a batch for its client export, the
+ * batch is sent once it is full or there are no more locks to process, see
+ * ldlm_bl_batch_flush().
+ */
+static int ldlm_bl_batch_add(struct ldlm_lock *lock,
+			     struct ldlm_lock_desc *desc,
+			     struct ldlm_cb_set_arg *arg)
+{
+	struct ldlm_lock_desc *descs;
+	struct ldlm_bl_batch *batch;
+	struct ldlm_request *body;
+
+	ENTRY;
+
+	batch = ldlm_bl_batch_get(arg, lock);
+	if (IS_ERR(batch))
+		RETURN(PTR_ERR(batch));
+
+	lock_res_and_lock(lock);
+	if (ldlm_is_destroyed(lock)) {
+		/* What's the point? */
+		unlock_res_and_lock(lock);
+		RETURN(0);
+	}
+
+	if (!ldlm_is_granted(lock)) {
+		/*
+		 * this blocking AST will be communicated as part of the
+		 * completion AST instead
+		 */
+		ldlm_add_blocked_lock(lock);
+		ldlm_set_waited(lock);
+		unlock_res_and_lock(lock);
+
+		LDLM_DEBUG(lock, "lock not granted, not sending blocking AST");
+		RETURN(0);
+	}
+
+	body = req_capsule_client_get(&batch->lbb_req->rq_pill, &RMF_DLM_REQ);
+	descs = req_capsule_client_get(&batch->lbb_req->rq_pill,
+				       &RMF_DLM_BL_DESCS);
+	body->lock_handle[batch->lbb_count] = lock->l_remote_handle;
+	descs[batch->lbb_count] = *desc;
+	batch->lbb_locks[batch->lbb_count++] = LDLM_LOCK_GET(lock);
+
+	LDLM_DEBUG(lock, "server preparing blocking AST, %d in batch",
+		   batch->lbb_count);
+
+	ldlm_set_cbpending(lock);
+	ldlm_add_waiting_lock(lock, ldlm_bl_timeout(lock));
+	unlock_res_and_lock(lock);
+
+	if (batch->lbb_count == LDLM_BL_BATCH_MAX)
+		ldlm_bl_batch_send(arg, batch);
+
+	RETURN(0);
+}
+
 /**
  * ->l_blocking_ast() method for server-side locks. This is invoked when newly
  * enqueued server lock conflicts with given one.
@@ -902,6 +1418,15 @@ int ldlm_server_blocking_ast(struct ldlm_lock *lock,
 
 	ldlm_lock_reorder_req(lock);
 
+	/*
+	 * Clients which support it get the blocking ASTs of several locks
+	 * in one RPC. Locks cancelled on block still get an RPC of their
+	 * own, it is sent without waiting for the reply.
+	 */
+	if (exp_connect_batch_bl_ast(lock->l_export) &&
+	    !ldlm_is_cancel_on_block(lock))
+		RETURN(ldlm_bl_batch_add(lock, desc, arg));
+
 	req = ptlrpc_request_alloc_pack(lock->l_export->exp_imp_reverse,
 					&RQF_LDLM_BL_CALLBACK,
 					LUSTRE_DLM_VERSION, LDLM_BL_CALLBACK);
@@ -2274,6 +2799,139 @@ static inline void ldlm_callback_errmsg(struct ptlrpc_request *req,
 		CWARN("Send reply failed, maybe cause b=21636.\n");
 }
 
+/**
+ * Check the lock of a multi-lock blocking AST like ldlm_callback_handler()
+ * does for a single lock.
+ *
+ * \retval lock referenced and marked for the blocking AST
+ * \retval NULL if the client doesn't have the lock anymore
+ */
+static struct ldlm_lock *ldlm_bl_callback_lock(struct ldlm_request *dlm_req,
+					       struct lustre_handle *lockh)
+{
+	struct ldlm_lock *lock;
+
+	lock = ldlm_handle2lock_long(lockh, 0);
+	if (!lock) {
+		CDEBUG(D_DLMTRACE,
+		       "callback on lock %#llx - lock disappeared\n",
+		       lockh->cookie);
+		return NULL;
+	}
+
+	if (ldlm_is_fail_loc(lock))
+		OBD_RACE(OBD_FAIL_LDLM_CP_BL_RACE);
+
+	/* Copy hints/flags (e.g. LDLM_FL_DISCARD_DATA) from AST. */
+	lock_res_and_lock(lock);
+	lock->l_flags |= ldlm_flags_from_wire(dlm_req->lock_flags &
+					      LDLM_FL_AST_MASK);
+	if ((ldlm_is_canceling(lock) && ldlm_is_bl_done(lock)) ||
+	    ldlm_is_failed(lock)) {
+		LDLM_DEBUG(lock, "callback on lock %llx - lock disappeared",
+			   lockh->cookie);
+		unlock_res_and_lock(lock);
+		LDLM_LOCK_RELEASE(lock);
+		return NULL;
+	}
+	ldlm_lock_remove_from_lru(lock);
+	ldlm_set_bl_ast(lock);
+	unlock_res_and_lock(lock);
+
+	return lock;
+}
+
+/**
+ * Callback handler for blocking ASTs revoking several locks at once.
+ *
+ * The locks the client doesn't have anymore are listed in the reply. The
+ * other ones are queued one by one once the reply is sent, like the lock
+ * of a single-lock AST, so the blocking threads handle them in parallel.
+ */
+static int ldlm_handle_bl_callback_batch(struct ptlrpc_request *req,
+					 struct ldlm_namespace *ns,
+					 struct ldlm_request *dlm_req)
+{
+	struct ldlm_lock_desc *descs;
+	struct ldlm_lock **locks;
+	struct ldlm_request *reply;
+	struct ldlm_lock *lock;
+	int count = dlm_req->lock_count;
+	int stale = 0;
+	int rc;
+	int i;
+
+	ENTRY;
+
+	if (dlm_req->lock_count > LDLM_BL_BATCH_MAX ||
+	    req_capsule_get_size(&req->rq_pill, &RMF_DLM_REQ, RCL_CLIENT) <
+	    ldlm_request_bufsize(count, LDLM_BL_CALLBACK)) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate with invalid parameter", rc,
+				     NULL);
+		RETURN(0);
+	}
+
+	req_capsule_extend(&req->rq_pill, &RQF_LDLM_BL_CALLBACK_BATCH);
+	descs = req_capsule_client_sized_get(&req->rq_pill, &RMF_DLM_BL_DESCS,
+					     count * sizeof(*descs));
+	if (descs == NULL) {
+		rc = ldlm_callback_reply(req, -EPROTO);
+		ldlm_callback_errmsg(req, "Operate without lock descriptors",
+				     rc, NULL);
+		RETURN(0);
+	}
+
+	req_capsule_set_size(&req->rq_pill, &RMF_DLM_REQ, RCL_SERVER,
+			     ldlm_request_bufsize(count, LDLM_BL_CALLBACK));
+	rc = req_capsule_server_pack(&req->rq_pill);
+	if (rc) {
+		rc = ldlm_callback_reply(req, rc);
+		ldlm_callback_errmsg(req, "Pack reply failed", rc, NULL);
+		RETURN(0);
+	}
+
+	reply = req_capsule_server_get(&req->rq_pill, &RMF_DLM_REQ);
+	memset(reply, 0, sizeof(*reply));
+
+	/* if this fails, the locks are queued before the reply is sent */
+	OBD_ALLOC(locks, count * sizeof(*locks));
+
+	for (i = 0; i < count; i++) {
+		lock = ldlm_bl_callback_lock(dlm_req, &dlm_req->lock_handle[i]);
+		if (lock == NULL) {
+			reply->lock_handle[stale++] = dlm_req->lock_handle[i];
+		} else if (locks != NULL) {
+			locks[i] = lock;
+		} else if (ldlm_bl_to_thread_lock(ns, &descs[i], lock)) {
+			ldlm_handle_bl_callback(ns, &descs[i], lock);
+		}
+	}
+
+	CDEBUG(D_DLMTRACE, "blocking ast for %d locks, %d disappeared\n",
+	       count, stale);
+
+	reply->lock_count = stale;
+	req_capsule_shrink(&req->rq_pill, &RMF_DLM_REQ,
+			   ldlm_request_bufsize(stale, LDLM_BL_CALLBACK),
+			   RCL_SERVER);
+	rc = ldlm_callback_reply(req, 0);
+	if (req->rq_no_reply || rc)
+		ldlm_callback_errmsg(req, "Normal process", rc, NULL);
+
+	if (locks == NULL)
+		RETURN(0);
+
+	for (i = 0; i < count; i++) {
+		if (locks[i] != NULL &&
+		    ldlm_bl_to_thread_lock(ns, &descs[i], locks[i]))
+			ldlm_handle_bl_callback(ns, &descs[i], locks[i]);
+	}
+	OBD_FREE(locks, count * sizeof(*locks));
+
+	RETURN(0);
+}
+
 /* TODO: handle requests in a similar way as MDT: see mdt_handle_common() */
 static int ldlm_callback_handler(struct ptlrpc_request *req)
 {
@@ -2358,6 +3016,14 @@ static int ldlm_callback_handler(struct ptlrpc_request *req)
 			CERROR("ldlm_cli_cancel: %d\n", rc);
 	}
 
+	if (lustre_msg_get_opc(req->rq_reqmsg) == LDLM_BL_CALLBACK &&
+	    dlm_req->lock_count > 1) {
+		CDEBUG(D_INODE, "blocking ast for %u locks\n",
+		       dlm_req->lock_count);
+		ldlm_handle_bl_callback_batch(req, ns, dlm_req);
+		RETURN(0);
+	}
+
 	lock = ldlm_handle2lock_long(&dlm_req->lock_handle[0], 0);
 	if (!lock) {
 		CDEBUG(D_DLMTRACE,
@@ -3276,6 +3942,10 @@ static int ldlm_setup(void)
 	}
 
 #ifdef HAVE_SERVER_SUPPORT
+	rc = ldlm_waiting_wheels_init();
+	if (rc)
+		GOTO(out, rc);
+
 	task = kthread_run(expired_lock_main, NULL, "ldlm_elt");
 	if (IS_ERR(task)) {
 		rc = PTR_ERR(task);
@@ -3364,6 +4034,7 @@ static int ldlm_cleanup(void)
 		wait_event(expired_lock_wait_queue,
 			   expired_lock_thread_state == ELT_STOPPED);
 	}
+	ldlm_waiting_wheels_fini();
 #endif
 
 	OBD_FREE(ldlm_state, sizeof(*ldlm_state));
@@ -1820,6 +1820,53 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
 	return ldlm_cancel_default_policy;
 }
 
+/**
+ * Spares probation LRU \a lock which the policy chose to cancel if it
+ * still covers cached data and hasn't been unused for ns_max_age: moves
+ * it to the tail of the probation list, so that the locks which are cheap
+ * to cancel and to get again go first. A lock is spared once while it is
+ * in the LRU, \a last_use is its l_last_used when it was picked.
+ *
+ * \retval true the lock was moved
+ */
+static bool ldlm_lru_spare_lock(struct ldlm_namespace *ns,
+				struct ldlm_lock *lock, ktime_t last_use)
+{
+	bool spared;
+
+	if (ns->ns_cancel == NULL)
+		return false;
+
+	switch (lock->l_resource->lr_type) {
+	case LDLM_EXTENT:
+	case LDLM_IBITS:
+		break;
+	default:
+		return false;
+	}
+
+	if (!ktime_before(ktime_get(), ktime_add(last_use, ns->ns_max_age)))
+		return false;
+
+	/* ns_cancel() tells the lock can be cancelled w/o flushing data */
+	if (ns->ns_cancel(lock) != 0)
+		return false;
+
+	spin_lock(&ns->ns_lock);
+	spared = !list_empty(&lock->l_lru) && !lock->l_lru_protected &&
+		 !lock->l_lru_spared &&
+		 !ktime_compare(last_use, lock->l_last_used);
+	if (spared) {
+		lock->l_lru_spared = 1;
+		if (ns->ns_last_pos == &lock->l_lru)
+			ns->ns_last_pos = lock->l_lru.prev;
+		list_move_tail(&lock->l_lru, &ns->ns_unused_list);
+	}
+	spin_unlock(&ns->ns_lock);
+
+	return spared;
+}
+
 /**
  * - Free space in LRU for \a count new locks,
  *   redundant unused locks are canceled locally;
@@ -1856,6 +1903,13 @@ ldlm_cancel_lru_policy(struct ldlm_namespace *ns, enum ldlm_lru_flags lru_flags)
  * flags & LDLM_CANCEL_CLEANUP - when cancelling read locks, do not check for
  *				other read locks covering the same pages, just
  *				discard those pages.
+ *
+ * Locks are taken from the probation list first, then from the protected
+ * list once it is exhausted, as long as the policy would cancel the oldest
+ * protected lock and LDLM_LRU_FLAG_NO_WAIT is not set. Unless called with
+ * LDLM_LRU_FLAG_NO_WAIT, LDLM_LRU_FLAG_SHRINK or LDLM_LRU_FLAG_CLEANUP, a
+ * probation lock which still covers cached data is spared once,
+ * \see ldlm_lru_spare_lock().
  */
 static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 				 struct list_head *cancels, int count, int max,
@@ -1864,6 +1918,9 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	ldlm_cancel_lru_policy_t pf;
 	int added = 0;
 	int no_wait = lru_flags & LDLM_LRU_FLAG_NO_WAIT;
+	bool may_spare = !(lru_flags & (LDLM_LRU_FLAG_NO_WAIT |
+					LDLM_LRU_FLAG_SHRINK |
+					LDLM_LRU_FLAG_CLEANUP));
 
 	ENTRY;
 
@@ -1873,12 +1930,20 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 	pf = ldlm_cancel_lru_policy(ns, lru_flags);
 	LASSERT(pf != NULL);
 
+	/* Aged protected locks are not worth protecting any more. */
+	spin_lock(&ns->ns_lock);
+	ldlm_lock_lru_balance_nolock(ns);
+	spin_unlock(&ns->ns_lock);
+
 	/* For any flags, stop scanning if @max is reached. */
-	while (!list_empty(&ns->ns_unused_list) && (max == 0 || added < max)) {
+	while ((!list_empty(&ns->ns_unused_list) ||
+		!list_empty(&ns->ns_protected_list)) &&
+	       (max == 0 || added < max)) {
 		struct ldlm_lock *lock;
 		struct list_head *item, *next;
 		enum ldlm_policy_res result;
 		ktime_t last_use = ktime_set(0, 0);
+		bool spare;
 
 		spin_lock(&ns->ns_lock);
 		item = no_wait ? ns->ns_last_pos : &ns->ns_unused_list;
@@ -1900,11 +1965,37 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			ldlm_lock_remove_from_lru_nolock(lock);
 		}
 		if (item == &ns->ns_unused_list) {
+			/*
+			 * The probation list is exhausted. Go on with the
+			 * oldest protected lock only if the policy would
+			 * cancel it. A no-wait scan only gets the locks it
+			 * can cancel right away, and leaves the protected
+			 * ones alone.
+			 */
+			if (no_wait || list_empty(&ns->ns_protected_list)) {
+				spin_unlock(&ns->ns_lock);
+				break;
+			}
+			lock = list_entry(ns->ns_protected_list.next,
+					  struct ldlm_lock, l_lru);
+			LDLM_LOCK_GET(lock);
 			spin_unlock(&ns->ns_lock);
-			break;
+
+			result = pf(ns, lock, ns->ns_nr_unused, added, count);
+			if (result == LDLM_POLICY_CANCEL_LOCK) {
+				spin_lock(&ns->ns_lock);
+				if (ns->ns_protected_list.next == &lock->l_lru)
+					ldlm_lock_lru_demote_nolock(ns, false);
+				spin_unlock(&ns->ns_lock);
+			}
+			LDLM_LOCK_RELEASE(lock);
+			if (result != LDLM_POLICY_CANCEL_LOCK)
+				break;
+			continue;
 		}
 
 		last_use = lock->l_last_used;
+		spare = may_spare && !lock->l_lru_spared;
 
 		LDLM_LOCK_GET(lock);
 		spin_unlock(&ns->ns_lock);
@@ -1946,6 +2037,12 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			continue;
 		}
 
+		if (spare && ldlm_lru_spare_lock(ns, lock, last_use)) {
+			lu_ref_del(&lock->l_reference, __func__, current);
+			LDLM_LOCK_RELEASE(lock);
+			continue;
+		}
+
 		lock_res_and_lock(lock);
 		/* Check flags again under the lock. */
 		if (ldlm_is_canceling(lock) ||
@@ -1964,6 +2061,7 @@ static int ldlm_prepare_lru_list(struct ldlm_namespace *ns,
 			continue;
 		}
 		LASSERT(!lock->l_readers && !lock->l_writers);
+		ldlm_lock_lru_ghost_add(lock);
 
 		/*
 		 * If we have chosen to cancel this lock voluntarily, we
@@ -304,6 +304,124 @@ static ssize_t lock_unused_count_show(struct kobject *kobj,
 }
 LUSTRE_RO_ATTR(lock_unused_count);
 
+static ssize_t lru_protected_count_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%d\n", ns->ns_nr_protected);
+}
+LUSTRE_RO_ATTR(lru_protected_count);
+
+static ssize_t lru_protected_ratio_show(struct kobject *kobj,
+					struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%u\n", ns->ns_lru_protected_ratio);
+}
+
+static ssize_t lru_protected_ratio_store(struct kobject *kobj,
+					 struct attribute *attr,
+					 const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	unsigned int tmp;
+	int err;
+
+	err = kstrtouint(buffer, 10, &tmp);
+	if (err != 0)
+		return err;
+	if (tmp > 100)
+		return -ERANGE;
+
+	spin_lock(&ns->ns_lock);
+	ns->ns_lru_protected_ratio = tmp;
+	ldlm_lock_lru_balance_nolock(ns);
+	spin_unlock(&ns->ns_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(lru_protected_ratio);
+
+static ssize_t match_cache_show(struct kobject *kobj, struct attribute *attr,
+				char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%d\n", ns->ns_match_cache_on);
+}
+
+static ssize_t match_cache_store(struct kobject *kobj, struct attribute *attr,
+				 const char *buffer, size_t count)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	bool val;
+	int err;
+
+	err = kstrtobool(buffer, &val);
+	if (err)
+		return err;
+
+	if (val && ns->ns_match_cache == NULL)
+		return -EOPNOTSUPP;
+
+	WRITE_ONCE(ns->ns_match_cache_on, val);
+	if (!val)
+		ldlm_match_cache_clear(ns);
+
+	return count;
+}
+LUSTRE_RW_ATTR(match_cache);
+
+static ssize_t match_cache_hits_show(struct kobject *kobj,
+				     struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+	__u64 hits;
+
+	hits = lprocfs_stats_collector(ns->ns_stats, LDLM_NSS_MATCH_CACHE_HITS,
+				       LPROCFS_FIELDS_FLAGS_COUNT);
+	return sprintf(buf, "%llu\n", hits);
+}
+LUSTRE_RO_ATTR(match_cache_hits);
+
+static ssize_t lru_hits_show(struct kobject *kobj, struct attribute *attr,
+			     char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%llu\n", ns->ns_lru_hits);
+}
+LUSTRE_RO_ATTR(lru_hits);
+
+static ssize_t lru_misses_show(struct kobject *kobj, struct attribute *attr,
+			       char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%llu\n", ns->ns_lru_misses);
+}
+LUSTRE_RO_ATTR(lru_misses);
+
+static ssize_t lru_ghost_hits_show(struct kobject *kobj,
+				   struct attribute *attr, char *buf)
+{
+	struct ldlm_namespace *ns = container_of(kobj, struct ldlm_namespace,
+						 ns_kobj);
+
+	return sprintf(buf, "%llu\n", ns->ns_lru_ghost_hits);
+}
+LUSTRE_RO_ATTR(lru_ghost_hits);
+
 static ssize_t lru_size_show(struct kobject *kobj, struct attribute *attr,
 			     char *buf)
 {
@@ -647,6 +765,13 @@ static struct attribute *ldlm_ns_attrs[] = {
 	&lustre_attr_lock_unused_count.attr,
 	&lustre_attr_lru_size.attr,
 	&lustre_attr_lru_max_age.attr,
+	&lustre_attr_lru_protected_count.attr,
+	&lustre_attr_lru_protected_ratio.attr,
+	&lustre_attr_lru_hits.attr,
+	&lustre_attr_lru_misses.attr,
+	&lustre_attr_lru_ghost_hits.attr,
+	&lustre_attr_match_cache.attr,
+	&lustre_attr_match_cache_hits.attr,
 	&lustre_attr_early_lock_cancel.attr,
 	&lustre_attr_dirty_age_limit.attr,
 #ifdef HAVE_SERVER_SUPPORT
@@ -708,6 +833,8 @@ int ldlm_namespace_sysfs_register(struct ldlm_namespace *ns)
 
 	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_LOCKS,
 			     LPROCFS_CNTR_AVGMINMAX, "locks", "locks");
+	lprocfs_counter_init(ns->ns_stats, LDLM_NSS_MATCH_CACHE_HITS, 0,
+			     "match_cache_hits", "locks");
 
 	return err;
 }
@@ -916,6 +1043,7 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 
 	INIT_LIST_HEAD(&ns->ns_list_chain);
 	INIT_LIST_HEAD(&ns->ns_unused_list);
+	INIT_LIST_HEAD(&ns->ns_protected_list);
 	spin_lock_init(&ns->ns_lock);
 	atomic_set(&ns->ns_bref, 0);
 	init_waitqueue_head(&ns->ns_waitq);
@@ -936,6 +1064,22 @@ struct ldlm_namespace *ldlm_namespace_new(struct obd_device *obd, char *name,
 	ns->ns_stopping           = 0;
 	ns->ns_reclaim_start	  = 0;
 	ns->ns_last_pos		  = &ns->ns_unused_list;
+	ns->ns_nr_protected	  = 0;
+	ns->ns_lru_protected_ratio = LDLM_DEFAULT_LRU_PROTECTED_RATIO;
+
+	if (client == LDLM_NAMESPACE_CLIENT) {
+		OBD_ALLOC_LARGE(ns->ns_lru_ghost, BIT(LDLM_LRU_GHOST_BITS) *
+						  sizeof(ns->ns_lru_ghost[0]));
+		if (!ns->ns_lru_ghost)
+			GOTO(out_hash, rc = -ENOMEM);
+
+		OBD_ALLOC_LARGE(ns->ns_match_cache,
+				BIT(LDLM_MATCH_CACHE_BITS) *
+				sizeof(ns->ns_match_cache[0]));
+		if (!ns->ns_match_cache)
+			GOTO(out_hash, rc = -ENOMEM);
+		ns->ns_match_cache_on = true;
+	}
 
 	rc = ldlm_namespace_sysfs_register(ns);
 	if (rc) {
@@ -964,6 +1108,12 @@ out_sysfs:
 	ldlm_namespace_sysfs_unregister(ns);
 	ldlm_namespace_cleanup(ns, 0);
 out_hash:
+	if (ns->ns_lru_ghost)
+		OBD_FREE_LARGE(ns->ns_lru_ghost, BIT(LDLM_LRU_GHOST_BITS) *
+						 sizeof(ns->ns_lru_ghost[0]));
+	if (ns->ns_match_cache)
+		OBD_FREE_LARGE(ns->ns_match_cache, BIT(LDLM_MATCH_CACHE_BITS) *
+						   sizeof(ns->ns_match_cache[0]));
 	OBD_FREE_LARGE(ns->ns_rs_buckets,
 		       BIT(ns->ns_bucket_bits) * sizeof(ns->ns_rs_buckets[0]));
 	kfree(ns->ns_name);
@@ -1234,6 +1384,12 @@ void ldlm_namespace_free_post(struct ldlm_namespace *ns)
 	ldlm_namespace_debugfs_unregister(ns);
 	ldlm_namespace_sysfs_unregister(ns);
 	cfs_hash_putref(ns->ns_rs_hash);
+	if (ns->ns_lru_ghost)
+		OBD_FREE_LARGE(ns->ns_lru_ghost, BIT(LDLM_LRU_GHOST_BITS) *
+						 sizeof(ns->ns_lru_ghost[0]));
+	if (ns->ns_match_cache)
+		OBD_FREE_LARGE(ns->ns_match_cache, BIT(LDLM_MATCH_CACHE_BITS) *
+						   sizeof(ns->ns_match_cache[0]));
 	OBD_FREE_LARGE(ns->ns_rs_buckets,
 		       BIT(ns->ns_bucket_bits) * sizeof(ns->ns_rs_buckets[0]));
 	kfree(ns->ns_name);
@@ -1358,7 +1514,11 @@ static bool ldlm_resource_extent_new(struct ldlm_resource *res)
 		res->lr_itree[idx].lit_size = 0;
 		res->lr_itree[idx].lit_mode = 1 << idx;
 		res->lr_itree[idx].lit_root = NULL;
+		res->lr_itree[idx].lit_waiting_size = 0;
+		res->lr_itree[idx].lit_waiting_root = NULL;
 	}
+	res->lr_waiting_seq = 0;
+	res->lr_waiting_rescan = false;
 	return true;
 }
 
@@ -1589,6 +1749,8 @@ void ldlm_resource_add_lock(struct ldlm_resource *res, struct list_head *head,
 
 	if (res->lr_type == LDLM_IBITS)
 		ldlm_inodebits_add_lock(res, head, lock);
+	else if (res->lr_type == LDLM_EXTENT && head == &res->lr_waiting)
+		ldlm_extent_add_waiting(res, lock);
 }
 
 /**
@@ -1614,6 +1776,9 @@ void ldlm_resource_insert_lock_after(struct ldlm_lock *original,
 	LASSERT(list_empty(&new->l_res_link));
 
 	list_add(&new->l_res_link, &original->l_res_link);
+
+	if (res->lr_type == LDLM_EXTENT && !ldlm_is_granted(new))
+		ldlm_extent_add_waiting(res, new);
  out:;
 }
 
@@ -1299,6 +1299,352 @@ out:
         RETURN(rc);
 }
 
+/* Fill \a stx from the attributes in \a body that are valid in \a valid */
+static void ll_mdt_body2statx(struct inode *inode, const struct mdt_body *body,
+			      __u64 valid, lstatx_t *stx)
+{
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+
+	memset(stx, 0, sizeof(*stx));
+	stx->stx_blksize = PAGE_SIZE;
+	stx->stx_nlink = body->mbo_nlink;
+	stx->stx_uid = body->mbo_uid;
+	stx->stx_gid = body->mbo_gid;
+	stx->stx_mode = body->mbo_mode;
+	stx->stx_ino = cl_fid_build_ino(&body->mbo_fid1,
+					sbi->ll_flags & LL_SBI_32BIT_API);
+	stx->stx_size = body->mbo_size;
+	stx->stx_blocks = body->mbo_blocks;
+	stx->stx_atime.tv_sec = body->mbo_atime;
+	stx->stx_ctime.tv_sec = body->mbo_ctime;
+	stx->stx_mtime.tv_sec = body->mbo_mtime;
+	stx->stx_rdev_major = MAJOR(body->mbo_rdev);
+	stx->stx_rdev_minor = MINOR(body->mbo_rdev);
+	stx->stx_dev_major = MAJOR(inode->i_sb->s_dev);
+	stx->stx_dev_minor = MINOR(inode->i_sb->s_dev);
+	stx->stx_mask |= STATX_BASIC_STATS;
+
+	if (!(valid & OBD_MD_FLSIZE))
+		stx->stx_mask &= ~STATX_SIZE;
+	if (!(valid & OBD_MD_FLBLOCKS))
+		stx->stx_mask &= ~STATX_BLOCKS;
+}
+
+struct ll_readdir_plus_entry {
+	struct lu_fid	 lre_fid;
+	__u64		 lre_hash;
+	char		*lre_name;
+	__u16		 lre_namelen;
+	__u16		 lre_type;
+	int		 lre_rc;
+	__u64		 lre_valid;
+	lstatx_t	 lre_stx;
+	struct lov_mds_md *lre_lmm;
+	int		 lre_lmmsize;
+};
+
+struct ll_readdir_plus_data {
+#ifdef HAVE_DIR_CONTEXT
+	struct dir_context	 lrpd_ctx;
+#endif
+	struct inode		*lrpd_inode;
+	struct ll_readdir_plus_entry *lrpd_ents;
+	int			 lrpd_count;
+	/* names of the entries, and size needed to return them */
+	char			*lrpd_names;
+	int			 lrpd_size;
+	int			 lrpd_bufsize;
+	/* layouts of the entries */
+	char			*lrpd_lmm;
+	int			 lrpd_lmmused;
+	int			 lrpd_lmmsize;
+};
+
+static inline int ll_readdir_plus_reclen(int namelen, int lmmsize)
+{
+	return round_up(sizeof(struct ll_readdir_plus_ent) + namelen + 1, 8) +
+	       round_up(offsetof(struct lov_user_mds_data, lmd_lmm) +
+			max_t(int, lmmsize, sizeof(struct lov_user_md_v1)), 8);
+}
+
+static int
+#ifndef HAVE_FILLDIR_USE_CTX
+ll_readdir_plus_filldir(void *cookie, const char *name, int namelen,
+			loff_t hash, u64 ino, unsigned int type)
+{
+	struct ll_readdir_plus_data *lrpd = cookie;
+#else
+ll_readdir_plus_filldir(struct dir_context *ctx, const char *name, int namelen,
+			loff_t hash, u64 ino, unsigned int type)
+{
+	struct ll_readdir_plus_data *lrpd =
+		container_of(ctx, struct ll_readdir_plus_data, lrpd_ctx);
+#endif /* HAVE_FILLDIR_USE_CTX */
+	/* 'name' is part of the 'lu_dirent', see ll_nfs_get_name_filldir() */
+	char (*n)[0] = (void *)name;
+	struct lu_dirent *lde = container_of0(n, struct lu_dirent, lde_name);
+	struct ll_readdir_plus_entry *lre;
+	int reclen;
+
+	if ((namelen == 1 && name[0] == '.') ||
+	    (namelen == 2 && name[0] == '.' && name[1] == '.'))
+		return 0;
+
+	/* stop here, the next call continues from this entry */
+	reclen = ll_readdir_plus_reclen(namelen, 0);
+	if (lrpd->lrpd_count == MD_BATCH_GETATTR_MAX ||
+	    lrpd->lrpd_size + reclen > lrpd->lrpd_bufsize)
+		return 1;
+
+	lre = &lrpd->lrpd_ents[lrpd->lrpd_count++];
+	fid_le_to_cpu(&lre->lre_fid, &lde->lde_fid);
+	lre->lre_hash = le64_to_cpu(lde->lde_hash);
+	lre->lre_type = type;
+	lre->lre_namelen = namelen;
+	lre->lre_name = lrpd->lrpd_names + lrpd->lrpd_size;
+	memcpy(lre->lre_name, name, namelen);
+	lre->lre_name[namelen] = '\0';
+	lrpd->lrpd_size += reclen;
+
+	return 0;
+}
+
+static void ll_readdir_plus_cb(struct md_getattr_batch *mgb, int idx, int rc,
+			       struct mdt_body *body, void *ea, int easize)
+{
+	struct ll_readdir_plus_data *lrpd = mgb->mgb_cbdata;
+	struct ll_readdir_plus_entry *lre = &lrpd->lrpd_ents[idx];
+	struct lov_mds_md *lmm;
+	__u64 valid;
+
+	lre->lre_rc = rc;
+	if (rc)
+		return;
+
+	/* the size of a striped directory is aggregated on the client, and
+	 * the MDT returns the size of the master object only
+	 */
+	valid = body->mbo_valid;
+	if (S_ISDIR(body->mbo_mode))
+		valid &= ~(OBD_MD_FLSIZE | OBD_MD_FLBLOCKS);
+	lre->lre_valid = valid;
+	ll_mdt_body2statx(lrpd->lrpd_inode, body, valid, &lre->lre_stx);
+
+	if (ea == NULL)
+		return;
+
+	if (lrpd->lrpd_lmmused + easize > lrpd->lrpd_lmmsize) {
+		lre->lre_rc = -EOVERFLOW;
+		return;
+	}
+
+	lmm = (struct lov_mds_md *)(lrpd->lrpd_lmm + lrpd->lrpd_lmmused);
+	memcpy(lmm, ea, easize);
+	rc = ll_lov_ea_to_cpu(lmm, body->mbo_mode);
+	if (rc) {
+		lre->lre_rc = rc;
+		return;
+	}
+	lre->lre_lmm = lmm;
+	lre->lre_lmmsize = easize;
+	lrpd->lrpd_lmmused += round_up(easize, 8);
+}
+
+/* Pack the entries collected in \a lrpd into \a buf in directory order. */
+static int ll_readdir_plus_pack(struct ll_readdir_plus_data *lrpd, char *buf,
+				__u64 *hash)
+{
+	int used = 0;
+	int i;
+
+	for (i = 0; i < lrpd->lrpd_count; i++) {
+		struct ll_readdir_plus_entry *lre = &lrpd->lrpd_ents[i];
+		struct ll_readdir_plus_ent *ent;
+		struct lov_user_mds_data *lmd;
+		int reclen;
+
+		reclen = ll_readdir_plus_reclen(lre->lre_namelen,
+						lre->lre_lmmsize);
+		if (used + reclen > lrpd->lrpd_bufsize) {
+			/* continue from this entry, unless no entry at all
+			 * fits, then return it without its layout
+			 */
+			if (i > 0) {
+				*hash = lre->lre_hash;
+				break;
+			}
+			lre->lre_rc = -EOVERFLOW;
+			lre->lre_lmmsize = 0;
+			reclen = ll_readdir_plus_reclen(lre->lre_namelen, 0);
+		}
+
+		ent = (struct ll_readdir_plus_ent *)(buf + used);
+		ent->lrpe_reclen = reclen;
+		ent->lrpe_rc = lre->lre_rc;
+		ent->lrpe_namelen = lre->lre_namelen;
+		ent->lrpe_type = lre->lre_type;
+		ent->lrpe_lmdoff = round_up(sizeof(*ent) + lre->lre_namelen + 1,
+					    8);
+		memcpy(ent->lrpe_name, lre->lre_name, lre->lre_namelen + 1);
+
+		lmd = (struct lov_user_mds_data *)((char *)ent +
+						   ent->lrpe_lmdoff);
+		lmd->lmd_fid = lre->lre_fid;
+		if (lre->lre_rc == 0) {
+			lmd->lmd_stx = lre->lre_stx;
+			lmd->lmd_flags = lre->lre_valid;
+			lmd->lmd_lmmsize = lre->lre_lmmsize;
+			if (lre->lre_lmmsize > 0)
+				memcpy(&lmd->lmd_lmm, lre->lre_lmm,
+				       lre->lre_lmmsize);
+		}
+		used += reclen;
+	}
+
+	return i;
+}
+
+/*
+ * Read a chunk of directory entries, and fetch the attributes and layouts of
+ * all of them with a single MDS_BATCH_GETATTR RPC, instead of one getattr per
+ * entry like IOC_MDC_GETFILEINFO does.
+ *
+ * Like IOC_MDC_GETFILEINFO this does not take any lock on the entries, so the
+ * attributes are not cached in the client, and are only a snapshot.
+ */
+static int ll_readdir_plus(struct file *file, void __user *arg)
+{
+	struct ll_readdir_plus __user *ulrp = arg;
+	struct inode *inode = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_readdir_plus_data lrpd = {
+#ifdef HAVE_DIR_CONTEXT
+		.lrpd_ctx.actor = ll_readdir_plus_filldir,
+#endif
+		.lrpd_inode = inode,
+	};
+	struct md_getattr_batch mgb = {
+		.mgb_valid = OBD_MD_FLEASIZE,
+		.mgb_cb = ll_readdir_plus_cb,
+		.mgb_cbdata = &lrpd,
+	};
+	struct ll_readdir_plus lrp;
+	struct md_op_data *op_data;
+	char *buf = NULL;
+	__u64 pos;
+	int i, rc;
+	ENTRY;
+
+	if (!exp_connect_batch_getattr(sbi->ll_md_exp))
+		RETURN(-EOPNOTSUPP);
+
+	if (copy_from_user(&lrp, ulrp, sizeof(lrp)))
+		RETURN(-EFAULT);
+
+	if (lrp.lrp_bufsize < ll_readdir_plus_reclen(NAME_MAX, 0))
+		RETURN(-EINVAL);
+	lrpd.lrpd_bufsize = min_t(__u32, lrp.lrp_bufsize,
+				  MD_BATCH_GETATTR_EASIZE_MAX);
+
+	rc = inode_permission(inode, MAY_READ | MAY_EXEC);
+	if (rc)
+		RETURN(rc);
+
+	lrp.lrp_count = 0;
+	lrp.lrp_flags = 0;
+	if (lrp.lrp_hash == MDS_DIR_END_OFF) {
+		lrp.lrp_flags |= LRP_F_EOF;
+		if (copy_to_user(ulrp, &lrp, sizeof(lrp)))
+			RETURN(-EFAULT);
+		RETURN(0);
+	}
+
+	OBD_ALLOC_LARGE(lrpd.lrpd_ents,
+			MD_BATCH_GETATTR_MAX * sizeof(*lrpd.lrpd_ents));
+	OBD_ALLOC_LARGE(lrpd.lrpd_names, lrpd.lrpd_bufsize);
+	OBD_ALLOC_LARGE(buf, lrpd.lrpd_bufsize);
+	if (lrpd.lrpd_ents == NULL || lrpd.lrpd_names == NULL || buf == NULL)
+		GOTO(out_free, rc = -ENOMEM);
+
+	op_data = ll_prep_md_op_data(NULL, inode, inode, NULL, 0, 0,
+				     LUSTRE_OPC_ANY, inode);
+	if (IS_ERR(op_data))
+		GOTO(out_free, rc = PTR_ERR(op_data));
+
+	/* foreign dirs are browsed out of Lustre */
+	if (unlikely(op_data->op_mea1 != NULL &&
+		     op_data->op_mea1->lsm_md_magic == LMV_MAGIC_FOREIGN)) {
+		ll_finish_md_op_data(op_data);
+		GOTO(out_free, rc = -ENODATA);
+	}
+
+	pos = lrp.lrp_hash;
+	inode_lock(inode);
+#ifdef HAVE_DIR_CONTEXT
+	lrpd.lrpd_ctx.pos = pos;
+	rc = ll_dir_read(inode, &pos, op_data, &lrpd.lrpd_ctx);
+	pos = lrpd.lrpd_ctx.pos;
+#else
+	rc = ll_dir_read(inode, &pos, op_data, &lrpd, ll_readdir_plus_filldir);
+#endif
+	inode_unlock(inode);
+	ll_finish_md_op_data(op_data);
+	if (rc)
+		GOTO(out_free, rc);
+
+	if (lrpd.lrpd_count == 0 && pos != MDS_DIR_END_OFF)
+		GOTO(out_free, rc = -EOVERFLOW);
+
+	if (lrpd.lrpd_count > 0) {
+		OBD_ALLOC_LARGE(mgb.mgb_fids,
+				lrpd.lrpd_count * sizeof(*mgb.mgb_fids));
+		if (mgb.mgb_fids == NULL)
+			GOTO(out_free, rc = -ENOMEM);
+		for (i = 0; i < lrpd.lrpd_count; i++)
+			mgb.mgb_fids[i] = lrpd.lrpd_ents[i].lre_fid;
+		mgb.mgb_nr = lrpd.lrpd_count;
+
+		/* layouts are returned for regular files only */
+		lrpd.lrpd_lmmsize = lrpd.lrpd_bufsize - lrpd.lrpd_size;
+		mgb.mgb_easize = lrpd.lrpd_lmmsize;
+		if (lrpd.lrpd_lmmsize > 0) {
+			OBD_ALLOC_LARGE(lrpd.lrpd_lmm, lrpd.lrpd_lmmsize);
+			if (lrpd.lrpd_lmm == NULL)
+				GOTO(out_fids, rc = -ENOMEM);
+		}
+
+		rc = md_batch_getattr(sbi->ll_md_exp, &mgb);
+		if (rc)
+			GOTO(out_fids, rc);
+	}
+
+	lrp.lrp_count = ll_readdir_plus_pack(&lrpd, buf, &pos);
+	if (pos == MDS_DIR_END_OFF)
+		lrp.lrp_flags |= LRP_F_EOF;
+	lrp.lrp_hash = pos;
+
+	if (copy_to_user(ulrp->lrp_buf, buf, lrpd.lrpd_bufsize) ||
+	    copy_to_user(ulrp, &lrp, sizeof(lrp)))
+		rc = -EFAULT;
+	EXIT;
+out_fids:
+	if (mgb.mgb_fids)
+		OBD_FREE_LARGE(mgb.mgb_fids,
+			       lrpd.lrpd_count * sizeof(*mgb.mgb_fids));
+out_free:
+	if (lrpd.lrpd_lmm)
+		OBD_FREE_LARGE(lrpd.lrpd_lmm, lrpd.lrpd_lmmsize);
+	if (buf)
+		OBD_FREE_LARGE(buf, lrpd.lrpd_bufsize);
+	if (lrpd.lrpd_names)
+		OBD_FREE_LARGE(lrpd.lrpd_names, lrpd.lrpd_bufsize);
+	if (lrpd.lrpd_ents)
+		OBD_FREE_LARGE(lrpd.lrpd_ents,
+			       MD_BATCH_GETATTR_MAX * sizeof(*lrpd.lrpd_ents));
+
+	return rc;
+}
+
 int ll_rmfid(struct file *file, void __user *arg)
 {
 	const struct fid_array __user *ufa = arg;
@@ -1725,6 +2071,8 @@ out_rmdir:
 	}
 	case LL_IOC_RMFID:
 		RETURN(ll_rmfid(file, (void __user *)arg));
+	case LL_IOC_READDIR_PLUS:
+		RETURN(ll_readdir_plus(file, (void __user *)arg));
 	case LL_IOC_LOV_SWAP_LAYOUTS:
 		RETURN(-EPERM);
 	case IOC_OBD_STATFS:
@@ -1840,28 +2188,9 @@ out_rmdir:
 				GOTO(out_req, rc = -EFAULT);
 		} else if (cmd == IOC_MDC_GETFILEINFO ||
 			   cmd == LL_IOC_MDC_GETINFO) {
-			lstatx_t stx = { 0 };
+			lstatx_t stx;
 			__u64 valid = body->mbo_valid;
 
-			stx.stx_blksize = PAGE_SIZE;
-			stx.stx_nlink = body->mbo_nlink;
-			stx.stx_uid = body->mbo_uid;
-			stx.stx_gid = body->mbo_gid;
-			stx.stx_mode = body->mbo_mode;
-			stx.stx_ino = cl_fid_build_ino(&body->mbo_fid1,
-						       sbi->ll_flags &
-						       LL_SBI_32BIT_API);
-			stx.stx_size = body->mbo_size;
-			stx.stx_blocks = body->mbo_blocks;
-			stx.stx_atime.tv_sec = body->mbo_atime;
-			stx.stx_ctime.tv_sec = body->mbo_ctime;
-			stx.stx_mtime.tv_sec = body->mbo_mtime;
-			stx.stx_rdev_major = MAJOR(body->mbo_rdev);
-			stx.stx_rdev_minor = MINOR(body->mbo_rdev);
-			stx.stx_dev_major = MAJOR(inode->i_sb->s_dev);
-			stx.stx_dev_minor = MINOR(inode->i_sb->s_dev);
-			stx.stx_mask |= STATX_BASIC_STATS;
-
 			/*
 			 * For a striped directory, the size and blocks returned
 			 * from MDT is not correct.
@@ -1876,6 +2205,8 @@ out_rmdir:
 			    ll_i2info(inode)->lli_lsm_md != NULL)
 				valid &= ~(OBD_MD_FLSIZE | OBD_MD_FLBLOCKS);
 
+			ll_mdt_body2statx(inode, body, valid, &stx);
+
 			if (flagsp && copy_to_user(flagsp, &valid,
 						   sizeof(*flagsp)))
 				GOTO(out_req, rc = -EFAULT);
@@ -1884,11 +2215,6 @@ out_rmdir:
 						 sizeof(*fidp)))
 				GOTO(out_req, rc = -EFAULT);
 
-			if (!(valid & OBD_MD_FLSIZE))
-				stx.stx_mask &= ~STATX_SIZE;
-			if (!(valid & OBD_MD_FLBLOCKS))
-				stx.stx_mask &= ~STATX_BLOCKS;
-
 			if (stxp && copy_to_user(stxp, &stx, sizeof(stx)))
 				GOTO(out_req, rc = -EFAULT);
 
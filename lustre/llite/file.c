@@ -2086,6 +2086,55 @@ out_unlock:
 	RETURN(rc);
 }
 
+/**
+ * Check the magic of a layout \a lmm returned by the MDS, and convert it to
+ * host endian before passing it to userspace.
+ *
+ * \retval 0 on success
+ * \retval -EPROTO if \a lmm is not a known layout
+ */
+int ll_lov_ea_to_cpu(struct lov_mds_md *lmm, __u32 mode)
+{
+	if (lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V1) &&
+	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V3) &&
+	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_COMP_V1) &&
+	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_FOREIGN))
+		return -EPROTO;
+
+	/*
+	 * This is coming from the MDS, so is probably in
+	 * little endian.  We convert it to host endian before
+	 * passing it to userspace.
+	 */
+	if ((lmm->lmm_magic & __swab32(LOV_MAGIC_MAGIC)) ==
+	    __swab32(LOV_MAGIC_MAGIC)) {
+		int stripe_count = 0;
+
+		if (lmm->lmm_magic == cpu_to_le32(LOV_MAGIC_V1) ||
+		    lmm->lmm_magic == cpu_to_le32(LOV_MAGIC_V3)) {
+			stripe_count = le16_to_cpu(lmm->lmm_stripe_count);
+			if (le32_to_cpu(lmm->lmm_pattern) &
+			    LOV_PATTERN_F_RELEASED)
+				stripe_count = 0;
+		}
+
+		lustre_swab_lov_user_md((struct lov_user_md *)lmm, 0);
+
+		/* if function called for directory - we should
+		 * avoid swab not existent lsm objects */
+		if (lmm->lmm_magic == LOV_MAGIC_V1 && S_ISREG(mode))
+			lustre_swab_lov_user_md_objects(
+				((struct lov_user_md_v1 *)lmm)->lmm_objects,
+				stripe_count);
+		else if (lmm->lmm_magic == LOV_MAGIC_V3 && S_ISREG(mode))
+			lustre_swab_lov_user_md_objects(
+				((struct lov_user_md_v3 *)lmm)->lmm_objects,
+				stripe_count);
+	}
+
+	return 0;
+}
+
 int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
                              struct lov_mds_md **lmmp, int *lmm_size,
                              struct ptlrpc_request **request)
@@ -2129,43 +2178,7 @@ int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
         lmm = req_capsule_server_sized_get(&req->rq_pill, &RMF_MDT_MD, lmmsize);
         LASSERT(lmm != NULL);
 
-	if (lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V1) &&
-	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_V3) &&
-	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_COMP_V1) &&
-	    lmm->lmm_magic != cpu_to_le32(LOV_MAGIC_FOREIGN))
-		GOTO(out, rc = -EPROTO);
-
-	/*
-	 * This is coming from the MDS, so is probably in
-	 * little endian.  We convert it to host endian before
-	 * passing it to userspace.
-	 */
-	if ((lmm->lmm_magic & __swab32(LOV_MAGIC_MAGIC)) ==
-	    __swab32(LOV_MAGIC_MAGIC)) {
-		int stripe_count = 0;
-
-		if (lmm->lmm_magic == cpu_to_le32(LOV_MAGIC_V1) ||
-		    lmm->lmm_magic == cpu_to_le32(LOV_MAGIC_V3)) {
-			stripe_count = le16_to_cpu(lmm->lmm_stripe_count);
-			if (le32_to_cpu(lmm->lmm_pattern) &
-			    LOV_PATTERN_F_RELEASED)
-				stripe_count = 0;
-		}
-
-		lustre_swab_lov_user_md((struct lov_user_md *)lmm, 0);
-
-		/* if function called for directory - we should
-		 * avoid swab not existent lsm objects */
-		if (lmm->lmm_magic == LOV_MAGIC_V1 && S_ISREG(body->mbo_mode))
-			lustre_swab_lov_user_md_objects(
-				((struct lov_user_md_v1 *)lmm)->lmm_objects,
-				stripe_count);
-		else if (lmm->lmm_magic == LOV_MAGIC_V3 &&
-			 S_ISREG(body->mbo_mode))
-			lustre_swab_lov_user_md_objects(
-				((struct lov_user_md_v3 *)lmm)->lmm_objects,
-				stripe_count);
-	}
+	rc = ll_lov_ea_to_cpu(lmm, body->mbo_mode);
 
 out:
 	*lmmp = lmm;
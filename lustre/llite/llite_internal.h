@@ -229,6 +229,9 @@ struct ll_inode_info {
 			struct mutex		 lli_group_mutex;
 			__u64			 lli_group_users;
 			unsigned long		 lli_group_gid;
+
+			/* read streams shared by all opens of the file */
+			struct ll_ra_streams	*lli_ra_streams;
 		};
 	};
 
@@ -473,6 +476,8 @@ enum ra_stat {
 	RA_STAT_FAILED_REACH_END,
 	RA_STAT_ASYNC,
 	RA_STAT_FAILED_FAST_READ,
+	RA_STAT_STREAM_NEW,
+	RA_STAT_STREAM_RECYCLE,
 	_NR_RA_STAT,
 };
 
@@ -491,6 +496,15 @@ struct ll_ra_info {
 	atomic_t ra_async_inflight;
 	/* Threshold to control when to trigger async readahead */
 	unsigned long ra_async_pages_per_file_threshold;
+	/*
+	 * Max number of read streams tracked per file, 1 means that
+	 * read-ahead state is kept per open file descriptor.
+	 */
+	unsigned int ra_max_streams;
+	/* protect ra_streams_list */
+	spinlock_t ra_streams_lock;
+	/* files with read streams, see ll_ra_streams */
+	struct list_head ra_streams_list;
 };
 
 /* ra_io_arg will be filled in the beginning of ll_readahead with
@@ -791,11 +805,63 @@ struct ll_readahead_state {
 	bool		ras_need_increase_window;
 	/* whether ra miss check should be skipped */
 	bool		ras_no_miss_check;
+	/*
+	 * Upper bound of ras_window_pages given by the bandwidth share of
+	 * this stream among the active streams of the file, 0 if the
+	 * stream is alone and may use ra_max_pages_per_file.
+	 */
+	unsigned long	ras_window_limit;
+	/* stream this state belongs to, NULL for per-fd state */
+	struct ll_ra_stream *ras_stream;
+};
+
+#define LL_RA_STREAMS_DEFAULT	8
+#define LL_RA_STREAMS_MAX	64
+
+/*
+ * A sequential or strided read stream of a file.
+ *
+ * Several threads or processes reading disjoint regions of the same file
+ * (e.g. N-to-1 MPI-IO) each get their own stream, so that the reads of one
+ * do not look like random seeks to the read-ahead state of another.
+ * Streams are matched against each read by ll_ras_get(), and the least
+ * recently used one is recycled when a read matches none of them.
+ */
+struct ll_ra_stream {
+	struct ll_readahead_state lrs_ras;
+	/* start of the last read issued on this stream, and last access,
+	 * 0 if the stream is unused. Both are changed with lrss_lock and
+	 * ras_lock held, and read with either of them */
+	loff_t			lrs_read_start;
+	ktime_t			lrs_last_access;
+	/* start and bytes read of the current bandwidth sampling period */
+	ktime_t			lrs_bw_start;
+	__u64			lrs_bw_bytes;
+	/* moving average of the stream bandwidth, bytes per second */
+	__u64			lrs_bw;
+	/* statistics, see read_ahead_stream_stats */
+	__u64			lrs_bytes;
+	unsigned long		lrs_hits;
+	unsigned long		lrs_misses;
+	unsigned long		lrs_misses_in_window;
+};
+
+/* per inode read streams, allocated on first read */
+struct ll_ra_streams {
+	/* protect stream matching, recycling and the bandwidth fields */
+	spinlock_t		lrss_lock;
+	/* link on ll_ra_info::ra_streams_list */
+	struct list_head	lrss_list;
+	struct lu_fid		lrss_fid;
+	unsigned int		lrss_count;
+	struct ll_ra_stream	lrss_streams[0];
 };
 
 struct ll_readahead_work {
 	/** File to readahead */
 	struct file			*lrw_file;
+	/* read-ahead state of the stream, pinned by lrw_file */
+	struct ll_readahead_state	*lrw_ras;
 	pgoff_t				 lrw_start_idx;
 	pgoff_t				 lrw_end_idx;
 
@@ -807,6 +873,8 @@ extern struct kmem_cache *ll_file_data_slab;
 struct lustre_handle;
 struct ll_file_data {
 	struct ll_readahead_state fd_ras;
+	/* stream of the last read on this file, see ll_ras_get() */
+	struct ll_ra_stream *fd_ra_stream;
 	struct ll_grouplock fd_grouplock;
 	__u64 lfd_pos;
 	__u32 fd_flags;
@@ -981,6 +1049,9 @@ int ll_readpage(struct file *file, struct page *page);
 int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 			   struct cl_page *page, struct file *file);
 void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras);
+void ll_ra_streams_fini(struct inode *inode);
+void ll_ra_streams_seq_show(struct ll_sb_info *sbi, struct seq_file *m);
+void ll_ra_streams_clear(struct ll_sb_info *sbi);
 int vvp_io_write_commit(const struct lu_env *env, struct cl_io *io);
 
 enum lcc_type;
@@ -1039,6 +1110,7 @@ int ll_ioctl_fssetxattr(struct inode *inode, unsigned int cmd,
 int ll_lov_setstripe_ea_info(struct inode *inode, struct dentry *dentry,
 			     __u64 flags, struct lov_user_md *lum,
 			     int lum_size);
+int ll_lov_ea_to_cpu(struct lov_mds_md *lmm, __u32 mode);
 int ll_lov_getstripe_ea_info(struct inode *inode, const char *filename,
                              struct lov_mds_md **lmm, int *lmm_size,
                              struct ptlrpc_request **request);
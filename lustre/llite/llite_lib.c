@@ -131,6 +131,9 @@ static struct ll_sb_info *ll_init_sbi(void)
 	sbi->ll_ra_info.ra_max_read_ahead_whole_pages = -1;
 	sbi->ll_ra_info.ra_async_max_active = ll_get_ra_async_max_active();
 	atomic_set(&sbi->ll_ra_info.ra_async_inflight, 0);
+	sbi->ll_ra_info.ra_max_streams = LL_RA_STREAMS_DEFAULT;
+	spin_lock_init(&sbi->ll_ra_info.ra_streams_lock);
+	INIT_LIST_HEAD(&sbi->ll_ra_info.ra_streams_list);
 
         sbi->ll_flags |= LL_SBI_VERBOSE;
 #ifdef ENABLE_CHECKSUM
@@ -269,7 +272,9 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 				   OBD_CONNECT2_INC_XID |
 				   OBD_CONNECT2_LSOM |
 				   OBD_CONNECT2_ASYNC_DISCARD |
-				   OBD_CONNECT2_PCC;
+				   OBD_CONNECT2_PCC |
+				   OBD_CONNECT2_BATCH_GETATTR |
+				   OBD_CONNECT2_BATCH_BL_AST;
 
 #ifdef HAVE_LRU_RESIZE_SUPPORT
         if (sbi->ll_flags & LL_SBI_LRU_RESIZE)
@@ -477,7 +482,8 @@ static int client_common_fill_super(struct super_block *sb, char *md, char *dt)
 #endif
 
 	data->ocd_connect_flags2 = OBD_CONNECT2_LOCKAHEAD |
-				   OBD_CONNECT2_INC_XID;
+				   OBD_CONNECT2_INC_XID |
+				   OBD_CONNECT2_BATCH_BL_AST;
 
 	if (!OBD_FAIL_CHECK(OBD_FAIL_OSC_CONNECT_GRANT_PARAM))
 		data->ocd_connect_flags |= OBD_CONNECT_GRANT_PARAM;
@@ -1022,6 +1028,7 @@ void ll_lli_init(struct ll_inode_info *lli)
 		mutex_init(&lli->lli_group_mutex);
 		lli->lli_group_users = 0;
 		lli->lli_group_gid = 0;
+		lli->lli_ra_streams = NULL;
 	}
 	mutex_init(&lli->lli_layout_mutex);
 	memset(lli->lli_jobid, 0, sizeof(lli->lli_jobid));
@@ -1604,6 +1611,7 @@ void ll_clear_inode(struct inode *inode)
 		LASSERT(lli->lli_opendir_pid == 0);
 	} else {
 		pcc_inode_free(inode);
+		ll_ra_streams_fini(inode);
 	}
 
 	md_null_inode(sbi->ll_md_exp, ll_inode2fid(inode));
@@ -96,6 +96,7 @@ void llite_tunables_unregister(void)
 static const struct file_operations ll_rw_extents_stats_fops;
 static const struct file_operations ll_rw_extents_stats_pp_fops;
 static const struct file_operations ll_rw_offset_stats_fops;
+static const struct file_operations ll_ra_stream_stats_fops;
 
 /**
  * ll_stats_pid_write() - Determine if stats collection should be enabled
@@ -1130,6 +1131,44 @@ static ssize_t max_read_ahead_async_active_store(struct kobject *kobj,
 }
 LUSTRE_RW_ATTR(max_read_ahead_async_active);
 
+static ssize_t max_read_ahead_streams_show(struct kobject *kobj,
+					   struct attribute *attr, char *buf)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+
+	return snprintf(buf, PAGE_SIZE, "%u\n",
+			sbi->ll_ra_info.ra_max_streams);
+}
+
+static ssize_t max_read_ahead_streams_store(struct kobject *kobj,
+					    struct attribute *attr,
+					    const char *buffer, size_t count)
+{
+	struct ll_sb_info *sbi = container_of(kobj, struct ll_sb_info,
+					      ll_kset.kobj);
+	unsigned int val;
+	int rc;
+
+	rc = kstrtouint(buffer, 10, &val);
+	if (rc)
+		return rc;
+
+	/* 1 keeps a single read-ahead state per open file */
+	if (val < 1 || val > LL_RA_STREAMS_MAX) {
+		CERROR("%s: max_read_ahead_streams=%u must be between 1 and %u\n",
+		       sbi->ll_fsname, val, LL_RA_STREAMS_MAX);
+		return -ERANGE;
+	}
+
+	spin_lock(&sbi->ll_lock);
+	sbi->ll_ra_info.ra_max_streams = val;
+	spin_unlock(&sbi->ll_lock);
+
+	return count;
+}
+LUSTRE_RW_ATTR(max_read_ahead_streams);
+
 static ssize_t read_ahead_async_file_threshold_mb_show(struct kobject *kobj,
 						       struct attribute *attr,
 						       char *buf)
@@ -1504,6 +1543,7 @@ static struct attribute *llite_attrs[] = {
 	&lustre_attr_max_read_ahead_per_file_mb.attr,
 	&lustre_attr_max_read_ahead_whole_mb.attr,
 	&lustre_attr_max_read_ahead_async_active.attr,
+	&lustre_attr_max_read_ahead_streams.attr,
 	&lustre_attr_read_ahead_async_file_threshold_mb.attr,
 	&lustre_attr_stats_track_pid.attr,
 	&lustre_attr_stats_track_ppid.attr,
@@ -1620,6 +1660,8 @@ static const char *ra_stat_string[] = {
 	[RA_STAT_FAILED_REACH_END] = "failed to reach end",
 	[RA_STAT_ASYNC] = "async readahead",
 	[RA_STAT_FAILED_FAST_READ] = "failed to fast read",
+	[RA_STAT_STREAM_NEW] = "stream started",
+	[RA_STAT_STREAM_RECYCLE] = "stream recycled",
 };
 
 int ll_debugfs_register_super(struct super_block *sb, const char *name)
@@ -1658,6 +1700,12 @@ int ll_debugfs_register_super(struct super_block *sb, const char *name)
 	if (rc)
 		CWARN("Error adding the offset_stats file\n");
 
+	rc = ldebugfs_seq_create(sbi->ll_debugfs_entry,
+				 "read_ahead_stream_stats", 0644,
+				 &ll_ra_stream_stats_fops, sbi);
+	if (rc)
+		CWARN("Error adding the read_ahead_stream_stats file\n");
+
 	/* File operations stats */
 	sbi->ll_stats = lprocfs_alloc_stats(LPROC_LL_FILE_OPCODES,
 					    LPROCFS_STATS_FLAG_NONE);
@@ -1916,6 +1964,34 @@ static ssize_t ll_rw_extents_stats_seq_write(struct file *file,
 
 LDEBUGFS_SEQ_FOPS(ll_rw_extents_stats);
 
+static int ll_ra_stream_stats_seq_show(struct seq_file *seq, void *v)
+{
+	struct ll_sb_info *sbi = seq->private;
+	struct timespec64 now;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(seq, "snapshot_time: %llu.%09lu\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+	ll_ra_streams_seq_show(sbi, seq);
+
+	return 0;
+}
+
+/* writing anything clears the per-stream counters */
+static ssize_t ll_ra_stream_stats_seq_write(struct file *file,
+					    const char __user *buf,
+					    size_t len, loff_t *off)
+{
+	struct seq_file *seq = file->private_data;
+	struct ll_sb_info *sbi = seq->private;
+
+	ll_ra_streams_clear(sbi);
+
+	return len;
+}
+
+LDEBUGFS_SEQ_FOPS(ll_ra_stream_stats);
+
 void ll_rw_stats_tally(struct ll_sb_info *sbi, pid_t pid,
                        struct ll_file_data *file, loff_t pos,
                        size_t count, int rw)
@@ -533,7 +533,7 @@ static void ll_readahead_handle_work(struct work_struct *wq)
 	work = container_of(wq, struct ll_readahead_work,
 			    lrw_readahead_work);
 	fd = work->lrw_file->private_data;
-	ras = &fd->fd_ras;
+	ras = work->lrw_ras;
 	file = work->lrw_file;
 	inode = file_inode(file);
 	sbi = ll_i2sbi(inode);
@@ -802,6 +802,19 @@ void ll_readahead_init(struct inode *inode, struct ll_readahead_state *ras)
 	ras_reset(ras, 0);
 	ras->ras_last_read_end_bytes = 0;
 	ras->ras_requests = 0;
+	ras->ras_window_limit = 0;
+	ras->ras_stream = NULL;
+}
+
+/* Upper bound of the read-ahead window of \a ras */
+static unsigned long ras_window_max(struct ll_readahead_state *ras,
+				    struct ll_ra_info *ra)
+{
+	if (ras->ras_window_limit != 0 &&
+	    ras->ras_window_limit < ra->ra_max_pages_per_file)
+		return ras->ras_window_limit;
+
+	return ra->ra_max_pages_per_file;
 }
 
 /*
@@ -910,7 +923,7 @@ static void ras_stride_increase_window(struct ll_readahead_state *ras,
 
 out:
 	if (stride_page_count(ras, window_bytes) <=
-	    ra->ra_max_pages_per_file || ras->ras_window_pages == 0)
+	    ras_window_max(ras, ra) || ras->ras_window_pages == 0)
 		ras->ras_window_pages = (window_bytes >> PAGE_SHIFT);
 
 	LASSERT(ras->ras_window_pages > 0);
@@ -933,7 +946,7 @@ static void ras_increase_window(struct inode *inode,
 		pgoff_t window_pages;
 
 		window_pages = min(ras->ras_window_pages + ras->ras_rpc_pages,
-				   ra->ra_max_pages_per_file);
+				   ras_window_max(ras, ra));
 		if (window_pages < ras->ras_rpc_pages)
 			ras->ras_window_pages = window_pages;
 		else
@@ -1008,10 +1021,403 @@ static void ras_detect_read_pattern(struct ll_readahead_state *ras,
 	ras->ras_last_read_end_bytes = pos + count - 1;
 }
 
+/* a stream not accessed for this long does not compete for read-ahead */
+#define LL_RA_STREAM_IDLE_NS	(2 * NSEC_PER_SEC)
+/* minimum period over which the bandwidth of a stream is sampled */
+#define LL_RA_STREAM_BW_NS	(100 * NSEC_PER_MSEC)
+
+static inline bool ras_stream_used(struct ll_ra_stream *lrs)
+{
+	return ktime_to_ns(lrs->lrs_last_access) != 0;
+}
+
+static inline bool ras_stream_active(struct ll_ra_stream *lrs, ktime_t now)
+{
+	return ras_stream_used(lrs) &&
+	       ktime_to_ns(ktime_sub(now, lrs->lrs_last_access)) <
+	       LL_RA_STREAM_IDLE_NS;
+}
+
+static struct ll_ra_streams *ll_ra_streams_get(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_ra_info *ra = &ll_i2sbi(inode)->ll_ra_info;
+	struct ll_ra_streams *lrss;
+	unsigned int count = ra->ra_max_streams;
+	int i;
+
+	if (count <= 1)
+		return NULL;
+
+	lrss = lli->lli_ra_streams;
+	if (lrss != NULL)
+		return lrss;
+
+	OBD_ALLOC_LARGE(lrss,
+			offsetof(struct ll_ra_streams, lrss_streams[count]));
+	if (lrss == NULL)
+		return NULL;
+
+	spin_lock_init(&lrss->lrss_lock);
+	INIT_LIST_HEAD(&lrss->lrss_list);
+	lrss->lrss_fid = *ll_inode2fid(inode);
+	lrss->lrss_count = count;
+	for (i = 0; i < count; i++) {
+		struct ll_ra_stream *lrs = &lrss->lrss_streams[i];
+
+		ll_readahead_init(inode, &lrs->lrs_ras);
+		lrs->lrs_ras.ras_stream = lrs;
+	}
+
+	spin_lock(&ra->ra_streams_lock);
+	if (lli->lli_ra_streams == NULL) {
+		lli->lli_ra_streams = lrss;
+		list_add_tail(&lrss->lrss_list, &ra->ra_streams_list);
+		lrss = NULL;
+	}
+	spin_unlock(&ra->ra_streams_lock);
+
+	/* lost the race with another reader */
+	if (lrss != NULL)
+		OBD_FREE_LARGE(lrss, offsetof(struct ll_ra_streams,
+					      lrss_streams[lrss->lrss_count]));
+
+	return lli->lli_ra_streams;
+}
+
+void ll_ra_streams_fini(struct inode *inode)
+{
+	struct ll_inode_info *lli = ll_i2info(inode);
+	struct ll_ra_info *ra = &ll_i2sbi(inode)->ll_ra_info;
+	struct ll_ra_streams *lrss = lli->lli_ra_streams;
+
+	if (lrss == NULL)
+		return;
+
+	spin_lock(&ra->ra_streams_lock);
+	list_del(&lrss->lrss_list);
+	lli->lli_ra_streams = NULL;
+	spin_unlock(&ra->ra_streams_lock);
+
+	OBD_FREE_LARGE(lrss, offsetof(struct ll_ra_streams,
+				      lrss_streams[lrss->lrss_count]));
+}
+
+/*
+ * How well a read of \a count bytes at \a pos fits stream \a lrs:
+ * 3 - it is part of the read currently issued on the stream,
+ * 2 - it continues the stream sequentially or at the detected stride,
+ * 1 - it is inside the read-ahead window of the stream,
+ * 0 - it is unrelated to the stream.
+ *
+ * Called with ras_lock of the stream held.
+ */
+static int ras_stream_match(struct ll_ra_stream *lrs, loff_t pos, size_t count)
+{
+	struct ll_readahead_state *ras = &lrs->lrs_ras;
+
+	assert_spin_locked(&ras->ras_lock);
+	if (!ras_stream_used(lrs))
+		return 0;
+
+	if (pos >= lrs->lrs_read_start && pos <= ras->ras_last_read_end_bytes)
+		return 3;
+
+	if (is_loose_seq_read(ras, pos) ||
+	    read_in_stride_window(ras, pos, count))
+		return 2;
+
+	if (ras->ras_window_pages != 0 &&
+	    pos_in_window(pos >> PAGE_SHIFT, ras->ras_window_start_idx, 0,
+			  ras->ras_window_pages))
+		return 1;
+
+	return 0;
+}
+
+static int ras_stream_match_lock(struct ll_ra_stream *lrs, loff_t pos,
+				 size_t count)
+{
+	int score;
+
+	spin_lock(&lrs->lrs_ras.ras_lock);
+	score = ras_stream_match(lrs, pos, count);
+	spin_unlock(&lrs->lrs_ras.ras_lock);
+
+	return score;
+}
+
+/*
+ * Start a new stream in \a lrs for a read at \a pos matching none of the
+ * existing streams. The pattern detection state is inherited from the most
+ * recently used stream \a mru, so that the first jump of a strided reader
+ * still initializes the stride detector as it did with a single stream.
+ */
+static void ras_stream_start(struct ll_ra_stream *lrs, struct ll_ra_stream *mru,
+			     loff_t pos, ktime_t now)
+{
+	struct ll_readahead_state *ras = &lrs->lrs_ras;
+	unsigned long rpc_pages = PTLRPC_MAX_BRW_PAGES;
+	loff_t last_read_end = 0;
+	loff_t consecutive_bytes = 0;
+	unsigned long requests = 0;
+
+	if (mru != NULL) {
+		rpc_pages = mru->lrs_ras.ras_rpc_pages;
+		last_read_end = mru->lrs_ras.ras_last_read_end_bytes;
+		consecutive_bytes = mru->lrs_ras.ras_consecutive_bytes;
+		requests = mru->lrs_ras.ras_requests;
+	}
+
+	spin_lock(&ras->ras_lock);
+	ras->ras_rpc_pages = rpc_pages;
+	ras_reset(ras, pos >> PAGE_SHIFT);
+	ras_stride_reset(ras);
+	ras->ras_last_read_end_bytes = last_read_end;
+	ras->ras_consecutive_bytes = consecutive_bytes;
+	ras->ras_requests = requests;
+	ras->ras_async_last_readpage_idx = 0;
+	ras->ras_window_limit = 0;
+	lrs->lrs_read_start = pos;
+	lrs->lrs_last_access = now;
+	spin_unlock(&ras->ras_lock);
+
+	lrs->lrs_bw_start = now;
+	lrs->lrs_bw_bytes = 0;
+	lrs->lrs_bw = 0;
+	lrs->lrs_bytes = 0;
+	lrs->lrs_hits = 0;
+	lrs->lrs_misses = 0;
+	lrs->lrs_misses_in_window = 0;
+}
+
+/* Account \a count bytes read on \a lrs, called with lrss_lock held */
+static void ras_stream_account(struct ll_ra_stream *lrs, size_t count,
+			       ktime_t now)
+{
+	s64 elapsed = ktime_to_ns(ktime_sub(now, lrs->lrs_bw_start));
+	__u64 sample;
+
+	lrs->lrs_bytes += count;
+	lrs->lrs_bw_bytes += count;
+	if (elapsed < LL_RA_STREAM_BW_NS)
+		return;
+
+	sample = div64_u64((lrs->lrs_bw_bytes >> 10) * NSEC_PER_SEC, elapsed);
+	if (lrs->lrs_bw == 0)
+		lrs->lrs_bw = sample;
+	else
+		lrs->lrs_bw = (lrs->lrs_bw * 7 + sample) >> 3;
+	lrs->lrs_bw_start = now;
+	lrs->lrs_bw_bytes = 0;
+}
+
+/*
+ * Share ra_max_pages_per_file among the active streams of a file in
+ * proportion to their bandwidth, so that a fast stream is not starved by
+ * many slow ones and the file as a whole stays within its budget.
+ * Streams whose bandwidth is not known yet get an equal share.
+ */
+static unsigned long ras_stream_limit(struct ll_ra_streams *lrss,
+				      struct ll_ra_stream *lrs,
+				      struct ll_ra_info *ra, ktime_t now)
+{
+	unsigned int active = 0;
+	unsigned long limit;
+	__u64 total = 0;
+	int i;
+
+	for (i = 0; i < lrss->lrss_count; i++) {
+		struct ll_ra_stream *cur = &lrss->lrss_streams[i];
+
+		if (!ras_stream_active(cur, now))
+			continue;
+		active++;
+		total += cur->lrs_bw;
+	}
+
+	if (active <= 1)
+		return 0;
+
+	if (lrs->lrs_bw == 0 || total == 0)
+		limit = ra->ra_max_pages_per_file / active;
+	else
+		limit = div64_u64((__u64)ra->ra_max_pages_per_file *
+				  lrs->lrs_bw, total);
+
+	return max(limit, lrs->lrs_ras.ras_rpc_pages);
+}
+
+/*
+ * Find the stream whose current read covers \a pos without lrss_lock, for
+ * the pages of a read looked up again from ->readpage(). The stream of the
+ * last read on the file is tried first, it is nearly always the one.
+ */
+static struct ll_ra_stream *ras_stream_find_issued(struct ll_ra_streams *lrss,
+						   struct ll_file_data *fd,
+						   loff_t pos, size_t count)
+{
+	struct ll_ra_stream *hint = READ_ONCE(fd->fd_ra_stream);
+	int i;
+
+	if (hint != NULL && ras_stream_match_lock(hint, pos, count) == 3)
+		return hint;
+
+	for (i = 0; i < lrss->lrss_count; i++) {
+		struct ll_ra_stream *cur = &lrss->lrss_streams[i];
+
+		if (cur != hint && ras_stream_match_lock(cur, pos, count) == 3)
+			return cur;
+	}
+
+	return NULL;
+}
+
+/*
+ * Find the read-ahead state for a read of \a count bytes at \a pos on
+ * \a file. Unless per-file streams are disabled, this is the stream of the
+ * inode the read belongs to, and a new stream is started if it matches
+ * none. \a account is set for reads issued by the application, so that
+ * they are accounted in the stream bandwidth, and unset when the pages of
+ * such a read are looked up again from ->readpage(). Only the former take
+ * lrss_lock, the pages of a read normally find their stream without it.
+ */
+static struct ll_readahead_state *
+ll_ras_get(struct file *file, loff_t pos, size_t count, bool account)
+{
+	struct ll_file_data *fd = file->private_data;
+	struct inode *inode = file_inode(file);
+	struct ll_sb_info *sbi = ll_i2sbi(inode);
+	struct ll_ra_streams *lrss;
+	struct ll_ra_stream *lrs = NULL;
+	struct ll_ra_stream *mru = NULL;
+	struct ll_ra_stream *lru = NULL;
+	unsigned long limit;
+	int best = 0;
+	ktime_t now;
+	int i;
+
+	lrss = ll_ra_streams_get(inode);
+	if (lrss == NULL)
+		return &fd->fd_ras;
+
+	if (!account) {
+		lrs = ras_stream_find_issued(lrss, fd, pos, count);
+		if (lrs != NULL)
+			return &lrs->lrs_ras;
+	}
+
+	now = ktime_get();
+	spin_lock(&lrss->lrss_lock);
+	for (i = 0; i < lrss->lrss_count; i++) {
+		struct ll_ra_stream *cur = &lrss->lrss_streams[i];
+		int score = ras_stream_match_lock(cur, pos, count);
+
+		if (score > best ||
+		    (score == best && score > 0 &&
+		     ktime_after(cur->lrs_last_access, lrs->lrs_last_access))) {
+			best = score;
+			lrs = cur;
+		}
+		if (ras_stream_used(cur) &&
+		    (mru == NULL ||
+		     ktime_after(cur->lrs_last_access, mru->lrs_last_access)))
+			mru = cur;
+		if (lru == NULL ||
+		    ktime_before(cur->lrs_last_access, lru->lrs_last_access))
+			lru = cur;
+	}
+
+	if (lrs == NULL) {
+		lrs = lru;
+		ll_ra_stats_inc_sbi(sbi, ras_stream_used(lrs) ?
+					 RA_STAT_STREAM_RECYCLE :
+					 RA_STAT_STREAM_NEW);
+		ras_stream_start(lrs, mru, pos, now);
+	}
+
+	if (account)
+		ras_stream_account(lrs, count, now);
+	limit = ras_stream_limit(lrss, lrs, &sbi->ll_ra_info, now);
+
+	spin_lock(&lrs->lrs_ras.ras_lock);
+	if (account)
+		lrs->lrs_read_start = pos;
+	lrs->lrs_last_access = now;
+	lrs->lrs_ras.ras_window_limit = limit;
+	spin_unlock(&lrs->lrs_ras.ras_lock);
+	spin_unlock(&lrss->lrss_lock);
+
+	WRITE_ONCE(fd->fd_ra_stream, lrs);
+
+	return &lrs->lrs_ras;
+}
+
+void ll_ra_streams_seq_show(struct ll_sb_info *sbi, struct seq_file *m)
+{
+	struct ll_ra_info *ra = &sbi->ll_ra_info;
+	struct ll_ra_streams *lrss;
+	ktime_t now = ktime_get();
+	int i;
+
+	seq_puts(m, "files:\n");
+	spin_lock(&ra->ra_streams_lock);
+	list_for_each_entry(lrss, &ra->ra_streams_list, lrss_list) {
+		bool header = false;
+
+		spin_lock(&lrss->lrss_lock);
+		for (i = 0; i < lrss->lrss_count; i++) {
+			struct ll_ra_stream *lrs = &lrss->lrss_streams[i];
+			struct ll_readahead_state *ras = &lrs->lrs_ras;
+
+			if (!ras_stream_used(lrs))
+				continue;
+
+			if (!header) {
+				seq_printf(m, "- fid: "DFID"\n  streams:\n",
+					   PFID(&lrss->lrss_fid));
+				header = true;
+			}
+			seq_printf(m, "  - { stream: %d, mode: %s, active: %s, last_read_end: %lld, window_start: %lu, window_pages: %lu, window_limit: %lu, bandwidth_kbps: %llu, read_bytes: %llu, hits: %lu, misses: %lu, misses_in_window: %lu }\n",
+				   i, stride_io_mode(ras) ? "stride" : "sequential",
+				   ras_stream_active(lrs, now) ? "yes" : "no",
+				   ras->ras_last_read_end_bytes,
+				   ras->ras_window_start_idx,
+				   ras->ras_window_pages,
+				   ras->ras_window_limit, lrs->lrs_bw,
+				   lrs->lrs_bytes, lrs->lrs_hits,
+				   lrs->lrs_misses, lrs->lrs_misses_in_window);
+		}
+		spin_unlock(&lrss->lrss_lock);
+	}
+	spin_unlock(&ra->ra_streams_lock);
+}
+
+void ll_ra_streams_clear(struct ll_sb_info *sbi)
+{
+	struct ll_ra_info *ra = &sbi->ll_ra_info;
+	struct ll_ra_streams *lrss;
+	int i;
+
+	spin_lock(&ra->ra_streams_lock);
+	list_for_each_entry(lrss, &ra->ra_streams_list, lrss_list) {
+		spin_lock(&lrss->lrss_lock);
+		for (i = 0; i < lrss->lrss_count; i++) {
+			struct ll_ra_stream *lrs = &lrss->lrss_streams[i];
+
+			lrs->lrs_bytes = 0;
+			lrs->lrs_hits = 0;
+			lrs->lrs_misses = 0;
+			lrs->lrs_misses_in_window = 0;
+		}
+		spin_unlock(&lrss->lrss_lock);
+	}
+	spin_unlock(&ra->ra_streams_lock);
+}
+
 void ll_ras_enter(struct file *f, loff_t pos, size_t count)
 {
-	struct ll_file_data *fd = f->private_data;
-	struct ll_readahead_state *ras = &fd->fd_ras;
+	struct ll_readahead_state *ras = ll_ras_get(f, pos, count, true);
 	struct inode *inode = file_inode(f);
 	unsigned long index = pos >> PAGE_SHIFT;
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
@@ -1098,6 +1504,12 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 		CDEBUG(D_READA, DFID " pages at %lu miss.\n",
 		       PFID(ll_inode2fid(inode)), index);
 	ll_ra_stats_inc_sbi(sbi, hit ? RA_STAT_HIT : RA_STAT_MISS);
+	if (ras->ras_stream != NULL) {
+		if (hit)
+			ras->ras_stream->lrs_hits++;
+		else
+			ras->ras_stream->lrs_misses++;
+	}
 
 	/*
 	 * The readahead window has been expanded to cover whole
@@ -1117,6 +1529,8 @@ static void ras_update(struct ll_sb_info *sbi, struct inode *inode,
 	    pos_in_window(index, ras->ras_window_start_idx, 0,
 			  ras->ras_window_pages)) {
 		ll_ra_stats_inc_sbi(sbi, RA_STAT_MISS_IN_WINDOW);
+		if (ras->ras_stream != NULL)
+			ras->ras_stream->lrs_misses_in_window++;
 		ras->ras_need_increase_window = false;
 
 		if (index_in_stride_window(ras, index) &&
@@ -1371,8 +1785,7 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 {
 	struct inode              *inode  = vvp_object_inode(page->cp_obj);
 	struct ll_sb_info         *sbi    = ll_i2sbi(inode);
-	struct ll_file_data       *fd     = file->private_data;
-	struct ll_readahead_state *ras    = &fd->fd_ras;
+	struct ll_readahead_state *ras    = NULL;
 	struct cl_2queue          *queue  = &io->ci_queue;
 	struct cl_sync_io	  *anchor = NULL;
 	struct vvp_page           *vpg;
@@ -1384,16 +1797,21 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 	uptodate = vpg->vpg_defer_uptodate;
 
 	if (sbi->ll_ra_info.ra_max_pages_per_file > 0 &&
-	    sbi->ll_ra_info.ra_max_pages > 0 &&
-	    !vpg->vpg_ra_updated) {
+	    sbi->ll_ra_info.ra_max_pages > 0) {
 		struct vvp_io *vio = vvp_env_io(env);
-		enum ras_update_flags flags = 0;
 
-		if (uptodate)
-			flags |= LL_RAS_HIT;
-		if (!vio->vui_ra_valid)
-			flags |= LL_RAS_MMAP;
-		ras_update(sbi, inode, ras, vvp_index(vpg), flags);
+		ras = ll_ras_get(file, (loff_t)vvp_index(vpg) << PAGE_SHIFT,
+				 PAGE_SIZE,
+				 !vio->vui_ra_valid && !vpg->vpg_ra_updated);
+		if (!vpg->vpg_ra_updated) {
+			enum ras_update_flags flags = 0;
+
+			if (uptodate)
+				flags |= LL_RAS_HIT;
+			if (!vio->vui_ra_valid)
+				flags |= LL_RAS_MMAP;
+			ras_update(sbi, inode, ras, vvp_index(vpg), flags);
+		}
 	}
 
 	cl_2queue_init(queue);
@@ -1409,8 +1827,7 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
 		cl_2queue_add(queue, page);
 	}
 
-	if (sbi->ll_ra_info.ra_max_pages_per_file > 0 &&
-	    sbi->ll_ra_info.ra_max_pages > 0) {
+	if (ras != NULL) {
 		int rc2;
 
 		rc2 = ll_readahead(env, io, &queue->c2_qin, ras,
@@ -1462,13 +1879,13 @@ int ll_io_read_page(const struct lu_env *env, struct cl_io *io,
  * 2 async readahead triggered and fast read could be used too.
  * < 0 on error.
  */
-static int kickoff_async_readahead(struct file *file, unsigned long pages)
+static int kickoff_async_readahead(struct file *file,
+				   struct ll_readahead_state *ras,
+				   unsigned long pages)
 {
 	struct ll_readahead_work *lrw;
 	struct inode *inode = file_inode(file);
 	struct ll_sb_info *sbi = ll_i2sbi(inode);
-	struct ll_file_data *fd = file->private_data;
-	struct ll_readahead_state *ras = &fd->fd_ras;
 	struct ll_ra_info *ra = &sbi->ll_ra_info;
 	unsigned long throttle;
 	pgoff_t start_idx = ras_align(ras, ras->ras_next_readahead_idx);
@@ -1497,6 +1914,7 @@ static int kickoff_async_readahead(struct file *file, unsigned long pages)
 	if (lrw) {
 		atomic_inc(&sbi->ll_ra_info.ra_async_inflight);
 		lrw->lrw_file = get_file(file);
+		lrw->lrw_ras = ras;
 		lrw->lrw_start_idx = start_idx;
 		lrw->lrw_end_idx = end_idx;
 		spin_lock(&ras->ras_lock);
@@ -1533,7 +1951,7 @@ static bool ll_use_fast_io(struct file *file,
 
 	if (ras->ras_window_start_idx + ras->ras_window_pages <
 	    ras->ras_next_readahead_idx + skip_pages ||
-	    kickoff_async_readahead(file, fast_read_pages) > 0)
+	    kickoff_async_readahead(file, ras, fast_read_pages) > 0)
 		return true;
 
 	return false;
@@ -1559,8 +1977,7 @@ int ll_readpage(struct file *file, struct page *vmpage)
 
 	if (io == NULL) { /* fast read */
 		struct inode *inode = file_inode(file);
-		struct ll_file_data *fd = file->private_data;
-		struct ll_readahead_state *ras = &fd->fd_ras;
+		struct ll_readahead_state *ras;
 		struct lu_env  *local_env = NULL;
 		struct vvp_page *vpg;
 
@@ -1582,6 +1999,9 @@ int ll_readpage(struct file *file, struct page *vmpage)
 			if (lcc && lcc->lcc_type == LCC_MMAP)
 				flags |= LL_RAS_MMAP;
 
+			ras = ll_ras_get(file,
+					 (loff_t)vvp_index(vpg) << PAGE_SHIFT,
+					 PAGE_SIZE, flags & LL_RAS_MMAP);
 			/* For fast read, it updates read ahead state only
 			 * if the page is hit in cache because non cache page
 			 * case will be handled by slow read later. */
@@ -3027,6 +3027,101 @@ out_fas:
 	RETURN(rc);
 }
 
+struct lmv_batch_getattr_args {
+	struct md_getattr_batch	*lbga_mgb;	/* batch of the caller */
+	int			*lbga_idx;	/* index in the caller batch */
+};
+
+static void lmv_batch_getattr_cb(struct md_getattr_batch *sub, int idx,
+				 int rc, struct mdt_body *body, void *ea,
+				 int easize)
+{
+	struct lmv_batch_getattr_args *args = sub->mgb_cbdata;
+	struct md_getattr_batch *mgb = args->lbga_mgb;
+
+	mgb->mgb_cb(mgb, args->lbga_idx[idx], rc, body, ea, easize);
+}
+
+/*
+ * Split the batch by the MDT owning each FID, and send one sub-batch to each
+ * MDT. A sub-batch failing as a whole is reported to the caller as the error
+ * of every FID in it, so that the caller can fall back to per-file getattr
+ * for those only.
+ */
+static int lmv_batch_getattr(struct obd_export *exp,
+			     struct md_getattr_batch *mgb)
+{
+	struct obd_device *obd = class_exp2obd(exp);
+	struct lmv_obd *lmv = &obd->u.lmv;
+	struct lmv_batch_getattr_args args = { .lbga_mgb = mgb };
+	struct md_getattr_batch sub = {
+		.mgb_valid = mgb->mgb_valid,
+		.mgb_cb = lmv_batch_getattr_cb,
+		.mgb_cbdata = &args,
+	};
+	struct lu_tgt_desc *tgt;
+	int nr = mgb->mgb_nr;
+	u32 *mdts = NULL;
+	int i, rc = 0, rc2;
+	ENTRY;
+
+	if (nr <= 0 || nr > MD_BATCH_GETATTR_MAX)
+		RETURN(-EINVAL);
+
+	OBD_ALLOC(mdts, nr * sizeof(*mdts));
+	OBD_ALLOC(sub.mgb_fids, nr * sizeof(*sub.mgb_fids));
+	OBD_ALLOC(args.lbga_idx, nr * sizeof(*args.lbga_idx));
+	if (mdts == NULL || sub.mgb_fids == NULL || args.lbga_idx == NULL)
+		GOTO(out, rc = -ENOMEM);
+
+	for (i = 0; i < nr; i++) {
+		rc2 = lmv_fld_lookup(lmv, &mgb->mgb_fids[i], &mdts[i]);
+		if (rc2) {
+			CDEBUG(D_OTHER, "can't lookup "DFID": rc = %d\n",
+			       PFID(&mgb->mgb_fids[i]), rc2);
+			mdts[i] = LMV_OFFSET_DEFAULT;
+			mgb->mgb_cb(mgb, i, rc2, NULL, NULL, 0);
+		}
+	}
+
+	lmv_foreach_connected_tgt(lmv, tgt) {
+		sub.mgb_nr = 0;
+		for (i = 0; i < nr; i++) {
+			if (mdts[i] != tgt->ltd_index)
+				continue;
+			sub.mgb_fids[sub.mgb_nr] = mgb->mgb_fids[i];
+			args.lbga_idx[sub.mgb_nr++] = i;
+			mdts[i] = LMV_OFFSET_DEFAULT;
+		}
+		if (sub.mgb_nr == 0)
+			continue;
+
+		/* share the layout budget in proportion to the FIDs sent */
+		sub.mgb_easize = mgb->mgb_easize / nr * sub.mgb_nr;
+		rc2 = md_batch_getattr(tgt->ltd_exp, &sub);
+		if (rc2 == 0)
+			continue;
+
+		for (i = 0; i < sub.mgb_nr; i++)
+			mgb->mgb_cb(mgb, args.lbga_idx[i], rc2, NULL, NULL, 0);
+	}
+
+	/* FIDs on MDTs that are not connected */
+	for (i = 0; i < nr; i++)
+		if (mdts[i] != LMV_OFFSET_DEFAULT)
+			mgb->mgb_cb(mgb, i, -ENODEV, NULL, NULL, 0);
+	EXIT;
+out:
+	if (args.lbga_idx)
+		OBD_FREE(args.lbga_idx, nr * sizeof(*args.lbga_idx));
+	if (sub.mgb_fids)
+		OBD_FREE(sub.mgb_fids, nr * sizeof(*sub.mgb_fids));
+	if (mdts)
+		OBD_FREE(mdts, nr * sizeof(*mdts));
+
+	return rc;
+}
+
 /**
  * Asynchronously set by key a value associated with a LMV device.
  *
@@ -3637,6 +3732,7 @@ static const struct md_ops lmv_md_ops = {
 	.m_get_fid_from_lsm	= lmv_get_fid_from_lsm,
 	.m_unpackmd		= lmv_unpackmd,
 	.m_rmfid		= lmv_rmfid,
+	.m_batch_getattr	= lmv_batch_getattr,
 };
 
 static int __init lmv_init(void)
@@ -2647,6 +2647,107 @@ static int mdc_rmfid(struct obd_export *exp, struct fid_array *fa,
 	RETURN(rc);
 }
 
+/**
+ * Fetch attributes and layouts of up to MD_BATCH_GETATTR_MAX files with
+ * a single MDS_BATCH_GETATTR RPC.
+ *
+ * The layouts of all files are packed back to back in RMF_MDT_MD, each
+ * one 8-byte aligned and sized by mbo_eadatasize of its body.  A file
+ * whose layout did not fit into \a mgb->mgb_easize is reported with
+ * -EOVERFLOW, but its attributes are still valid.
+ *
+ * \retval 0 if \a mgb->mgb_cb was called for every FID
+ * \retval negative errno if the whole batch failed, no callback was called
+ */
+static int mdc_batch_getattr(struct obd_export *exp,
+			     struct md_getattr_batch *mgb)
+{
+	struct ptlrpc_request *req;
+	struct req_capsule *pill;
+	struct mdt_body *bodies;
+	struct lu_fid *fids;
+	char *eadata = NULL;
+	int ealen, eaoff = 0;
+	int flen, nr, i, rc;
+	__u32 *rcs;
+	ENTRY;
+
+	if (!exp_connect_batch_getattr(exp))
+		RETURN(-EOPNOTSUPP);
+
+	nr = mgb->mgb_nr;
+	if (nr <= 0 || nr > MD_BATCH_GETATTR_MAX)
+		RETURN(-EINVAL);
+
+	req = ptlrpc_request_alloc(class_exp2cliimp(exp),
+				   &RQF_MDS_BATCH_GETATTR);
+	if (req == NULL)
+		RETURN(-ENOMEM);
+
+	pill = &req->rq_pill;
+	flen = nr * sizeof(struct lu_fid);
+	req_capsule_set_size(pill, &RMF_FID_ARRAY, RCL_CLIENT, flen);
+	req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER, nr * sizeof(__u32));
+	req_capsule_set_size(pill, &RMF_MDT_BODY_ARRAY, RCL_SERVER,
+			     nr * sizeof(struct mdt_body));
+	req_capsule_set_size(pill, &RMF_MDT_MD, RCL_SERVER, mgb->mgb_easize);
+	rc = ptlrpc_request_pack(req, LUSTRE_MDS_VERSION, MDS_BATCH_GETATTR);
+	if (rc) {
+		ptlrpc_request_free(req);
+		RETURN(rc);
+	}
+
+	fids = req_capsule_client_get(pill, &RMF_FID_ARRAY);
+	memcpy(fids, mgb->mgb_fids, flen);
+	mdc_pack_body(req, NULL, mgb->mgb_valid, mgb->mgb_easize, -1, 0);
+	ptlrpc_request_set_replen(req);
+
+	rc = ptlrpc_queue_wait(req);
+	if (rc)
+		GOTO(out, rc);
+
+	rcs = req_capsule_server_sized_get(pill, &RMF_RCS, nr * sizeof(__u32));
+	bodies = req_capsule_server_sized_get(pill, &RMF_MDT_BODY_ARRAY,
+					      nr * sizeof(struct mdt_body));
+	if (rcs == NULL || bodies == NULL)
+		GOTO(out, rc = -EPROTO);
+
+	ealen = req_capsule_get_size(pill, &RMF_MDT_MD, RCL_SERVER);
+	if (ealen > 0)
+		eadata = req_capsule_server_get(pill, &RMF_MDT_MD);
+
+	for (i = 0; i < nr; i++) {
+		struct mdt_body *body = NULL;
+		void *ea = NULL;
+		int easize = 0;
+		int rc2 = (int)rcs[i];
+
+		if (rc2 == 0 || rc2 == -EOVERFLOW)
+			body = &bodies[i];
+
+		if (body != NULL && body->mbo_eadatasize > 0 &&
+		    body->mbo_valid & (OBD_MD_FLEASIZE | OBD_MD_FLDIREA)) {
+			easize = body->mbo_eadatasize;
+			if (eadata != NULL && eaoff + easize <= ealen) {
+				ea = eadata + eaoff;
+				eaoff += round_up(easize, 8);
+			} else {
+				/* only this file is lost, keep the batch */
+				body = NULL;
+				easize = 0;
+				rc2 = -EPROTO;
+			}
+		}
+
+		mgb->mgb_cb(mgb, i, rc2, body, ea, easize);
+	}
+	EXIT;
+out:
+	ptlrpc_req_finished(req);
+
+	return rc;
+}
+
 static int mdc_import_event(struct obd_device *obd, struct obd_import *imp,
 			    enum obd_import_event event)
 {
@@ -2956,6 +3057,7 @@ static const struct md_ops mdc_md_ops = {
 	.m_intent_getattr_async = mdc_intent_getattr_async,
 	.m_revalidate_lock      = mdc_revalidate_lock,
 	.m_rmfid		= mdc_rmfid,
+	.m_batch_getattr	= mdc_batch_getattr,
 };
 
 dev_t mdc_changelog_dev;
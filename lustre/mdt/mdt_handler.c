@@ -2215,6 +2215,159 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Fetch attributes and, for regular files, the layout of one FID of a
+ * MDS_BATCH_GETATTR request into \a body and \a eabuf.
+ *
+ * \retval 0 on success
+ * \retval -EOVERFLOW if the layout did not fit into \a eabuf, the
+ *	   attributes in \a body are still valid
+ * \retval negative errno on other failures
+ */
+static int mdt_batch_getattr_one(struct mdt_thread_info *info,
+				 const struct lu_fid *fid, __u64 valid,
+				 struct mdt_body *body, struct lu_buf *eabuf)
+{
+	struct md_attr *ma = &info->mti_attr;
+	struct mdt_object *obj;
+	bool need_lov;
+	int rc = 0;
+	ENTRY;
+
+	if (!fid_is_sane(fid))
+		RETURN(-EINVAL);
+
+	obj = mdt_object_find(info->mti_env, info->mti_mdt, fid);
+	if (IS_ERR(obj))
+		RETURN(PTR_ERR(obj));
+
+	if (mdt_object_remote(obj))
+		GOTO(out, rc = -EREMOTE);
+	if (!mdt_object_exists(obj) || lu_object_is_dying(&obj->mot_header))
+		GOTO(out, rc = -ENOENT);
+
+	need_lov = (valid & OBD_MD_FLEASIZE) &&
+		   S_ISREG(lu_object_attr(&obj->mot_obj));
+
+	ma->ma_need = MA_INODE;
+	ma->ma_lmm = NULL;
+	ma->ma_lmm_size = 0;
+	if (need_lov && eabuf->lb_len > 0) {
+		ma->ma_lmm = eabuf->lb_buf;
+		ma->ma_lmm_size = eabuf->lb_len;
+		ma->ma_need |= MA_LOV;
+	}
+	info->mti_som_valid = 0;
+
+	rc = mdt_attr_get_complex(info, obj, ma);
+	if (rc)
+		GOTO(out, rc);
+
+	mdt_pack_attr2body(info, body, &ma->ma_attr, fid);
+	if (ma->ma_valid & MA_LOV) {
+		if (info->mti_big_lmm_used) {
+			/* not enough room left in the reply */
+			rc = -EOVERFLOW;
+		} else {
+			body->mbo_eadatasize = ma->ma_lmm_size;
+			body->mbo_valid |= OBD_MD_FLEASIZE;
+		}
+	} else if (need_lov && !(ma->ma_need & MA_LOV)) {
+		rc = -EOVERFLOW;
+	}
+
+	mdt_counter_incr(mdt_info_req(info), LPROC_MDT_GETATTR);
+	EXIT;
+out:
+	info->mti_big_lmm_used = 0;
+	mdt_object_put(info->mti_env, obj);
+
+	return rc;
+}
+
+/**
+ * MDS_BATCH_GETATTR handler, return attributes and layouts of up to
+ * MD_BATCH_GETATTR_MAX FIDs at once.
+ *
+ * This is a lockless getattr like MDS_GETATTR without an intent, the client
+ * gets the attributes but no lock to cache them under. The result of each FID
+ * is returned in RMF_RCS, its attributes in RMF_MDT_BODY_ARRAY and its layout
+ * in RMF_MDT_MD, where all the layouts are packed back to back, each one
+ * 8-byte aligned.
+ */
+static int mdt_batch_getattr(struct tgt_session_info *tsi)
+{
+	struct mdt_thread_info *info = tsi2mdt_info(tsi);
+	struct req_capsule *pill = tsi->tsi_pill;
+	struct mdt_body *reqbody;
+	struct mdt_body *bodies;
+	struct lu_buf eabuf;
+	struct lu_fid *fids;
+	char *eadata = NULL;
+	int easize = 0, eaused = 0;
+	int bufsize, nr, i, rc;
+	__u32 *rcs;
+	ENTRY;
+
+	reqbody = req_capsule_client_get(pill, &RMF_MDT_BODY);
+	if (reqbody == NULL)
+		RETURN(-EPROTO);
+
+	bufsize = req_capsule_get_size(pill, &RMF_FID_ARRAY, RCL_CLIENT);
+	nr = bufsize / sizeof(struct lu_fid);
+	if (nr == 0 || nr > MD_BATCH_GETATTR_MAX ||
+	    nr * sizeof(struct lu_fid) != bufsize)
+		RETURN(-EINVAL);
+
+	fids = req_capsule_client_get(pill, &RMF_FID_ARRAY);
+	if (fids == NULL)
+		RETURN(-EPROTO);
+
+	if (reqbody->mbo_valid & OBD_MD_FLEASIZE)
+		easize = min_t(__u32, reqbody->mbo_eadatasize,
+			       MD_BATCH_GETATTR_EASIZE_MAX);
+
+	req_capsule_set_size(pill, &RMF_RCS, RCL_SERVER, nr * sizeof(__u32));
+	req_capsule_set_size(pill, &RMF_MDT_BODY_ARRAY, RCL_SERVER,
+			     nr * sizeof(struct mdt_body));
+	req_capsule_set_size(pill, &RMF_MDT_MD, RCL_SERVER, easize);
+	rc = req_capsule_server_pack(pill);
+	if (rc)
+		RETURN(err_serious(rc));
+
+	rcs = req_capsule_server_get(pill, &RMF_RCS);
+	LASSERT(rcs);
+	bodies = req_capsule_server_get(pill, &RMF_MDT_BODY_ARRAY);
+	LASSERT(bodies);
+	if (easize > 0)
+		eadata = req_capsule_server_get(pill, &RMF_MDT_MD);
+
+	rc = mdt_init_ucred(info, reqbody);
+	if (rc)
+		GOTO(out_shrink, rc);
+
+	for (i = 0; i < nr; i++) {
+		if (ptlrpc_req_need_swab(mdt_info_req(info)))
+			lustre_swab_lu_fid(&fids[i]);
+
+		eabuf.lb_buf = eadata + eaused;
+		eabuf.lb_len = easize - eaused;
+		memset(&bodies[i], 0, sizeof(bodies[i]));
+		rcs[i] = mdt_batch_getattr_one(info, &fids[i],
+					       reqbody->mbo_valid, &bodies[i],
+					       &eabuf);
+		if (rcs[i] == 0 && bodies[i].mbo_valid & OBD_MD_FLEASIZE)
+			eaused = min(easize, eaused +
+				     round_up(bodies[i].mbo_eadatasize, 8));
+	}
+	mdt_exit_ucred(info);
+	EXIT;
+out_shrink:
+	req_capsule_shrink(pill, &RMF_MDT_MD, eaused, RCL_SERVER);
+
+	return rc;
+}
+
 static int mdt_iocontrol(unsigned int cmd, struct obd_export *exp, int len,
 			 void *karg, void __user *uarg);
 
@@ -5197,6 +5350,7 @@ TGT_MDT_HDL(HAS_KEY | HAS_BODY | HAS_REPLY | IS_MUTABLE,
 	    MDS_SWAP_LAYOUTS,
 	    mdt_swap_layouts),
 TGT_MDT_HDL(IS_MUTABLE,		MDS_RMFID,	mdt_rmfid),
+TGT_MDT_HDL(0,				MDS_BATCH_GETATTR,	mdt_batch_getattr),
 };
 
 static struct tgt_handler mdt_io_ops[] = {
@@ -5932,6 +6086,10 @@ static int mdt_connect_internal(const struct lu_env *env,
 	if (data->ocd_connect_flags & OBD_CONNECT_FLAGS2)
 		data->ocd_connect_flags2 &= MDT_CONNECT_SUPPORTED2;
 
+	/* act as a server without MDS_BATCH_GETATTR */
+	if (OBD_FAIL_CHECK(OBD_FAIL_MDS_NO_BATCH_GETATTR))
+		data->ocd_connect_flags2 &= ~OBD_CONNECT2_BATCH_GETATTR;
+
 	data->ocd_ibits_known &= MDS_INODELOCK_FULL;
 
 	if (!mdt->mdt_opts.mo_acl)
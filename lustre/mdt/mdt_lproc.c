@@ -1075,6 +1075,7 @@ LUSTRE_RW_ATTR(enable_remote_rename);
 LPROC_SEQ_FOPS_RO_TYPE(mdt, hash);
 LPROC_SEQ_FOPS_WR_ONLY(mdt, mds_evict_client);
 LUSTRE_RW_ATTR(job_cleanup_interval);
+LUSTRE_RW_ATTR(job_latency_max);
 LPROC_SEQ_FOPS_RW_TYPE(mdt, nid_stats_clear);
 LUSTRE_RW_ATTR(hsm_control);
 
@@ -1121,6 +1122,7 @@ static struct attribute *mdt_attrs[] = {
 	&lustre_attr_migrate_hsm_allowed.attr,
 	&lustre_attr_hsm_control.attr,
 	&lustre_attr_job_cleanup_interval.attr,
+	&lustre_attr_job_latency_max.attr,
 	&lustre_attr_readonly.attr,
 	NULL,
 };
@@ -1204,7 +1206,8 @@ void mdt_counter_incr(struct ptlrpc_request *req, int opcode)
 	    (exp_connect_flags(exp) & OBD_CONNECT_JOBSTATS))
 		lprocfs_job_stats_log(exp->exp_obd,
 				      lustre_msg_get_jobid(req->rq_reqmsg),
-				      opcode, 1);
+				      opcode, 1, timespec64_to_ktime(
+						req->rq_arrival_time));
 }
 
 static const char * const mdt_stats[] = {
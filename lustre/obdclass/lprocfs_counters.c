@@ -75,8 +75,8 @@ void lprocfs_counter_add(struct lprocfs_stats *stats, int idx, long amount)
 		 * flag, because it needs accurate counting lest memory leak
 		 * check reports error.
 		 */
-		if (in_interrupt() &&
-		    (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0)
+		if ((stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0 &&
+		    in_interrupt())
 			percpu_cntr->lc_sum_irq += amount;
 		else
 			percpu_cntr->lc_sum += amount;
@@ -125,8 +125,8 @@ void lprocfs_counter_sub(struct lprocfs_stats *stats, int idx, long amount)
 		 * flag, because it needs accurate counting lest memory leak
 		 * check reports error.
 		 */
-		if (in_interrupt() &&
-		    (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0)
+		if ((stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) != 0 &&
+		    in_interrupt())
 			percpu_cntr->lc_sum_irq -= amount;
 		else
 			percpu_cntr->lc_sum -= amount;
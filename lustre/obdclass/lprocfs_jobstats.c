@@ -69,8 +69,28 @@ struct job_stat {
 	time64_t		js_timestamp;	/* seconds of most recent stat*/
 	struct lprocfs_stats	*js_stats;	/* per-job statistics */
 	struct obd_job_stats	*js_jobstats;	/* for accessing ojs_lock */
+	atomic_t		*js_latency;	/* latency histograms, or NULL */
 };
 
+/*
+ * Per-job latency histograms.
+ *
+ * Each counter of a job has JOB_LAT_BUCKETS log2 buckets of service time
+ * in microseconds: bucket 0 counts requests served in less than 1us, and
+ * bucket i > 0 those served in [2^(i-1), 2^i) us, the last bucket also
+ * counting anything slower.  The histograms of a job are allocated on its
+ * first latency sample, as long as the histograms of all jobs of the
+ * target fit in ojs_lat_max bytes, and are then updated with atomic
+ * increments only.
+ */
+#define JOB_LAT_BUCKETS		26
+#define JOB_LAT_MAX_DEFAULT	(16 << 20)
+
+static inline size_t job_latency_size(struct obd_job_stats *stats)
+{
+	return stats->ojs_cntr_num * JOB_LAT_BUCKETS * sizeof(atomic_t);
+}
+
 static unsigned
 job_stat_hash(struct cfs_hash *hs, const void *key, unsigned mask)
 {
@@ -113,6 +133,11 @@ static void job_free(struct job_stat *job)
 	list_del_init(&job->js_list);
 	write_unlock(&job->js_jobstats->ojs_lock);
 
+	if (job->js_latency != NULL) {
+		OBD_FREE(job->js_latency, job_latency_size(job->js_jobstats));
+		atomic_long_sub(job_latency_size(job->js_jobstats),
+				&job->js_jobstats->ojs_lat_bytes);
+	}
 	lprocfs_free_stats(&job->js_stats);
 	OBD_FREE_PTR(job);
 }
@@ -262,37 +287,77 @@ static struct job_stat *job_alloc(char *jobid, struct obd_job_stats *jobs)
 	return job;
 }
 
-int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
-			  int event, long amount)
+static atomic_t *job_latency_get(struct job_stat *job)
 {
-	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
-	struct job_stat *job, *job2;
-	ENTRY;
+	struct obd_job_stats *stats = job->js_jobstats;
+	size_t size = job_latency_size(stats);
+	atomic_t *lat;
+
+	lat = READ_ONCE(job->js_latency);
+	if (likely(lat != NULL))
+		return lat;
+
+	if (atomic_long_add_return(size, &stats->ojs_lat_bytes) >
+	    stats->ojs_lat_max)
+		goto out_unaccount;
+
+	OBD_ALLOC(lat, size);
+	if (lat == NULL)
+		goto out_unaccount;
+
+	if (cmpxchg(&job->js_latency, NULL, lat) != NULL) {
+		/* lost the race against another sample of this job */
+		OBD_FREE(lat, size);
+		atomic_long_sub(size, &stats->ojs_lat_bytes);
+		lat = job->js_latency;
+	}
 
-	LASSERT(stats != NULL);
-	LASSERT(stats->ojs_hash != NULL);
+	return lat;
 
-	if (event >= stats->ojs_cntr_num)
-		RETURN(-EINVAL);
+out_unaccount:
+	atomic_long_sub(size, &stats->ojs_lat_bytes);
+	return NULL;
+}
+
+static void job_latency_add(struct job_stat *job, int event, ktime_t start)
+{
+	atomic_t *lat;
+	s64 usecs;
+	int bucket;
+
+	lat = job_latency_get(job);
+	if (lat == NULL)
+		return;
+
+	usecs = ktime_us_delta(ktime_get_real(), start);
+	bucket = usecs > 0 ? min_t(int, fls64(usecs), JOB_LAT_BUCKETS - 1) : 0;
+	atomic_inc(&lat[event * JOB_LAT_BUCKETS + bucket]);
+}
+
+/* Find the stats of \a jobid, creating them if \a create is set */
+static struct job_stat *job_stat_find(struct obd_job_stats *stats,
+				      char *jobid, bool create)
+{
+	struct job_stat *job, *job2;
 
 	if (jobid == NULL || strlen(jobid) == 0)
-		RETURN(-EINVAL);
+		return ERR_PTR(-EINVAL);
 
 	if (strlen(jobid) >= LUSTRE_JOBID_SIZE) {
 		CERROR("Invalid jobid size (%lu), expect(%d)\n",
 		       (unsigned long)strlen(jobid) + 1, LUSTRE_JOBID_SIZE);
-		RETURN(-EINVAL);
+		return ERR_PTR(-EINVAL);
 	}
 
 	job = cfs_hash_lookup(stats->ojs_hash, jobid);
-	if (job)
-		goto found;
+	if (job || !create)
+		return job ?: ERR_PTR(-ENOENT);
 
 	lprocfs_job_cleanup(stats, stats->ojs_cleanup_interval);
 
 	job = job_alloc(jobid, stats);
 	if (job == NULL)
-		RETURN(-ENOMEM);
+		return ERR_PTR(-ENOMEM);
 
 	job2 = cfs_hash_findadd_unique(stats->ojs_hash, job->js_jobid,
 				       &job->js_hash);
@@ -311,10 +376,38 @@ int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
 		write_unlock(&stats->ojs_lock);
 	}
 
-found:
+	return job;
+}
+
+/**
+ * Account \a amount to counter \a event of job \a jobid.
+ *
+ * If \a start is not zero, also add the time elapsed since \a start (in
+ * the CLOCK_REALTIME base, like ptlrpc_request::rq_arrival_time) to the
+ * latency histogram of this counter.
+ */
+int lprocfs_job_stats_log(struct obd_device *obd, char *jobid,
+			  int event, long amount, ktime_t start)
+{
+	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
+	struct job_stat *job;
+	ENTRY;
+
+	LASSERT(stats != NULL);
+	LASSERT(stats->ojs_hash != NULL);
+
+	if (event >= stats->ojs_cntr_num)
+		RETURN(-EINVAL);
+
+	job = job_stat_find(stats, jobid, true);
+	if (IS_ERR(job))
+		RETURN(PTR_ERR(job));
+
 	LASSERT(stats == job->js_jobstats);
 	job->js_timestamp = ktime_get_real_seconds();
 	lprocfs_counter_add(job->js_stats, event, amount);
+	if (ktime_to_ns(start) != 0)
+		job_latency_add(job, event, start);
 
 	job_putref(job);
 
@@ -322,6 +415,31 @@ found:
 }
 EXPORT_SYMBOL(lprocfs_job_stats_log);
 
+/**
+ * Add the time elapsed since \a start to the latency histogram of counter
+ * \a event of job \a jobid, without counting a new request. This is used
+ * for operations counted when they start, like bulk I/O.
+ */
+int lprocfs_job_stats_latency(struct obd_device *obd, char *jobid,
+			      int event, ktime_t start)
+{
+	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
+	struct job_stat *job;
+
+	if (stats->ojs_hash == NULL || event >= stats->ojs_cntr_num)
+		return -EINVAL;
+
+	job = job_stat_find(stats, jobid, false);
+	if (IS_ERR(job))
+		return PTR_ERR(job);
+
+	job_latency_add(job, event, start);
+	job_putref(job);
+
+	return 0;
+}
+EXPORT_SYMBOL(lprocfs_job_stats_latency);
+
 void lprocfs_job_stats_fini(struct obd_device *obd)
 {
 	struct obd_job_stats *stats = &obd->u.obt.obt_jobstats;
@@ -405,10 +523,15 @@ static void *lprocfs_jobstats_seq_next(struct seq_file *p, void *v, loff_t *pos)
  * - job_id         dd.4854
  *   snapshot_time: 1322494602
  *   read:          { samples: 0, unit: bytes, min:  0, max:  0, sum:  0 }
- *   write:         { samples: 1, unit: bytes, min: 4096, max: 4096, sum: 4096 }
+ *   write:         { samples: 1, unit: bytes, min: 4096, max: 4096, sum: 4096,
+ *		      latency_us: { p50: 512, p90: 512, p99: 512, p999: 512,
+ *				    max: 512 } }
  *   setattr:       { samples: 0, unit: reqs }
  *   punch:         { samples: 0, unit: reqs }
  *   sync:          { samples: 0, unit: reqs }
+ *
+ * Latency percentiles are the upper bound of the histogram bucket they fall
+ * in, and are only shown for operations with latency samples.
  */
 
 static const char spaces[] = "                    ";
@@ -418,6 +541,48 @@ static int inline width(const char *str, int len)
 	return len - min((int)strlen(str), 15);
 }
 
+static inline u64 job_latency_bucket_max(int bucket)
+{
+	return 1ULL << bucket;
+}
+
+static void job_latency_show(struct seq_file *p, atomic_t *lat)
+{
+	static const struct {
+		unsigned int	permille;
+		const char	*name;
+	} pcts[] = {
+		{ 500, "p50" },
+		{ 900, "p90" },
+		{ 990, "p99" },
+		{ 999, "p999" },
+	};
+	u32 hist[JOB_LAT_BUCKETS];
+	u64 total = 0;
+	u64 sum = 0;
+	int last = 0;
+	int i, j;
+
+	for (i = 0; i < JOB_LAT_BUCKETS; i++) {
+		hist[i] = atomic_read(&lat[i]);
+		total += hist[i];
+		if (hist[i] != 0)
+			last = i;
+	}
+	if (total == 0)
+		return;
+
+	seq_puts(p, ", latency_us: {");
+	for (i = 0, j = 0; i < JOB_LAT_BUCKETS && j < ARRAY_SIZE(pcts); i++) {
+		sum += hist[i];
+		for (; j < ARRAY_SIZE(pcts) &&
+		       sum * 1000 >= total * pcts[j].permille; j++)
+			seq_printf(p, " %s: %llu,", pcts[j].name,
+				   job_latency_bucket_max(i));
+	}
+	seq_printf(p, " max: %llu }", job_latency_bucket_max(last));
+}
+
 static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 {
 	struct job_stat			*job = v;
@@ -467,6 +632,9 @@ static int lprocfs_jobstats_seq_show(struct seq_file *p, void *v)
 			seq_printf(p, ", sumsq: %18llu",
 				   ret.lc_count ? ret.lc_sumsquare : 0);
 		}
+		if (job->js_latency != NULL)
+			job_latency_show(p, job->js_latency +
+					    i * JOB_LAT_BUCKETS);
 
 		seq_printf(p, " }\n");
 
@@ -610,6 +778,8 @@ int lprocfs_job_stats_init(struct obd_device *obd, int cntr_num,
 	stats->ojs_cntr_init_fn = init_fn;
 	stats->ojs_cleanup_interval = 600; /* 10 mins by default */
 	stats->ojs_last_cleanup = ktime_get_real_seconds();
+	atomic_long_set(&stats->ojs_lat_bytes, 0);
+	stats->ojs_lat_max = JOB_LAT_MAX_DEFAULT;
 
 	entry = lprocfs_add_simple(obd->obd_proc_entry, "job_stats", stats,
 				   &lprocfs_jobstats_seq_fops);
@@ -655,3 +825,37 @@ ssize_t job_cleanup_interval_store(struct kobject *kobj,
 	return count;
 }
 EXPORT_SYMBOL(job_cleanup_interval_store);
+
+ssize_t job_latency_max_show(struct kobject *kobj, struct attribute *attr,
+			     char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct obd_job_stats *stats;
+
+	stats = &obd->u.obt.obt_jobstats;
+	return scnprintf(buf, PAGE_SIZE, "%llu\n", stats->ojs_lat_max);
+}
+EXPORT_SYMBOL(job_latency_max_show);
+
+/* Jobs which already have latency histograms keep them when the limit is
+ * lowered, it only applies to the histograms of new jobs. */
+ssize_t job_latency_max_store(struct kobject *kobj, struct attribute *attr,
+			      const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	struct obd_job_stats *stats;
+	u64 val;
+	int rc;
+
+	stats = &obd->u.obt.obt_jobstats;
+
+	rc = sysfs_memparse(buffer, count, &val, "B");
+	if (rc < 0)
+		return rc;
+
+	stats->ojs_lat_max = val;
+	return count;
+}
+EXPORT_SYMBOL(job_latency_max_store);
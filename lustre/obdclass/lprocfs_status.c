@@ -442,7 +442,9 @@ EXPORT_SYMBOL(lprocfs_server_uuid_seq_show);
  * will only access the statistics for that CPU.  If the stats structure
  * for the current CPU has not been allocated (or previously freed),
  * allocate it now.  The per-CPU statistics do not need locking since
- * the thread is pinned to the CPU during update.
+ * the thread is pinned to the CPU during update.  Readers of per-CPU
+ * statistics take no lock either, the per-CPU areas are only freed along
+ * with the statistics structure, so they never contend with updaters.
  *
  * For global statistics, lock the stats structure to prevent concurrent update.
  *
@@ -473,7 +475,7 @@ int lprocfs_stats_lock(struct lprocfs_stats *stats,
 	case LPROCFS_GET_SMP_ID: {
 		unsigned int cpuid = get_cpu();
 
-		if (unlikely(!stats->ls_percpu[cpuid])) {
+		if (unlikely(!READ_ONCE(stats->ls_percpu[cpuid]))) {
 			int rc = lprocfs_stats_alloc_one(stats, cpuid);
 
 			if (rc < 0) {
@@ -484,7 +486,7 @@ int lprocfs_stats_lock(struct lprocfs_stats *stats,
 		return cpuid;
 	}
 	case LPROCFS_GET_NUM_CPU:
-		return stats->ls_biggest_alloc_num;
+		return READ_ONCE(stats->ls_biggest_alloc_num);
 	default:
 		LBUG();
 	}
@@ -517,6 +519,18 @@ void lprocfs_stats_unlock(struct lprocfs_stats *stats,
 	}
 }
 
+static inline void lprocfs_counter_sum(struct lprocfs_counter *cnt,
+				       struct lprocfs_counter *percpu_cntr)
+{
+	cnt->lc_count += percpu_cntr->lc_count;
+	cnt->lc_sum += percpu_cntr->lc_sum;
+	if (percpu_cntr->lc_min < cnt->lc_min)
+		cnt->lc_min = percpu_cntr->lc_min;
+	if (percpu_cntr->lc_max > cnt->lc_max)
+		cnt->lc_max = percpu_cntr->lc_max;
+	cnt->lc_sumsquare += percpu_cntr->lc_sumsquare;
+}
+
 /** add up per-cpu counters */
 void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 			   struct lprocfs_counter *cnt)
@@ -539,17 +553,45 @@ void lprocfs_stats_collect(struct lprocfs_stats *stats, int idx,
 	num_entry = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
 
 	for (i = 0; i < num_entry; i++) {
-		if (!stats->ls_percpu[i])
+		struct lprocfs_percpu *percpu = lprocfs_stats_percpu(stats, i);
+
+		if (!percpu)
 			continue;
-		percpu_cntr = lprocfs_stats_counter_get(stats, i, idx);
+		percpu_cntr = lprocfs_percpu_counter(stats, percpu, idx);
+		lprocfs_counter_sum(cnt, percpu_cntr);
+	}
+
+	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
+}
+
+/**
+ * Add up all \a stats counters into the \a cnt array of ls_num entries.
+ *
+ * Each per-CPU area is walked once from start to end instead of touching
+ * every CPU once per counter as repeated lprocfs_stats_collect() calls do.
+ */
+static void lprocfs_stats_collect_all(struct lprocfs_stats *stats,
+				      struct lprocfs_counter *cnt)
+{
+	unsigned int num_entry;
+	unsigned long flags = 0;
+	int i;
+	int j;
+
+	memset(cnt, 0, stats->ls_num * sizeof(*cnt));
+	for (j = 0; j < stats->ls_num; j++)
+		cnt[j].lc_min = LC_MIN_INIT;
+
+	num_entry = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
+
+	for (i = 0; i < num_entry; i++) {
+		struct lprocfs_percpu *percpu = lprocfs_stats_percpu(stats, i);
 
-		cnt->lc_count += percpu_cntr->lc_count;
-		cnt->lc_sum += percpu_cntr->lc_sum;
-		if (percpu_cntr->lc_min < cnt->lc_min)
-			cnt->lc_min = percpu_cntr->lc_min;
-		if (percpu_cntr->lc_max > cnt->lc_max)
-			cnt->lc_max = percpu_cntr->lc_max;
-		cnt->lc_sumsquare += percpu_cntr->lc_sumsquare;
+		if (!percpu)
+			continue;
+		for (j = 0; j < stats->ls_num; j++)
+			lprocfs_counter_sum(&cnt[j],
+				lprocfs_percpu_counter(stats, percpu, j));
 	}
 
 	lprocfs_stats_unlock(stats, LPROCFS_GET_NUM_CPU, &flags);
@@ -658,6 +700,8 @@ static const char *obd_connect_names[] = {
 	"crush",		/* 0x2000 */
 	"async_discard",	/* 0x4000 */
 	"client_encryption",	/* 0x8000 */
+	"batch_getattr",	/* 0x10000 */
+	"batch_bl_ast",		/* 0x20000 */
 	NULL
 };
 
@@ -1161,41 +1205,46 @@ int lprocfs_obd_cleanup(struct obd_device *obd)
 }
 EXPORT_SYMBOL(lprocfs_obd_cleanup);
 
+/**
+ * Allocate the per-CPU counter area of \a cpuid.
+ *
+ * The area is fully initialized before it is published with cmpxchg(), so
+ * lockless readers never see it half set up.  An interrupt updating the same
+ * stats on this CPU may race with us; the loser frees its copy.
+ */
 int lprocfs_stats_alloc_one(struct lprocfs_stats *stats, unsigned int cpuid)
 {
+	struct lprocfs_percpu *percpu;
 	struct lprocfs_counter *cntr;
 	unsigned int percpusize;
-	int rc = -ENOMEM;
-	unsigned long flags = 0;
+	unsigned int old;
 	int i;
 
-	LASSERT(stats->ls_percpu[cpuid] == NULL);
 	LASSERT((stats->ls_flags & LPROCFS_STATS_FLAG_NOPERCPU) == 0);
 
 	percpusize = lprocfs_stats_counter_size(stats);
-	LIBCFS_ALLOC_ATOMIC(stats->ls_percpu[cpuid], percpusize);
-	if (stats->ls_percpu[cpuid]) {
-		rc = 0;
-		if (unlikely(stats->ls_biggest_alloc_num <= cpuid)) {
-			if (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE)
-				spin_lock_irqsave(&stats->ls_lock, flags);
-			else
-				spin_lock(&stats->ls_lock);
-			if (stats->ls_biggest_alloc_num <= cpuid)
-				stats->ls_biggest_alloc_num = cpuid + 1;
-			if (stats->ls_flags & LPROCFS_STATS_FLAG_IRQ_SAFE) {
-				spin_unlock_irqrestore(&stats->ls_lock, flags);
-			} else {
-				spin_unlock(&stats->ls_lock);
-			}
-		}
-		/* initialize the ls_percpu[cpuid] non-zero counter */
-		for (i = 0; i < stats->ls_num; ++i) {
-			cntr = lprocfs_stats_counter_get(stats, cpuid, i);
-			cntr->lc_min = LC_MIN_INIT;
-		}
+	LIBCFS_ALLOC_ATOMIC(percpu, percpusize);
+	if (!percpu)
+		return -ENOMEM;
+
+	/* initialize the ls_percpu[cpuid] non-zero counter */
+	for (i = 0; i < stats->ls_num; ++i) {
+		cntr = lprocfs_percpu_counter(stats, percpu, i);
+		cntr->lc_min = LC_MIN_INIT;
 	}
-	return rc;
+
+	if (cmpxchg(&stats->ls_percpu[cpuid], NULL, percpu) != NULL) {
+		LIBCFS_FREE(percpu, percpusize);
+		return 0;
+	}
+
+	do {
+		old = READ_ONCE(stats->ls_biggest_alloc_num);
+		if (old > cpuid)
+			break;
+	} while (cmpxchg(&stats->ls_biggest_alloc_num, old, cpuid + 1) != old);
+
+	return 0;
 }
 
 struct lprocfs_stats *lprocfs_alloc_stats(unsigned int num,
@@ -1291,12 +1340,13 @@ u64 lprocfs_stats_collector(struct lprocfs_stats *stats, int idx,
 
 	num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
 	for (i = 0; i < num_cpu; i++) {
+		struct lprocfs_percpu *percpu = lprocfs_stats_percpu(stats, i);
 		struct lprocfs_counter *cntr;
 
-		if (!stats->ls_percpu[i])
+		if (!percpu)
 			continue;
 
-		cntr = lprocfs_stats_counter_get(stats, i, idx);
+		cntr = lprocfs_percpu_counter(stats, percpu, idx);
 		ret += lprocfs_read_helper(cntr, &stats->ls_cnt_header[idx],
 					   stats->ls_flags, field);
 	}
@@ -1316,10 +1366,12 @@ void lprocfs_clear_stats(struct lprocfs_stats *stats)
 	num_entry = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
 
 	for (i = 0; i < num_entry; i++) {
-		if (!stats->ls_percpu[i])
+		struct lprocfs_percpu *percpu = lprocfs_stats_percpu(stats, i);
+
+		if (!percpu)
 			continue;
 		for (j = 0; j < stats->ls_num; j++) {
-			percpu_cntr = lprocfs_stats_counter_get(stats, i, j);
+			percpu_cntr = lprocfs_percpu_counter(stats, percpu, j);
 			percpu_cntr->lc_count		= 0;
 			percpu_cntr->lc_min		= LC_MIN_INIT;
 			percpu_cntr->lc_max		= 0;
@@ -1334,23 +1386,35 @@ void lprocfs_clear_stats(struct lprocfs_stats *stats)
 }
 EXPORT_SYMBOL(lprocfs_clear_stats);
 
+/* private data of an open stats file */
+struct lprocfs_stats_seq {
+	struct lprocfs_stats	*lss_stats;
+	/* ls_num counters summed over all CPUs */
+	struct lprocfs_counter	 lss_cntr[0];
+};
+
 static ssize_t lprocfs_stats_seq_write(struct file *file,
 				       const char __user *buf,
 				       size_t len, loff_t *off)
 {
 	struct seq_file *seq = file->private_data;
-	struct lprocfs_stats *stats = seq->private;
+	struct lprocfs_stats_seq *priv = seq->private;
 
-	lprocfs_clear_stats(stats);
+	lprocfs_clear_stats(priv->lss_stats);
 
 	return len;
 }
 
+/* Counters are summed over all CPUs once per read() in seq_start(). */
 static void *lprocfs_stats_seq_start(struct seq_file *p, loff_t *pos)
 {
-	struct lprocfs_stats *stats = p->private;
+	struct lprocfs_stats_seq *priv = p->private;
 
-	return (*pos < stats->ls_num) ? pos : NULL;
+	if (*pos >= priv->lss_stats->ls_num)
+		return NULL;
+
+	lprocfs_stats_collect_all(priv->lss_stats, priv->lss_cntr);
+	return pos;
 }
 
 static void lprocfs_stats_seq_stop(struct seq_file *p, void *v)
@@ -1359,15 +1423,18 @@ static void lprocfs_stats_seq_stop(struct seq_file *p, void *v)
 
 static void *lprocfs_stats_seq_next(struct seq_file *p, void *v, loff_t *pos)
 {
+	struct lprocfs_stats_seq *priv = p->private;
+
 	(*pos)++;
 
-	return lprocfs_stats_seq_start(p, pos);
+	return (*pos < priv->lss_stats->ls_num) ? pos : NULL;
 }
 
 /* seq file export of one lprocfs counter */
 static int lprocfs_stats_seq_show(struct seq_file *p, void *v)
 {
-	struct lprocfs_stats *stats = p->private;
+	struct lprocfs_stats_seq *priv = p->private;
+	struct lprocfs_stats *stats = priv->lss_stats;
 	struct lprocfs_counter_header *hdr;
 	struct lprocfs_counter ctr;
 	int idx = *(loff_t *)v;
@@ -1381,7 +1448,7 @@ static int lprocfs_stats_seq_show(struct seq_file *p, void *v)
 	}
 
 	hdr = &stats->ls_cnt_header[idx];
-	lprocfs_stats_collect(stats, idx, &ctr);
+	ctr = priv->lss_cntr[idx];
 
 	if (ctr.lc_count == 0)
 		return 0;
@@ -1408,14 +1475,17 @@ static const struct seq_operations lprocfs_stats_seq_sops = {
 
 static int lprocfs_stats_seq_open(struct inode *inode, struct file *file)
 {
-	struct seq_file *seq;
-	int rc;
+	struct lprocfs_stats *stats;
+	struct lprocfs_stats_seq *priv;
 
-	rc = seq_open(file, &lprocfs_stats_seq_sops);
-	if (rc)
-		return rc;
-	seq = file->private_data;
-	seq->private = inode->i_private ? inode->i_private : PDE_DATA(inode);
+	stats = inode->i_private ? inode->i_private : PDE_DATA(inode);
+	priv = __seq_open_private(file, &lprocfs_stats_seq_sops,
+				  offsetof(struct lprocfs_stats_seq,
+					   lss_cntr[stats->ls_num]));
+	if (!priv)
+		return -ENOMEM;
+
+	priv->lss_stats = stats;
 	return 0;
 }
 
@@ -1425,7 +1495,7 @@ static const struct file_operations lprocfs_stats_seq_fops = {
 	.read    = seq_read,
 	.write   = lprocfs_stats_seq_write,
 	.llseek  = seq_lseek,
-	.release = lprocfs_seq_release,
+	.release = seq_release_private,
 };
 
 int ldebugfs_register_stats(struct dentry *parent, const char *name,
@@ -1479,9 +1549,11 @@ void lprocfs_counter_init(struct lprocfs_stats *stats, int index,
 
 	num_cpu = lprocfs_stats_lock(stats, LPROCFS_GET_NUM_CPU, &flags);
 	for (i = 0; i < num_cpu; ++i) {
-		if (!stats->ls_percpu[i])
+		struct lprocfs_percpu *percpu = lprocfs_stats_percpu(stats, i);
+
+		if (!percpu)
 			continue;
-		percpu_cntr = lprocfs_stats_counter_get(stats, i, index);
+		percpu_cntr = lprocfs_percpu_counter(stats, percpu, index);
 		percpu_cntr->lc_count		= 0;
 		percpu_cntr->lc_min		= LC_MIN_INIT;
 		percpu_cntr->lc_max		= 0;
@@ -71,6 +71,65 @@ enum cksum_types obd_cksum_types_supported_server(const char *obd_name)
 }
 EXPORT_SYMBOL(obd_cksum_types_supported_server);
 
+/**
+ * Start queueing bulk pages to be hashed with \a req.
+ *
+ * Pages added with obd_cksum_batch_add_page() are handed to the hash
+ * driver CFS_CRYPTO_HASH_BATCH_PAGES at a time, so a single update walks
+ * several pages.  The page contents must not change until the batch is
+ * flushed; obd_cksum_batch_flush() must be called before the hash is
+ * finalized.
+ */
+void obd_cksum_batch_init(struct obd_cksum_batch *ocb,
+			  struct ahash_request *req)
+{
+	ocb->ocb_req = req;
+	ocb->ocb_count = 0;
+	ocb->ocb_nob = 0;
+	ocb->ocb_rc = 0;
+	sg_init_table(ocb->ocb_sg, ARRAY_SIZE(ocb->ocb_sg));
+}
+EXPORT_SYMBOL(obd_cksum_batch_init);
+
+/**
+ * Hash the queued pages.
+ *
+ * \retval	0 on success
+ * \retval	negative errno of the first failed update of this batch
+ */
+int obd_cksum_batch_flush(struct obd_cksum_batch *ocb)
+{
+	int rc;
+
+	if (ocb->ocb_count == 0)
+		return ocb->ocb_rc;
+
+	sg_mark_end(&ocb->ocb_sg[ocb->ocb_count - 1]);
+	rc = cfs_crypto_hash_update_sg(ocb->ocb_req, ocb->ocb_sg,
+				       ocb->ocb_nob);
+	if (rc != 0 && ocb->ocb_rc == 0)
+		ocb->ocb_rc = rc;
+
+	sg_init_table(ocb->ocb_sg, ARRAY_SIZE(ocb->ocb_sg));
+	ocb->ocb_count = 0;
+	ocb->ocb_nob = 0;
+
+	return ocb->ocb_rc;
+}
+EXPORT_SYMBOL(obd_cksum_batch_flush);
+
+void obd_cksum_batch_add_page(struct obd_cksum_batch *ocb, struct page *page,
+			      unsigned int offset, unsigned int len)
+{
+	sg_set_page(&ocb->ocb_sg[ocb->ocb_count++], page, len,
+		    offset & ~PAGE_MASK);
+	ocb->ocb_nob += len;
+
+	if (ocb->ocb_count == ARRAY_SIZE(ocb->ocb_sg))
+		obd_cksum_batch_flush(ocb);
+}
+EXPORT_SYMBOL(obd_cksum_batch_add_page);
+
 /* The OBD_FL_CKSUM_* flags is packed into 5 bits of o_flags, since there can
  * only be a single checksum type per RPC.
  *
@@ -841,6 +841,7 @@ LUSTRE_RW_ATTR(ir_factor);
 LPROC_SEQ_FOPS_WR_ONLY(ofd, evict_client);
 LPROC_SEQ_FOPS_RW_TYPE(ofd, checksum_dump);
 LUSTRE_RW_ATTR(job_cleanup_interval);
+LUSTRE_RW_ATTR(job_latency_max);
 
 LUSTRE_RO_ATTR(tot_dirty);
 LUSTRE_RO_ATTR(tot_granted);
@@ -930,6 +931,7 @@ static struct attribute *ofd_attrs[] = {
 	&lustre_attr_soft_sync_limit.attr,
 	&lustre_attr_lfsck_speed_limit.attr,
 	&lustre_attr_job_cleanup_interval.attr,
+	&lustre_attr_job_latency_max.attr,
 	&lustre_attr_checksum_t10pi_enforce.attr,
 #if LUSTRE_VERSION_CODE < OBD_OCD_VERSION(2, 14, 53, 0)
 	&lustre_attr_read_cache_enable.attr,
@@ -923,7 +923,7 @@ static int ofd_set_info_hdl(struct tgt_session_info *tsi)
 		rc = -EOPNOTSUPP;
 	}
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_SET_INFO,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	RETURN(rc);
 }
@@ -1183,7 +1183,7 @@ out_put:
 		rc = -EOPNOTSUPP;
 	}
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_GET_INFO,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	RETURN(rc);
 }
@@ -1272,7 +1272,7 @@ out:
 		tgt_extent_unlock(&lh, lock_mode);
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_GETATTR,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	repbody->oa.o_valid |= OBD_MD_FLFLAGS;
 	repbody->oa.o_flags = OBD_FL_FLUSH;
@@ -1347,7 +1347,7 @@ static int ofd_setattr_hdl(struct tgt_session_info *tsi)
 		     OFD_VALID_FLAGS | LA_UID | LA_GID | LA_PROJID);
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_SETATTR,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 	EXIT;
 out_put:
 	ofd_object_put(tsi->tsi_env, fo);
@@ -1725,7 +1725,7 @@ static int ofd_create_hdl(struct tgt_session_info *tsi)
 	}
 	EXIT;
 	ofd_counter_incr(exp, LPROC_OFD_STATS_CREATE,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 	if (unlikely(!oseq->os_last_id_synced))
 		oseq->os_last_id_synced = 1;
 out:
@@ -1829,7 +1829,7 @@ static int ofd_destroy_hdl(struct tgt_session_info *tsi)
 	}
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_DESTROY,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	GOTO(out, rc);
 
@@ -1870,7 +1870,7 @@ static int ofd_statfs_hdl(struct tgt_session_info *tsi)
 		rc = -EINPROGRESS;
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_STATFS,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	RETURN(rc);
 }
@@ -1913,7 +1913,7 @@ static int ofd_sync_hdl(struct tgt_session_info *tsi)
 		GOTO(put, rc);
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_SYNC,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 	if (fo == NULL)
 		RETURN(0);
 
@@ -2019,7 +2019,7 @@ static int ofd_punch_hdl(struct tgt_session_info *tsi)
 		GOTO(out_put, rc);
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_PUNCH,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 	EXIT;
 out_put:
 	ofd_object_put(tsi->tsi_env, fo);
@@ -2282,7 +2282,7 @@ static int ofd_quotactl(struct tgt_session_info *tsi)
 	rc = lquotactl_slv(tsi->tsi_env, tsi->tsi_tgt->lut_bottom, repoqc);
 
 	ofd_counter_incr(tsi->tsi_exp, LPROC_OFD_STATS_QUOTACTL,
-			 tsi->tsi_jobid, 1);
+			 tsi->tsi_jobid, 1, tgt_ses_arrival(tsi));
 
 	if (repoqc->qc_id != id)
 		swap(repoqc->qc_id, id);
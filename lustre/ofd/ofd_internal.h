@@ -70,15 +70,18 @@ enum {
 	LPROC_OFD_STATS_LAST,
 };
 
+/* \a start is the arrival time of the request, or zero to not account the
+ * latency of this operation in jobstats */
 static inline void ofd_counter_incr(struct obd_export *exp, int opcode,
-				    char *jobid, long amount)
+				    char *jobid, long amount, ktime_t start)
 {
 	if (exp->exp_obd && exp->exp_obd->obd_stats)
 		lprocfs_counter_add(exp->exp_obd->obd_stats, opcode, amount);
 
 	if (exp->exp_obd && exp->exp_obd->u.obt.obt_jobstats.ojs_hash &&
 	    (exp_connect_flags(exp) & OBD_CONNECT_JOBSTATS))
-		lprocfs_job_stats_log(exp->exp_obd, jobid, opcode, amount);
+		lprocfs_job_stats_log(exp->exp_obd, jobid, opcode, amount,
+				      start);
 
 	if (exp->exp_nid_stats != NULL &&
 	    exp->exp_nid_stats->nid_stats != NULL) {
@@ -87,6 +90,15 @@ static inline void ofd_counter_incr(struct obd_export *exp, int opcode,
 	}
 }
 
+/* Account the latency of an operation counted when it started */
+static inline void ofd_counter_latency(struct obd_export *exp, int opcode,
+				       char *jobid, ktime_t start)
+{
+	if (exp->exp_obd && exp->exp_obd->u.obt.obt_jobstats.ojs_hash &&
+	    (exp_connect_flags(exp) & OBD_CONNECT_JOBSTATS))
+		lprocfs_job_stats_latency(exp->exp_obd, jobid, opcode, start);
+}
+
 struct ofd_seq {
 	struct list_head	os_list;
 	struct ost_id		os_oi;
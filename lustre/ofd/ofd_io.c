@@ -555,7 +555,8 @@ static int ofd_preprw_read(const struct lu_env *env, struct obd_export *exp,
 	if (unlikely(rc))
 		GOTO(buf_put, rc);
 
-	ofd_counter_incr(exp, LPROC_OFD_STATS_READ, jobid, tot_bytes);
+	ofd_counter_incr(exp, LPROC_OFD_STATS_READ, jobid, tot_bytes,
+			 ktime_set(0, 0));
 	RETURN(0);
 
 buf_put:
@@ -734,7 +735,8 @@ static int ofd_preprw_write(const struct lu_env *env, struct obd_export *exp,
 		GOTO(err, rc);
 
 	ofd_read_unlock(env, fo);
-	ofd_counter_incr(exp, LPROC_OFD_STATS_WRITE, jobid, tot_bytes);
+	ofd_counter_incr(exp, LPROC_OFD_STATS_WRITE, jobid, tot_bytes,
+			 ktime_set(0, 0));
 	RETURN(0);
 err:
 	dt_bufs_put(env, ofd_object_child(fo), lnb, *nr_local);
@@ -1404,5 +1406,15 @@ int ofd_commitrw(const struct lu_env *env, int cmd, struct obd_export *exp,
 		rc = -EPROTO;
 	}
 
+	/* bulk I/O is counted in ofd_preprw(), its latency once done */
+	if (rc == 0 && tgt_ses_req(tgt_ses_info(env)) != NULL) {
+		struct tgt_session_info *tsi = tgt_ses_info(env);
+
+		ofd_counter_latency(exp, cmd == OBD_BRW_WRITE ?
+				    LPROC_OFD_STATS_WRITE :
+				    LPROC_OFD_STATS_READ,
+				    tsi->tsi_jobid, tgt_ses_arrival(tsi));
+	}
+
 	RETURN(rc);
 }
@@ -946,7 +946,8 @@ static int ofd_echo_setattr(const struct lu_env *env, struct obd_export *exp,
 	if (rc)
 		GOTO(out_unlock, rc);
 
-	ofd_counter_incr(exp, LPROC_OFD_STATS_SETATTR, NULL, 1);
+	ofd_counter_incr(exp, LPROC_OFD_STATS_SETATTR, NULL, 1,
+			 ktime_set(0, 0));
 	EXIT;
 out_unlock:
 	ofd_object_put(env, fo);
@@ -739,6 +739,90 @@ static ssize_t grant_shrink_store(struct kobject *kobj, struct attribute *attr,
 }
 LUSTRE_RW_ATTR(grant_shrink);
 
+static ssize_t cpt_affinity_show(struct kobject *kobj, struct attribute *attr,
+				 char *buf)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+
+	return sprintf(buf, "%d\n", obd->u.cli.cl_cpt_affinity ? 1 : 0);
+}
+
+static ssize_t cpt_affinity_store(struct kobject *kobj, struct attribute *attr,
+				  const char *buffer, size_t count)
+{
+	struct obd_device *obd = container_of(kobj, struct obd_device,
+					      obd_kset.kobj);
+	bool val;
+	int rc;
+
+	rc = kstrtobool(buffer, &val);
+	if (rc)
+		return rc;
+
+	obd->u.cli.cl_cpt_affinity = val;
+
+	return count;
+}
+LUSTRE_RW_ATTR(cpt_affinity);
+
+static int osc_cpt_stats_seq_show(struct seq_file *m, void *v)
+{
+	struct obd_device *obd = m->private;
+	struct client_obd *cli = &obd->u.cli;
+	struct timespec64 now;
+	int i;
+
+	ktime_get_real_ts64(&now);
+	seq_printf(m, "snapshot_time: %lld.%09lu\n",
+		   (s64)now.tv_sec, now.tv_nsec);
+	seq_printf(m, "cpt_affinity: %d\n", cli->cl_cpt_affinity ? 1 : 0);
+	if (cli->cl_cpt_stats == NULL)
+		return 0;
+
+	seq_puts(m, "cpts:\n");
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++) {
+		struct client_obd_cpt_stats *ccs = &cli->cl_cpt_stats[i];
+
+		seq_printf(m, "- { cpt: %d, read_rpcs: %ld, read_pages: %ld, "
+			   "read_local: %ld, write_rpcs: %ld, write_pages: %ld, "
+			   "write_local: %ld }\n", i,
+			   atomic_long_read(&ccs->ccs_read_rpcs),
+			   atomic_long_read(&ccs->ccs_read_pages),
+			   atomic_long_read(&ccs->ccs_read_local),
+			   atomic_long_read(&ccs->ccs_write_rpcs),
+			   atomic_long_read(&ccs->ccs_write_pages),
+			   atomic_long_read(&ccs->ccs_write_local));
+	}
+	return 0;
+}
+
+static ssize_t osc_cpt_stats_seq_write(struct file *file,
+				       const char __user *buffer,
+				       size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct obd_device *obd = m->private;
+	struct client_obd *cli = &obd->u.cli;
+	int i;
+
+	if (cli->cl_cpt_stats == NULL)
+		return count;
+
+	for (i = 0; i < cfs_cpt_number(cfs_cpt_tab); i++) {
+		struct client_obd_cpt_stats *ccs = &cli->cl_cpt_stats[i];
+
+		atomic_long_set(&ccs->ccs_read_rpcs, 0);
+		atomic_long_set(&ccs->ccs_read_pages, 0);
+		atomic_long_set(&ccs->ccs_read_local, 0);
+		atomic_long_set(&ccs->ccs_write_rpcs, 0);
+		atomic_long_set(&ccs->ccs_write_pages, 0);
+		atomic_long_set(&ccs->ccs_write_local, 0);
+	}
+	return count;
+}
+LPROC_SEQ_FOPS(osc_cpt_stats);
+
 LPROC_SEQ_FOPS_RO_TYPE(osc, connect_flags);
 LPROC_SEQ_FOPS_RO_TYPE(osc, server_uuid);
 LPROC_SEQ_FOPS_RO_TYPE(osc, timeouts);
@@ -770,6 +854,8 @@ struct lprocfs_vars lprocfs_osc_obd_vars[] = {
 	  .fops	=	&osc_pinger_recov_fops		},
 	{ .name	=	"unstable_stats",
 	  .fops	=	&osc_unstable_stats_fops	},
+	{ .name	=	"cpt_stats",
+	  .fops	=	&osc_cpt_stats_fops		},
 	{ NULL }
 };
 
@@ -956,6 +1042,7 @@ static struct attribute *osc_attrs[] = {
 	&lustre_attr_idle_timeout.attr,
 	&lustre_attr_idle_connect.attr,
 	&lustre_attr_grant_shrink.attr,
+	&lustre_attr_cpt_affinity.attr,
 	NULL,
 };
 
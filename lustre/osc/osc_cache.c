@@ -336,10 +336,20 @@ static struct osc_extent *osc_extent_alloc(struct osc_object *obj)
 	INIT_LIST_HEAD(&ext->oe_pages);
 	init_waitqueue_head(&ext->oe_waitq);
 	ext->oe_dlmlock = NULL;
+	/* pages of the extent are dirtied or read by the allocating thread */
+	ext->oe_cpt = cfs_cpt_current(cfs_cpt_tab, 1);
 
 	return ext;
 }
 
+/* can pages of @ext and @other be sent in the same RPC? */
+static inline bool osc_extent_cpt_match(const struct osc_extent *ext,
+					const struct osc_extent *other)
+{
+	return !osc_cli(ext->oe_obj)->cl_cpt_affinity ||
+	       ext->oe_cpt == other->oe_cpt;
+}
+
 static void osc_extent_free(struct osc_extent *ext)
 {
 	OBD_SLAB_FREE_PTR(ext, osc_extent_kmem);
@@ -521,6 +531,9 @@ static int osc_extent_merge(const struct lu_env *env, struct osc_extent *cur,
 	if (cur->oe_max_end != victim->oe_max_end)
 		return -ERANGE;
 
+	if (!osc_extent_cpt_match(cur, victim))
+		return -ERANGE;
+
 	LASSERT(cur->oe_dlmlock == victim->oe_dlmlock);
 	ppc_bits = osc_cli(obj)->cl_chunkbits - PAGE_SHIFT;
 	chunk_start = cur->oe_start >> ppc_bits;
@@ -755,6 +768,10 @@ restart:
 		    cli->cl_max_extent_pages)
 			continue;
 
+		/* do not mix pages dirtied on different CPTs */
+		if (!osc_extent_cpt_match(ext, cur))
+			continue;
+
 		/* it's required that an extent must be contiguous at chunk
 		 * level so that we know the whole extent is covered by grant
 		 * (the pages in the extent are NOT required to be contiguous).
@@ -1853,6 +1870,9 @@ can_merge(const struct osc_extent *ext, const struct osc_extent *in_rpc)
 	if (in_rpc->oe_dio && overlapped(ext, in_rpc))
 		return false;
 
+	if (!osc_extent_cpt_match(ext, in_rpc))
+		return false;
+
 	return true;
 }
 
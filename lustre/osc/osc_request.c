@@ -1209,6 +1209,7 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 {
 	int				i = 0;
 	struct ahash_request	       *req;
+	struct obd_cksum_batch		batch;
 	unsigned int			bufsize;
 	unsigned char			cfs_alg = cksum_obd2cfs(cksum_type);
 
@@ -1220,6 +1221,7 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 		       cfs_crypto_hash_name(cfs_alg));
 		return PTR_ERR(req);
 	}
+	obd_cksum_batch_init(&batch, req);
 
 	while (nob > 0 && pg_count > 0) {
 		unsigned int count = pga[i]->count > nob ? nob : pga[i]->count;
@@ -1234,9 +1236,8 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 			memcpy(ptr + off, "bad1", min_t(typeof(nob), 4, nob));
 			kunmap(pga[i]->pg);
 		}
-		cfs_crypto_hash_update_page(req, pga[i]->pg,
-					    pga[i]->off & ~PAGE_MASK,
-					    count);
+		obd_cksum_batch_add_page(&batch, pga[i]->pg,
+					 pga[i]->off & ~PAGE_MASK, count);
 		LL_CDEBUG_PAGE(D_PAGE, pga[i]->pg, "off %d\n",
 			       (int)(pga[i]->off & ~PAGE_MASK));
 
@@ -1244,6 +1245,7 @@ static int osc_checksum_bulk(int nob, size_t pg_count,
 		pg_count--;
 		i++;
 	}
+	obd_cksum_batch_flush(&batch);
 
 	bufsize = sizeof(*cksum);
 	cfs_crypto_hash_final(req, (unsigned char *)cksum, &bufsize);
@@ -1542,6 +1544,7 @@ no_bulk:
 	aa->aa_resends = 0;
 	aa->aa_ppga = pga;
 	aa->aa_cli = cli;
+	aa->aa_cpt = CFS_CPT_ANY;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 
 	*reqp = req;
@@ -1910,6 +1913,20 @@ out:
 	RETURN(rc);
 }
 
+/**
+ * Queue a BRW request to ptlrpcd.  With cpt_affinity enabled the request
+ * is handled by a ptlrpcd thread on the CPT its pages were dirtied on, so
+ * the bulk is set up and completed next to the memory it transfers.
+ */
+static void osc_brw_queue_req(struct client_obd *cli,
+			      struct ptlrpc_request *req, int cpt)
+{
+	if (cli->cl_cpt_affinity && cpt != CFS_CPT_ANY)
+		ptlrpcd_add_req_cpt(req, cpt);
+	else
+		ptlrpcd_add_req(req);
+}
+
 static int osc_brw_redo_request(struct ptlrpc_request *request,
 				struct osc_brw_async_args *aa, int rc)
 {
@@ -1960,6 +1977,7 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 	INIT_LIST_HEAD(&new_aa->aa_exts);
 	list_splice_init(&aa->aa_exts, &new_aa->aa_exts);
 	new_aa->aa_resends = aa->aa_resends;
+	new_aa->aa_cpt = aa->aa_cpt;
 
 	list_for_each_entry(oap, &new_aa->aa_oaps, oap_rpc_item) {
                 if (oap->oap_request) {
@@ -1972,7 +1990,7 @@ static int osc_brw_redo_request(struct ptlrpc_request *request,
 	 * to add a series of BRW RPCs into a self-defined ptlrpc_request_set
 	 * and wait for all of them to be finished. We should inherit request
 	 * set from old request. */
-	ptlrpcd_add_req(new_req);
+	osc_brw_queue_req(aa->aa_cli, new_req, aa->aa_cpt);
 
 	DEBUG_REQ(D_INFO, new_req, "new request");
 	RETURN(0);
@@ -2055,6 +2073,26 @@ static int brw_interpret(const struct lu_env *env,
 			rc = -EIO;
 	}
 
+	if (cli->cl_cpt_stats != NULL && aa->aa_cpt >= 0 &&
+	    aa->aa_cpt < cfs_cpt_number(cfs_cpt_tab)) {
+		struct client_obd_cpt_stats *ccs = &cli->cl_cpt_stats[aa->aa_cpt];
+		bool local = cfs_cpt_current(cfs_cpt_tab, 1) == aa->aa_cpt;
+
+		if (lustre_msg_get_opc(req->rq_reqmsg) == OST_WRITE) {
+			atomic_long_inc(&ccs->ccs_write_rpcs);
+			atomic_long_add(aa->aa_page_count,
+					&ccs->ccs_write_pages);
+			if (local)
+				atomic_long_inc(&ccs->ccs_write_local);
+		} else {
+			atomic_long_inc(&ccs->ccs_read_rpcs);
+			atomic_long_add(aa->aa_page_count,
+					&ccs->ccs_read_pages);
+			if (local)
+				atomic_long_inc(&ccs->ccs_read_local);
+		}
+	}
+
 	if (rc == 0) {
 		struct obdo *oa = aa->aa_oa;
 		struct cl_attr *attr = &osc_env_info(env)->oti_attr;
@@ -2185,6 +2223,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	bool				ndelay = false;
 	int				i;
 	int				grant = 0;
+	int				cpt = CFS_CPT_ANY;
 	int				rc;
 	__u32				layout_version = 0;
 	LIST_HEAD(rpc_list);
@@ -2199,8 +2238,10 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		grant += ext->oe_grants;
 		page_count += ext->oe_nr_pages;
 		layout_version = max(layout_version, ext->oe_layout_version);
-		if (obj == NULL)
+		if (obj == NULL) {
 			obj = ext->oe_obj;
+			cpt = ext->oe_cpt;
+		}
 	}
 
 	soft_sync = osc_over_unstable_soft_limit(cli);
@@ -2295,6 +2336,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 	lustre_msg_set_jobid(req->rq_reqmsg, crattr->cra_jobid);
 
 	aa = ptlrpc_req_async_args(aa, req);
+	aa->aa_cpt = cpt;
 	INIT_LIST_HEAD(&aa->aa_oaps);
 	list_splice_init(&rpc_list, &aa->aa_oaps);
 	INIT_LIST_HEAD(&aa->aa_exts);
@@ -2322,7 +2364,7 @@ int osc_build_rpc(const struct lu_env *env, struct client_obd *cli,
 		  cli->cl_w_in_flight);
 	OBD_FAIL_TIMEOUT(OBD_FAIL_OSC_DELAY_IO, cfs_fail_val);
 
-	ptlrpcd_add_req(req);
+	osc_brw_queue_req(cli, req, cpt);
 	rc = 0;
 	EXIT;
 
@@ -3184,6 +3226,13 @@ int osc_setup_common(struct obd_device *obd, struct lustre_cfg *lcfg)
 	if (rc)
 		GOTO(out_ptlrpcd_work, rc);
 
+	OBD_ALLOC(cli->cl_cpt_stats,
+		  cfs_cpt_number(cfs_cpt_tab) * sizeof(*cli->cl_cpt_stats));
+	if (cli->cl_cpt_stats == NULL) {
+		osc_quota_cleanup(obd);
+		GOTO(out_ptlrpcd_work, rc = -ENOMEM);
+	}
+
 	cli->cl_grant_shrink_interval = GRANT_SHRINK_INTERVAL;
 	osc_update_next_shrink(cli);
 
@@ -3314,6 +3363,12 @@ int osc_cleanup_common(struct obd_device *obd)
 	/* free memory of osc quota cache */
 	osc_quota_cleanup(obd);
 
+	if (cli->cl_cpt_stats != NULL) {
+		OBD_FREE(cli->cl_cpt_stats, cfs_cpt_number(cfs_cpt_tab) *
+					    sizeof(*cli->cl_cpt_stats));
+		cli->cl_cpt_stats = NULL;
+	}
+
 	rc = client_obd_cleanup(obd);
 
 	ptlrpcd_decref();
@@ -352,6 +352,22 @@ static const struct req_msg_field *mds_rmfid_server[] = {
 	&RMF_RCS,
 };
 
+static const struct req_msg_field *mds_batch_getattr_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_MDT_BODY,
+	&RMF_FID_ARRAY,
+	&RMF_CAPA1,
+	&RMF_CAPA2,
+};
+
+static const struct req_msg_field *mds_batch_getattr_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_MDT_BODY,
+	&RMF_RCS,
+	&RMF_MDT_BODY_ARRAY,
+	&RMF_MDT_MD,
+};
+
 static const struct req_msg_field *obd_connect_client[] = {
 	&RMF_PTLRPC_BODY,
 	&RMF_TGTUUID,
@@ -405,6 +421,17 @@ static const struct req_msg_field *ldlm_enqueue_lvb_server[] = {
         &RMF_DLM_LVB
 };
 
+static const struct req_msg_field *ldlm_bl_callback_batch_client[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ,
+	&RMF_DLM_BL_DESCS
+};
+
+static const struct req_msg_field *ldlm_bl_callback_batch_server[] = {
+	&RMF_PTLRPC_BODY,
+	&RMF_DLM_REQ
+};
+
 static const struct req_msg_field *ldlm_cp_callback_client[] = {
         &RMF_PTLRPC_BODY,
         &RMF_DLM_REQ,
@@ -800,6 +827,7 @@ static struct req_format *req_formats[] = {
 	&RQF_MDS_HSM_REQUEST,
 	&RQF_MDS_SWAP_LAYOUTS,
 	&RQF_MDS_RMFID,
+	&RQF_MDS_BATCH_GETATTR,
 	&RQF_OUT_UPDATE,
 	&RQF_OST_CONNECT,
 	&RQF_OST_DISCONNECT,
@@ -827,6 +855,7 @@ static struct req_format *req_formats[] = {
 	&RQF_LDLM_CALLBACK,
 	&RQF_LDLM_CP_CALLBACK,
 	&RQF_LDLM_BL_CALLBACK,
+	&RQF_LDLM_BL_CALLBACK_BATCH,
 	&RQF_LDLM_GL_CALLBACK,
 	&RQF_LDLM_GL_CALLBACK_DESC,
 	&RQF_LDLM_INTENT,
@@ -985,6 +1014,11 @@ struct req_msg_field RMF_MDT_BODY =
                     sizeof(struct mdt_body), lustre_swab_mdt_body, NULL);
 EXPORT_SYMBOL(RMF_MDT_BODY);
 
+struct req_msg_field RMF_MDT_BODY_ARRAY =
+	DEFINE_MSGF("mdt_body_array", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct mdt_body), lustre_swab_mdt_body, NULL);
+EXPORT_SYMBOL(RMF_MDT_BODY_ARRAY);
+
 struct req_msg_field RMF_OBD_QUOTACTL =
         DEFINE_MSGF("obd_quotactl", 0,
                     sizeof(struct obd_quotactl),
@@ -1107,6 +1141,13 @@ struct req_msg_field RMF_DLM_LVB =
 	DEFINE_MSGF("dlm_lvb", 0, -1, NULL, NULL);
 EXPORT_SYMBOL(RMF_DLM_LVB);
 
+/* lock descriptors of a multi-lock blocking AST, one per lock_handle[] */
+struct req_msg_field RMF_DLM_BL_DESCS =
+	DEFINE_MSGF("dlm_bl_descs", RMF_F_STRUCT_ARRAY,
+		    sizeof(struct ldlm_lock_desc), lustre_swab_ldlm_lock_desc,
+		    NULL);
+EXPORT_SYMBOL(RMF_DLM_BL_DESCS);
+
 struct req_msg_field RMF_DLM_GL_DESC =
 	DEFINE_MSGF("dlm_gl_desc", 0, sizeof(union ldlm_gl_desc), NULL, NULL);
 EXPORT_SYMBOL(RMF_DLM_GL_DESC);
@@ -1561,6 +1602,11 @@ struct req_format RQF_LDLM_BL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_enqueue_client, empty);
 EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK);
 
+struct req_format RQF_LDLM_BL_CALLBACK_BATCH =
+	DEFINE_REQ_FMT0("LDLM_BL_CALLBACK", ldlm_bl_callback_batch_client,
+			ldlm_bl_callback_batch_server);
+EXPORT_SYMBOL(RQF_LDLM_BL_CALLBACK_BATCH);
+
 struct req_format RQF_LDLM_GL_CALLBACK =
         DEFINE_REQ_FMT0("LDLM_GL_CALLBACK", ldlm_enqueue_client,
                         ldlm_gl_callback_server);
@@ -1661,6 +1707,11 @@ struct req_format RQF_MDS_RMFID =
 			mds_rmfid_server);
 EXPORT_SYMBOL(RQF_MDS_RMFID);
 
+struct req_format RQF_MDS_BATCH_GETATTR =
+	DEFINE_REQ_FMT0("MDS_BATCH_GETATTR", mds_batch_getattr_client,
+			mds_batch_getattr_server);
+EXPORT_SYMBOL(RQF_MDS_BATCH_GETATTR);
+
 struct req_format RQF_LLOG_ORIGIN_HANDLE_CREATE =
         DEFINE_REQ_FMT0("LLOG_ORIGIN_HANDLE_CREATE",
                         llog_origin_handle_create_client, llogd_body_only);
@@ -97,6 +97,7 @@ static struct ll_rpc_opcode {
 	{ MDS_HSM_CT_UNREGISTER, "mds_hsm_ct_unregister" },
 	{ MDS_SWAP_LAYOUTS,	"mds_swap_layouts" },
 	{ MDS_RMFID,        "mds_rmfid" },
+	{ MDS_BATCH_GETATTR, "mds_batch_getattr" },
 	{ LDLM_ENQUEUE,     "ldlm_enqueue" },
 	{ LDLM_CONVERT,     "ldlm_convert" },
 	{ LDLM_CANCEL,      "ldlm_cancel" },
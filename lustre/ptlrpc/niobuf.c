@@ -201,7 +201,9 @@ int ptlrpc_start_bulk_transfer(struct ptlrpc_bulk_desc *desc)
 	md.threshold = 2; /* SENT and ACK/REPLY */
 
 	for (posted_md = 0; posted_md < total_md; mbits++) {
-		md.options = PTLRPC_MD_OPTIONS;
+		/* the MDs are matched by mbits whichever NIs they use, let
+		 * LNet spread them across the rails to a Multi-Rail peer */
+		md.options = PTLRPC_MD_OPTIONS | LNET_MD_MR_STRIPE;
 
 		/* NB it's assumed that source and sink buffer frags are
 		 * page-aligned. Otherwise we'd have to send client bulk
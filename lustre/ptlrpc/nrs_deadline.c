@@ -0,0 +1,980 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License version 2 for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * lustre/ptlrpc/nrs_deadline.c
+ *
+ * Network Request Scheduler (NRS) Deadline policy
+ *
+ * This policy handles requests in earliest deadline first order, so that
+ * latency sensitive requests are not stuck behind a flood of bulk requests
+ * which can afford to wait.
+ */
+/**
+ * \addtogoup nrs
+ * @{
+ */
+
+#define DEBUG_SUBSYSTEM S_RPC
+
+#include <obd_support.h>
+#include <obd_class.h>
+#include "ptlrpc_internal.h"
+
+/**
+ * \name deadline
+ *
+ * Each request is given a deadline upon enqueue. Requests matching one of
+ * the administrator-defined classes (by uid or jobid) are due a fixed number
+ * of milliseconds after their arrival; all other requests are due when the
+ * client would time them out, as derived from adaptive timeouts.
+ *
+ * Requests are handled in deadline order, except that when the oldest queued
+ * request has waited for longer than the maximum wait time, every other
+ * dispatch serves requests in arrival order instead, so that requests with
+ * distant deadlines make progress while keeping at least half of the
+ * service threads for the requests which are due first.
+ *
+ * @{
+ */
+
+#define NRS_POL_NAME_DEADLINE	"deadline"
+
+/* Default maximum wait before starvation protection kicks in, in ms. */
+#define NRS_DEADLINE_MAX_WAIT_DEFAULT	1000
+
+/**
+ * Binary heap predicate.
+ *
+ * Elements are sorted according to the deadline assigned to the requests
+ * upon enqueue, and by their order of arrival for identical deadlines.
+ *
+ * \retval 0 e1 is due after e2
+ * \retval 1 e1 is due before or together with e2
+ */
+static int deadline_req_compare(struct cfs_binheap_node *e1,
+				struct cfs_binheap_node *e2)
+{
+	struct nrs_deadline_req *dr1;
+	struct nrs_deadline_req *dr2;
+
+	dr1 = &container_of(e1, struct ptlrpc_nrs_request,
+			    nr_node)->nr_u.deadline;
+	dr2 = &container_of(e2, struct ptlrpc_nrs_request,
+			    nr_node)->nr_u.deadline;
+
+	if (dr1->dr_deadline != dr2->dr_deadline)
+		return dr1->dr_deadline < dr2->dr_deadline;
+
+	return dr1->dr_sequence <= dr2->dr_sequence;
+}
+
+static struct cfs_binheap_ops nrs_deadline_heap_ops = {
+	.hop_enter	= NULL,
+	.hop_exit	= NULL,
+	.hop_compare	= deadline_req_compare,
+};
+
+static inline u64 nrs_deadline_arrival(struct ptlrpc_nrs_request *nrq)
+{
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+
+	return timespec64_to_ns(&req->rq_arrival_time);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STARTED; allocates and initializes
+ * the deadline-specific private data structure.
+ *
+ * \param[in] policy The policy to start
+ * \param[in] Generic char buffer; unused in this policy
+ *
+ * \retval -ENOMEM OOM error
+ * \retval  0	   success
+ *
+ * \see nrs_policy_register()
+ * \see nrs_policy_ctl()
+ */
+static int nrs_deadline_start(struct ptlrpc_nrs_policy *policy, char *arg)
+{
+	struct nrs_deadline_data *dd;
+
+	ENTRY;
+
+	OBD_CPT_ALLOC_PTR(dd, nrs_pol2cptab(policy), nrs_pol2cptid(policy));
+	if (dd == NULL)
+		RETURN(-ENOMEM);
+
+	dd->dd_binheap = cfs_binheap_create(&nrs_deadline_heap_ops,
+					    CBH_FLAG_ATOMIC_GROW, 4096, NULL,
+					    nrs_pol2cptab(policy),
+					    nrs_pol2cptid(policy));
+	if (dd->dd_binheap == NULL) {
+		OBD_FREE_PTR(dd);
+		RETURN(-ENOMEM);
+	}
+
+	INIT_LIST_HEAD(&dd->dd_fifo);
+	spin_lock_init(&dd->dd_lock);
+	dd->dd_max_wait = NRS_DEADLINE_MAX_WAIT_DEFAULT;
+
+	policy->pol_private = dd;
+
+	RETURN(0);
+}
+
+/**
+ * Is called before the policy transitions into
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED; deallocates the
+ * deadline-specific private data structure.
+ *
+ * \param[in] policy The policy to stop
+ *
+ * \see nrs_policy_stop0()
+ */
+static void nrs_deadline_stop(struct ptlrpc_nrs_policy *policy)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+
+	LASSERT(dd != NULL);
+	LASSERT(dd->dd_binheap != NULL);
+	LASSERT(cfs_binheap_is_empty(dd->dd_binheap));
+	LASSERT(list_empty(&dd->dd_fifo));
+
+	cfs_binheap_destroy(dd->dd_binheap);
+
+	OBD_FREE_PTR(dd);
+}
+
+/**
+ * Is called for obtaining a deadline policy resource.
+ *
+ * \param[in]  policy	  The policy on which the request is being asked for
+ * \param[in]  nrq	  The request for which resources are being taken
+ * \param[in]  parent	  Parent resource, unused in this policy
+ * \param[out] resp	  Resources references are placed in this array
+ * \param[in]  moving_req Signifies limited caller context; unused in this
+ *			  policy
+ *
+ * \retval 1 The deadline policy only has a one-level resource hierarchy
+ *
+ * \see nrs_resource_get_safe()
+ */
+static int nrs_deadline_res_get(struct ptlrpc_nrs_policy *policy,
+				struct ptlrpc_nrs_request *nrq,
+				const struct ptlrpc_nrs_resource *parent,
+				struct ptlrpc_nrs_resource **resp,
+				bool moving_req)
+{
+	*resp = &((struct nrs_deadline_data *)policy->pol_private)->dd_res;
+	return 1;
+}
+
+/**
+ * Called when getting a request from the deadline policy for handling, or
+ * just peeking; removes the request from the policy when it is to be
+ * handled.
+ *
+ * The request with the earliest deadline is returned, unless the oldest
+ * queued request has waited for longer than nrs_deadline_data::dd_max_wait
+ * and the previous request was not itself picked by starvation protection.
+ *
+ * \param[in] policy The policy
+ * \param[in] peek   When set, signifies that we just want to examine the
+ *		     request, and not handle it, so the request is not removed
+ *		     from the policy.
+ * \param[in] force  Force the policy to return a request; unused in this
+ *		     policy
+ *
+ * \retval The request to be handled
+ * \retval NULL no request available
+ *
+ * \see ptlrpc_nrs_req_get_nolock()
+ * \see nrs_request_get()
+ */
+static
+struct ptlrpc_nrs_request *nrs_deadline_req_get(struct ptlrpc_nrs_policy *policy,
+						bool peek, bool force)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+	struct ptlrpc_nrs_request *nrq;
+	struct ptlrpc_nrs_request *oldest;
+	struct nrs_deadline_class_stats *dcs;
+	struct cfs_binheap_node *node;
+	bool starved = false;
+	u64 now;
+	u64 wait;
+
+	node = cfs_binheap_root(dd->dd_binheap);
+	if (unlikely(node == NULL))
+		return NULL;
+
+	nrq = container_of(node, struct ptlrpc_nrs_request, nr_node);
+	now = ktime_get_real_ns();
+
+	if (!dd->dd_last_starved && dd->dd_max_wait != 0) {
+		oldest = list_first_entry(&dd->dd_fifo,
+					  struct ptlrpc_nrs_request,
+					  nr_u.deadline.dr_list);
+		if (oldest != nrq &&
+		    now > nrs_deadline_arrival(oldest) +
+			  (u64)dd->dd_max_wait * NSEC_PER_MSEC) {
+			nrq = oldest;
+			starved = true;
+		}
+	}
+
+	if (peek)
+		return nrq;
+
+	cfs_binheap_remove(dd->dd_binheap, &nrq->nr_node);
+	list_del_init(&nrq->nr_u.deadline.dr_list);
+	dd->dd_last_starved = starved;
+
+	wait = now > nrs_deadline_arrival(nrq) ?
+	       (now - nrs_deadline_arrival(nrq)) / NSEC_PER_USEC : 0;
+
+	spin_lock(&dd->dd_lock);
+	dcs = &dd->dd_stats[nrq->nr_u.deadline.dr_class];
+	dcs->dcs_requests++;
+	dcs->dcs_wait_sum += wait;
+	if (wait > dcs->dcs_wait_max)
+		dcs->dcs_wait_max = wait;
+	if (starved)
+		dcs->dcs_starved++;
+	spin_unlock(&dd->dd_lock);
+
+	return nrq;
+}
+
+static bool nrs_deadline_jobid_match(const char *pattern, const char *jobid)
+{
+	size_t len = strlen(pattern);
+
+	if (len > 0 && pattern[len - 1] == '*')
+		return strncmp(pattern, jobid, len - 1) == 0;
+
+	return strcmp(pattern, jobid) == 0;
+}
+
+/**
+ * Finds the first class matching \a req.
+ *
+ * \param[in] dd	policy private data
+ * \param[in] req	the request to classify
+ * \param[in] id	the request uid, or NULL if it could not be found
+ *
+ * \retval index of the matched class, or NRS_DL_CLASS_DEFAULT
+ */
+static unsigned int nrs_deadline_classify(struct nrs_deadline_data *dd,
+					  struct ptlrpc_request *req,
+					  struct tbf_id *id)
+{
+	const char *jobid = lustre_msg_get_jobid(req->rq_reqmsg);
+	unsigned int i;
+
+	assert_spin_locked(&dd->dd_lock);
+
+	for (i = 0; i < NRS_DL_CLASS_MAX; i++) {
+		struct nrs_deadline_class *dc = &dd->dd_classes[i];
+
+		switch (dc->dc_type) {
+		case NRS_DL_CLASS_UNUSED:
+			break;
+		case NRS_DL_CLASS_UID:
+			if (id != NULL && id->ti_uid == dc->dc_uid)
+				return i;
+			break;
+		case NRS_DL_CLASS_JOBID:
+			if (jobid != NULL &&
+			    nrs_deadline_jobid_match(dc->dc_jobid, jobid))
+				return i;
+			break;
+		}
+	}
+
+	return NRS_DL_CLASS_DEFAULT;
+}
+
+/**
+ * Adds request \a nrq to a deadline \a policy instance's set of queued
+ * requests.
+ *
+ * The deadline of the request is its arrival time plus the target latency of
+ * its class, or the time at which the client times it out if it matches no
+ * class, or has no timeout set.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to add
+ *
+ * \retval 0 request added
+ * \retval != 0 request not added
+ */
+static int nrs_deadline_req_add(struct ptlrpc_nrs_policy *policy,
+				struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+	struct nrs_deadline_req *dr = &nrq->nr_u.deadline;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	u64 arrival = nrs_deadline_arrival(nrq);
+	struct tbf_id id;
+	bool id_valid = false;
+	__u32 target = 0;
+	int rc;
+
+	/* only unpack the request body when it can make a difference */
+	if (dd->dd_nr_uid_classes > 0)
+		id_valid = nrs_tbf_id_cli_set(req, &id, NRS_TBF_FLAG_UID) == 0;
+
+	spin_lock(&dd->dd_lock);
+	dr->dr_class = nrs_deadline_classify(dd, req, id_valid ? &id : NULL);
+	if (dr->dr_class != NRS_DL_CLASS_DEFAULT)
+		target = dd->dd_classes[dr->dr_class].dc_target_ms;
+	spin_unlock(&dd->dd_lock);
+
+	if (target != 0)
+		dr->dr_deadline = arrival + (u64)target * NSEC_PER_MSEC;
+	else if (req->rq_deadline > req->rq_arrival_time.tv_sec)
+		dr->dr_deadline = (u64)req->rq_deadline * NSEC_PER_SEC;
+	else
+		dr->dr_deadline = arrival +
+				  (u64)dd->dd_max_wait * NSEC_PER_MSEC;
+	dr->dr_sequence = dd->dd_sequence++;
+
+	rc = cfs_binheap_insert(dd->dd_binheap, &nrq->nr_node);
+	if (rc == 0)
+		list_add_tail(&dr->dr_list, &dd->dd_fifo);
+
+	return rc;
+}
+
+/**
+ * Removes request \a nrq from \a policy's list of queued requests.
+ *
+ * \param[in] policy The policy
+ * \param[in] nrq    The request to remove
+ */
+static void nrs_deadline_req_del(struct ptlrpc_nrs_policy *policy,
+				 struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+
+	cfs_binheap_remove(dd->dd_binheap, &nrq->nr_node);
+	list_del_init(&nrq->nr_u.deadline.dr_list);
+}
+
+/**
+ * Accounts requests which are finished after their deadline.
+ *
+ * \param[in] policy The policy handling the request
+ * \param[in] nrq    The request being handled
+ *
+ * \see ptlrpc_server_finish_request()
+ * \see ptlrpc_nrs_req_stop_nolock()
+ */
+static void nrs_deadline_req_stop(struct ptlrpc_nrs_policy *policy,
+				  struct ptlrpc_nrs_request *nrq)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+	struct ptlrpc_request *req = container_of(nrq, struct ptlrpc_request,
+						  rq_nrq);
+	u64 now = ktime_get_real_ns();
+
+	if (now <= nrq->nr_u.deadline.dr_deadline)
+		return;
+
+	spin_lock(&dd->dd_lock);
+	dd->dd_stats[nrq->nr_u.deadline.dr_class].dcs_missed++;
+	spin_unlock(&dd->dd_lock);
+
+	DEBUG_REQ(D_RPCTRACE, req,
+		  "NRS: finished request from %s %lluus after its deadline",
+		  libcfs_id2str(req->rq_peer),
+		  (now - nrq->nr_u.deadline.dr_deadline) / NSEC_PER_USEC);
+}
+
+static int nrs_deadline_class_find(struct nrs_deadline_data *dd,
+				   const char *name)
+{
+	int i;
+
+	for (i = 0; i < NRS_DL_CLASS_MAX; i++)
+		if (dd->dd_classes[i].dc_type != NRS_DL_CLASS_UNUSED &&
+		    strcmp(dd->dd_classes[i].dc_name, name) == 0)
+			return i;
+
+	return -ENOENT;
+}
+
+static int nrs_deadline_class_set(struct nrs_deadline_data *dd,
+				  struct nrs_deadline_class_cmd *cmd)
+{
+	struct nrs_deadline_class *dc = &cmd->dcc_class;
+	int i;
+
+	spin_lock(&dd->dd_lock);
+	i = nrs_deadline_class_find(dd, dc->dc_name);
+	if (!cmd->dcc_start) {
+		if (i < 0)
+			GOTO(out, i);
+	} else if (i < 0) {
+		/* a new class, find it a free slot */
+		for (i = 0; i < NRS_DL_CLASS_MAX; i++)
+			if (dd->dd_classes[i].dc_type == NRS_DL_CLASS_UNUSED)
+				break;
+		if (i == NRS_DL_CLASS_MAX)
+			GOTO(out, i = -ENOSPC);
+		memset(&dd->dd_stats[i], 0, sizeof(dd->dd_stats[i]));
+	}
+
+	if (dd->dd_classes[i].dc_type == NRS_DL_CLASS_UID)
+		dd->dd_nr_uid_classes--;
+
+	if (cmd->dcc_start)
+		dd->dd_classes[i] = *dc;
+	else
+		memset(&dd->dd_classes[i], 0, sizeof(dd->dd_classes[i]));
+
+	if (dd->dd_classes[i].dc_type == NRS_DL_CLASS_UID)
+		dd->dd_nr_uid_classes++;
+	i = 0;
+out:
+	spin_unlock(&dd->dd_lock);
+
+	return i;
+}
+
+/**
+ * Performs ctl functions specific to deadline policy instances; similar to
+ * ioctl
+ *
+ * \param[in]	  policy the policy instance
+ * \param[in]	  opc	 the opcode
+ * \param[in,out] arg	 used for passing parameters and information
+ *
+ * \pre assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ * \post assert_spin_locked(&policy->pol_nrs->->nrs_lock)
+ *
+ * \retval 0   operation carried out successfully
+ * \retval -ve error
+ */
+static int nrs_deadline_ctl(struct ptlrpc_nrs_policy *policy,
+			    enum ptlrpc_nrs_ctl opc, void *arg)
+{
+	struct nrs_deadline_data *dd = policy->pol_private;
+
+	assert_spin_locked(&policy->pol_nrs->nrs_lock);
+
+	switch ((enum nrs_ctl_deadline)opc) {
+	default:
+		RETURN(-EINVAL);
+
+	case NRS_CTL_DEADLINE_RD_MAX_WAIT:
+		*(__u32 *)arg = dd->dd_max_wait;
+		break;
+
+	case NRS_CTL_DEADLINE_WR_MAX_WAIT:
+		dd->dd_max_wait = *(__u32 *)arg;
+		break;
+
+	case NRS_CTL_DEADLINE_WR_CLASS:
+		RETURN(nrs_deadline_class_set(dd, arg));
+
+	case NRS_CTL_DEADLINE_RD_STATS: {
+		struct nrs_deadline_stats *ds = arg;
+		int i;
+
+		spin_lock(&dd->dd_lock);
+		memcpy(ds->ds_classes, dd->dd_classes, sizeof(ds->ds_classes));
+		for (i = 0; i <= NRS_DL_CLASS_MAX; i++) {
+			struct nrs_deadline_class_stats *src = &dd->dd_stats[i];
+			struct nrs_deadline_class_stats *dst = &ds->ds_stats[i];
+
+			dst->dcs_requests += src->dcs_requests;
+			dst->dcs_wait_sum += src->dcs_wait_sum;
+			dst->dcs_wait_max = max(dst->dcs_wait_max,
+						src->dcs_wait_max);
+			dst->dcs_missed += src->dcs_missed;
+			dst->dcs_starved += src->dcs_starved;
+		}
+		spin_unlock(&dd->dd_lock);
+		break;
+	}
+
+	case NRS_CTL_DEADLINE_CLEAR_STATS:
+		spin_lock(&dd->dd_lock);
+		memset(dd->dd_stats, 0, sizeof(dd->dd_stats));
+		spin_unlock(&dd->dd_lock);
+		break;
+	}
+	RETURN(0);
+}
+
+/**
+ * debugfs interface
+ */
+
+/* nrs_deadline_max_wait is bounded by this value, in milliseconds */
+#define LPROCFS_NRS_DEADLINE_MAX_WAIT_UPPER_BOUND	600000
+
+#define LPROCFS_NRS_DEADLINE_MAX_WAIT_NAME_REG		"reg_max_wait:"
+#define LPROCFS_NRS_DEADLINE_MAX_WAIT_NAME_HP		"hp_max_wait:"
+
+/**
+ * Retrieves the maximum wait before starvation protection, in milliseconds,
+ * of deadline policy instances on both the regular and high-priority NRS
+ * head of a service, as long as a policy instance is not in the
+ * ptlrpc_nrs_pol_state::NRS_POL_STATE_STOPPED state.
+ */
+static int
+ptlrpc_lprocfs_nrs_deadline_max_wait_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	__u32 max_wait;
+	int rc;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_REG,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_RD_MAX_WAIT,
+				       true, &max_wait);
+	if (rc == 0)
+		seq_printf(m, LPROCFS_NRS_DEADLINE_MAX_WAIT_NAME_REG"%u\n",
+			   max_wait);
+	else if (rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	rc = ptlrpc_nrs_policy_control(svc, PTLRPC_NRS_QUEUE_HP,
+				       NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_RD_MAX_WAIT,
+				       true, &max_wait);
+	if (rc == 0)
+		seq_printf(m, LPROCFS_NRS_DEADLINE_MAX_WAIT_NAME_HP"%u\n",
+			   max_wait);
+	else if (rc == -ENODEV)
+		rc = 0;
+
+	return rc;
+}
+
+/**
+ * Sets the maximum wait, in milliseconds, after which queued requests are
+ * served in arrival order on every other dispatch, for both the regular and
+ * high-priority NRS heads of a service; 0 disables starvation protection.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_deadline_max_wait=500
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_deadline_max_wait_seq_write(struct file *file,
+					       const char __user *buffer,
+					       size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_REG;
+	__u32 max_wait;
+	int rc;
+
+	rc = kstrtouint_from_user(buffer, count, 0, &max_wait);
+	if (rc)
+		return rc;
+
+	if (max_wait > LPROCFS_NRS_DEADLINE_MAX_WAIT_UPPER_BOUND)
+		return -ERANGE;
+
+	if (nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_BOTH;
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_WR_MAX_WAIT, false,
+				       &max_wait);
+
+	return rc ? rc : count;
+}
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_deadline_max_wait);
+
+/**
+ * Reads the class table and the statistics of the policy instances of queue
+ * \a queue, summed over all service partitions.
+ */
+static struct nrs_deadline_stats *
+nrs_deadline_stats_get(struct ptlrpc_service *svc,
+		       enum ptlrpc_nrs_queue_type queue)
+{
+	struct nrs_deadline_stats *ds;
+	int rc;
+
+	OBD_ALLOC_PTR(ds);
+	if (ds == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_RD_STATS, false, ds);
+	if (rc) {
+		OBD_FREE_PTR(ds);
+		return ERR_PTR(rc);
+	}
+
+	return ds;
+}
+
+static void nrs_deadline_class_print(struct seq_file *m,
+				     struct nrs_deadline_class *dc)
+{
+	seq_printf(m, "  - name: %s\n", dc->dc_name);
+	if (dc->dc_type == NRS_DL_CLASS_UID)
+		seq_printf(m, "    uid: %u\n", dc->dc_uid);
+	else
+		seq_printf(m, "    jobid: %s\n", dc->dc_jobid);
+	seq_printf(m, "    target_ms: %u\n", dc->dc_target_ms);
+}
+
+static int nrs_deadline_classes_show(struct seq_file *m,
+				     struct ptlrpc_service *svc,
+				     enum ptlrpc_nrs_queue_type queue)
+{
+	struct nrs_deadline_stats *ds;
+	int i;
+
+	ds = nrs_deadline_stats_get(svc, queue);
+	if (IS_ERR(ds))
+		return PTR_ERR(ds);
+
+	seq_printf(m, "%s:\n", queue == PTLRPC_NRS_QUEUE_HP ?
+		   "high_priority_requests" : "regular_requests");
+	for (i = 0; i < NRS_DL_CLASS_MAX; i++)
+		if (ds->ds_classes[i].dc_type != NRS_DL_CLASS_UNUSED)
+			nrs_deadline_class_print(m, &ds->ds_classes[i]);
+
+	OBD_FREE_PTR(ds);
+
+	return 0;
+}
+
+static int
+ptlrpc_lprocfs_nrs_deadline_classes_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	int rc;
+
+	rc = nrs_deadline_classes_show(m, svc, PTLRPC_NRS_QUEUE_REG);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	rc = nrs_deadline_classes_show(m, svc, PTLRPC_NRS_QUEUE_HP);
+
+	return rc == -ENODEV ? 0 : rc;
+}
+
+/**
+ * Strips the braces around a single class id, as in "uid={500}".
+ */
+static char *nrs_deadline_id_strip(char *id)
+{
+	size_t len = strlen(id);
+
+	if (len >= 2 && id[0] == '{' && id[len - 1] == '}') {
+		id[len - 1] = '\0';
+		id++;
+	}
+
+	return id;
+}
+
+static int nrs_deadline_class_parse(char *buffer,
+				    struct nrs_deadline_class_cmd *cmd)
+{
+	struct nrs_deadline_class *dc = &cmd->dcc_class;
+	char *val = strim(buffer);
+	char *token;
+	char *key;
+	int rc;
+
+	token = strsep(&val, " ");
+	if (strcmp(token, "start") == 0)
+		cmd->dcc_start = true;
+	else if (strcmp(token, "stop") != 0)
+		return -EINVAL;
+
+	token = strsep(&val, " ");
+	if (token == NULL || *token == '\0' ||
+	    strlen(token) >= sizeof(dc->dc_name))
+		return -EINVAL;
+	strlcpy(dc->dc_name, token, sizeof(dc->dc_name));
+
+	if (!cmd->dcc_start)
+		return val == NULL || *val == '\0' ? 0 : -EINVAL;
+
+	while ((token = strsep(&val, " ")) != NULL) {
+		if (*token == '\0')
+			continue;
+
+		key = strsep(&token, "=");
+		if (token == NULL || *token == '\0')
+			return -EINVAL;
+
+		if (strcmp(key, "uid") == 0) {
+			rc = kstrtou32(nrs_deadline_id_strip(token), 10,
+				       &dc->dc_uid);
+			if (rc)
+				return rc;
+			dc->dc_type = NRS_DL_CLASS_UID;
+		} else if (strcmp(key, "jobid") == 0) {
+			token = nrs_deadline_id_strip(token);
+			if (strlen(token) >= sizeof(dc->dc_jobid))
+				return -EINVAL;
+			strlcpy(dc->dc_jobid, token, sizeof(dc->dc_jobid));
+			dc->dc_type = NRS_DL_CLASS_JOBID;
+		} else if (strcmp(key, "target") == 0) {
+			rc = kstrtou32(token, 10, &dc->dc_target_ms);
+			if (rc)
+				return rc;
+		} else {
+			return -EINVAL;
+		}
+	}
+
+	if (dc->dc_type == NRS_DL_CLASS_UNUSED || dc->dc_target_ms == 0 ||
+	    dc->dc_target_ms > LPROCFS_NRS_DEADLINE_MAX_WAIT_UPPER_BOUND)
+		return -EINVAL;
+
+	return 0;
+}
+
+#define LPROCFS_WR_NRS_DEADLINE_MAX_CMD	256
+
+/**
+ * Adds, changes or removes a deadline class on both the regular and
+ * high-priority NRS heads of a service. Requests from a uid, or with a
+ * jobid, of a class are due the class target number of milliseconds after
+ * their arrival. Up to NRS_DL_CLASS_MAX classes can be defined, the first
+ * matching class applies.
+ *
+ * For example:
+ *
+ * lctl set_param ost.OSS.ost_io.nrs_deadline_classes="start interactive uid={500} target=10"
+ * lctl set_param ost.OSS.ost_io.nrs_deadline_classes="start ckpt jobid={ckpt.*} target=5000"
+ * lctl set_param ost.OSS.ost_io.nrs_deadline_classes="stop interactive"
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_deadline_classes_seq_write(struct file *file,
+					      const char __user *buffer,
+					      size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_REG;
+	struct nrs_deadline_class_cmd cmd = { 0 };
+	char *kernbuf;
+	int rc;
+
+	if (count > LPROCFS_WR_NRS_DEADLINE_MAX_CMD - 1)
+		return -EINVAL;
+
+	OBD_ALLOC(kernbuf, LPROCFS_WR_NRS_DEADLINE_MAX_CMD);
+	if (kernbuf == NULL)
+		return -ENOMEM;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		GOTO(out, rc = -EFAULT);
+
+	rc = nrs_deadline_class_parse(kernbuf, &cmd);
+	if (rc)
+		GOTO(out, rc);
+
+	if (nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_BOTH;
+
+	/**
+	 * Serialize NRS core lprocfs operations with policy registration/
+	 * unregistration.
+	 */
+	mutex_lock(&nrs_core.nrs_mutex);
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_WR_CLASS, false, &cmd);
+	mutex_unlock(&nrs_core.nrs_mutex);
+out:
+	OBD_FREE(kernbuf, LPROCFS_WR_NRS_DEADLINE_MAX_CMD);
+
+	return rc ? rc : count;
+}
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_deadline_classes);
+
+static void nrs_deadline_class_stats_print(struct seq_file *m,
+					   const char *name, __u32 target_ms,
+					   struct nrs_deadline_class_stats *dcs)
+{
+	seq_printf(m, "  - class: %s\n", name);
+	seq_printf(m, "    target_ms: %u\n", target_ms);
+	seq_printf(m, "    requests: %llu\n", dcs->dcs_requests);
+	seq_printf(m, "    wait_avg_us: %llu\n", dcs->dcs_requests ?
+		   div64_u64(dcs->dcs_wait_sum, dcs->dcs_requests) : 0);
+	seq_printf(m, "    wait_max_us: %llu\n", dcs->dcs_wait_max);
+	seq_printf(m, "    missed_deadlines: %llu\n", dcs->dcs_missed);
+	seq_printf(m, "    starved: %llu\n", dcs->dcs_starved);
+}
+
+static int nrs_deadline_stats_show(struct seq_file *m,
+				   struct ptlrpc_service *svc,
+				   enum ptlrpc_nrs_queue_type queue)
+{
+	struct nrs_deadline_stats *ds;
+	int i;
+
+	ds = nrs_deadline_stats_get(svc, queue);
+	if (IS_ERR(ds))
+		return PTR_ERR(ds);
+
+	seq_printf(m, "%s:\n", queue == PTLRPC_NRS_QUEUE_HP ?
+		   "high_priority_requests" : "regular_requests");
+	for (i = 0; i < NRS_DL_CLASS_MAX; i++) {
+		struct nrs_deadline_class *dc = &ds->ds_classes[i];
+
+		if (dc->dc_type != NRS_DL_CLASS_UNUSED)
+			nrs_deadline_class_stats_print(m, dc->dc_name,
+						       dc->dc_target_ms,
+						       &ds->ds_stats[i]);
+	}
+	/* requests matching no class are due when the client times out */
+	nrs_deadline_class_stats_print(m, "default", 0,
+				       &ds->ds_stats[NRS_DL_CLASS_DEFAULT]);
+
+	OBD_FREE_PTR(ds);
+
+	return 0;
+}
+
+/**
+ * Shows per-class request counts, queue wait times, missed deadlines and
+ * requests served by starvation protection, summed over the service
+ * partitions of each NRS head of a service.
+ */
+static int
+ptlrpc_lprocfs_nrs_deadline_stats_seq_show(struct seq_file *m, void *data)
+{
+	struct ptlrpc_service *svc = m->private;
+	int rc;
+
+	rc = nrs_deadline_stats_show(m, svc, PTLRPC_NRS_QUEUE_REG);
+	if (rc != 0 && rc != -ENODEV)
+		return rc;
+
+	if (!nrs_svc_has_hp(svc))
+		return 0;
+
+	rc = nrs_deadline_stats_show(m, svc, PTLRPC_NRS_QUEUE_HP);
+
+	return rc == -ENODEV ? 0 : rc;
+}
+
+/**
+ * Writing "clear" resets the statistics of all classes.
+ */
+static ssize_t
+ptlrpc_lprocfs_nrs_deadline_stats_seq_write(struct file *file,
+					    const char __user *buffer,
+					    size_t count, loff_t *off)
+{
+	struct seq_file *m = file->private_data;
+	struct ptlrpc_service *svc = m->private;
+	enum ptlrpc_nrs_queue_type queue = PTLRPC_NRS_QUEUE_REG;
+	char kernbuf[16];
+	int rc;
+
+	if (count > sizeof(kernbuf) - 1)
+		return -EINVAL;
+
+	if (copy_from_user(kernbuf, buffer, count))
+		return -EFAULT;
+	kernbuf[count] = '\0';
+
+	if (strcmp(strim(kernbuf), "clear") != 0)
+		return -EINVAL;
+
+	if (nrs_svc_has_hp(svc))
+		queue = PTLRPC_NRS_QUEUE_BOTH;
+
+	rc = ptlrpc_nrs_policy_control(svc, queue, NRS_POL_NAME_DEADLINE,
+				       NRS_CTL_DEADLINE_CLEAR_STATS, false,
+				       NULL);
+
+	return rc ? rc : count;
+}
+LDEBUGFS_SEQ_FOPS(ptlrpc_lprocfs_nrs_deadline_stats);
+
+static int nrs_deadline_lprocfs_init(struct ptlrpc_service *svc)
+{
+	struct lprocfs_vars nrs_deadline_lprocfs_vars[] = {
+		{ .name		= "nrs_deadline_max_wait",
+		  .fops		= &ptlrpc_lprocfs_nrs_deadline_max_wait_fops,
+		  .data		= svc },
+		{ .name		= "nrs_deadline_classes",
+		  .fops		= &ptlrpc_lprocfs_nrs_deadline_classes_fops,
+		  .data		= svc },
+		{ .name		= "nrs_deadline_stats",
+		  .fops		= &ptlrpc_lprocfs_nrs_deadline_stats_fops,
+		  .data		= svc },
+		{ NULL }
+	};
+
+	if (!svc->srv_debugfs_entry)
+		return 0;
+
+	return ldebugfs_add_vars(svc->srv_debugfs_entry,
+				 nrs_deadline_lprocfs_vars, NULL);
+}
+
+/**
+ * Deadline policy operations
+ */
+static const struct ptlrpc_nrs_pol_ops nrs_deadline_ops = {
+	.op_policy_start	= nrs_deadline_start,
+	.op_policy_stop		= nrs_deadline_stop,
+	.op_policy_ctl		= nrs_deadline_ctl,
+	.op_res_get		= nrs_deadline_res_get,
+	.op_req_get		= nrs_deadline_req_get,
+	.op_req_enqueue		= nrs_deadline_req_add,
+	.op_req_dequeue		= nrs_deadline_req_del,
+	.op_req_stop		= nrs_deadline_req_stop,
+	.op_lprocfs_init	= nrs_deadline_lprocfs_init,
+};
+
+/**
+ * Deadline policy configuration
+ */
+struct ptlrpc_nrs_pol_conf nrs_conf_deadline = {
+	.nc_name		= NRS_POL_NAME_DEADLINE,
+	.nc_ops			= &nrs_deadline_ops,
+	.nc_compat		= nrs_policy_compat_all,
+};
+
+/** @} deadline */
+
+/** @} nrs */
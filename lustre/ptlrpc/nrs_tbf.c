@@ -1589,8 +1589,8 @@ static int ldlm_tbf_id_cli_set(struct ptlrpc_request *req,
 	return 0;
 }
 
-static int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
-			      enum nrs_tbf_flag ti_type)
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type)
 {
 	u32 opc = lustre_msg_get_opc(req->rq_reqmsg);
 	struct req_format *fmt = req_fmt(opc);
@@ -52,8 +52,13 @@ extern struct ptlrpc_nrs_pol_conf nrs_conf_orr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_trr;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_tbf;
 extern struct ptlrpc_nrs_pol_conf nrs_conf_delay;
+extern struct ptlrpc_nrs_pol_conf nrs_conf_deadline;
 #endif /* HAVE_SERVER_SUPPORT */
 
+/* nrs_tbf.c */
+int nrs_tbf_id_cli_set(struct ptlrpc_request *req, struct tbf_id *id,
+		       enum nrs_tbf_flag ti_type);
+
 /**
  * \addtogoup nrs
  * @{
@@ -165,17 +165,21 @@ void ptlrpcd_wake(struct ptlrpc_request *req)
 }
 EXPORT_SYMBOL(ptlrpcd_wake);
 
+/*
+ * Pick a ptlrpcd thread of CPT \a cpt, or of the CPT of the current thread
+ * if \a cpt is CFS_CPT_ANY.
+ */
 static struct ptlrpcd_ctl *
-ptlrpcd_select_pc(struct ptlrpc_request *req)
+ptlrpcd_select_pc(struct ptlrpc_request *req, int cpt)
 {
 	struct ptlrpcd	*pd;
-	int		cpt;
 	int		idx;
 
 	if (req != NULL && req->rq_send_state != LUSTRE_IMP_FULL)
 		return &ptlrpcd_rcv;
 
-	cpt = cfs_cpt_current(cfs_cpt_tab, 1);
+	if (cpt < 0 || cpt >= cfs_cpt_number(cfs_cpt_tab))
+		cpt = cfs_cpt_current(cfs_cpt_tab, 1);
 	if (ptlrpcds_cpt_idx == NULL)
 		idx = cpt;
 	else
@@ -202,7 +206,7 @@ void ptlrpcd_add_rqset(struct ptlrpc_request_set *set)
 	struct ptlrpc_request_set *new;
 	int count, i;
 
-	pc = ptlrpcd_select_pc(NULL);
+	pc = ptlrpcd_select_pc(NULL, CFS_CPT_ANY);
 	new = pc->pc_set;
 
 	list_for_each_safe(pos, tmp, &set->set_requests) {
@@ -264,8 +268,12 @@ static int ptlrpcd_steal_rqset(struct ptlrpc_request_set *des,
 /**
  * Requests that are added to the ptlrpcd queue are sent via
  * ptlrpcd_check->ptlrpc_check_set().
+ *
+ * The request is handled by a ptlrpcd thread of CPT \a cpt, which lets the
+ * caller keep it on the NUMA node its bulk pages live on. CFS_CPT_ANY
+ * picks the CPT of the current thread.
  */
-void ptlrpcd_add_req(struct ptlrpc_request *req)
+void ptlrpcd_add_req_cpt(struct ptlrpc_request *req, int cpt)
 {
 	struct ptlrpcd_ctl *pc;
 
@@ -298,13 +306,19 @@ void ptlrpcd_add_req(struct ptlrpc_request *req)
 		spin_unlock(&req->rq_lock);
 	}
 
-	pc = ptlrpcd_select_pc(req);
+	pc = ptlrpcd_select_pc(req, cpt);
 
 	DEBUG_REQ(D_INFO, req, "add req [%p] to pc [%s+%d]",
 		  req, pc->pc_name, pc->pc_index);
 
 	ptlrpc_set_add_new_req(pc, req);
 }
+EXPORT_SYMBOL(ptlrpcd_add_req_cpt);
+
+void ptlrpcd_add_req(struct ptlrpc_request *req)
+{
+	ptlrpcd_add_req_cpt(req, CFS_CPT_ANY);
+}
 EXPORT_SYMBOL(ptlrpcd_add_req);
 
 static inline void ptlrpc_reqset_get(struct ptlrpc_request_set *set)
@@ -1748,6 +1748,7 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 				 __u32 *cksum)
 {
 	struct ahash_request	       *req;
+	struct obd_cksum_batch		batch;
 	unsigned int			bufsize;
 	int				i, err;
 	unsigned char			cfs_alg = cksum_obd2cfs(cksum_type);
@@ -1758,6 +1759,7 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 		       tgt_name(tgt), cfs_crypto_hash_name(cfs_alg));
 		return PTR_ERR(req);
 	}
+	obd_cksum_batch_init(&batch, req);
 
 	CDEBUG(D_INFO, "Checksum for algo %s\n", cfs_crypto_hash_name(cfs_alg));
 	for (i = 0; i < npages; i++) {
@@ -1781,17 +1783,17 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 				 * display in dump_all_bulk_pages() */
 				np->index = i;
 
-				cfs_crypto_hash_update_page(req, np, off,
-							    len);
+				obd_cksum_batch_add_page(&batch, np, off,
+							 len);
 				continue;
 			} else {
 				CERROR("%s: can't alloc page for corruption\n",
 				       tgt_name(tgt));
 			}
 		}
-		cfs_crypto_hash_update_page(req, local_nb[i].lnb_page,
-				  local_nb[i].lnb_page_offset & ~PAGE_MASK,
-				  local_nb[i].lnb_len);
+		obd_cksum_batch_add_page(&batch, local_nb[i].lnb_page,
+				local_nb[i].lnb_page_offset & ~PAGE_MASK,
+				local_nb[i].lnb_len);
 
 		 /* corrupt the data after we compute the checksum, to
 		 * simulate an OST->client data error */
@@ -1813,8 +1815,8 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 				 * display in dump_all_bulk_pages() */
 				np->index = i;
 
-				cfs_crypto_hash_update_page(req, np, off,
-							    len);
+				obd_cksum_batch_add_page(&batch, np, off,
+							 len);
 				continue;
 			} else {
 				CERROR("%s: can't alloc page for corruption\n",
@@ -1823,6 +1825,8 @@ static int tgt_checksum_niobuf(struct lu_target *tgt,
 		}
 	}
 
+	obd_cksum_batch_flush(&batch);
+
 	bufsize = sizeof(*cksum);
 	err = cfs_crypto_hash_final(req, (unsigned char *)cksum, &bufsize);
 
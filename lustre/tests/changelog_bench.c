@@ -0,0 +1,266 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/tests/changelog_bench.c
+ *
+ * Consume the changelog of an MDT with llapi_changelog_parallel() and an
+ * increasing number of workers, reporting records/sec for each.  Every
+ * record is checked to be processed after all earlier records of the same
+ * target FID, whichever worker they were given to.  A per-record cost can
+ * be simulated to model a real consumer.
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <lustre/lustreapi.h>
+
+#define BENCH_MAX_WORKERS	256
+#define BENCH_MAX_RUNS		32
+#define BENCH_HASH_BITS		16
+#define BENCH_HASH_LOCKS	256
+
+/* last record processed for a target FID */
+struct fid_entry {
+	struct fid_entry	*fe_next;
+	struct lu_fid		 fe_fid;
+	__u64			 fe_index;
+	unsigned int		 fe_worker;
+};
+
+static char *progname;
+static long work_usec;
+static long records;
+static struct fid_entry *fid_hash[1 << BENCH_HASH_BITS];
+static pthread_mutex_t fid_locks[BENCH_HASH_LOCKS];
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"Usage: %s [-u cl_user] [-w usec] [-t threads,...] mdtname\n"
+		"  -u: clear the records for that changelog user on the last run\n"
+		"  -w: simulated processing time per record in usec (default 0)\n"
+		"  -t: comma separated worker counts to run (default 1,2,4,8)\n",
+		progname);
+	exit(out == stderr);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static unsigned int fid_hash_index(const struct lu_fid *fid)
+{
+	__u64 hash = fid->f_seq * 0x9E3779B97F4A7C15ULL ^ fid->f_oid;
+
+	return (hash ^ hash >> 32) & ((1 << BENCH_HASH_BITS) - 1);
+}
+
+static void fid_hash_clear(void)
+{
+	struct fid_entry *fe;
+	int i;
+
+	for (i = 0; i < 1 << BENCH_HASH_BITS; i++) {
+		while ((fe = fid_hash[i]) != NULL) {
+			fid_hash[i] = fe->fe_next;
+			free(fe);
+		}
+	}
+}
+
+/* Check that \a rec comes after every record of its FID processed so far,
+ * and that all of them went to \a worker. */
+static int fid_check_order(struct changelog_rec *rec, unsigned int worker)
+{
+	unsigned int idx = fid_hash_index(&rec->cr_tfid);
+	pthread_mutex_t *lock = &fid_locks[idx % BENCH_HASH_LOCKS];
+	struct fid_entry *fe;
+	int rc = 0;
+
+	pthread_mutex_lock(lock);
+	for (fe = fid_hash[idx]; fe != NULL; fe = fe->fe_next)
+		if (memcmp(&fe->fe_fid, &rec->cr_tfid, sizeof(fe->fe_fid)) == 0)
+			break;
+
+	if (fe == NULL) {
+		fe = calloc(1, sizeof(*fe));
+		if (fe == NULL) {
+			rc = -ENOMEM;
+			goto out;
+		}
+		fe->fe_fid = rec->cr_tfid;
+		fe->fe_worker = worker;
+		fe->fe_next = fid_hash[idx];
+		fid_hash[idx] = fe;
+	} else if (rec->cr_index <= fe->fe_index) {
+		fprintf(stderr, "%s: "DFID" record %llu processed after %llu\n",
+			progname, PFID(&rec->cr_tfid),
+			(unsigned long long)rec->cr_index,
+			(unsigned long long)fe->fe_index);
+		rc = -EPROTO;
+		goto out;
+	} else if (fe->fe_worker != worker) {
+		fprintf(stderr, "%s: "DFID" record %llu given to worker %u, earlier ones to %u\n",
+			progname, PFID(&rec->cr_tfid),
+			(unsigned long long)rec->cr_index, worker,
+			fe->fe_worker);
+		rc = -EPROTO;
+		goto out;
+	}
+	fe->fe_index = rec->cr_index;
+out:
+	pthread_mutex_unlock(lock);
+
+	return rc;
+}
+
+static int changelog_work(struct changelog_rec *rec, unsigned int worker,
+			  void *data)
+{
+	double deadline;
+	int rc;
+
+	rc = fid_check_order(rec, worker);
+	if (rc < 0)
+		return rc;
+
+	if (work_usec > 0) {
+		deadline = now() + work_usec / 1000000.0;
+		while (now() < deadline)
+			;
+	}
+
+	__atomic_add_fetch(&records, 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	struct llapi_changelog_parallel param = {
+		.lcp_flags = CHANGELOG_FLAG_JOBID | CHANGELOG_FLAG_EXTRA_FLAGS,
+		.lcp_cb = changelog_work,
+	};
+	char threads_default[] = "1,2,4,8";
+	char *threads = threads_default;
+	unsigned int runs[BENCH_MAX_RUNS];
+	int nruns = 0;
+	const char *cl_user = NULL;
+	long long first_endrec = -1;
+	long first_records = -1;
+	char *tok;
+	int rc;
+	int c;
+	int i;
+
+	progname = argv[0];
+	while ((c = getopt(argc, argv, "ht:u:w:")) != -1) {
+		switch (c) {
+		case 't':
+			threads = optarg;
+			break;
+		case 'u':
+			cl_user = optarg;
+			break;
+		case 'w':
+			work_usec = atol(optarg);
+			break;
+		case 'h':
+			usage(stdout);
+		default:
+			usage(stderr);
+		}
+	}
+
+	if (optind != argc - 1 || work_usec < 0)
+		usage(stderr);
+
+	for (tok = strtok(threads, ","); tok != NULL;
+	     tok = strtok(NULL, ",")) {
+		runs[nruns] = strtoul(tok, NULL, 0);
+		if (runs[nruns] == 0 || runs[nruns] > BENCH_MAX_WORKERS ||
+		    nruns == BENCH_MAX_RUNS - 1) {
+			fprintf(stderr, "%s: bad thread count '%s'\n",
+				progname, tok);
+			return 1;
+		}
+		nruns++;
+	}
+
+	for (i = 0; i < BENCH_HASH_LOCKS; i++)
+		pthread_mutex_init(&fid_locks[i], NULL);
+
+	param.lcp_mdtname = argv[optind];
+	printf("%8s %12s %10s %14s\n", "threads", "records", "seconds",
+	       "records/sec");
+	for (i = 0; i < nruns; i++) {
+		unsigned int nthreads = runs[i];
+		long long endrec;
+		double start, elapsed;
+
+		fid_hash_clear();
+		records = 0;
+		param.lcp_workers = nthreads;
+		/* clearing on an earlier run would leave nothing to replay */
+		param.lcp_clear_id = i == nruns - 1 ? cl_user : NULL;
+		start = now();
+		rc = llapi_changelog_parallel(&param, &endrec);
+		elapsed = now() - start;
+		if (rc) {
+			fprintf(stderr, "%s: consumer with %u threads failed: %s\n",
+				progname, nthreads, strerror(-rc));
+			return 1;
+		}
+
+		/* every run goes through the same records */
+		if (first_records < 0) {
+			first_records = records;
+			first_endrec = endrec;
+		} else if (records != first_records ||
+			   endrec != first_endrec) {
+			fprintf(stderr, "%s: %ld records up to %lld with %u threads, %ld up to %lld with the first run\n",
+				progname, records, endrec, nthreads,
+				first_records, first_endrec);
+			return 1;
+		}
+
+		printf("%8u %12ld %10.3f %14.0f\n", nthreads, records, elapsed,
+		       elapsed > 0 ? records / elapsed : 0.0);
+	}
+	fid_hash_clear();
+
+	return 0;
+}
@@ -0,0 +1,226 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/tests/find_bench.c
+ *
+ * Build a synthetic directory tree and time llapi_find_parallel() over it
+ * with an increasing number of threads, reporting entries/sec for each.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <getopt.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <lustre/lustreapi.h>
+
+static char *progname;
+static long entries;
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"Usage: %s [-c] [-d depth] [-w width] [-f files] [-t threads,...] dir\n"
+		"  -c: create the tree under dir first\n"
+		"  -d: depth of the tree to create (default 3)\n"
+		"  -w: subdirectories per directory (default 8)\n"
+		"  -f: files per directory (default 64)\n"
+		"  -t: comma separated thread counts to run (default 1,2,4,8)\n",
+		progname);
+	exit(out == stderr);
+}
+
+static int tree_create(char *path, int depth, int width, int files)
+{
+	int len = strlen(path);
+	int rc;
+	int i;
+
+	for (i = 0; i < files; i++) {
+		int fd;
+
+		snprintf(path + len, PATH_MAX - len, "/f%d", i);
+		fd = open(path, O_CREAT | O_WRONLY, 0644);
+		if (fd < 0) {
+			fprintf(stderr, "%s: cannot create '%s': %s\n",
+				progname, path, strerror(errno));
+			return -errno;
+		}
+		close(fd);
+	}
+
+	if (depth == 0)
+		goto out;
+
+	for (i = 0; i < width; i++) {
+		snprintf(path + len, PATH_MAX - len, "/d%d", i);
+		if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+			fprintf(stderr, "%s: cannot mkdir '%s': %s\n",
+				progname, path, strerror(errno));
+			return -errno;
+		}
+		rc = tree_create(path, depth - 1, width, files);
+		if (rc)
+			return rc;
+	}
+out:
+	path[len] = '\0';
+	return 0;
+}
+
+static int tree_count(const char *path, const struct stat *st, int flag,
+		      struct FTW *ftw)
+{
+	entries++;
+	return 0;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+	struct find_param param = {
+		.fp_max_depth = -1,
+		.fp_quiet = 1,
+	};
+	char threads_default[] = "1,2,4,8";
+	char *threads = threads_default;
+	char path[PATH_MAX + 1];
+	int depth = 3;
+	int width = 8;
+	int files = 64;
+	bool create = false;
+	char *tok;
+	int stdout_fd;
+	int null_fd;
+	int rc;
+	int c;
+
+	progname = argv[0];
+	while ((c = getopt(argc, argv, "cd:f:ht:w:")) != -1) {
+		switch (c) {
+		case 'c':
+			create = true;
+			break;
+		case 'd':
+			depth = atoi(optarg);
+			break;
+		case 'f':
+			files = atoi(optarg);
+			break;
+		case 't':
+			threads = optarg;
+			break;
+		case 'w':
+			width = atoi(optarg);
+			break;
+		case 'h':
+			usage(stdout);
+		default:
+			usage(stderr);
+		}
+	}
+
+	if (optind != argc - 1 || depth < 0 || width < 0 || files < 0)
+		usage(stderr);
+
+	snprintf(path, sizeof(path), "%s", argv[optind]);
+	if (create) {
+		if (mkdir(path, 0755) < 0 && errno != EEXIST) {
+			fprintf(stderr, "%s: cannot mkdir '%s': %s\n",
+				progname, path, strerror(errno));
+			return 1;
+		}
+		rc = tree_create(path, depth, width, files);
+		if (rc)
+			return 1;
+	}
+
+	rc = nftw(path, tree_count, 64, FTW_PHYS);
+	if (rc) {
+		fprintf(stderr, "%s: cannot walk '%s': %s\n",
+			progname, path, strerror(errno));
+		return 1;
+	}
+
+	/* the matches go to stdout, only the results are of interest */
+	fflush(stdout);
+	stdout_fd = dup(STDOUT_FILENO);
+	null_fd = open("/dev/null", O_WRONLY);
+	if (stdout_fd < 0 || null_fd < 0) {
+		fprintf(stderr, "%s: cannot redirect stdout: %s\n",
+			progname, strerror(errno));
+		return 1;
+	}
+
+	printf("%8s %12s %10s %14s\n", "threads", "entries", "seconds",
+	       "entries/sec");
+	for (tok = strtok(threads, ","); tok != NULL;
+	     tok = strtok(NULL, ",")) {
+		unsigned int nthreads = strtoul(tok, NULL, 0);
+		double start, elapsed;
+
+		if (nthreads == 0) {
+			fprintf(stderr, "%s: bad thread count '%s'\n",
+				progname, tok);
+			return 1;
+		}
+
+		fflush(stdout);
+		dup2(null_fd, STDOUT_FILENO);
+		start = now();
+		rc = llapi_find_parallel(path, &param, nthreads);
+		elapsed = now() - start;
+		fflush(stdout);
+		dup2(stdout_fd, STDOUT_FILENO);
+		if (rc) {
+			fprintf(stderr, "%s: find with %u threads failed: %s\n",
+				progname, nthreads, strerror(-rc));
+			return 1;
+		}
+
+		printf("%8u %12ld %10.3f %14.0f\n", nthreads, entries, elapsed,
+		       elapsed > 0 ? entries / elapsed : 0.0);
+	}
+
+	close(null_fd);
+	close(stdout_fd);
+
+	return 0;
+}
@@ -0,0 +1,198 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * Bulk checksum microbenchmark.  For each checksum algorithm usable for
+ * bulk RPCs, hash a set of pages one page per update call (the old bulk
+ * checksum path) and CFS_CRYPTO_HASH_BATCH_PAGES pages per update call
+ * (the current one), and report the throughput of both in GB/s next to
+ * the speed libcfs measured at load time, which is what the client and
+ * server use to pick the checksum type.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/highmem.h>
+#include <linux/random.h>
+#include <linux/scatterlist.h>
+#include <linux/slab.h>
+#include <linux/time.h>
+
+#include <libcfs/libcfs.h>
+#include <libcfs/libcfs_crypto.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int pages = 256;
+module_param(pages, int, 0644);
+MODULE_PARM_DESC(pages, "number of pages hashed per checksum (default 256)");
+
+static int msecs = 250;
+module_param(msecs, int, 0644);
+MODULE_PARM_DESC(msecs, "run time of each test in ms (default 250)");
+
+#define PREFIX "lustre_kcksum_%u:"
+
+static const enum cfs_crypto_hash_alg kcksum_algs[] = {
+	CFS_HASH_ALG_ADLER32,
+	CFS_HASH_ALG_CRC32,
+	CFS_HASH_ALG_CRC32C,
+};
+
+static int kcksum_one(enum cfs_crypto_hash_alg alg, struct page **pgs,
+		      struct scatterlist *sg, bool batched)
+{
+	unsigned char hash[CFS_CRYPTO_HASH_DIGESTSIZE_MAX];
+	unsigned int hash_len = sizeof(hash);
+	struct ahash_request *req;
+	int rc = 0;
+	int i;
+
+	req = cfs_crypto_hash_init(alg, NULL, 0);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	for (i = 0; i < pages && rc == 0; ) {
+		if (batched) {
+			int n = min(pages - i, CFS_CRYPTO_HASH_BATCH_PAGES);
+			int j;
+
+			sg_init_table(sg, n);
+			for (j = 0; j < n; j++)
+				sg_set_page(&sg[j], pgs[i + j], PAGE_SIZE, 0);
+			rc = cfs_crypto_hash_update_sg(req, sg, n * PAGE_SIZE);
+			i += n;
+		} else {
+			rc = cfs_crypto_hash_update_page(req, pgs[i], 0,
+							 PAGE_SIZE);
+			i++;
+		}
+	}
+
+	if (rc == 0)
+		rc = cfs_crypto_hash_final(req, hash, &hash_len);
+	else
+		cfs_crypto_hash_final(req, NULL, NULL);
+
+	return rc;
+}
+
+/* returns throughput in MB/s, or negative errno */
+static long kcksum_speed(enum cfs_crypto_hash_alg alg, struct page **pgs,
+			 struct scatterlist *sg, bool batched)
+{
+	u64 start = ktime_get_ns();
+	u64 deadline = start + (u64)msecs * NSEC_PER_MSEC;
+	u64 elapsed;
+	u64 bytes = 0;
+	int rc;
+
+	do {
+		rc = kcksum_one(alg, pgs, sg, batched);
+		if (rc != 0)
+			return rc;
+		bytes += (u64)pages * PAGE_SIZE;
+		cond_resched();
+	} while (ktime_get_ns() < deadline);
+
+	elapsed = ktime_get_ns() - start;
+
+	return div64_u64(bytes * NSEC_PER_SEC, elapsed) >> 20;
+}
+
+static int __init kcksum_init(void)
+{
+	struct scatterlist sg[CFS_CRYPTO_HASH_BATCH_PAGES];
+	struct page **pgs;
+	int rc = 0;
+	int i;
+
+	if (pages <= 0 || msecs <= 0) {
+		pr_err(PREFIX " invalid pages=%d msecs=%d\n",
+		       run_id, pages, msecs);
+		return -EINVAL;
+	}
+
+	pgs = kcalloc(pages, sizeof(*pgs), GFP_KERNEL);
+	if (!pgs)
+		return -ENOMEM;
+
+	for (i = 0; i < pages; i++) {
+		void *addr;
+
+		pgs[i] = alloc_page(GFP_KERNEL);
+		if (!pgs[i]) {
+			rc = -ENOMEM;
+			goto out;
+		}
+		addr = kmap(pgs[i]);
+		get_random_bytes(addr, PAGE_SIZE);
+		kunmap(pgs[i]);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(kcksum_algs); i++) {
+		enum cfs_crypto_hash_alg alg = kcksum_algs[i];
+		long single = kcksum_speed(alg, pgs, sg, false);
+		long batched = kcksum_speed(alg, pgs, sg, true);
+
+		if (single < 0 || batched < 0) {
+			pr_err(PREFIX " %s: test failed: rc = %ld\n", run_id,
+			       cfs_crypto_hash_name(alg),
+			       single < 0 ? single : batched);
+			continue;
+		}
+
+		/* below message is checked in sanity.sh test_77m */
+		pr_err(PREFIX " %s: per-page %ld.%03ld GB/s, batched %ld.%03ld GB/s, selection speed %d MB/s\n",
+		       run_id, cfs_crypto_hash_name(alg),
+		       single >> 10, (single & 1023) * 1000 >> 10,
+		       batched >> 10, (batched & 1023) * 1000 >> 10,
+		       cfs_crypto_hash_speed(alg));
+	}
+
+out:
+	for (i = 0; i < pages; i++)
+		if (pgs[i])
+			__free_page(pgs[i]);
+	kfree(pgs);
+
+	/* Don't load. */
+	return rc ?: -EINVAL;
+}
+
+static void __exit kcksum_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("Lustre bulk checksum benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kcksum_init);
+module_exit(kcksum_exit);
@@ -0,0 +1,247 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * LNet portal matching microbenchmark.  Post a number of MEs with ignore
+ * bits on a wildcard portal, spread over a few distinct ignore masks, then
+ * PUT to ourselves over the loopback NI, matching either the first or the
+ * last posted ME, and report the average latency of both, and the number of
+ * MEs tried per PUT.  With a linear scan of the MEs the latter grows with
+ * the number of MEs.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/time.h>
+
+#include <lnet/lib-lnet.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int mes = 1024;
+module_param(mes, int, 0644);
+MODULE_PARM_DESC(mes, "number of MEs posted (default 1024)");
+
+static int classes = 4;
+module_param(classes, int, 0644);
+MODULE_PARM_DESC(classes, "number of distinct ignore masks (1-8, default 4)");
+
+static int puts = 10000;
+module_param(puts, int, 0644);
+MODULE_PARM_DESC(puts, "number of PUTs per measurement (default 10000)");
+
+static int portal = MAX_PORTALS - 1;
+module_param(portal, int, 0644);
+MODULE_PARM_DESC(portal, "portal the MEs are posted on, must be unused");
+
+#define PREFIX "lustre_kmatch_%u:"
+
+/* match bits of ME @i, above the bits ignored by any class */
+#define KMATCH_MBITS(i)		((__u64)(i) << 16)
+/* ignore mask of class @c */
+#define KMATCH_IBITS(c)		((1ULL << (8 + (c))) - 1)
+
+static atomic_t kmatch_mds;
+
+static void kmatch_eq_handler(struct lnet_event *ev)
+{
+	if (ev->unlinked)
+		atomic_dec(&kmatch_mds);
+}
+
+/* MEs tried by matching on the portal so far */
+static u64 kmatch_tried(void)
+{
+	struct lnet_portal *ptl = the_lnet.ln_portals[portal];
+	struct lnet_match_table *mtable;
+	u64 tried = 0;
+	int i;
+
+	cfs_percpt_for_each(mtable, i, ptl->ptl_mtables)
+		tried += READ_ONCE(mtable->mt_me_tried);
+
+	return tried;
+}
+
+/* returns average latency in ns, or negative errno, and sets @tried to the
+ * average number of MEs tried per PUT */
+static long kmatch_speed(struct lnet_handle_md mdh,
+			 struct lnet_process_id self, __u64 mbits,
+			 long *tried)
+{
+	u64 tried_start = kmatch_tried();
+	u64 start = ktime_get_ns();
+	int rc;
+	int i;
+
+	for (i = 0; i < puts; i++) {
+		rc = LNetPut(self.nid, mdh, LNET_NOACK_REQ, self, portal,
+			     mbits, 0, 0);
+		if (rc != 0)
+			return rc;
+		if ((i & 1023) == 1023)
+			cond_resched();
+	}
+
+	*tried = div64_u64(kmatch_tried() - tried_start, puts);
+	return div64_u64(ktime_get_ns() - start, puts);
+}
+
+static int __init kmatch_init(void)
+{
+	struct lnet_process_id match_id = {
+		.nid = LNET_NID_ANY,
+		.pid = LNET_PID_ANY,
+	};
+	struct lnet_process_id self;
+	struct lnet_handle_md mdh;
+	struct lnet_me **mep;
+	struct lnet_eq *eq;
+	struct lnet_md md;
+	char *buf;
+	long first_tried;
+	long last_tried;
+	long first;
+	long last;
+	int posted = 0;
+	int rc;
+	int i;
+
+	if (mes <= 0 || puts <= 0 || classes < 1 || classes > 8 ||
+	    portal <= LNET_RESERVED_PORTAL || portal >= MAX_PORTALS) {
+		pr_err(PREFIX " invalid mes=%d classes=%d puts=%d portal=%d\n",
+		       run_id, mes, classes, puts, portal);
+		return -EINVAL;
+	}
+
+	mep = kcalloc(mes, sizeof(*mep), GFP_KERNEL);
+	buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!mep || !buf) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
+	rc = LNetNIInit(LNET_PID_LUSTRE);
+	if (rc < 0)
+		goto out_free;
+
+	for (i = 0; LNetGetId(i, &self) == 0; i++) {
+		if (LNET_NETTYP(LNET_NIDNET(self.nid)) == LOLND)
+			break;
+	}
+	if (LNET_NETTYP(LNET_NIDNET(self.nid)) != LOLND) {
+		rc = -ENOENT;
+		goto out_fini;
+	}
+
+	eq = LNetEQAlloc(kmatch_eq_handler);
+	if (IS_ERR(eq)) {
+		rc = PTR_ERR(eq);
+		goto out_fini;
+	}
+
+	memset(&md, 0, sizeof(md));
+	md.start = buf;
+	md.length = PAGE_SIZE;
+	md.threshold = LNET_MD_THRESH_INF;
+	md.options = LNET_MD_OP_PUT | LNET_MD_TRUNCATE;
+	md.eq_handle = eq;
+
+	for (posted = 0; posted < mes; posted++) {
+		struct lnet_me *me;
+
+		me = LNetMEAttach(portal, match_id, KMATCH_MBITS(posted),
+				  KMATCH_IBITS(posted % classes), LNET_RETAIN,
+				  LNET_INS_AFTER);
+		if (IS_ERR(me)) {
+			rc = PTR_ERR(me);
+			goto out_unlink;
+		}
+
+		rc = LNetMDAttach(me, md, LNET_RETAIN, &mdh);
+		if (rc != 0) {
+			LNetMEUnlink(me);
+			goto out_unlink;
+		}
+		atomic_inc(&kmatch_mds);
+		mep[posted] = me;
+	}
+
+	/* the source MD of all PUTs */
+	md.length = 64;
+	md.options = 0;
+	rc = LNetMDBind(md, LNET_RETAIN, &mdh);
+	if (rc != 0)
+		goto out_unlink;
+	atomic_inc(&kmatch_mds);
+
+	first = kmatch_speed(mdh, self, KMATCH_MBITS(0), &first_tried);
+	last = kmatch_speed(mdh, self, KMATCH_MBITS(mes - 1), &last_tried);
+	if (first < 0 || last < 0) {
+		pr_err(PREFIX " test failed: rc = %ld\n", run_id,
+		       first < 0 ? first : last);
+	} else {
+		/* below message is checked in sanity-lnet.sh test_105 */
+		pr_err(PREFIX " %d MEs in %d classes: first ME %ld ns/PUT, last ME %ld ns/PUT, MEs tried first %ld last %ld\n",
+		       run_id, mes, classes, first, last, first_tried,
+		       last_tried);
+	}
+
+	LNetMDUnlink(mdh);
+out_unlink:
+	while (posted-- > 0)
+		LNetMEUnlink(mep[posted]);
+
+	/* buffers are in use until every MD has been unlinked */
+	while (atomic_read(&kmatch_mds) > 0)
+		schedule_timeout_uninterruptible(cfs_time_seconds(1) / 100);
+
+	LNetEQFree(eq);
+out_fini:
+	LNetNIFini();
+out_free:
+	kfree(buf);
+	kfree(mep);
+
+	/* Don't load. */
+	return rc ?: -EINVAL;
+}
+
+static void __exit kmatch_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("LNet portal matching benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kmatch_init);
+module_exit(kmatch_exit);
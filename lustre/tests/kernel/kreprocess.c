@@ -0,0 +1,217 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * LDLM extent lock reprocessing stress test.  In a local server namespace,
+ * take N PW locks on disjoint extents of one resource, queue a conflicting
+ * PW lock behind each of them, then cancel the granted locks from the last
+ * one to the first.  Report the average and maximum time of a cancel, which
+ * includes reprocessing the waiting locks, and how many waiting locks were
+ * granted before the first lock was cancelled, for 16, 64, ... N waiting
+ * locks.  A reprocess which stops at the first waiting lock it can't grant
+ * grants none of them early, and then has to grant all of them at once.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/time.h>
+
+#include <obd.h>
+#include <obd_class.h>
+#include <lustre_dlm.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int waiters = 1024;
+module_param(waiters, int, 0644);
+MODULE_PARM_DESC(waiters, "maximum number of waiting locks (default 1024)");
+
+#define PREFIX "lustre_kreprocess_%u:"
+
+#define KREPROCESS_EXTENT	4096
+
+static atomic_t kreprocess_granted;
+
+static int kreprocess_completion_ast(struct ldlm_lock *lock, __u64 flags,
+				     void *data)
+{
+	/* never wait, the waiting locks are granted by the cancels */
+	if (!(flags & LDLM_FL_BLOCKED_MASK) && ldlm_is_granted(lock))
+		atomic_inc(&kreprocess_granted);
+	return 0;
+}
+
+static int kreprocess_enqueue(struct ldlm_namespace *ns,
+			      const struct ldlm_res_id *res_id, int index,
+			      struct lustre_handle *lockh)
+{
+	union ldlm_policy_data policy = {
+		.l_extent = {
+			.start = (__u64)index * KREPROCESS_EXTENT,
+			.end = (__u64)(index + 1) * KREPROCESS_EXTENT - 1,
+		},
+	};
+	__u64 flags = LDLM_FL_ATOMIC_CB;
+
+	return ldlm_cli_enqueue_local(NULL, ns, res_id, LDLM_EXTENT, &policy,
+				      LCK_PW, &flags, ldlm_blocking_ast,
+				      kreprocess_completion_ast, NULL, NULL, 0,
+				      LVB_T_NONE, NULL, lockh);
+}
+
+static int kreprocess_run(struct ldlm_namespace *ns, int count,
+			  struct lustre_handle *granted,
+			  struct lustre_handle *waiting)
+{
+	struct ldlm_res_id res_id = { .name = { count } };
+	int early = 0;
+	int taken = 0;
+	int queued = 0;
+	u64 total = 0;
+	u64 worst = 0;
+	int rc = 0;
+
+	for (taken = 0; taken < count; taken++) {
+		rc = kreprocess_enqueue(ns, &res_id, taken, &granted[taken]);
+		if (rc != ELDLM_OK)
+			goto out;
+	}
+
+	atomic_set(&kreprocess_granted, 0);
+	for (queued = 0; queued < count; queued++) {
+		rc = kreprocess_enqueue(ns, &res_id, queued, &waiting[queued]);
+		if (rc != ELDLM_OK)
+			goto out;
+	}
+	if (atomic_read(&kreprocess_granted) != 0) {
+		rc = -EALREADY;
+		goto out;
+	}
+
+	/* the waiting lock behind each cancelled lock can be granted, the
+	 * first waiting lock can't until the last cancel */
+	while (taken > 0) {
+		u64 start = ktime_get_ns();
+		u64 elapsed;
+
+		ldlm_lock_decref_and_cancel(&granted[--taken], LCK_PW);
+		elapsed = ktime_get_ns() - start;
+
+		total += elapsed;
+		worst = max(worst, elapsed);
+		if (taken == 1)
+			early = atomic_read(&kreprocess_granted);
+	}
+
+	if (atomic_read(&kreprocess_granted) != count) {
+		rc = -EDEADLK;
+		goto out;
+	}
+
+	/* below message is checked in sanity.sh test_124e */
+	pr_err(PREFIX " %d waiting locks: %llu ns/cancel, max %llu ns, %d granted early\n",
+	       run_id, count, div_u64(total, count), worst, early);
+out:
+	if (rc != 0)
+		pr_err(PREFIX " %d waiting locks: test failed: rc = %d\n",
+		       run_id, count, rc);
+
+	while (taken > 0)
+		ldlm_lock_decref_and_cancel(&granted[--taken], LCK_PW);
+	while (queued > 0)
+		ldlm_lock_decref_and_cancel(&waiting[--queued], LCK_PW);
+
+	return rc;
+}
+
+static int __init kreprocess_init(void)
+{
+#ifdef HAVE_SERVER_SUPPORT
+	static struct obd_device obd;
+	struct lustre_handle *granted;
+	struct lustre_handle *waiting;
+	struct ldlm_namespace *ns;
+	char name[32];
+	int count;
+	int rc;
+
+	if (waiters < 16) {
+		pr_err(PREFIX " invalid waiters=%d\n", run_id, waiters);
+		return -EINVAL;
+	}
+
+	granted = kcalloc(waiters, sizeof(*granted), GFP_KERNEL);
+	waiting = kcalloc(waiters, sizeof(*waiting), GFP_KERNEL);
+	if (!granted || !waiting) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
+	snprintf(obd.obd_name, sizeof(obd.obd_name), "kreprocess-%u", run_id);
+	snprintf(name, sizeof(name), "kreprocess-%u", run_id);
+	ns = ldlm_namespace_new(&obd, name, LDLM_NAMESPACE_SERVER,
+				LDLM_NAMESPACE_MODEST, LDLM_NS_TYPE_OST);
+	if (!ns) {
+		rc = -ENOMEM;
+		goto out_free;
+	}
+
+	for (count = 16; ; count = min(count * 4, waiters)) {
+		rc = kreprocess_run(ns, count, granted, waiting);
+		if (rc != 0 || count == waiters)
+			break;
+	}
+
+	ldlm_namespace_free_prior(ns, NULL, 1);
+	ldlm_namespace_free_post(ns);
+out_free:
+	kfree(waiting);
+	kfree(granted);
+
+	/* Don't load. */
+	return rc ?: -EINVAL;
+#else
+	pr_err(PREFIX " no server support\n", run_id);
+
+	/* Don't load. */
+	return -EINVAL;
+#endif
+}
+
+static void __exit kreprocess_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("LDLM extent lock reprocessing test module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(kreprocess_init);
+module_exit(kreprocess_exit);
@@ -0,0 +1,418 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * LNet multi-threaded send microbenchmark.  Start 1, 2, 4, ... threads,
+ * each bound to a different CPT and PUTting to its own portal over the
+ * loopback NI, and report the aggregate PUT rate for each thread count.
+ * Every PUT goes through the send path and the health accounting of the
+ * received message, so a lock shared by all CPTs there shows up as a rate
+ * that doesn't grow with the number of threads.
+ *
+ * The loopback PUTs of all the threads are received on the CPT of the
+ * loopback NID, which hides such a lock from the rates.  So also count
+ * the PUTs a thread on that CPT gets through while CPT 0's net lock is
+ * held, which are none if anything on the path still takes it.
+ */
+
+#include <linux/delay.h>
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/time.h>
+#include <linux/wait.h>
+
+#include <lnet/lib-lnet.h>
+
+/* Random ID passed by userspace, and printed in messages, used to
+ * separate different runs of that module. */
+static int run_id;
+module_param(run_id, int, 0644);
+MODULE_PARM_DESC(run_id, "run ID");
+
+static int threads = 4;
+module_param(threads, int, 0644);
+MODULE_PARM_DESC(threads, "maximum number of sending threads (1-16, default 4)");
+
+static int puts = 100000;
+module_param(puts, int, 0644);
+MODULE_PARM_DESC(puts, "number of PUTs per thread (default 100000)");
+
+static int hold_ms = 100;
+module_param(hold_ms, int, 0644);
+MODULE_PARM_DESC(hold_ms, "how long CPT 0's net lock is held while sending (default 100)");
+
+static int portal = MAX_PORTALS - 2;
+module_param(portal, int, 0644);
+MODULE_PARM_DESC(portal, "portal of the first thread, the following threads use the ones below it, must be unused");
+
+#define PREFIX "lustre_ksend_%u:"
+
+#define KSEND_THREADS_MAX	16
+
+struct ksend_thread {
+	struct task_struct	*kt_task;
+	struct completion	 kt_done;
+	struct lnet_process_id	 kt_self;
+	char			*kt_buf;
+	int			 kt_index;
+	int			 kt_cpt;
+	/* send until ksend_stop is set instead of puts times, and count
+	 * the PUTs in ksend_sent */
+	bool			 kt_until_stop;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(ksend_waitq);
+static atomic_t ksend_ready;
+static atomic_t ksend_mds;
+static atomic_t ksend_sent;
+static bool ksend_go;
+static bool ksend_stop;
+static struct lnet_eq *ksend_eq;
+
+static void ksend_eq_handler(struct lnet_event *ev)
+{
+	if (ev->unlinked)
+		atomic_dec(&ksend_mds);
+}
+
+static int ksend_put(struct ksend_thread *kt, int index)
+{
+	struct lnet_process_id match_id = {
+		.nid = LNET_NID_ANY,
+		.pid = LNET_PID_ANY,
+	};
+	struct lnet_handle_md mdh;
+	struct lnet_me *me;
+	struct lnet_md md;
+	int rc;
+	int i;
+
+	memset(&md, 0, sizeof(md));
+	md.start = kt->kt_buf;
+	md.length = PAGE_SIZE;
+	md.threshold = LNET_MD_THRESH_INF;
+	md.options = LNET_MD_OP_PUT | LNET_MD_TRUNCATE;
+	md.eq_handle = ksend_eq;
+
+	me = LNetMEAttach(index, match_id, 0, 0, LNET_RETAIN, LNET_INS_LOCAL);
+	if (IS_ERR(me))
+		return PTR_ERR(me);
+
+	rc = LNetMDAttach(me, md, LNET_RETAIN, &mdh);
+	if (rc != 0) {
+		LNetMEUnlink(me);
+		return rc;
+	}
+	atomic_inc(&ksend_mds);
+
+	/* the source MD of all PUTs */
+	md.length = 64;
+	md.options = 0;
+	rc = LNetMDBind(md, LNET_RETAIN, &mdh);
+	if (rc != 0) {
+		LNetMEUnlink(me);
+		return rc;
+	}
+	atomic_inc(&ksend_mds);
+
+	atomic_inc(&ksend_ready);
+	wake_up_all(&ksend_waitq);
+	wait_event(ksend_waitq, READ_ONCE(ksend_go));
+
+	for (i = 0; kt->kt_until_stop ? !READ_ONCE(ksend_stop) : i < puts;
+	     i++) {
+		rc = LNetPut(kt->kt_self.nid, mdh, LNET_NOACK_REQ, kt->kt_self,
+			     index, 0, 0, 0);
+		if (rc != 0)
+			break;
+		if (kt->kt_until_stop)
+			atomic_inc(&ksend_sent);
+		if ((i & 1023) == 1023)
+			cond_resched();
+	}
+
+	LNetMDUnlink(mdh);
+	LNetMEUnlink(me);
+
+	return rc;
+}
+
+static int ksend_thread_main(void *arg)
+{
+	struct ksend_thread *kt = arg;
+	int rc;
+
+	/* each thread sends from, and matches on, the CPT it's bound to */
+	cfs_cpt_bind(lnet_cpt_table(), kt->kt_cpt);
+
+	rc = ksend_put(kt, portal - kt->kt_index);
+	if (rc != 0) {
+		/* don't leave ksend_run() waiting for us to get ready */
+		atomic_inc(&ksend_ready);
+		wake_up_all(&ksend_waitq);
+	}
+	complete(&kt->kt_done);
+
+	/* stay around for kthread_stop() to collect rc */
+	set_current_state(TASK_INTERRUPTIBLE);
+	while (!kthread_should_stop()) {
+		schedule();
+		set_current_state(TASK_INTERRUPTIBLE);
+	}
+	__set_current_state(TASK_RUNNING);
+
+	return rc;
+}
+
+/* returns the aggregate rate in PUTs/s, or negative errno */
+static long ksend_run(struct lnet_process_id self, int nthreads)
+{
+	struct ksend_thread *kts;
+	struct task_struct *task;
+	int started;
+	u64 start;
+	u64 ns;
+	int rc = 0;
+	int i;
+
+	kts = kcalloc(nthreads, sizeof(*kts), GFP_KERNEL);
+	if (!kts)
+		return -ENOMEM;
+
+	atomic_set(&ksend_ready, 0);
+	WRITE_ONCE(ksend_go, false);
+
+	for (i = 0; i < nthreads; i++) {
+		kts[i].kt_self = self;
+		kts[i].kt_index = i;
+		kts[i].kt_cpt = i % LNET_CPT_NUMBER;
+		init_completion(&kts[i].kt_done);
+
+		kts[i].kt_buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+		if (!kts[i].kt_buf) {
+			rc = -ENOMEM;
+			break;
+		}
+
+		task = kthread_run(ksend_thread_main, &kts[i], "ksend_%02d", i);
+		if (IS_ERR(task)) {
+			rc = PTR_ERR(task);
+			break;
+		}
+		kts[i].kt_task = task;
+	}
+	started = i;
+
+	wait_event(ksend_waitq, atomic_read(&ksend_ready) == started);
+
+	start = ktime_get_ns();
+	WRITE_ONCE(ksend_go, true);
+	wake_up_all(&ksend_waitq);
+
+	for (i = 0; i < started; i++)
+		wait_for_completion(&kts[i].kt_done);
+	ns = ktime_get_ns() - start;
+
+	for (i = 0; i < started; i++) {
+		int trc = kthread_stop(kts[i].kt_task);
+
+		if (trc != 0 && rc == 0)
+			rc = trc;
+	}
+
+	/* buffers are in use until every MD has been unlinked */
+	while (atomic_read(&ksend_mds) > 0)
+		schedule_timeout_uninterruptible(cfs_time_seconds(1) / 100);
+
+	for (i = 0; i < nthreads; i++)
+		kfree(kts[i].kt_buf);
+	kfree(kts);
+	if (rc != 0)
+		return rc;
+
+	return div64_u64((u64)nthreads * puts * NSEC_PER_SEC, ns ?: 1);
+}
+
+/*
+ * returns the number of PUTs sent from the CPT of @self while CPT 0's net
+ * lock was held, -EOPNOTSUPP if @self is on CPT 0, or negative errno
+ */
+static long ksend_run_locked(struct lnet_process_id self)
+{
+	struct ksend_thread *kt;
+	struct task_struct *task;
+	long sent;
+	int cpt;
+	int rc;
+
+	cpt = lnet_cpt_of_nid(self.nid, NULL);
+	if (cpt == 0)
+		return -EOPNOTSUPP;
+
+	kt = kzalloc(sizeof(*kt), GFP_KERNEL);
+	if (!kt)
+		return -ENOMEM;
+
+	kt->kt_buf = kzalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!kt->kt_buf) {
+		kfree(kt);
+		return -ENOMEM;
+	}
+	kt->kt_self = self;
+	kt->kt_cpt = cpt;
+	kt->kt_until_stop = true;
+	init_completion(&kt->kt_done);
+
+	atomic_set(&ksend_ready, 0);
+	atomic_set(&ksend_sent, 0);
+	WRITE_ONCE(ksend_go, false);
+	WRITE_ONCE(ksend_stop, false);
+
+	task = kthread_run(ksend_thread_main, kt, "ksend_locked");
+	if (IS_ERR(task)) {
+		kfree(kt->kt_buf);
+		kfree(kt);
+		return PTR_ERR(task);
+	}
+
+	/* hold the lock from CPT 0, away from the sending thread */
+	cfs_cpt_bind(lnet_cpt_table(), 0);
+
+	wait_event(ksend_waitq, atomic_read(&ksend_ready) == 1);
+	WRITE_ONCE(ksend_go, true);
+	wake_up_all(&ksend_waitq);
+
+	/* the peer is set up and healthy once the first PUTs got through */
+	while (atomic_read(&ksend_sent) < 1024 &&
+	       !completion_done(&kt->kt_done))
+		schedule_timeout_uninterruptible(1);
+
+	lnet_net_lock(0);
+	sent = atomic_read(&ksend_sent);
+	mdelay(hold_ms);
+	sent = atomic_read(&ksend_sent) - sent;
+	lnet_net_unlock(0);
+
+	WRITE_ONCE(ksend_stop, true);
+	wait_for_completion(&kt->kt_done);
+	rc = kthread_stop(task);
+
+	while (atomic_read(&ksend_mds) > 0)
+		schedule_timeout_uninterruptible(cfs_time_seconds(1) / 100);
+
+	kfree(kt->kt_buf);
+	kfree(kt);
+
+	return rc ?: sent;
+}
+
+static int __init ksend_init(void)
+{
+	struct lnet_process_id self;
+	long rate;
+	int nthreads;
+	int rc;
+	int i;
+
+	if (threads < 1 || threads > KSEND_THREADS_MAX || puts <= 0 ||
+	    hold_ms <= 0 ||
+	    portal - threads < LNET_RESERVED_PORTAL || portal >= MAX_PORTALS) {
+		pr_err(PREFIX " invalid threads=%d puts=%d portal=%d\n",
+		       run_id, threads, puts, portal);
+		return -EINVAL;
+	}
+
+	rc = LNetNIInit(LNET_PID_LUSTRE);
+	if (rc < 0)
+		return rc;
+
+	for (i = 0; LNetGetId(i, &self) == 0; i++) {
+		if (LNET_NETTYP(LNET_NIDNET(self.nid)) == LOLND)
+			break;
+	}
+	if (LNET_NETTYP(LNET_NIDNET(self.nid)) != LOLND) {
+		rc = -ENOENT;
+		goto out_fini;
+	}
+
+	ksend_eq = LNetEQAlloc(ksend_eq_handler);
+	if (IS_ERR(ksend_eq)) {
+		rc = PTR_ERR(ksend_eq);
+		goto out_fini;
+	}
+
+	for (nthreads = 1; ; nthreads = min(nthreads * 2, threads)) {
+		rate = ksend_run(self, nthreads);
+		if (rate < 0) {
+			rc = rate;
+			pr_err(PREFIX " test failed: rc = %d\n", run_id, rc);
+			break;
+		}
+
+		/* below message is checked in sanity-lnet.sh test_109 */
+		pr_err(PREFIX " %d threads on %d CPTs: %ld PUTs/s\n",
+		       run_id, nthreads, min_t(int, nthreads, LNET_CPT_NUMBER), rate);
+
+		if (nthreads == threads)
+			break;
+	}
+
+	if (rc == 0) {
+		rate = ksend_run_locked(self);
+		/* below messages are checked in sanity-lnet.sh test_109 */
+		if (rate == -EOPNOTSUPP) {
+			pr_err(PREFIX " loopback NID on CPT 0, lock test skipped\n",
+			       run_id);
+		} else if (rate < 0) {
+			rc = rate;
+			pr_err(PREFIX " lock test failed: rc = %d\n",
+			       run_id, rc);
+		} else {
+			pr_err(PREFIX " %ld PUTs while CPT 0 was locked for %d ms\n",
+			       run_id, rate, hold_ms);
+		}
+	}
+
+	LNetEQFree(ksend_eq);
+out_fini:
+	LNetNIFini();
+
+	/* Don't load. */
+	return rc ?: -EINVAL;
+}
+
+static void __exit ksend_exit(void)
+{
+}
+
+MODULE_AUTHOR("OpenSFS, Inc. <http://www.lustre.org/>");
+MODULE_DESCRIPTION("LNet multi-threaded send benchmark module");
+MODULE_VERSION(LUSTRE_VERSION_STRING);
+MODULE_LICENSE("GPL");
+
+module_init(ksend_init);
+module_exit(ksend_exit);
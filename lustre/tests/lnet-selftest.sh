@@ -155,7 +155,7 @@ test_smoke_sub () {
     echo 'trap "cleanup $pid" INT TERM'
     echo sleep $smoke_DURATION
     echo 'cleanup $pid'
-    
+    echo "$LST results c s"
 }
 
 run_lst () {
@@ -201,6 +201,9 @@ test_smoke () {
 
 	# error counters in "lst show_error" should be checked
 	check_lst_err $log
+	# test clients record the latency of their RPCs
+	awk '/^ *rpcs:/ { n += $2 } END { exit n == 0 }' $log ||
+		error "no RPC latency in lst results"
 	lst_cleanup_all
 }
 run_test smoke "lst regression test"
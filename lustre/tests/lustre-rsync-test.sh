@@ -374,6 +374,41 @@ test_2c() {
 }
 run_test 2c "Replicate files while dbench is running."
 
+# Test 2d - Replicate files changed by dbench with the pipelined mode
+test_2d() {
+	init_src
+	init_changelog
+
+	# Run dbench
+	sh rundbench -C -D $DIR/$tdir 2 -t $DBENCH_TIME || error "dbench failed"
+
+	# rewrite some files many times, only one copy each is needed
+	for i in $(seq 10); do
+		dd if=/dev/urandom of=$DIR/$tdir/f$i bs=64k count=16 \
+			2> /dev/null || error "dd failed"
+		for j in $(seq 5); do
+			dd if=/dev/urandom of=$DIR/$tdir/f$i bs=4k count=1 \
+				seek=$j conv=notrunc 2> /dev/null ||
+				error "dd failed"
+		done
+	done
+
+	local LRSYNC_LOG=$(generate_logname "lrsync_log")
+	# Replicate the changes to $TGT, with small batches to checkpoint
+	# often
+	$LRSYNC -s $DIR -t $TGT -t $TGT2 -m $MDT0 -u $CL_USER -l $LREPL_LOG \
+		-D $LRSYNC_LOG --threads 4 --batch 100 ||
+		error "$LRSYNC --threads failed"
+
+	check_diff $DIR/$tdir $TGT/$tdir
+	check_diff $DIR/$tdir $TGT2/$tdir
+
+	fini_changelog
+	cleanup_src_tgt
+	return 0
+}
+run_test 2d "Replicate files changed by dbench with --threads."
+
 # Test 3a - Replicate files created by createmany
 test_3a() {
 	init_src
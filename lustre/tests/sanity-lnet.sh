@@ -89,6 +89,25 @@ do_lnetctl() {
 	$LNETCTL "$@"
 }
 
+# Start lnet_selftest bulk writes of $3 bytes with concurrency $4 from the
+# NIDs $1 to the NIDs $2, lnet_selftest must be loaded on all of them
+lst_bulk_start() {
+	[[ -n "$LST" ]] || return 1
+	load_module ../lnet/selftest/lnet_selftest || return $?
+
+	export LST_SESSION=$$
+	$LST new_session --timeout 100 sanity_lnet_$$ || return $?
+	$LST add_group c $1 && $LST add_group s $2 && $LST add_batch bulk &&
+	$LST add_test --batch bulk --loop 100000000 --concurrency $4 \
+		--from c --to s brw write check=simple size=$3 &&
+		$LST run bulk || { lst_bulk_stop; return 1; }
+}
+
+lst_bulk_stop() {
+	$LST stop bulk
+	$LST end_session
+}
+
 TESTNS='test_ns'
 FAKE_IF="test1pg"
 FAKE_IP="10.1.2.3"
@@ -1041,6 +1060,10 @@ net:
               peer_credits: 8
               peer_buffer_credits: 0
               credits: 256
+          lnd tunables:
+              zerocopy: 0
+              rx_batch: 1
+              tls: 0
 route:
     - net: tcp7
       gateway: 7.7.7.7@tcp
@@ -1073,6 +1096,10 @@ net:
               peer_credits: 8
               peer_buffer_credits: 0
               credits: 256
+          lnd tunables:
+              zerocopy: 0
+              rx_batch: 1
+              tls: 0
 route:
     - net: tcp8
       gateway: 8.8.8.10@tcp
@@ -1142,6 +1169,442 @@ test_103() {
 }
 run_test 103 "Delete route with multiple gw (tcp)"
 
+test_104() {
+	have_interface "eth0" || skip "Need eth0 interface with ipv4 configured"
+	reinit_dlc || return $?
+	load_module ../lnet/klnds/socklnd/ksocklnd ||
+		error "Can't load ksocklnd.ko"
+	cat <<EOF > $TMP/sanity-lnet-$testnum.yaml
+net:
+    - net type: tcp
+      local NI(s):
+        - interfaces:
+              0: eth0
+          tunables:
+              peer_timeout: 180
+              peer_credits: 8
+              peer_buffer_credits: 0
+              credits: 256
+          lnd tunables:
+              zerocopy: 1
+              rx_batch: 8
+EOF
+	do_lnetctl import < $TMP/sanity-lnet-$testnum.yaml ||
+		error "Import failed $?"
+
+	local zerocopy=$($LNETCTL net show --net tcp -v |
+			 awk '/zerocopy:/ { print $2 }')
+	local rx_batch=$($LNETCTL net show --net tcp -v |
+			 awk '/rx_batch:/ { print $2 }')
+
+	[[ $rx_batch == 8 ]] || error "rx_batch is '$rx_batch', expected 8"
+	# kernels without MSG_ZEROCOPY keep using ZC-ACKs
+	[[ $zerocopy == 1 ]] ||
+		dmesg | grep -q "MSG_ZEROCOPY is not supported" ||
+		error "zerocopy is '$zerocopy', expected 1"
+
+	# with only the common tunables the module parameters apply
+	do_lnetctl net del --net tcp || error "net del failed $?"
+	sed -i '/lnd tunables:/,$d' $TMP/sanity-lnet-$testnum.yaml
+	do_lnetctl import < $TMP/sanity-lnet-$testnum.yaml ||
+		error "Import failed $?"
+
+	zerocopy=$($LNETCTL net show --net tcp -v |
+		   awk '/zerocopy:/ { print $2 }')
+	rx_batch=$($LNETCTL net show --net tcp -v |
+		   awk '/rx_batch:/ { print $2 }')
+
+	[[ $zerocopy == 0 ]] || error "zerocopy is '$zerocopy', expected 0"
+	[[ $rx_batch == 1 ]] || error "rx_batch is '$rx_batch', expected 1"
+}
+run_test 104 "Set socklnd zerocopy and rx_batch per NI (tcp)"
+
+test_105() {
+	local module=$LUSTRE/tests/kernel/kmatch.ko
+	local run_id=$RANDOM
+	local mes=4096
+	local first
+	local last
+
+	[ -f $module ] || skip "no $module"
+
+	reinit_dlc || return $?
+
+	# The module only reports the results and always fails to load
+	insmod $module run_id=$run_id mes=$mes classes=4 &> /dev/null
+
+	dmesg | grep "lustre_kmatch_$run_id:" ||
+		error "no matching latency reported"
+	first=$(dmesg | awk '/lustre_kmatch_'$run_id':/ { print $(NF - 2) }')
+	last=$(dmesg | awk '/lustre_kmatch_'$run_id':/ { print $NF }')
+
+	# MEs are looked up by their ignore-bits class, so matching the first
+	# or the last of 4096 MEs only tries the few MEs hashed with it, where
+	# a linear scan tries all of them for the last one
+	(( first > 0 && first * 64 <= mes )) ||
+		error "$first MEs tried to match the first ME"
+	(( last > 0 && last * 64 <= mes )) ||
+		error "$last MEs tried to match the last of $mes MEs"
+}
+run_test 105 "Match PUTs against many MEs with ignore bits"
+
+test_106() {
+	local param=/sys/module/lnet/parameters/lnet_arena_size
+	local hiwater
+	local cached
+	local i
+
+	reinit_dlc || return $?
+	[[ $(cat $param) -gt 0 ]] || skip "LNet arenas are disabled"
+
+	for i in {1..10}; do
+		$LNETCTL ping 0@lo > /dev/null || error "ping 0@lo failed"
+	done
+
+	$LNETCTL stats show | grep "_arena_"
+	hiwater=$($LNETCTL stats show | awk '/msgs_arena_hiwater:/ { print $2 }')
+	cached=$($LNETCTL stats show | awk '/msgs_arena_cached:/ { print $2 }')
+
+	# finished pings return their msgs to the arenas
+	(( hiwater > 0 )) || error "msgs_arena_hiwater is '$hiwater'"
+	(( cached <= hiwater )) ||
+		error "msgs_arena_cached $cached > msgs_arena_hiwater $hiwater"
+}
+run_test 106 "LNet msg arenas recycle freed msgs"
+
+test_107() {
+	local param=/sys/module/lnet/parameters/router_buffer_autoscale
+	local total
+	local old
+	local val
+
+	reinit_dlc || return $?
+	[[ -e $param ]] || skip "router buffer autoscaling not supported"
+	old=$(cat $param)
+	stack_trap "echo $old > $param" EXIT
+
+	do_lnetctl set routing 1 || error "Failed to enable routing $?"
+	stack_trap "$LNETCTL set routing 0" EXIT
+	do_lnetctl set tiny_buffers 512 || error "set tiny_buffers failed $?"
+	echo 1 > $param
+
+	$LNETCTL routing show
+	val=$($LNETCTL routing show | awk '/autoscale:/ { print $2 }')
+	[[ $val == 1 ]] || error "autoscale is '$val', expected 1"
+
+	# the autoscaler never shrinks a pool below its configured size,
+	# and the configured sizes are what gets exported
+	total=$($LNETCTL routing show | awk '/tiny:/ { tiny = 1 }
+		tiny && /nbuffers:/ { n = $2 }
+		tiny && /configured:/ { tiny = 0; sum += $2
+			if (n < $2) bad = 1 }
+		END { print bad ? -1 : sum }')
+	(( total > 0 )) || error "bad tiny pool sizes"
+
+	val=$($LNETCTL export --backup | awk '/tiny:/ { print $2 }')
+	[[ $val == $total ]] ||
+		error "exported $val tiny buffers, $total configured"
+}
+run_test 107 "Router buffer autoscaler keeps the configured pool sizes"
+
+# sum of the $2 values of the $1 pool over all CPTs in "routing show"
+routing_pool_sum() {
+	$LNETCTL routing show | awk -v pool="$1:" -v key="$2:" '
+		$1 == "tiny:" || $1 == "small:" || $1 == "large:" {
+			cur = $1 }
+		cur == pool && $1 == key { sum += $2 }
+		END { print sum + 0 }'
+}
+
+test_107b() {
+	local param=/sys/module/lnet/parameters
+	local grown
+	local shrunk
+	local boosted=0
+	local i
+
+	[[ -n "$RTR_CLIENT_NID" && -n "$RTR_SERVER_NID" ]] ||
+		skip "RTR_CLIENT_NID and RTR_SERVER_NID routed through this node needed"
+	[[ -e $param/router_buffer_autoscale ]] ||
+		skip "router buffer autoscaling not supported"
+
+	for i in router_buffer_autoscale router_buffer_autoscale_interval; do
+		stack_trap "echo $(cat $param/$i) > $param/$i" EXIT
+	done
+
+	do_lnetctl set routing 1 || error "Failed to enable routing $?"
+	stack_trap "$LNETCTL set routing 0" EXIT
+	# too few large buffers for 1MB bulks at any concurrency
+	do_lnetctl set large_buffers 16 || error "set large_buffers failed $?"
+	echo 1 > $param/router_buffer_autoscale_interval
+	echo 1 > $param/router_buffer_autoscale
+
+	lst_bulk_start $RTR_CLIENT_NID $RTR_SERVER_NID 1M 64 ||
+		error "lnet_selftest bulk failed to start"
+	for i in $(seq 20); do
+		sleep 1
+		boosted=$($LNETCTL routing show |
+			  awk '/boosted_credits:/ { sum += $2 }
+			       END { print sum + 0 }')
+		(( boosted > 0 )) && break
+	done
+	grown=$(routing_pool_sum large grown)
+	$LNETCTL routing show
+	lst_bulk_stop
+
+	(( grown > 0 )) || error "large pool did not grow under load"
+	(( boosted > 0 )) || error "no peer was lent router credits"
+
+	# idle pools shrink back after a few checks, and lent credits
+	# are taken back
+	for i in $(seq 30); do
+		shrunk=$(routing_pool_sum large shrunk)
+		(( shrunk > 0 )) && break
+		sleep 1
+	done
+	$LNETCTL routing show
+	(( shrunk > 0 )) || error "large pool did not shrink once idle"
+	boosted=$($LNETCTL routing show |
+		  awk '/boosted_credits:/ { sum += $2 } END { print sum + 0 }')
+	(( boosted == 0 )) || error "$boosted credits still lent when idle"
+	(( $(routing_pool_sum large nbuffers) >=
+	   $(routing_pool_sum large configured) )) ||
+		error "large pool shrank below its configured size"
+}
+run_test 107b "Router buffer autoscaler grows pools and lends credits"
+
+test_108() {
+	local params=/sys/module/ko2iblnd/parameters
+	local nid
+	local sent
+	local i
+
+	# Pings to a local NID are looped back above the LND, so the CQ
+	# polling is only exercised against another node's o2ib NID
+	[[ -n "$O2IB_PEER_NID" ]] ||
+		skip "O2IB_PEER_NID of a peer on the same o2ib net needed"
+	have_interface "eth0" || skip "Need eth0 interface with ipv4 configured"
+
+	if ! ls /sys/class/infiniband 2> /dev/null | grep -q .; then
+		which rdma > /dev/null 2>&1 || skip "Need rdma tool for soft-RoCE"
+		modprobe rdma_rxe 2> /dev/null || skip "Need rdma_rxe module"
+		rdma link add rxe_lnet type rxe netdev eth0 ||
+			skip "Can't add soft-RoCE device"
+		stack_trap "rdma link delete rxe_lnet" EXIT
+	fi
+
+	reinit_dlc || return $?
+	load_module ../lnet/klnds/o2iblnd/ko2iblnd poll_batch=16 \
+		cq_moderation=8 || error "Can't load ko2iblnd.ko"
+	stack_trap "$LNETCTL net del --net ${O2IB_PEER_NID#*@}" EXIT
+
+	do_lnetctl net add --net ${O2IB_PEER_NID#*@} --if eth0 ||
+		error "net add failed $?"
+	nid=$($LNETCTL net show --net ${O2IB_PEER_NID#*@} |
+	      awk '/- nid:/ { print $NF }')
+	[[ -n $nid ]] || skip "no IB or soft-RoCE NI on eth0"
+	[[ $nid != $O2IB_PEER_NID ]] || error "O2IB_PEER_NID is local"
+
+	[[ $(cat $params/poll_batch) == 16 ]] || error "poll_batch not set"
+	for i in {1..10}; do
+		$LNETCTL ping $O2IB_PEER_NID > /dev/null ||
+			error "ping $O2IB_PEER_NID failed"
+	done
+	sent=$($LNETCTL net show -v --net ${O2IB_PEER_NID#*@} |
+	       awk '/send_count:/ { print $NF; exit }')
+	(( sent >= 10 )) || error "only $sent messages sent over $nid"
+
+	# the polling mode can be switched off at runtime
+	echo 1 > $params/poll_batch
+	$LNETCTL ping $O2IB_PEER_NID > /dev/null ||
+		error "ping $O2IB_PEER_NID failed"
+}
+run_test 108 "o2iblnd batched CQ polling to an o2ib peer"
+
+test_109() {
+	local module=$LUSTRE/tests/kernel/ksend.ko
+	local run_id=$RANDOM
+	local threads
+	local sent
+
+	[ -f $module ] || skip "no $module"
+
+	reinit_dlc || return $?
+
+	threads=$($LCTL get_param -n cpu_partition_table | wc -l)
+	(( threads > 1 )) || skip "need at least 2 CPTs"
+	(( threads <= 16 )) || threads=16
+
+	# The module only reports the results and always fails to load
+	insmod $module run_id=$run_id threads=$threads &> /dev/null
+
+	dmesg | grep "lustre_ksend_$run_id:" ||
+		error "no send rate reported"
+	dmesg | grep -q "lustre_ksend_$run_id: .*lock test skipped" &&
+		skip "loopback NID is on CPT 0"
+	sent=$(dmesg | awk '/lustre_ksend_'$run_id':.*while CPT 0 was locked/ {
+		print $(NF - 9) }')
+	[[ -n $sent ]] || error "lock test failed"
+
+	# Sending and receiving on another CPT must not need CPT 0's lock
+	(( sent >= 1000 )) ||
+		error "only $sent PUTs sent while CPT 0 was locked"
+}
+run_test 109 "Send PUTs on other CPTs while CPT 0 is locked"
+
+test_110() {
+	local key=${TLS_KEY:-$(head -c 32 /dev/urandom | od -An -tx1 |
+			      tr -d ' \n')}
+	local nid
+	local before
+	local after
+	local tls
+
+	have_interface "eth0" || skip "Need eth0 interface with ipv4 configured"
+	reinit_dlc || return $?
+	load_module ../lnet/klnds/socklnd/ksocklnd tls_key=$key ||
+		error "Can't load ksocklnd.ko"
+	cat <<EOF > $TMP/sanity-lnet-$testnum.yaml
+net:
+    - net type: tcp
+      local NI(s):
+        - interfaces:
+              0: eth0
+          lnd tunables:
+              tls: 1
+EOF
+	if ! do_lnetctl import < $TMP/sanity-lnet-$testnum.yaml; then
+		dmesg | grep -q "kernel TLS is not supported" &&
+			skip "kernel TLS is not supported"
+		error "Import failed $?"
+	fi
+
+	tls=$($LNETCTL net show --net tcp -v | awk '/tls:/ { print $2 }')
+	[[ $tls == 1 ]] || error "tls is '$tls', expected 1"
+
+	# the peer runs lnet_selftest on a tls NI set up with TLS_KEY
+	[[ -n "$TLS_PEER_NID" && -n "$TLS_KEY" ]] || return 0
+
+	nid=$($LNETCTL net show --net tcp | awk '/- nid:/ { print $NF }')
+	before=$($LNETCTL stats show | awk '/send_length:/ { print $2 }')
+	lst_bulk_start $nid $TLS_PEER_NID 1M 8 ||
+		error "lnet_selftest bulk to $TLS_PEER_NID failed to start"
+	sleep 10
+	if [[ -e /proc/net/tls_stat ]]; then
+		awk '/TlsCurr(Tx|Rx)Sw/ { sum += $2 } END { exit sum == 0 }' \
+			/proc/net/tls_stat || error "no kernel TLS sessions"
+	fi
+	lst_bulk_stop
+	after=$($LNETCTL stats show | awk '/send_length:/ { print $2 }')
+
+	# the client sends the brw write bulks, so the data went through
+	# the encrypted sockets
+	echo "$(((after - before) / 10485760)) MB/s over kernel TLS"
+	(( after - before >= 10 * 1048576 )) ||
+		error "only $((after - before)) bytes sent to $TLS_PEER_NID"
+	dmesg | grep -q "Can't set kernel TLS keys" &&
+		error "kernel TLS setup failed"
+	return 0
+}
+run_test 110 "Encrypt socklnd connections with kernel TLS (tcp)"
+
+peer_state() {
+	$LNETCTL peer show --nid $1 -v 3 | awk '/peer state:/ { print $3 }'
+}
+
+test_111() {
+	have_interface "eth0" || skip "Need eth0 interface with ipv4 configured"
+	add_net "tcp" "eth0"
+	local cache=$TMP/sanity-lnet-$testnum-peers.yaml
+	local seeded=$((1 << 18))
+	local configured=$((1 << 3))
+	local state
+
+	do_lnetctl peer add --prim_nid 111.111.111.111@tcp \
+		--nid 111.111.111.[112-113]@tcp || error "peer add failed $?"
+	do_lnetctl peer save $cache || error "peer save failed $?"
+	grep -q "111.111.111.113@tcp" $cache ||
+		error "peer NID missing from the peer cache"
+	do_lnetctl peer del --prim_nid 111.111.111.111@tcp ||
+		error "peer del failed $?"
+
+	do_lnetctl peer load $cache || error "peer load failed $?"
+	$LNETCTL peer show --nid 111.111.111.111@tcp |
+		grep -q "111.111.111.113@tcp" ||
+		error "peer NID not seeded"
+	state=$(peer_state 111.111.111.111@tcp)
+	(( (state & seeded) && !(state & configured) )) ||
+		error "peer state $state, expected seeded"
+
+	# a configured peer is never overridden by the cache
+	do_lnetctl peer del --prim_nid 111.111.111.111@tcp ||
+		error "peer del failed $?"
+	do_lnetctl peer add --prim_nid 111.111.111.111@tcp ||
+		error "peer add failed $?"
+	do_lnetctl peer load $cache || error "peer load failed $?"
+	state=$(peer_state 111.111.111.111@tcp)
+	(( !(state & seeded) && (state & configured) )) ||
+		error "peer state $state, expected configured"
+	$LNETCTL peer show --nid 111.111.111.111@tcp |
+		grep -q "111.111.111.113@tcp" &&
+		error "configured peer changed by the peer cache"
+	return 0
+}
+run_test 111 "Seed peers from a saved peer cache (tcp)"
+
+ni_send_count() {
+	$LNETCTL net show -v |
+		awk '/- nid:/ { nid = $NF }
+		     /send_count:/ && nid == "'$1'" { print $NF; exit }'
+}
+
+test_112() {
+	local param=/sys/module/lnet/parameters/lnet_bulk_stripe
+	local net=${MR_PEER_NID#*@}
+	local nids
+	local before
+	local after
+
+	[[ -n "$MR_PEER" && -n "$MR_PEER_NID" ]] ||
+		skip "MR_PEER host and its MR_PEER_NID with two NIs needed"
+	[[ -e $param ]] || skip "bulk striping not supported"
+
+	nids=($($LNETCTL net show --net $net | awk '/- nid:/ { print $NF }'))
+	(( ${#nids[@]} >= 2 )) || skip "need two local NIs on $net"
+
+	stack_trap "echo $(cat $param) > $param" EXIT
+	do_node $MR_PEER modprobe lnet_selftest ||
+		error "Can't load lnet_selftest on $MR_PEER"
+	# the peer only sends to ${nids[0]}, so without striping every bulk
+	# is sent from that NI as well
+	do_node $MR_PEER "$LNETCTL peer del --prim_nid ${nids[0]}; \
+		$LNETCTL peer add --prim_nid ${nids[0]} --non_mr" ||
+		error "Can't add ${nids[0]} as a non-MR peer on $MR_PEER"
+	stack_trap "do_node $MR_PEER $LNETCTL peer del --prim_nid ${nids[0]}" EXIT
+
+	# this node is the lnet_selftest server, it GETs the 1MB bulks
+	echo 1 > $param
+	before=$(ni_send_count ${nids[1]})
+	lst_bulk_start $MR_PEER_NID ${nids[0]} 1M 8 ||
+		error "lnet_selftest bulk failed to start"
+	sleep 5
+	lst_bulk_stop
+	after=$(ni_send_count ${nids[1]})
+	echo "${nids[1]} sent $((after - before)) messages with striping"
+	(( after - before > 100 )) || error "bulks not striped to ${nids[1]}"
+
+	echo 0 > $param
+	before=$(ni_send_count ${nids[1]})
+	lst_bulk_start $MR_PEER_NID ${nids[0]} 1M 8 ||
+		error "lnet_selftest bulk failed to start"
+	sleep 5
+	lst_bulk_stop
+	after=$(ni_send_count ${nids[1]})
+	echo "${nids[1]} sent $((after - before)) messages without striping"
+	(( after - before < 10 )) || error "bulks striped to ${nids[1]}"
+}
+run_test 112 "Stripe the bulks to a Multi-Rail peer across NIs"
+
 ### load lnet in default namespace, configure in target namespace
 
 test_200() {
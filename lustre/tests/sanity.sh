@@ -7150,6 +7150,116 @@ test_56ca() {
 }
 run_test 56ca "check lfs find --mirror-count|-N and --mirror-state"
 
+test_56cb() {
+	local dir=$DIR/$tdir
+	local serial=$TMP/$tfile.serial
+	local parallel=$TMP/$tfile.parallel
+	local bench=$LUSTRE/tests/find_bench
+
+	[[ -x $bench ]] || bench=$(which find_bench 2> /dev/null)
+	[[ -n "$bench" ]] || skip_env "find_bench not found"
+
+	$bench -c -d 3 -w 4 -f 16 -t 1,2,4 $dir ||
+		error "find_bench failed"
+
+	$LFS find $dir | sort > $serial
+	$LFS find --threads 4 $dir | sort > $parallel
+	diff -u $serial $parallel ||
+		error "lfs find --threads output differs from serial find"
+
+	$LFS find $dir -type f -name "f1*" | sort > $serial
+	$LFS find --threads 8 $dir -type f -name "f1*" | sort > $parallel
+	diff -u $serial $parallel ||
+		error "lfs find --threads with filters differs from serial find"
+
+	$LFS find --threads 4 --maxdepth 1 $dir | sort > $parallel
+	$LFS find --maxdepth 1 $dir | sort > $serial
+	diff -u $serial $parallel ||
+		error "lfs find --threads --maxdepth differs from serial find"
+
+	rm -f $serial $parallel
+}
+run_test 56cb "lfs find --threads matches serial lfs find"
+
+test_56cc() {
+	local dir=$DIR/$tdir
+	local nrfiles=1000
+	local expected=$TMP/$tfile.expected
+	local found=$TMP/$tfile.found
+
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep batch_getattr)" ] &&
+		skip "MDS does not support batched getattr"
+
+	test_mkdir $dir
+	createmany -o $dir/f $nrfiles || error "createmany failed"
+	for ((i = 0; i < nrfiles; i += 3)); do
+		echo data > $dir/f$i || error "write $dir/f$i failed"
+	done
+
+	cancel_lru_locks mdc
+	lctl set_param -n mdc.*.stats=clear
+	$LFS find $dir -type f -size +0 | sort > $found
+	local batches=$(calc_stats mdc.*.stats mds_batch_getattr)
+	local getattrs=$(calc_stats mdc.*.stats mds_getattr)
+
+	echo "batches: $batches getattrs: $getattrs"
+	(( batches > 0 )) || error "no MDS_BATCH_GETATTR sent"
+	(( batches <= nrfiles / 64 )) ||
+		error "too many MDS_BATCH_GETATTR: $batches"
+	(( getattrs < nrfiles / 10 )) ||
+		error "too many MDS_GETATTR: $getattrs"
+
+	find $dir -type f -size +0 | sort > $expected
+	diff -u $expected $found ||
+		error "lfs find with batched getattr returned wrong files"
+
+	rm -f $expected $found
+}
+run_test 56cc "lfs find uses batched getattr"
+
+test_56cd() {
+	local dir=$DIR/$tdir
+	local nrfiles=200
+	local expected=$TMP/$tfile.expected
+	local found=$TMP/$tfile.found
+	local mdts=$(comma_list $(mdts_nodes))
+
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep batch_getattr)" ] &&
+		skip "MDS does not support batched getattr"
+
+	test_mkdir $dir
+	createmany -o $dir/f $nrfiles || error "createmany failed"
+	for ((i = 0; i < nrfiles; i += 3)); do
+		echo data > $dir/f$i || error "write $dir/f$i failed"
+	done
+
+	# reconnect to MDTs which don't grant OBD_CONNECT2_BATCH_GETATTR
+	#define OBD_FAIL_MDS_NO_BATCH_GETATTR	0x169
+	do_nodes $mdts $LCTL set_param fail_loc=0x169
+	stack_trap "do_nodes $mdts $LCTL set_param fail_loc=0; \
+		    remount_client $MOUNT" EXIT
+	remount_client $MOUNT || error "remount_client failed"
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep batch_getattr)" ] ||
+		error "batch_getattr still negotiated"
+
+	lctl set_param -n mdc.*.stats=clear
+	$LFS find $dir -type f -size +0 | sort > $found
+	$LFS find --threads 4 $dir -type f -size +0 | sort > $found.mt
+	local batches=$(calc_stats mdc.*.stats mds_batch_getattr)
+
+	echo "batches: $batches"
+	(( batches == 0 )) || error "$batches MDS_BATCH_GETATTR sent"
+
+	find $dir -type f -size +0 | sort > $expected
+	diff -u $expected $found ||
+		error "lfs find without batched getattr returned wrong files"
+	diff -u $expected $found.mt ||
+		error "lfs find --threads without batched getattr wrong files"
+
+	rm -f $expected $found $found.mt
+}
+run_test 56cd "lfs find falls back without batched getattr"
+
 test_57a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 	# note test will not do anything if MDS is not local
@@ -7679,6 +7789,40 @@ test_64d() {
 }
 run_test 64d "check grant limit exceed"
 
+test_64e() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	$LCTL get_param -n osc.*.cpt_affinity >/dev/null 2>&1 ||
+		skip "no cpt_affinity support"
+
+	local osc=$FSNAME-OST0000-osc-[^M]*
+	local old=$($LCTL get_param -n osc.$osc.cpt_affinity)
+	local rpcs
+	local local_rpcs
+
+	stack_trap "$LCTL set_param -n osc.$osc.cpt_affinity=$old" EXIT
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile || error "setstripe failed"
+
+	for aff in 0 1; do
+		$LCTL set_param -n osc.$osc.cpt_affinity=$aff
+		$LCTL set_param -n osc.$osc.cpt_stats=clear
+		taskset -c 0 dd if=/dev/zero of=$DIR/$tfile bs=1M count=16 \
+			conv=fsync || error "dd with cpt_affinity=$aff failed"
+
+		$LCTL get_param osc.$osc.cpt_stats
+		rpcs=$($LCTL get_param -n osc.$osc.cpt_stats |
+			awk -F'write_rpcs: ' '/cpt:/ { split($2, a, ","); n += a[1] }
+				END { print n + 0 }')
+		local_rpcs=$($LCTL get_param -n osc.$osc.cpt_stats |
+			awk -F'write_local: ' '/cpt:/ { split($2, a, " "); n += a[1] }
+				END { print n + 0 }')
+		(( rpcs > 0 )) ||
+			error "no write RPCs accounted with cpt_affinity=$aff"
+		(( aff == 0 || local_rpcs == rpcs )) ||
+			error "only $local_rpcs/$rpcs write RPCs completed locally"
+	done
+}
+run_test 64e "osc cpt_affinity keeps write RPCs on the writer's CPT"
+
 # bug 1414 - set/get directories' stripe info
 test_65a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
@@ -8585,6 +8729,24 @@ test_77l() {
 }
 run_test 77l "preferred checksum type is remembered after reconnected"
 
+test_77m() {
+	local module=$LUSTRE/tests/kernel/kcksum.ko
+	local run_id=$RANDOM
+	local alg
+
+	[ -f $module ] || skip "no $module"
+
+	# The module only reports the results and always fails to load
+	insmod $module run_id=$run_id &> /dev/null
+
+	dmesg | grep "lustre_kcksum_$run_id:"
+	for alg in adler32 crc32 crc32c; do
+		dmesg | grep -q "lustre_kcksum_$run_id: $alg: per-page" ||
+			error "no $alg checksum speed reported"
+	done
+}
+run_test 77m "bulk checksum per-page and batched throughput"
+
 [ "$ORIG_CSUM" ] && set_checksums $ORIG_CSUM || true
 rm -f $F77_TMP
 unset F77_TMP
@@ -9233,6 +9395,79 @@ test_101h() {
 }
 run_test 101h "Readahead should cover current read window"
 
+test_101i() {
+	local streams=$($LCTL get_param -n llite.*.max_read_ahead_streams |
+			head -n 1)
+	[ -n "$streams" ] || skip "no multi-stream readahead"
+
+	$LCTL set_param llite.*.max_read_ahead_streams=0 &&
+		error "max_read_ahead_streams=0 should fail"
+	stack_trap "$LCTL set_param llite.*.max_read_ahead_streams=$streams" \
+		EXIT
+	$LCTL set_param llite.*.max_read_ahead_streams=8 ||
+		error "set max_read_ahead_streams=8 failed"
+
+	$LFS setstripe -c 1 -i 0 $DIR/$tfile
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=64 ||
+		error "dd 64M file failed"
+	local fid=$($LFS path2fid $DIR/$tfile)
+	cancel_lru_locks osc
+
+	# four streams interleaved through the same file descriptor, 64KiB
+	# at a time from each quarter of the file
+	local cmd="o"
+	local i
+	local j
+
+	for ((j = 0; j < 256; j++)); do
+		for i in 0 1 2 3; do
+			cmd+="z$(((i * 256 + j) * 65536))r65536"
+		done
+	done
+	cmd+="c"
+
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	$LCTL set_param -n llite.*.read_ahead_stream_stats 0
+	$MULTIOP $DIR/$tfile $cmd || error "interleaved reads failed"
+
+	$LCTL get_param llite.*.read_ahead_stream_stats
+	local nr=$($LCTL get_param -n llite.*.read_ahead_stream_stats |
+		   awk -v fid="$fid" '/^- fid:/ { found = ($3 == fid) }
+				      found && /stream:/ { n++ }
+				      END { print n + 0 }')
+	(( nr >= 4 )) || error "expected >= 4 streams for $fid, got $nr"
+
+	local hits=$($LCTL get_param -n llite.*.read_ahead_stats |
+		     get_named_value 'hits' | cut -d" " -f1 | calc_total)
+	local miss=$($LCTL get_param -n llite.*.read_ahead_stats |
+		     get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	echo "hits $hits misses $miss"
+	(( hits > miss * 10 )) ||
+		error "too many misses with interleaved streams: $miss/$hits"
+
+	# the same pattern defeats the single read-ahead state of the file
+	$LCTL set_param llite.*.max_read_ahead_streams=1
+	cancel_lru_locks osc
+	$LCTL set_param -n llite.*.read_ahead_stats 0
+	$MULTIOP $DIR/$tfile $cmd || error "interleaved reads failed"
+
+	local miss1=$($LCTL get_param -n llite.*.read_ahead_stats |
+		      get_named_value 'misses' | cut -d" " -f1 | calc_total)
+	echo "misses $miss1 with a single stream"
+	(( miss1 > miss * 4 )) ||
+		error "single stream misses $miss1 not above $miss * 4"
+
+	# a single stream per open file is the old behaviour
+	cp $DIR/$tfile $DIR/$tfile.2 || error "cp failed"
+	cancel_lru_locks osc
+	fid=$($LFS path2fid $DIR/$tfile.2)
+	cat $DIR/$tfile.2 > /dev/null
+	$LCTL get_param -n llite.*.read_ahead_stream_stats | grep -q "$fid" &&
+		error "streams tracked with max_read_ahead_streams=1"
+	rm -f $DIR/$tfile $DIR/$tfile.2
+}
+run_test 101i "multi-stream readahead on a shared file"
+
 setup_test102() {
 	test_mkdir $DIR/$tdir
 	chown $RUNAS_ID $DIR/$tdir
@@ -11511,6 +11746,135 @@ test_124d() {
 }
 run_test 124d "cancel very aged locks if lru-resize diasbaled"
 
+test_124e() {
+	local module=$LUSTRE/tests/kernel/kreprocess.ko
+	local run_id=$RANDOM
+	local count
+
+	[ -f $module ] || skip "no $module"
+
+	# The module only reports the results and always fails to load
+	insmod $module run_id=$run_id &> /dev/null
+
+	dmesg | grep "lustre_kreprocess_$run_id:"
+	dmesg | grep -q "lustre_kreprocess_$run_id: no server support" &&
+		skip "no server support"
+	for count in 16 64 256 1024; do
+		dmesg | grep -q "lustre_kreprocess_$run_id: $count waiting locks: .* ns/cancel" ||
+			error "no reprocess time reported for $count waiting locks"
+	done
+	# a cancel grants the lock waiting behind it, even if the first
+	# waiting lock is still blocked
+	dmesg | grep -q "lustre_kreprocess_$run_id: 1024 waiting locks: .*, 1023 granted early" ||
+		error "waiting locks were not granted early"
+}
+run_test 124e "extent lock reprocess time against waiting locks"
+
+test_124f() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local nr=500
+	local param
+
+	for param in lru_hits lru_misses lru_ghost_hits lru_protected_count \
+		     lru_protected_ratio; do
+		$LCTL get_param -n $nsdir.$param > /dev/null ||
+			error "no $param in $nsdir"
+	done
+
+	test_mkdir -i0 -c1 $DIR/$tdir
+	touch $DIR/$tdir/hot || error "touch $DIR/$tdir/hot failed"
+	test_mkdir -i0 -c1 $DIR/$tdir/cold
+	createmany -o $DIR/$tdir/cold/f $nr ||
+		error "failed to create $nr files in $DIR/$tdir/cold"
+	stack_trap "unlinkmany $DIR/$tdir/cold/f $nr" EXIT
+
+	lru_resize_disable mdc
+	stack_trap "lru_resize_enable mdc" EXIT
+	cancel_lru_locks mdc
+
+	# the locks of a file reused while unused get protected
+	local hits=$($LCTL get_param -n $nsdir.lru_hits)
+
+	stat $DIR/$tdir/hot > /dev/null
+	stat $DIR/$tdir/hot > /dev/null
+	(( $($LCTL get_param -n $nsdir.lru_hits) > hits )) ||
+		error "no LRU hit on reused lock"
+	(( $($LCTL get_param -n $nsdir.lru_protected_count) > 0 )) ||
+		error "no protected lock"
+
+	# a scan of many files used once doesn't flush them
+	$LCTL set_param -n $nsdir.lru_size=$((nr / 10))
+	ls -l $DIR/$tdir/cold > /dev/null
+
+	$LCTL set_param -n mdc.*.stats=clear
+	stat $DIR/$tdir/hot > /dev/null
+	local enq=$(calc_stats mdc.*MDT0000*.stats ldlm_ibits_enqueue)
+
+	$LCTL get_param $nsdir.lock_unused_count $nsdir.lru_*
+	(( enq == 0 )) || error "$enq enqueues for reused file after scan"
+}
+run_test 124f "client lock LRU keeps reused locks over a scan"
+
+match_cache_hits() {
+	$LCTL get_param -n ldlm.namespaces.*mdc*.match_cache_hits \
+		ldlm.namespaces.*osc*.match_cache_hits |
+		awk '{ sum += $1 } END { print sum + 0 }'
+}
+
+test_124g() {
+	local dir=$DIR/$tdir
+	local bench=$LUSTRE/tests/stat_bench
+	local nsdir="ldlm.namespaces.*-MDT0000-mdc-*"
+	local before
+	local after
+	local param
+	local val
+
+	[[ -x $bench ]] || bench=$(which stat_bench 2> /dev/null)
+	[[ -n "$bench" ]] || skip_env "stat_bench not found"
+
+	$LCTL get_param -n $nsdir.match_cache > /dev/null ||
+		error "no match_cache in $nsdir"
+	stack_trap "$LCTL set_param -n ldlm.namespaces.*mdc*.match_cache=1 \
+		ldlm.namespaces.*osc*.match_cache=1" EXIT
+
+	test_mkdir -i0 -c1 $dir
+	$LFS setstripe -c 1 -i 0 $dir
+	$bench -c -f 4 -n 10 -t 1 $dir || error "stat_bench create failed"
+
+	for val in 0 1; do
+		$LCTL set_param -n ldlm.namespaces.*mdc*.match_cache=$val \
+			ldlm.namespaces.*osc*.match_cache=$val
+		before=$(match_cache_hits)
+		echo "match_cache=$val stat:"
+		$bench -f 4 -n 20000 -t 1,2,4,8 $dir ||
+			error "stat_bench failed with match_cache=$val"
+		echo "match_cache=$val read:"
+		$bench -r -f 4 -n 20000 -t 1,2,4,8 $dir ||
+			error "stat_bench -r failed with match_cache=$val"
+		after=$(match_cache_hits)
+		echo "match_cache=$val: $((after - before)) match cache hits"
+
+		if (( val == 0 )); then
+			(( after == before )) ||
+				error "$((after - before)) hits while disabled"
+		else
+			# the reads alone are 15 x 20000 lock matches on the
+			# same 4 files, nearly all of them cached
+			(( after - before > 100000 )) ||
+				error "only $((after - before)) hits"
+		fi
+	done
+
+	# data read through cached locks is still the data written
+	cancel_lru_locks osc
+	$bench -r -f 4 -n 1000 -t 8 $dir || error "stat_bench -r failed"
+	cmp -n 4096 $dir/f0 $dir/f3 || error "$dir/f0 and $dir/f3 differ"
+}
+run_test 124g "lockless lock match with many threads stat and read"
+
 test_125() { # 13358
 	$LCTL get_param -n llite.*.client_type | grep -q local ||
 		skip "must run as local client"
@@ -14461,6 +14825,47 @@ test_160k() {
 }
 run_test 160k "Verify that changelog records are not lost"
 
+test_160l() {
+	[ $PARALLEL == "yes" ] && skip "skip parallel run"
+	remote_mds_nodsh && skip "remote MDS with nodsh"
+
+	local bench=$LUSTRE/tests/changelog_bench
+
+	[[ -x $bench ]] || bench=$(which changelog_bench 2> /dev/null)
+	[[ -n "$bench" ]] || skip_env "changelog_bench not found"
+
+	changelog_register || error "changelog_register failed"
+	local cl_user="${CL_USERS[$SINGLEMDS]%% *}"
+	local mdt=$(facet_svc $SINGLEMDS)
+	local i
+
+	# several records per file, spread over a few directories
+	test_mkdir -c1 $DIR/$tdir
+	for i in $(seq 16); do
+		mkdir $DIR/$tdir/d$i || error "mkdir d$i failed"
+		createmany -o $DIR/$tdir/d$i/f 200 ||
+			error "create in d$i failed"
+	done
+	chmod 0600 $DIR/$tdir/d*/f* || error "chmod failed"
+	touch $DIR/$tdir/d*/f* || error "touch failed"
+	for i in $(seq 16); do
+		unlinkmany $DIR/$tdir/d$i/f 200 ||
+			error "unlink in d$i failed"
+	done
+
+	local last=$($LFS changelog $mdt | tail -n 1 | awk '{ print $1 }')
+
+	# the benchmark checks that the records of each FID are processed
+	# in order by one worker, and that every run sees the same records
+	$bench -u $cl_user -t 1,2,4,8 $mdt || error "changelog_bench failed"
+
+	local rec=$(changelog_user_rec $SINGLEMDS $cl_user)
+
+	(( rec >= last )) ||
+		error "$cl_user cleared up to $rec, last record $last"
+}
+run_test 160l "parallel changelog consumer keeps per-FID order"
+
 test_161a() {
 	[ $PARALLEL == "yes" ] && skip "skip parallel run"
 
@@ -15738,6 +16143,46 @@ test_205b() {
 }
 run_test 205b "Verify job stats jobid parsing"
 
+test_205c() {
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	[ -z "$(lctl get_param -n mdc.*.connect_flags | grep jobstats)" ] &&
+		skip "Server doesn't support jobstats"
+	[[ $JOBID_VAR = disable ]] && skip_env "jobstats is disabled"
+
+	local old_jobvar=$($LCTL get_param -n jobid_var)
+	local old_jobname=$($LCTL get_param -n jobid_name)
+	local ost=$(convert_facet2label ost1)
+	local param=obdfilter.$ost.job_latency_max
+	local old_max=$(do_facet ost1 $LCTL get_param -n $param)
+	local pcts="p50: [0-9]*, p90: [0-9]*, p99: [0-9]*, p999: [0-9]*"
+	local jobid=id.205c.$RANDOM
+
+	stack_trap "$LCTL set_param jobid_var=$old_jobvar \
+		jobid_name=$old_jobname" EXIT
+	stack_trap "do_facet ost1 $LCTL set_param $param=$old_max" EXIT
+
+	$LCTL set_param jobid_var=nodelocal jobid_name=$jobid
+	$LFS setstripe -i 0 -c 1 $DIR/$tfile
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd failed"
+	do_facet ost1 $LCTL get_param obdfilter.$ost.job_stats |
+		grep -A 13 "job_id:.*$jobid" | grep "write:" |
+		grep "latency_us: { $pcts, max: [0-9]* }" ||
+		error "no write latency for $jobid"
+
+	# histograms of new jobs are not allocated over the memory limit
+	do_facet ost1 $LCTL set_param $param=0
+	jobid=id.205c.$RANDOM
+	$LCTL set_param jobid_name=$jobid
+	dd if=/dev/zero of=$DIR/$tfile bs=1M count=4 oflag=direct ||
+		error "dd failed"
+	do_facet ost1 $LCTL get_param obdfilter.$ost.job_stats |
+		grep -A 13 "job_id:.*$jobid" | grep "write:" |
+		grep latency_us && error "latency kept over job_latency_max"
+	true
+}
+run_test 205c "Verify job stats latency histograms"
+
 # LU-1480, LU-1773 and LU-1657
 test_206() {
 	mkdir -p $DIR/$tdir
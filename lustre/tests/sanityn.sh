@@ -4212,6 +4212,46 @@ test_77n() { #LU-10802
 }
 run_test 77n "check wildcard support for TBF JobID NRS policy"
 
+test_77o() {
+	[ "$OST1_VERSION" -lt $(version_code 2.13.52) ] &&
+		skip "Need OST version at least 2.13.52"
+
+	local nodes=$(comma_list $(osts_nodes))
+
+	do_nodes $nodes lctl set_param ost.OSS.ost_io.nrs_policies=deadline \
+		ost.OSS.ost_io.nrs_deadline_max_wait=500 \
+		ost.OSS.ost_io.nrs_deadline_classes="start\ dl_runas\ uid={$RUNAS_ID}\ target=10" ||
+		error "Failed to set deadline policy"
+	stack_trap "do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_policies=fifo" EXIT
+
+	# a class needs a target, and a name can only be used once
+	do_facet ost1 lctl set_param ost.OSS.ost_io.nrs_deadline_classes="start\ dl_bad\ uid={0}" &&
+		error "class without target should be rejected"
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_deadline_classes |
+		grep -c "name: dl_runas" | grep -q "^1$" ||
+		error "class dl_runas not listed once"
+
+	nrs_write_read "$RUNAS"
+
+	local stats=$(do_facet ost1 lctl get_param -n \
+		ost.OSS.ost_io.nrs_deadline_stats)
+	echo "$stats"
+	local reqs=$(echo "$stats" | awk '/class: dl_runas/ { found = 1 }
+		found && /requests:/ { print $2; exit }')
+	[ -n "$reqs" ] && [ $reqs -gt 0 ] ||
+		error "no request accounted to class dl_runas"
+
+	do_nodes $nodes lctl set_param \
+		ost.OSS.ost_io.nrs_deadline_classes="stop\ dl_runas" ||
+		error "failed to stop class dl_runas"
+	do_facet ost1 lctl get_param -n ost.OSS.ost_io.nrs_deadline_classes |
+		grep -q dl_runas && error "class dl_runas still listed"
+
+	return 0
+}
+run_test 77o "check deadline NRS policy classes and statistics"
+
 test_78() { #LU-6673
 	local rc
 
@@ -5109,6 +5149,150 @@ test_105() {
 }
 run_test 105 "Glimpse and lock cancel race"
 
+test_106() {
+	local count=16
+	local i
+
+	$LCTL get_param -n osc.*OST0000-osc-[-0-9a-f]*.connect_flags |
+		grep -q batch_bl_ast || skip "OST does not support batch_bl_ast"
+
+	$LFS setstripe -i 0 -c 1 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+
+	# client1 takes one PW lock per MB of the file
+	for ((i = 0; i < count; i++)); do
+		$LFS ladvise -a lockahead --start ${i}M --length 1M \
+			--mode WRITE $DIR1/$tfile ||
+			error "lockahead at ${i}M failed"
+	done
+	# lockahead locks are granted asynchronously
+	wait_update $HOSTNAME "$LCTL get_param -n \
+		ldlm.namespaces.*OST0000-osc-[-0-9a-f]*.lock_count |
+		awk '{ sum += \\\$1 } END { print sum }'" $count ||
+		error "lockahead locks not granted"
+
+	local bl1=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		    awk '/ldlm_bl_callback/ { print $2 }')
+
+	# the write lock of client2 revokes all locks of client1 at once
+	dd if=/dev/zero of=$DIR2/$tfile bs=${count}M count=1 conv=notrunc ||
+		error "dd on client2 failed"
+
+	local bl2=$($LCTL get_param -n ldlm.services.ldlm_cbd.stats |
+		    awk '/ldlm_bl_callback/ { print $2 }')
+
+	echo "$((bl2 - bl1)) blocking AST RPCs for $count locks"
+	(( bl2 - bl1 > 0 && bl2 - bl1 <= count / 4 )) ||
+		error "$((bl2 - bl1)) blocking AST RPCs for $count locks"
+}
+run_test 106 "Revoke many locks of a client with batched blocking ASTs"
+
+# Lock callback timeouts of at least 64s are filed on the second level of
+# the OST timer wheels, and moved down a level when the wheel gets to them.
+LDLM_WHEEL_TIMEOUT=70
+
+setup_107() {
+	local param=/sys/module/ptlrpc/parameters/ldlm_enqueue_min
+
+	remote_ost_nodsh && skip "remote OST with nodsh"
+	do_facet ost1 "test -f $param" || skip "missing $param"
+
+	local save=$(do_facet ost1 cat $param)
+
+	do_facet ost1 "echo $LDLM_WHEEL_TIMEOUT > $param"
+	stack_trap "do_facet ost1 'echo $save > $param'" EXIT
+	stack_trap "do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0" EXIT
+
+	$LFS setstripe -i 0 -c 1 $DIR1/$tfile || error "setstripe failed"
+	cancel_lru_locks osc
+}
+
+client_evicted_since() {
+	local since=$1
+	local evict=$($LCTL get_param osc.$FSNAME-OST0000-osc-*.state |
+		awk -F"[ [,]" '/EVICTED ]$/ { if (t<$5) {t=$5;} } END { print t }')
+
+	[ -n "$evict" ] && (( evict > since ))
+}
+
+test_107a() {
+	local count=24
+	local pause=5
+	local before=$(date +%s)
+	local osc=osc.$FSNAME-OST0000-osc-*
+
+	setup_107
+
+	local rpcs=$($LCTL get_param -n $osc.max_rpcs_in_flight | head -n1)
+	local pages=$($LCTL get_param -n $osc.max_pages_per_rpc | head -n1)
+
+	# flush the dirty pages of client1 one 1MB RPC at a time
+	$LCTL set_param $osc.max_rpcs_in_flight=1 \
+		$osc.max_pages_per_rpc=$((1048576 / PAGE_SIZE))
+	stack_trap "$LCTL set_param $osc.max_rpcs_in_flight=$rpcs \
+		    $osc.max_pages_per_rpc=$pages" EXIT
+
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=$count ||
+		error "write on client1 failed"
+
+	local timeouts=$(get_ost_lock_timeouts)
+
+	# every write RPC refreshes the lock of client1, which stays on the
+	# wheel well past its callback timeout and a second level cascade
+	#define OBD_FAIL_OST_BRW_PAUSE_BULK	0x214
+	do_facet ost1 $LCTL set_param fail_loc=0x214 fail_val=$pause
+
+	local start=$SECONDS
+
+	dd if=$DIR2/$tfile of=/dev/null bs=1M count=1 ||
+		error "read on client2 failed"
+
+	local elapsed=$((SECONDS - start))
+
+	do_facet ost1 $LCTL set_param fail_loc=0 fail_val=0
+	echo "client1 flushed $count MB in ${elapsed}s"
+	(( elapsed > LDLM_WHEEL_TIMEOUT )) ||
+		error "flush took ${elapsed}s, not past the lock timeout"
+	[[ $(get_ost_lock_timeouts) == $timeouts ]] ||
+		error "lock timeout happened"
+	! client_evicted_since $before || error "client1 was evicted"
+}
+run_test 107a "Lock refreshed by I/O is not evicted after wheel cascade"
+
+test_107b() {
+	local pause=$((LDLM_WHEEL_TIMEOUT + 40))
+
+	setup_107
+
+	dd if=/dev/zero of=$DIR1/$tfile bs=1M count=1 conv=fsync ||
+		error "write on client1 failed"
+
+	local timeouts=$(get_ost_lock_timeouts)
+	local before=$(date +%s)
+
+	# client1 replies to the blocking AST, but doesn't cancel its lock
+	# before the lock callback timer expires
+	#define OBD_FAIL_LDLM_PAUSE_CANCEL	0x312
+	$LCTL set_param fail_loc=0x80000312 fail_val=$pause
+
+	local start=$SECONDS
+
+	dd if=$DIR2/$tfile of=/dev/null bs=1M count=1
+
+	local elapsed=$((SECONDS - start))
+
+	echo "client2 got the lock after ${elapsed}s"
+	$LCTL set_param fail_loc=0 fail_val=0
+	(( $(get_ost_lock_timeouts) > timeouts )) ||
+		error "no lock timeout happened"
+	client_evicted_since $((before - 1)) || error "client1 not evicted"
+	(( elapsed >= LDLM_WHEEL_TIMEOUT - 2 && elapsed < pause )) ||
+		error "client1 evicted after ${elapsed}s, not when the lock timed out"
+
+	wait_osc_import_ready client ost1
+}
+run_test 107b "Client not cancelling its lock is evicted from the wheel"
+
 log "cleanup: ======================================================"
 
 # kill and wait in each test only guarentee script finish, but command in script
@@ -0,0 +1,277 @@
+/*
+ * GPL HEADER START
+ *
+ * DO NOT ALTER OR REMOVE COPYRIGHT NOTICES OR THIS FILE HEADER.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 only,
+ * as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License version 2 for more details (a copy is included
+ * in the LICENSE file that accompanied this code).
+ *
+ * You should have received a copy of the GNU General Public License
+ * version 2 along with this program; If not, see
+ * http://www.gnu.org/licenses/gpl-2.0.html
+ *
+ * GPL HEADER END
+ */
+/*
+ * This file is part of Lustre, http://www.lustre.org/
+ *
+ * lustre/tests/stat_bench.c
+ *
+ * Stat or read the same few small files from an increasing number of
+ * threads, reporting operations/sec for each thread count. All threads
+ * match the same cached DLM locks, so this shows how lock matching on the
+ * client scales with the number of threads.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#define STAT_BENCH_IOSIZE	4096
+
+static char *progname;
+static char **paths;
+static int *fds;
+static int files = 4;
+static long ops = 100000;
+static bool do_read;
+
+static pthread_mutex_t start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static unsigned int ready;
+static bool go;
+
+struct bench_thread {
+	pthread_t	bt_thread;
+	unsigned int	bt_index;
+	int		bt_rc;
+};
+
+static void usage(FILE *out)
+{
+	fprintf(out,
+		"Usage: %s [-c] [-r] [-f files] [-n ops] [-t threads,...] dir\n"
+		"  -c: create the files under dir first\n"
+		"  -r: read the first %u bytes of the files instead of stat\n"
+		"  -f: number of files (default 4)\n"
+		"  -n: operations per thread (default 100000)\n"
+		"  -t: comma separated thread counts to run (default 1,2,4,8)\n",
+		progname, STAT_BENCH_IOSIZE);
+	exit(out == stderr);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void *bench_thread_main(void *arg)
+{
+	struct bench_thread *bt = arg;
+	char buf[STAT_BENCH_IOSIZE];
+	struct stat st;
+	long i;
+
+	pthread_mutex_lock(&start_lock);
+	ready++;
+	pthread_cond_broadcast(&start_cond);
+	while (!go)
+		pthread_cond_wait(&start_cond, &start_lock);
+	pthread_mutex_unlock(&start_lock);
+
+	for (i = 0; i < ops; i++) {
+		/* start each thread on a different file */
+		int f = (bt->bt_index + i) % files;
+
+		if (do_read) {
+			if (pread(fds[f], buf, sizeof(buf), 0) < 0) {
+				bt->bt_rc = -errno;
+				fprintf(stderr, "%s: cannot read '%s': %s\n",
+					progname, paths[f], strerror(errno));
+				break;
+			}
+		} else if (stat(paths[f], &st) < 0) {
+			bt->bt_rc = -errno;
+			fprintf(stderr, "%s: cannot stat '%s': %s\n",
+				progname, paths[f], strerror(errno));
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+/* returns elapsed seconds, or negative errno */
+static double bench_run(unsigned int nthreads)
+{
+	struct bench_thread *bts;
+	double start = 0;
+	double elapsed;
+	unsigned int started;
+	int rc = 0;
+
+	bts = calloc(nthreads, sizeof(*bts));
+	if (bts == NULL)
+		return -ENOMEM;
+
+	ready = 0;
+	go = false;
+	for (started = 0; started < nthreads; started++) {
+		bts[started].bt_index = started;
+		rc = pthread_create(&bts[started].bt_thread, NULL,
+				    bench_thread_main, &bts[started]);
+		if (rc) {
+			rc = -rc;
+			break;
+		}
+	}
+
+	pthread_mutex_lock(&start_lock);
+	while (ready < started)
+		pthread_cond_wait(&start_cond, &start_lock);
+	start = now();
+	go = true;
+	pthread_cond_broadcast(&start_cond);
+	pthread_mutex_unlock(&start_lock);
+
+	while (started-- > 0) {
+		pthread_join(bts[started].bt_thread, NULL);
+		if (bts[started].bt_rc && !rc)
+			rc = bts[started].bt_rc;
+	}
+	elapsed = now() - start;
+	free(bts);
+
+	return rc ? rc : elapsed;
+}
+
+int main(int argc, char **argv)
+{
+	char threads_default[] = "1,2,4,8";
+	char *threads = threads_default;
+	char buf[STAT_BENCH_IOSIZE];
+	bool create = false;
+	char *tok;
+	int rc = 0;
+	int c;
+	int i;
+
+	progname = argv[0];
+	while ((c = getopt(argc, argv, "cf:hn:rt:")) != -1) {
+		switch (c) {
+		case 'c':
+			create = true;
+			break;
+		case 'f':
+			files = atoi(optarg);
+			break;
+		case 'n':
+			ops = atol(optarg);
+			break;
+		case 'r':
+			do_read = true;
+			break;
+		case 't':
+			threads = optarg;
+			break;
+		case 'h':
+			usage(stdout);
+		default:
+			usage(stderr);
+		}
+	}
+
+	if (optind != argc - 1 || files <= 0 || ops <= 0)
+		usage(stderr);
+
+	if (create && mkdir(argv[optind], 0755) < 0 && errno != EEXIST) {
+		fprintf(stderr, "%s: cannot mkdir '%s': %s\n",
+			progname, argv[optind], strerror(errno));
+		return 1;
+	}
+
+	paths = calloc(files, sizeof(*paths));
+	fds = calloc(files, sizeof(*fds));
+	if (paths == NULL || fds == NULL) {
+		fprintf(stderr, "%s: cannot allocate %d files\n", progname,
+			files);
+		return 1;
+	}
+
+	memset(buf, 0x5a, sizeof(buf));
+	for (i = 0; i < files; i++) {
+		if (asprintf(&paths[i], "%s/f%d", argv[optind], i) < 0) {
+			fprintf(stderr, "%s: cannot allocate path\n", progname);
+			return 1;
+		}
+
+		fds[i] = open(paths[i], create ? O_CREAT | O_RDWR : O_RDONLY,
+			      0644);
+		if (fds[i] < 0) {
+			fprintf(stderr, "%s: cannot open '%s': %s\n",
+				progname, paths[i], strerror(errno));
+			return 1;
+		}
+
+		if (create && pwrite(fds[i], buf, sizeof(buf), 0) < 0) {
+			fprintf(stderr, "%s: cannot write '%s': %s\n",
+				progname, paths[i], strerror(errno));
+			return 1;
+		}
+	}
+
+	printf("%8s %12s %10s %14s\n", "threads", "ops", "seconds", "ops/sec");
+	for (tok = strtok(threads, ","); tok != NULL;
+	     tok = strtok(NULL, ",")) {
+		unsigned int nthreads = strtoul(tok, NULL, 0);
+		double elapsed;
+
+		if (nthreads == 0) {
+			fprintf(stderr, "%s: bad thread count '%s'\n",
+				progname, tok);
+			rc = 1;
+			break;
+		}
+
+		elapsed = bench_run(nthreads);
+		if (elapsed < 0) {
+			fprintf(stderr, "%s: %s with %u threads failed: %s\n",
+				progname, do_read ? "read" : "stat", nthreads,
+				strerror((int)-elapsed));
+			rc = 1;
+			break;
+		}
+
+		printf("%8u %12ld %10.3f %14.0f\n", nthreads, nthreads * ops,
+		       elapsed, elapsed > 0 ? nthreads * ops / elapsed : 0.0);
+	}
+
+	for (i = 0; i < files; i++) {
+		close(fds[i]);
+		free(paths[i]);
+	}
+	free(fds);
+	free(paths);
+
+	return rc;
+}
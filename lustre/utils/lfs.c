@@ -481,6 +481,7 @@ command_t cmdlist[] = {
 	 "     [[!] --mdt-count|-T [+-]<stripes>]\n"
 	 "     [[!] --mdt-hash|-H <hashtype>\n"
 	 "     [[!] --mdt-index|-m <uuid|index,...>]\n"
+	 "     [--threads <count>]\n"
          "\t !: used before an option indicates 'NOT' requested attribute\n"
          "\t -: used before a value indicates less than requested value\n"
          "\t +: used before a value indicates more than requested value\n"
@@ -2984,6 +2985,7 @@ enum {
 	LFS_LAYOUT_FOREIGN_OPT,
 	LFS_MODE_OPT,
 	LFS_NEWERXY_OPT,
+	LFS_FIND_THREADS_OPT,
 };
 
 /* functions */
@@ -4220,6 +4222,8 @@ static int lfs_find(int argc, char **argv)
 	{ .val = 'S',	.name = "stripe-size",	.has_arg = required_argument },
 	{ .val = 'S',	.name = "stripe_size",	.has_arg = required_argument },
 	{ .val = 't',	.name = "type",		.has_arg = required_argument },
+	{ .val = LFS_FIND_THREADS_OPT,
+			.name = "threads",	.has_arg = required_argument },
 	{ .val = 'T',	.name = "mdt-count",	.has_arg = required_argument },
 	{ .val = 'u',	.name = "uid",		.has_arg = required_argument },
 	{ .val = 'U',	.name = "user",		.has_arg = required_argument },
@@ -4234,6 +4238,7 @@ static int lfs_find(int argc, char **argv)
 	int pathend = -1;
 	int pathbad = -1;
 	int neg_opt = 0;
+	unsigned int nthreads = 1;
 	time_t *xtime;
 	int *xsign;
 	int isoption;
@@ -4895,6 +4900,24 @@ err_free:
 			param.fp_check_ext_size = 1;
 			param.fp_exclude_ext_size = !!neg_opt;
 			break;
+		case LFS_FIND_THREADS_OPT:
+			if (neg_opt) {
+				fprintf(stderr,
+					"error: %s: '!' is not valid with --threads\n",
+					argv[0]);
+				ret = CMD_HELP;
+				goto err;
+			}
+			errno = 0;
+			nthreads = strtoul(optarg, &endptr, 0);
+			if (errno != 0 || *endptr != '\0' || nthreads == 0) {
+				fprintf(stderr,
+					"error: %s: bad thread count '%s'\n",
+					argv[0], optarg);
+				ret = CMD_HELP;
+				goto err;
+			}
+			break;
 		default:
 			ret = CMD_HELP;
 			goto err;
@@ -4912,7 +4935,11 @@ err_free:
 	}
 
 	do {
-		rc = llapi_find(argv[pathstart], &param);
+		if (nthreads > 1)
+			rc = llapi_find_parallel(argv[pathstart], &param,
+						 nthreads);
+		else
+			rc = llapi_find(argv[pathstart], &param);
 		if (rc && !ret) {
 			ret = rc;
 			pathbad = pathstart;
@@ -71,8 +71,10 @@
 #include <poll.h>
 #include <time.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include <libcfs/util/ioctl.h>
+#include <libcfs/util/list.h>
 #include <libcfs/util/param.h>
 #include <libcfs/util/string.h>
 #include <linux/lnet/lnetctl.h>
@@ -2084,12 +2086,146 @@ static int get_lmd_info(char *path, DIR *parent, DIR *dir, void *lmdbuf,
 	return get_lmd_info_fd(path, parent_fd, dir_fd, lmdbuf, lmdlen, type);
 }
 
+/**
+ * Read directory entries of \a dirfd along with their attributes and
+ * layouts, see struct ll_readdir_plus.
+ *
+ * \retval 0 on success
+ * \retval -EOPNOTSUPP if the client or the MDT cannot do it
+ * \retval negative errno on other failures
+ */
+int llapi_readdir_plus(int dirfd, struct ll_readdir_plus *lrp)
+{
+	int rc;
+
+	rc = ioctl(dirfd, LL_IOC_READDIR_PLUS, lrp);
+	if (rc < 0) {
+		rc = -errno;
+		if (rc == -ENOTTY)
+			rc = -EOPNOTSUPP;
+	}
+
+	return rc;
+}
+
+#define FIND_READDIR_PLUS_SIZE	(256 * 1024)
+
+/*
+ * Directory reader of the find traversal. If fp_lmd_prefetch is set, the
+ * entries are read with llapi_readdir_plus(), which also returns the
+ * lov_user_mds_data of each entry, so cb_find_init() does not need one
+ * IOC_MDC_GETFILEINFO per file. Otherwise, or if that is not supported,
+ * it is a plain readdir64().
+ */
+struct find_dir_reader {
+	DIR				*fdr_dir;
+	struct ll_readdir_plus		*fdr_lrp;
+	struct ll_readdir_plus_ent	*fdr_ent;
+	unsigned int			 fdr_left;
+	/* lmd of the last entry returned, NULL if not known */
+	struct lov_user_mds_data	*fdr_lmd;
+	struct dirent64			 fdr_dent;
+};
+
+static void find_dir_reader_init(struct find_dir_reader *fdr, DIR *d,
+				 struct find_param *param)
+{
+	memset(fdr, 0, sizeof(*fdr));
+	fdr->fdr_dir = d;
+	if (!param->fp_lmd_prefetch)
+		return;
+
+	fdr->fdr_lrp = calloc(1, sizeof(*fdr->fdr_lrp) +
+			      FIND_READDIR_PLUS_SIZE);
+	if (fdr->fdr_lrp != NULL)
+		fdr->fdr_lrp->lrp_bufsize = FIND_READDIR_PLUS_SIZE;
+}
+
+static void find_dir_reader_fini(struct find_dir_reader *fdr)
+{
+	free(fdr->fdr_lrp);
+	fdr->fdr_lrp = NULL;
+}
+
+static struct dirent64 *find_readdir(struct find_dir_reader *fdr,
+				     struct find_param *param)
+{
+	struct ll_readdir_plus *lrp = fdr->fdr_lrp;
+	struct ll_readdir_plus_ent *ent;
+	struct dirent64 *dent = &fdr->fdr_dent;
+	int rc;
+
+	fdr->fdr_lmd = NULL;
+	if (lrp == NULL)
+		return readdir64(fdr->fdr_dir);
+
+	while (fdr->fdr_left == 0) {
+		if (lrp->lrp_flags & LRP_F_EOF)
+			return NULL;
+
+		rc = llapi_readdir_plus(dirfd(fdr->fdr_dir), lrp);
+		if (rc == 0) {
+			fdr->fdr_ent = (void *)lrp->lrp_buf;
+			fdr->fdr_left = lrp->lrp_count;
+			continue;
+		}
+
+		/* fall back to readdir if nothing was returned yet */
+		if (lrp->lrp_hash == 0) {
+			if (rc == -EOPNOTSUPP)
+				param->fp_lmd_prefetch = 0;
+			find_dir_reader_fini(fdr);
+			return readdir64(fdr->fdr_dir);
+		}
+
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "error: %s: cannot read directory", __func__);
+		errno = -rc;
+		return NULL;
+	}
+
+	ent = fdr->fdr_ent;
+	fdr->fdr_ent = (void *)((char *)ent + ent->lrpe_reclen);
+	fdr->fdr_left--;
+
+	memset(dent, 0, offsetof(struct dirent64, d_name));
+	dent->d_type = ent->lrpe_type;
+	dent->d_reclen = offsetof(struct dirent64, d_name) +
+			 ent->lrpe_namelen + 1;
+	snprintf(dent->d_name, sizeof(dent->d_name), "%s", ent->lrpe_name);
+	if (ent->lrpe_rc == 0)
+		fdr->fdr_lmd = (void *)((char *)ent + ent->lrpe_lmdoff);
+
+	return dent;
+}
+
+/* Hand the lmd read along with the current entry over to cb_find_init() */
+static void find_lmd_prefetched(struct find_dir_reader *fdr,
+				struct find_param *param)
+{
+	struct lov_user_mds_data *lmd = fdr->fdr_lmd;
+	size_t size;
+
+	if (lmd == NULL)
+		return;
+
+	size = offsetof(struct lov_user_mds_data, lmd_lmm) +
+	       (lmd->lmd_lmmsize > sizeof(struct lov_user_md_v1) ?
+		lmd->lmd_lmmsize : sizeof(struct lov_user_md_v1));
+	if (size > param->fp_lum_size)
+		return;
+
+	memcpy(param->fp_lmd, lmd, size);
+	param->fp_lmd_prefetched = 1;
+}
+
 static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 				   semantic_func_t sem_init,
 				   semantic_func_t sem_fini, void *data,
 				   struct dirent64 *de)
 {
 	struct find_param *param = (struct find_param *)data;
+	struct find_dir_reader fdr;
 	struct dirent64 *dent;
 	int len, ret;
 	DIR *d, *p = NULL;
@@ -2118,7 +2254,8 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 	if (d == NULL)
 		goto out;
 
-	while ((dent = readdir64(d)) != NULL) {
+	find_dir_reader_init(&fdr, d, param);
+	while ((dent = find_readdir(&fdr, param)) != NULL) {
 		int rc;
 
 		if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
@@ -2162,7 +2299,9 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 		default:
 			rc = 0;
 			if (sem_init) {
+				find_lmd_prefetched(&fdr, param);
 				rc = sem_init(path, d, NULL, data, dent);
+				param->fp_lmd_prefetched = 0;
 				if (rc < 0 && ret == 0) {
 					ret = rc;
 					break;
@@ -2172,6 +2311,7 @@ static int llapi_semantic_traverse(char *path, int size, DIR *parent,
 				sem_fini(path, d, NULL, data, dent);
                 }
         }
+	find_dir_reader_fini(&fdr);
 
 out:
         path[len] = 0;
@@ -4515,6 +4655,17 @@ static bool find_check_lmm_info(struct find_param *param)
 	       param->fp_check_projid;
 }
 
+/* Whether cb_find_init() needs the stat and layout of every file. */
+static bool find_check_lmd_info(struct find_param *param)
+{
+	return param->fp_obd_uuid || param->fp_mdt_uuid ||
+	       param->fp_check_uid || param->fp_check_gid ||
+	       param->fp_newerxy || param->fp_atime || param->fp_mtime ||
+	       param->fp_ctime || param->fp_check_size ||
+	       param->fp_check_blocks || find_check_lmm_info(param) ||
+	       param->fp_check_mdt_count || param->fp_check_hash_type;
+}
+
 /*
  * Get file/directory project id.
  * by the open fd resides on.
@@ -4533,6 +4684,53 @@ static int fget_projid(int fd, int *projid)
 	return 0;
 }
 
+/* Output buffer of the current directory, only set for the threads of
+ * llapi_find_parallel(), so that matches of one directory are written
+ * together and not interleaved with lines printed by other threads. */
+struct find_outbuf {
+	char	*fo_buf;
+	size_t	 fo_len;
+	size_t	 fo_size;
+};
+
+static __thread struct find_outbuf *find_outbuf;
+
+static void find_print_path(struct find_param *param, char *path)
+{
+	struct find_outbuf *fo = find_outbuf;
+	size_t len;
+
+	if (fo == NULL) {
+		llapi_printf(LLAPI_MSG_NORMAL, "%s", path);
+		if (param->fp_zero_end)
+			llapi_printf(LLAPI_MSG_NORMAL, "%c", '\0');
+		else
+			llapi_printf(LLAPI_MSG_NORMAL, "\n");
+		return;
+	}
+
+	len = strlen(path);
+	if (fo->fo_len + len + 1 > fo->fo_size) {
+		size_t size = fo->fo_size * 2;
+		char *buf;
+
+		while (fo->fo_len + len + 1 > size)
+			size *= 2;
+		buf = realloc(fo->fo_buf, size);
+		if (buf == NULL) {
+			llapi_error(LLAPI_MSG_ERROR, -ENOMEM,
+				    "error: cannot buffer output for '%s'",
+				    path);
+			return;
+		}
+		fo->fo_buf = buf;
+		fo->fo_size = size;
+	}
+	memcpy(fo->fo_buf + fo->fo_len, path, len);
+	fo->fo_len += len;
+	fo->fo_buf[fo->fo_len++] = param->fp_zero_end ? '\0' : '\n';
+}
+
 static int cb_find_init(char *path, DIR *parent, DIR **dirp,
 			void *data, struct dirent64 *de)
 {
@@ -4577,12 +4775,7 @@ static int cb_find_init(char *path, DIR *parent, DIR **dirp,
 
 	/* Request MDS for the stat info if some of these parameters need
 	 * to be compared. */
-	if (param->fp_obd_uuid || param->fp_mdt_uuid ||
-	    param->fp_check_uid || param->fp_check_gid || param->fp_newerxy ||
-	    param->fp_atime || param->fp_mtime || param->fp_ctime ||
-	    param->fp_check_size || param->fp_check_blocks ||
-	    find_check_lmm_info(param) ||
-	    param->fp_check_mdt_count || param->fp_check_hash_type)
+	if (find_check_lmd_info(param))
 		decision = 0;
 
 	if (param->fp_type != 0 && checked_type == 0)
@@ -4607,9 +4800,14 @@ static int cb_find_init(char *path, DIR *parent, DIR **dirp,
 			}
 		}
 
-		param->fp_lmd->lmd_lmm.lmm_magic = 0;
-		ret = get_lmd_info(path, parent, dir, param->fp_lmd,
-				   param->fp_lum_size, GET_LMD_INFO);
+		/* already fetched along with the directory entry */
+		if (param->fp_lmd_prefetched) {
+			ret = 0;
+		} else {
+			param->fp_lmd->lmd_lmm.lmm_magic = 0;
+			ret = get_lmd_info(path, parent, dir, param->fp_lmd,
+					   param->fp_lum_size, GET_LMD_INFO);
+		}
 		if (ret == 0 && param->fp_lmd->lmd_lmm.lmm_magic == 0 &&
 		    find_check_lmm_info(param)) {
 			struct lov_user_md *lmm = &param->fp_lmd->lmd_lmm;
@@ -4962,11 +5160,7 @@ obd_matches:
 	}
 
 foreign:
-	llapi_printf(LLAPI_MSG_NORMAL, "%s", path);
-	if (param->fp_zero_end)
-		llapi_printf(LLAPI_MSG_NORMAL, "%c", '\0');
-	else
-		llapi_printf(LLAPI_MSG_NORMAL, "\n");
+	find_print_path(param, path);
 
 decided:
 	ret = 0;
@@ -5142,7 +5336,521 @@ int llapi_mv(char *path, struct find_param *param)
 
 int llapi_find(char *path, struct find_param *param)
 {
-        return param_callback(path, cb_find_init, cb_common_fini, param);
+	param->fp_lmd_prefetch = find_check_lmd_info(param);
+
+	return param_callback(path, cb_find_init, cb_common_fini, param);
+}
+
+/*
+ * Parallel find.
+ *
+ * Every thread owns a queue of directories still to be scanned.  A thread
+ * pushes the subdirectories it finds to the head of its own queue and pops
+ * from there again, so it walks its part of the tree depth first.  An idle
+ * thread steals the oldest entry from the tail of another thread's queue,
+ * which is the one closest to the top of the tree and so likely the biggest
+ * piece of remaining work.
+ *
+ * Each thread runs cb_find_init() on its own copy of the find_param, so all
+ * the predicates behave exactly as in llapi_find().  The matches of one
+ * directory are buffered and written to stdout in one piece, in readdir
+ * order, once the directory is done (or when the buffer gets large).
+ */
+#define FIND_THREADS_MAX	1024
+#define FIND_OUTBUF_SIZE	(64 * 1024)
+#define FIND_PUSH_BATCH		64
+
+struct find_work {
+	struct list_head	fw_list;
+	unsigned int		fw_depth;
+	char			fw_path[0];
+};
+
+struct find_pool;
+
+struct find_thread {
+	struct find_pool	*ft_pool;
+	pthread_t		 ft_thread;
+	pthread_mutex_t		 ft_lock;
+	struct list_head	 ft_queue;	/* protected by ft_lock */
+	struct find_param	 ft_param;
+	struct find_outbuf	 ft_out;
+	char			 ft_path[PATH_MAX + 1];
+	unsigned int		 ft_id;
+	bool			 ft_started;
+};
+
+struct find_pool {
+	struct find_thread	*fpl_threads;
+	unsigned int		 fpl_nthreads;
+	pthread_mutex_t		 fpl_lock;
+	pthread_cond_t		 fpl_wait;
+	pthread_mutex_t		 fpl_out_lock;
+	/* directories queued or being scanned */
+	long			 fpl_pending;
+	/* directories queued and not yet picked up by any thread */
+	long			 fpl_queued;
+	/* threads waiting on fpl_wait for work */
+	long			 fpl_idle;
+	/* first error hit by any thread */
+	int			 fpl_rc;
+	semantic_func_t		*fpl_sem_init;
+	semantic_func_t		*fpl_sem_fini;
+};
+
+static void find_pool_set_rc(struct find_pool *pool, int rc)
+{
+	int zero = 0;
+
+	if (rc < 0)
+		__atomic_compare_exchange_n(&pool->fpl_rc, &zero, rc, false,
+					    __ATOMIC_SEQ_CST,
+					    __ATOMIC_SEQ_CST);
+}
+
+static struct find_work *find_work_alloc(const char *path, unsigned int depth)
+{
+	struct find_work *fw;
+	size_t len = strlen(path);
+
+	fw = malloc(sizeof(*fw) + len + 1);
+	if (fw == NULL)
+		return NULL;
+
+	INIT_LIST_HEAD(&fw->fw_list);
+	fw->fw_depth = depth;
+	memcpy(fw->fw_path, path, len + 1);
+
+	return fw;
+}
+
+/* Move the directories collected in \a batch to the head of the queue of
+ * \a ft, and wake up the idle threads so they can steal them. */
+static void find_work_push(struct find_thread *ft, struct list_head *batch,
+			   long count)
+{
+	struct find_pool *pool = ft->ft_pool;
+
+	if (count == 0)
+		return;
+
+	__atomic_add_fetch(&pool->fpl_pending, count, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&ft->ft_lock);
+	list_splice_init(batch, &ft->ft_queue);
+	pthread_mutex_unlock(&ft->ft_lock);
+	__atomic_add_fetch(&pool->fpl_queued, count, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&pool->fpl_idle, __ATOMIC_SEQ_CST) > 0) {
+		pthread_mutex_lock(&pool->fpl_lock);
+		pthread_cond_broadcast(&pool->fpl_wait);
+		pthread_mutex_unlock(&pool->fpl_lock);
+	}
+}
+
+static struct find_work *find_work_dequeue(struct find_thread *ft, bool steal)
+{
+	struct find_work *fw = NULL;
+
+	pthread_mutex_lock(&ft->ft_lock);
+	if (!list_empty(&ft->ft_queue)) {
+		if (steal)
+			fw = list_entry(ft->ft_queue.prev, struct find_work,
+					fw_list);
+		else
+			fw = list_entry(ft->ft_queue.next, struct find_work,
+					fw_list);
+		list_del_init(&fw->fw_list);
+	}
+	pthread_mutex_unlock(&ft->ft_lock);
+
+	if (fw != NULL)
+		__atomic_sub_fetch(&ft->ft_pool->fpl_queued, 1,
+				   __ATOMIC_SEQ_CST);
+
+	return fw;
+}
+
+/* Take the next directory for \a ft, from its own queue if possible, or
+ * stolen from another thread.  Sleep while there is nothing to take but
+ * other threads are still scanning, and return NULL once all is done. */
+static struct find_work *find_work_get(struct find_thread *ft)
+{
+	struct find_pool *pool = ft->ft_pool;
+	struct find_work *fw;
+	unsigned int i;
+
+	while (1) {
+		fw = find_work_dequeue(ft, false);
+		if (fw != NULL)
+			return fw;
+
+		for (i = 1; i < pool->fpl_nthreads; i++) {
+			struct find_thread *victim;
+
+			victim = &pool->fpl_threads[(ft->ft_id + i) %
+						   pool->fpl_nthreads];
+			fw = find_work_dequeue(victim, true);
+			if (fw != NULL)
+				return fw;
+		}
+
+		pthread_mutex_lock(&pool->fpl_lock);
+		__atomic_add_fetch(&pool->fpl_idle, 1, __ATOMIC_SEQ_CST);
+		while (__atomic_load_n(&pool->fpl_queued,
+				       __ATOMIC_SEQ_CST) == 0 &&
+		       __atomic_load_n(&pool->fpl_pending,
+				       __ATOMIC_SEQ_CST) > 0)
+			pthread_cond_wait(&pool->fpl_wait, &pool->fpl_lock);
+		__atomic_sub_fetch(&pool->fpl_idle, 1, __ATOMIC_SEQ_CST);
+		pthread_mutex_unlock(&pool->fpl_lock);
+
+		if (__atomic_load_n(&pool->fpl_pending, __ATOMIC_SEQ_CST) == 0)
+			return NULL;
+	}
+}
+
+static void find_work_done(struct find_thread *ft, struct find_work *fw)
+{
+	struct find_pool *pool = ft->ft_pool;
+
+	free(fw);
+	if (__atomic_sub_fetch(&pool->fpl_pending, 1, __ATOMIC_SEQ_CST) == 0) {
+		pthread_mutex_lock(&pool->fpl_lock);
+		pthread_cond_broadcast(&pool->fpl_wait);
+		pthread_mutex_unlock(&pool->fpl_lock);
+	}
+}
+
+static void find_output_flush(struct find_thread *ft)
+{
+	struct find_outbuf *fo = &ft->ft_out;
+
+	if (fo->fo_len == 0)
+		return;
+
+	/* llapi_printf() would not print anything at this level either */
+	if (llapi_msg_get_level() < LLAPI_MSG_NORMAL) {
+		fo->fo_len = 0;
+		return;
+	}
+
+	pthread_mutex_lock(&ft->ft_pool->fpl_out_lock);
+	fwrite(fo->fo_buf, 1, fo->fo_len, stdout);
+	fflush(stdout);
+	pthread_mutex_unlock(&ft->ft_pool->fpl_out_lock);
+	fo->fo_len = 0;
+}
+
+/* Scan the directory described by \a fw, the same way one level of
+ * llapi_semantic_traverse() does, but queue subdirectories instead of
+ * descending into them. */
+static int find_scan_dir(struct find_thread *ft, struct find_work *fw)
+{
+	struct find_pool *pool = ft->ft_pool;
+	struct find_param *param = &ft->ft_param;
+	struct dirent64 dir_de = { .d_type = DT_DIR };
+	struct find_dir_reader fdr;
+	struct dirent64 *de = NULL;
+	struct dirent64 *dent;
+	struct list_head batch;
+	char *path = ft->ft_path;
+	long count = 0;
+	int len, ret = 0;
+	DIR *d;
+
+	INIT_LIST_HEAD(&batch);
+	snprintf(path, sizeof(ft->ft_path), "%s", fw->fw_path);
+	len = strlen(path);
+
+	/* the starting directory has no dirent, like llapi_find() */
+	if (fw->fw_depth > 0) {
+		char *name = strrchr(path, '/');
+
+		name = name == NULL ? path : name + 1;
+		if (strlen(name) > NAME_MAX) {
+			ret = -ENAMETOOLONG;
+			llapi_error(LLAPI_MSG_ERROR, ret, "%s: bad name '%s'",
+				    __func__, path);
+			return ret;
+		}
+		strcpy(dir_de.d_name, name);
+		de = &dir_de;
+	}
+
+	d = opendir(path);
+	if (d == NULL) {
+		ret = -errno;
+		llapi_error(LLAPI_MSG_ERROR, ret, "%s: Failed to open '%s'",
+			    __func__, path);
+		return ret;
+	}
+
+	param->fp_depth = fw->fw_depth;
+	if (pool->fpl_sem_init &&
+	    (ret = pool->fpl_sem_init(path, NULL, &d, param, de)))
+		goto out_close;
+
+	find_dir_reader_init(&fdr, d, param);
+	while ((dent = find_readdir(&fdr, param)) != NULL) {
+		int rc;
+
+		if (!strcmp(dent->d_name, ".") || !strcmp(dent->d_name, ".."))
+			continue;
+
+		path[len] = 0;
+		if ((len + dent->d_reclen + 2) > sizeof(ft->ft_path)) {
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: string buffer too small",
+					  __func__);
+			break;
+		}
+		strcat(path, "/");
+		strcat(path, dent->d_name);
+
+		if (dent->d_type == DT_UNKNOWN) {
+			struct lov_user_mds_data *lmd = param->fp_lmd;
+
+			rc = get_lmd_info(path, d, NULL, lmd,
+					  param->fp_lum_size, GET_LMD_INFO);
+			if (rc == 0)
+				dent->d_type = IFTODT(lmd->lmd_stx.stx_mode);
+			else if (ret == 0)
+				ret = rc;
+
+			if (rc == -ENOENT)
+				continue;
+		}
+
+		switch (dent->d_type) {
+		case DT_UNKNOWN:
+			llapi_err_noerrno(LLAPI_MSG_ERROR,
+					  "error: %s: '%s' is UNKNOWN type %d",
+					  __func__, dent->d_name, dent->d_type);
+			break;
+		case DT_DIR: {
+			struct find_work *child;
+
+			child = find_work_alloc(path, param->fp_depth);
+			if (child == NULL) {
+				if (ret == 0)
+					ret = -ENOMEM;
+				break;
+			}
+			list_add_tail(&child->fw_list, &batch);
+			if (++count >= FIND_PUSH_BATCH) {
+				find_work_push(ft, &batch, count);
+				count = 0;
+			}
+			break;
+		}
+		default:
+			rc = 0;
+			if (pool->fpl_sem_init) {
+				find_lmd_prefetched(&fdr, param);
+				rc = pool->fpl_sem_init(path, d, NULL, param,
+						       dent);
+				param->fp_lmd_prefetched = 0;
+				if (rc < 0 && ret == 0) {
+					ret = rc;
+					break;
+				}
+			}
+			if (pool->fpl_sem_fini && rc == 0)
+				pool->fpl_sem_fini(path, d, NULL, param, dent);
+		}
+
+		if (ft->ft_out.fo_len >= FIND_OUTBUF_SIZE)
+			find_output_flush(ft);
+	}
+	find_dir_reader_fini(&fdr);
+	find_work_push(ft, &batch, count);
+
+	path[len] = 0;
+	if (pool->fpl_sem_fini)
+		pool->fpl_sem_fini(path, NULL, &d, param, de);
+out_close:
+	if (d)
+		closedir(d);
+	find_output_flush(ft);
+
+	return ret;
+}
+
+static void *find_thread_main(void *arg)
+{
+	struct find_thread *ft = arg;
+	struct find_work *fw;
+
+	find_outbuf = &ft->ft_out;
+	while ((fw = find_work_get(ft)) != NULL) {
+		find_pool_set_rc(ft->ft_pool, find_scan_dir(ft, fw));
+		find_work_done(ft, fw);
+	}
+	find_outbuf = NULL;
+
+	return NULL;
+}
+
+static void find_thread_fini(struct find_thread *ft)
+{
+	struct find_work *fw;
+
+	while (!list_empty(&ft->ft_queue)) {
+		fw = list_entry(ft->ft_queue.next, struct find_work, fw_list);
+		list_del(&fw->fw_list);
+		free(fw);
+	}
+	if (ft->ft_param.fp_mdt_indexes) {
+		free(ft->ft_param.fp_mdt_indexes);
+		ft->ft_param.fp_mdt_indexes = NULL;
+	}
+	find_param_fini(&ft->ft_param);
+	free(ft->ft_out.fo_buf);
+	pthread_mutex_destroy(&ft->ft_lock);
+}
+
+static int find_thread_init(struct find_pool *pool, struct find_thread *ft,
+			    unsigned int id, char *path,
+			    struct find_param *param)
+{
+	ft->ft_pool = pool;
+	ft->ft_id = id;
+	pthread_mutex_init(&ft->ft_lock, NULL);
+	INIT_LIST_HEAD(&ft->ft_queue);
+
+	ft->ft_out.fo_buf = malloc(FIND_OUTBUF_SIZE);
+	if (ft->ft_out.fo_buf == NULL)
+		return -ENOMEM;
+	ft->ft_out.fo_size = FIND_OUTBUF_SIZE;
+
+	/* every thread checks the predicates on its own copy, the buffers
+	 * and the target indexes are set up per thread */
+	ft->ft_param = *param;
+	ft->ft_param.fp_lmd = NULL;
+	ft->ft_param.fp_lmv_md = NULL;
+	ft->ft_param.fp_mdt_indexes = NULL;
+	ft->ft_param.fp_obd_indexes = NULL;
+	ft->ft_param.fp_got_uuids = 0;
+
+	return common_param_init(&ft->ft_param, path);
+}
+
+static int find_parallel(char *path, unsigned int nthreads,
+			 semantic_func_t sem_init, semantic_func_t sem_fini,
+			 struct find_param *param)
+{
+	struct find_pool pool = {
+		.fpl_nthreads = nthreads,
+		.fpl_sem_init = sem_init,
+		.fpl_sem_fini = sem_fini,
+	};
+	struct find_work *fw;
+	unsigned int i;
+	int rc;
+
+	pool.fpl_threads = calloc(nthreads, sizeof(*pool.fpl_threads));
+	if (pool.fpl_threads == NULL)
+		return -ENOMEM;
+
+	pthread_mutex_init(&pool.fpl_lock, NULL);
+	pthread_mutex_init(&pool.fpl_out_lock, NULL);
+	pthread_cond_init(&pool.fpl_wait, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		rc = find_thread_init(&pool, &pool.fpl_threads[i], i, path,
+				      param);
+		if (rc)
+			goto out;
+	}
+
+	fw = find_work_alloc(path, 0);
+	if (fw == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+	pool.fpl_pending = 1;
+	pool.fpl_queued = 1;
+	list_add(&fw->fw_list, &pool.fpl_threads[0].ft_queue);
+
+	/* make sure the output already written by the caller comes first */
+	fflush(stdout);
+	for (i = 0; i < nthreads; i++) {
+		struct find_thread *ft = &pool.fpl_threads[i];
+
+		rc = pthread_create(&ft->ft_thread, NULL, find_thread_main, ft);
+		if (rc) {
+			rc = -rc;
+			llapi_error(LLAPI_MSG_ERROR, rc,
+				    "cannot start find thread %u", i);
+			/* the threads already started finish the job */
+			if (i > 0)
+				rc = 0;
+			break;
+		}
+		ft->ft_started = true;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		if (pool.fpl_threads[i].ft_started)
+			pthread_join(pool.fpl_threads[i].ft_thread, NULL);
+	}
+	if (rc == 0)
+		rc = pool.fpl_rc;
+out:
+	for (i = 0; i < nthreads; i++) {
+		if (pool.fpl_threads[i].ft_pool != NULL)
+			find_thread_fini(&pool.fpl_threads[i]);
+	}
+	pthread_cond_destroy(&pool.fpl_wait);
+	pthread_mutex_destroy(&pool.fpl_out_lock);
+	pthread_mutex_destroy(&pool.fpl_lock);
+	free(pool.fpl_threads);
+
+	return rc;
+}
+
+/**
+ * Same as llapi_find(), but scan the directory tree with \a nthreads
+ * threads.  Matches are written directly to stdout rather than through
+ * the llapi_printf() callback.  Entries of one directory are
+ * printed together and in readdir order, but the directories themselves
+ * are printed in no particular order.
+ *
+ * \param path		file or directory to start the search from
+ * \param param		search criteria, as for llapi_find()
+ * \param nthreads	number of scanning threads
+ *
+ * \retval 0 on success, or the first negative errno hit during the scan.
+ */
+int llapi_find_parallel(char *path, struct find_param *param,
+			unsigned int nthreads)
+{
+	struct stat st;
+	int rc;
+
+	if (nthreads == 0 || nthreads > FIND_THREADS_MAX) {
+		rc = -EINVAL;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "invalid number of find threads %u, max is %u",
+			    nthreads, FIND_THREADS_MAX);
+		return rc;
+	}
+
+	if (strlen(path) > PATH_MAX) {
+		rc = -EINVAL;
+		llapi_error(LLAPI_MSG_ERROR, rc,
+			    "Path name '%s' is too long", path);
+		return rc;
+	}
+
+	/* nothing to share out for a single thread or a single file */
+	if (nthreads == 1 || stat(path, &st) != 0 || !S_ISDIR(st.st_mode))
+		return llapi_find(path, param);
+
+	param->fp_lmd_prefetch = find_check_lmd_info(param);
+
+	return find_parallel(path, nthreads, cb_find_init, cb_common_fini,
+			     param);
 }
 
 /*
@@ -34,6 +34,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <poll.h>
+#include <pthread.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/ioctl.h>
@@ -58,6 +59,8 @@ static int chlg_dev_path(char *path, size_t path_len, const char *device)
 
 #define CHANGELOG_PRIV_MAGIC 0xCA8E1080
 #define CHANGELOG_BUFFER_SZ  4096
+/* read buffer of the parallel consumer, which reads records in bulk */
+#define CHANGELOG_BULK_BUFFER_SZ (1024 * 1024)
 
 /**
  * Record state for efficient changelog consumption.
@@ -72,6 +75,8 @@ struct changelog_private {
 	enum changelog_send_flag	 clp_send_flags;
 	/* Changelog extra flags */
 	enum changelog_send_extra_flag	 clp_send_extra_flags;
+	/* Size of clp_buf */
+	size_t				 clp_buf_size;
 	/* Available bytes in buffer */
 	size_t				 clp_buf_len;
 	/* Current position in buffer */
@@ -80,17 +85,8 @@ struct changelog_private {
 	char				 clp_buf[0];
 };
 
-/**
- * Start reading from a changelog
- *
- * @param priv      Opaque private control structure
- * @param flags     Start flags (e.g. CHANGELOG_FLAG_JOBID)
- * @param device    Report changes recorded on this MDT
- * @param startrec  Report changes beginning with this record number
- * (just call llapi_changelog_fini when done; don't need an endrec)
- */
-int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
-			  const char *device, long long startrec)
+static int chlg_start(void **priv, enum changelog_send_flag flags,
+		      const char *device, long long startrec, size_t buf_size)
 {
 	struct changelog_private *cp;
 	static bool warned_extra_flags;
@@ -103,12 +99,13 @@ int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
 		return rc;
 
 	/* Set up the receiver control struct */
-	cp = calloc(1, sizeof(*cp) + CHANGELOG_BUFFER_SZ);
+	cp = calloc(1, sizeof(*cp) + buf_size);
 	if (cp == NULL)
 		return -ENOMEM;
 
 	cp->clp_magic = CHANGELOG_PRIV_MAGIC;
 	cp->clp_send_flags = flags;
+	cp->clp_buf_size = buf_size;
 
 	cp->clp_buf_len = 0;
 	cp->clp_buf_pos = cp->clp_buf;
@@ -168,6 +165,21 @@ out_free_cp:
 	return rc;
 }
 
+/**
+ * Start reading from a changelog
+ *
+ * @param priv      Opaque private control structure
+ * @param flags     Start flags (e.g. CHANGELOG_FLAG_JOBID)
+ * @param device    Report changes recorded on this MDT
+ * @param startrec  Report changes beginning with this record number
+ * (just call llapi_changelog_fini when done; don't need an endrec)
+ */
+int llapi_changelog_start(void **priv, enum changelog_send_flag flags,
+			  const char *device, long long startrec)
+{
+	return chlg_start(priv, flags, device, startrec, CHANGELOG_BUFFER_SZ);
+}
+
 /** Finish reading from a changelog */
 int llapi_changelog_fini(void **priv)
 {
@@ -182,23 +194,42 @@ int llapi_changelog_fini(void **priv)
 	return 0;
 }
 
+/* Refill the buffer, keeping any partial record left at its end. The
+ * changelog device only returns whole records, but a saved changelog
+ * file is read in arbitrary chunks. */
 static ssize_t chlg_read_bulk(struct changelog_private *cp)
 {
+	size_t left;
 	ssize_t rd_bytes;
 
 	if (!cp || cp->clp_magic != CHANGELOG_PRIV_MAGIC)
 		return -EINVAL;
 
-	rd_bytes = read(cp->clp_fd, cp->clp_buf, CHANGELOG_BUFFER_SZ);
+	left = cp->clp_buf + cp->clp_buf_len - cp->clp_buf_pos;
+	if (left > 0)
+		memmove(cp->clp_buf, cp->clp_buf_pos, left);
+
+	rd_bytes = read(cp->clp_fd, cp->clp_buf + left,
+			cp->clp_buf_size - left);
 	if (rd_bytes < 0)
 		return -errno;
 
 	cp->clp_buf_pos = cp->clp_buf;
-	cp->clp_buf_len = rd_bytes;
+	cp->clp_buf_len = left + rd_bytes;
 
 	return rd_bytes;
 }
 
+/* Is there a whole record at clp_buf_pos? */
+static bool chlg_rec_in_buf(struct changelog_private *cp)
+{
+	size_t left = cp->clp_buf + cp->clp_buf_len - cp->clp_buf_pos;
+	struct changelog_rec *rec = (struct changelog_rec *)cp->clp_buf_pos;
+
+	return left >= sizeof(*rec) &&
+	       left >= changelog_rec_size(rec) + rec->cr_namelen;
+}
+
 /**
  * Returns a file descriptor to poll on.
  *
@@ -256,7 +287,7 @@ int llapi_changelog_recv(void *priv, struct changelog_rec **rech)
 			rec_extra_fmt |= CLFE_XATTR;
 	}
 
-	if (cp->clp_buf + cp->clp_buf_len <= cp->clp_buf_pos) {
+	while (!chlg_rec_in_buf(cp)) {
 		ssize_t refresh;
 
 		refresh = chlg_read_bulk(cp);
@@ -380,3 +411,331 @@ int llapi_changelog_set_xflags(void *priv,
 
 	return 0;
 }
+
+#define CHLG_PAR_QUEUE_DEPTH	1024
+#define CHLG_PAR_CLEAR_INTERVAL	10000
+
+/* per-worker FIFO of records, in changelog index order */
+struct chlg_par_queue {
+	pthread_mutex_t		 cpq_lock;
+	/* signalled when a record is queued or on shutdown */
+	pthread_cond_t		 cpq_work;
+	/* signalled when the worker completes a record */
+	pthread_cond_t		 cpq_space;
+	struct changelog_rec	**cpq_recs;
+	unsigned int		 cpq_size;
+	/* oldest record, still queued or being processed by the worker */
+	unsigned int		 cpq_head;
+	unsigned int		 cpq_count;
+	bool			 cpq_stop;
+};
+
+struct chlg_par_worker {
+	struct chlg_par_pool	*cpw_pool;
+	struct chlg_par_queue	 cpw_queue;
+	pthread_t		 cpw_thread;
+	unsigned int		 cpw_id;
+	bool			 cpw_started;
+};
+
+struct chlg_par_pool {
+	const struct llapi_changelog_parallel	*cpp_param;
+	struct chlg_par_worker			*cpp_workers;
+	/* first error returned by a worker callback */
+	int					 cpp_rc;
+};
+
+static int chlg_par_get_rc(struct chlg_par_pool *pool)
+{
+	return __atomic_load_n(&pool->cpp_rc, __ATOMIC_SEQ_CST);
+}
+
+static void chlg_par_set_rc(struct chlg_par_pool *pool, int rc)
+{
+	int zero = 0;
+
+	if (rc < 0)
+		__atomic_compare_exchange_n(&pool->cpp_rc, &zero, rc, false,
+					    __ATOMIC_SEQ_CST,
+					    __ATOMIC_SEQ_CST);
+}
+
+static void *chlg_par_worker_main(void *arg)
+{
+	struct chlg_par_worker *cpw = arg;
+	struct chlg_par_queue *q = &cpw->cpw_queue;
+	const struct llapi_changelog_parallel *param = cpw->cpw_pool->cpp_param;
+	struct changelog_rec *rec;
+	int rc;
+
+	while (1) {
+		pthread_mutex_lock(&q->cpq_lock);
+		while (q->cpq_count == 0 && !q->cpq_stop)
+			pthread_cond_wait(&q->cpq_work, &q->cpq_lock);
+		if (q->cpq_count == 0) {
+			pthread_mutex_unlock(&q->cpq_lock);
+			break;
+		}
+		rec = q->cpq_recs[q->cpq_head];
+		pthread_mutex_unlock(&q->cpq_lock);
+
+		rc = param->lcp_cb(rec, cpw->cpw_id, param->lcp_cb_data);
+		if (rc < 0) {
+			/* leave the record queued, it is not committed */
+			chlg_par_set_rc(cpw->cpw_pool, rc);
+			pthread_mutex_lock(&q->cpq_lock);
+			pthread_cond_signal(&q->cpq_space);
+			pthread_mutex_unlock(&q->cpq_lock);
+			break;
+		}
+
+		pthread_mutex_lock(&q->cpq_lock);
+		q->cpq_recs[q->cpq_head] = NULL;
+		q->cpq_head = (q->cpq_head + 1) % q->cpq_size;
+		q->cpq_count--;
+		pthread_cond_signal(&q->cpq_space);
+		pthread_mutex_unlock(&q->cpq_lock);
+
+		llapi_changelog_free(&rec);
+	}
+
+	return NULL;
+}
+
+static int chlg_par_enqueue(struct chlg_par_pool *pool,
+			    struct chlg_par_queue *q, struct changelog_rec *rec)
+{
+	int rc;
+
+	pthread_mutex_lock(&q->cpq_lock);
+	while (q->cpq_count == q->cpq_size && chlg_par_get_rc(pool) == 0)
+		pthread_cond_wait(&q->cpq_space, &q->cpq_lock);
+	rc = chlg_par_get_rc(pool);
+	if (rc != 0) {
+		pthread_mutex_unlock(&q->cpq_lock);
+		return rc;
+	}
+	q->cpq_recs[(q->cpq_head + q->cpq_count) % q->cpq_size] = rec;
+	q->cpq_count++;
+	pthread_cond_signal(&q->cpq_work);
+	pthread_mutex_unlock(&q->cpq_lock);
+
+	return 0;
+}
+
+/*
+ * Highest index such that every record up to it has been committed by its
+ * worker: records are dispatched in index order and each worker completes
+ * them in queue order, so it is just below the oldest pending record.
+ */
+static long long chlg_par_committed(struct chlg_par_pool *pool,
+				    long long dispatched)
+{
+	const struct llapi_changelog_parallel *param = pool->cpp_param;
+	long long committed = dispatched;
+	unsigned int i;
+
+	for (i = 0; i < param->lcp_workers; i++) {
+		struct chlg_par_queue *q = &pool->cpp_workers[i].cpw_queue;
+
+		pthread_mutex_lock(&q->cpq_lock);
+		if (q->cpq_count > 0 &&
+		    q->cpq_recs[q->cpq_head]->cr_index <= committed)
+			committed = q->cpq_recs[q->cpq_head]->cr_index - 1;
+		pthread_mutex_unlock(&q->cpq_lock);
+	}
+
+	return committed;
+}
+
+/* All records of one target FID go to the same worker, so they are
+ * processed in changelog order. */
+static unsigned int chlg_par_shard(const struct changelog_rec *rec,
+				   unsigned int workers)
+{
+	const struct lu_fid *fid = &rec->cr_tfid;
+	__u64 hash;
+
+	hash = fid->f_seq * 0x9E3779B97F4A7C15ULL;
+	hash ^= ((__u64)fid->f_oid << 32 | fid->f_ver) * 0xC2B2AE3D27D4EB4FULL;
+	hash ^= hash >> 29;
+
+	return hash % workers;
+}
+
+static int chlg_par_clear(const struct llapi_changelog_parallel *param,
+			  long long committed, long long *cleared)
+{
+	int rc;
+
+	if (param->lcp_clear_id == NULL || committed <= *cleared)
+		return 0;
+
+	rc = llapi_changelog_clear(param->lcp_mdtname, param->lcp_clear_id,
+				   committed);
+	if (rc == 0)
+		*cleared = committed;
+
+	return rc;
+}
+
+/**
+ * Consume a changelog with several worker threads.
+ *
+ * Records are read in bulk and handed to \a param->lcp_workers threads
+ * which call \a param->lcp_cb on each of them.  Records are sharded by
+ * target FID, so all records of a given file or directory are processed in
+ * changelog order by the same worker, while records of other FIDs are
+ * processed concurrently.
+ *
+ * When \a param->lcp_clear_id is set, records are cleared for that
+ * changelog user as they are committed, i.e. only up to the highest index
+ * for which every record, including those of other workers, has been
+ * successfully processed.
+ *
+ * \param[in] param	consumer description
+ * \param[out] endrec	highest index up to which all records were processed
+ *
+ * \retval 0 once the end of the changelog has been reached
+ * \retval negative errno on failure, or the first error returned by the
+ *	   callback, in which case no record past the failed one is cleared
+ */
+int llapi_changelog_parallel(const struct llapi_changelog_parallel *param,
+			     long long *endrec)
+{
+	struct chlg_par_pool pool = { .cpp_param = param };
+	unsigned int depth;
+	unsigned int interval;
+	long long dispatched;
+	long long cleared;
+	long long count = 0;
+	void *priv = NULL;
+	unsigned int i;
+	int rc;
+	int rc2;
+
+	if (param == NULL || param->lcp_mdtname == NULL ||
+	    param->lcp_cb == NULL || param->lcp_workers == 0)
+		return -EINVAL;
+
+	depth = param->lcp_queue_depth ?: CHLG_PAR_QUEUE_DEPTH;
+	interval = param->lcp_clear_interval ?: CHLG_PAR_CLEAR_INTERVAL;
+	dispatched = cleared = param->lcp_startrec > 0 ?
+			       param->lcp_startrec - 1 : 0;
+
+	rc = chlg_start(&priv, param->lcp_flags, param->lcp_mdtname,
+			param->lcp_startrec, CHANGELOG_BULK_BUFFER_SZ);
+	if (rc < 0)
+		return rc;
+
+	if (param->lcp_xflags != 0) {
+		rc = llapi_changelog_set_xflags(priv, param->lcp_xflags);
+		if (rc < 0)
+			goto out_fini;
+	}
+
+	pool.cpp_workers = calloc(param->lcp_workers,
+				  sizeof(*pool.cpp_workers));
+	if (pool.cpp_workers == NULL) {
+		rc = -ENOMEM;
+		goto out_fini;
+	}
+
+	for (i = 0; i < param->lcp_workers; i++) {
+		struct chlg_par_worker *cpw = &pool.cpp_workers[i];
+		struct chlg_par_queue *q = &cpw->cpw_queue;
+
+		cpw->cpw_pool = &pool;
+		cpw->cpw_id = i;
+		pthread_mutex_init(&q->cpq_lock, NULL);
+		pthread_cond_init(&q->cpq_work, NULL);
+		pthread_cond_init(&q->cpq_space, NULL);
+		q->cpq_size = depth;
+		q->cpq_recs = calloc(depth, sizeof(*q->cpq_recs));
+		if (q->cpq_recs == NULL) {
+			rc = -ENOMEM;
+			goto out_stop;
+		}
+
+		rc = pthread_create(&cpw->cpw_thread, NULL,
+				    chlg_par_worker_main, cpw);
+		if (rc != 0) {
+			rc = -rc;
+			goto out_stop;
+		}
+		cpw->cpw_started = true;
+	}
+
+	while (chlg_par_get_rc(&pool) == 0) {
+		struct changelog_rec *rec;
+		unsigned int shard;
+
+		rc = llapi_changelog_recv(priv, &rec);
+		if (rc == 1) {
+			rc = 0;
+			break;
+		}
+		if (rc < 0)
+			break;
+
+		shard = chlg_par_shard(rec, param->lcp_workers);
+		dispatched = rec->cr_index;
+		rc = chlg_par_enqueue(&pool, &pool.cpp_workers[shard].cpw_queue,
+				      rec);
+		if (rc < 0) {
+			llapi_changelog_free(&rec);
+			break;
+		}
+
+		if (++count % interval == 0) {
+			rc = chlg_par_clear(param,
+					    chlg_par_committed(&pool, dispatched),
+					    &cleared);
+			if (rc < 0)
+				break;
+		}
+	}
+
+out_stop:
+	for (i = 0; i < param->lcp_workers; i++) {
+		struct chlg_par_queue *q = &pool.cpp_workers[i].cpw_queue;
+
+		if (!pool.cpp_workers[i].cpw_started)
+			continue;
+		pthread_mutex_lock(&q->cpq_lock);
+		q->cpq_stop = true;
+		pthread_cond_signal(&q->cpq_work);
+		pthread_mutex_unlock(&q->cpq_lock);
+	}
+	for (i = 0; i < param->lcp_workers; i++)
+		if (pool.cpp_workers[i].cpw_started)
+			pthread_join(pool.cpp_workers[i].cpw_thread, NULL);
+
+	/* records left queued after a failure were not committed */
+	dispatched = chlg_par_committed(&pool, dispatched);
+	rc2 = chlg_par_clear(param, dispatched, &cleared);
+	if (rc == 0)
+		rc = chlg_par_get_rc(&pool) ?: rc2;
+	if (endrec != NULL)
+		*endrec = dispatched;
+
+	for (i = 0; i < param->lcp_workers; i++) {
+		struct chlg_par_queue *q = &pool.cpp_workers[i].cpw_queue;
+
+		if (q->cpq_recs == NULL)
+			continue;
+		while (q->cpq_count > 0) {
+			llapi_changelog_free(&q->cpq_recs[q->cpq_head]);
+			q->cpq_head = (q->cpq_head + 1) % q->cpq_size;
+			q->cpq_count--;
+		}
+		free(q->cpq_recs);
+		pthread_mutex_destroy(&q->cpq_lock);
+		pthread_cond_destroy(&q->cpq_work);
+		pthread_cond_destroy(&q->cpq_space);
+	}
+	free(pool.cpp_workers);
+out_fini:
+	llapi_changelog_fini(&priv);
+	return rc;
+}
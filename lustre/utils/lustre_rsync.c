@@ -112,7 +112,11 @@
 #include <stdarg.h>
 #include <fcntl.h>
 #include <signal.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
 #include <errno.h>
 #include <limits.h>
@@ -129,9 +133,13 @@
 #define REPLICATE_STATUS_VER 1
 #define CLEAR_INTERVAL 100
 #define DEFAULT_RSYNC_THRESHOLD 0xA00000 /* 10 MB */
+#define LR_COPY_CHUNK (64 << 20) /* bytes per copy_file_range() call */
 
 #define TYPE_STR_LEN 16
 
+#define LR_DEFAULT_BATCH 1024
+#define LR_HASH_BITS 12
+
 #define DEFAULT_MDT "-MDT0000"
 #define SPECIAL_DIR ".lustrerepl"
 #define RSYNC "rsync"
@@ -191,6 +199,10 @@ long long rsync_threshold = DEFAULT_RSYNC_THRESHOLD;
 int quit;       /* Flag to stop processing the changelog; set on the
                    receipt of a signal */
 int abort_on_err = 0;
+int lr_threads;		/* Copy threads of the pipeline, 0 for serial mode */
+int lr_resolve_threads;	/* fid2path threads of the pipeline */
+int lr_batch = LR_DEFAULT_BATCH; /* Records per pipeline batch */
+long long collapsed;	/* No of records merged into an earlier one */
 
 char rsync[PATH_MAX + 128];
 char rsync_ver[PATH_MAX * 2];
@@ -208,12 +220,16 @@ struct option long_opts[] = {
 	{ .val = 'v',	.name = "verbose",	.has_arg = no_argument },
 	{ .val = 'x',	.name = "xattr",	.has_arg = required_argument },
 	{ .val = 'z',	.name = "dry-run",	.has_arg = no_argument },
+	{ .val = 'p',	.name = "threads",	.has_arg = required_argument },
 	/* Undocumented options follow */
 	{ .val = 'a',	.name = "abort-on-err",	.has_arg = no_argument },
 	{ .val = 'c',	.name = "cl-clear",	.has_arg = required_argument },
 	{ .val = 'd',	.name = "debug",	.has_arg = required_argument },
 	{ .val = 'D',	.name = "debuglog",	.has_arg = required_argument },
+	{ .val = 'b',	.name = "batch",	.has_arg = required_argument },
 	{ .val = 'n',	.name = "start-recno",	.has_arg = required_argument },
+	{ .val = 'R',	.name = "resolve-threads",
+						.has_arg = required_argument },
 	{ .val = 'r',	.name = "use-rsync",	.has_arg = no_argument },
 	{ .val = 'y',	.name = "rsync-threshold",
 						.has_arg = required_argument },
@@ -231,7 +247,8 @@ void lr_usage()
                 "\t--xattr <yes|no> replicate EAs\n"
                 "\t--abort-on-err   abort at first err\n"
                 "\t--verbose\n"
-                "\t--dry-run        don't write anything\n");
+                "\t--dry-run        don't write anything\n"
+		"\t--threads <n>    copy data with a pipeline of n threads\n");
 }
 
 /* Print debug information. This is controlled by the value of the
@@ -336,6 +353,41 @@ int lr_rsync_data(struct lr_info *info)
         return rc;
 }
 
+/* Copy from the current offset of fd_src to the end of the file into
+ * fd_dest with copy_file_range(), or sendfile() on kernels without it.
+ * Returns -EOPNOTSUPP if neither can be used for this pair of files,
+ * before anything was copied. */
+static int lr_copy_range(int fd_src, int fd_dest)
+{
+	bool use_sendfile = false;
+	bool copied = false;
+	ssize_t rc;
+
+	while (1) {
+#ifdef __NR_copy_file_range
+		if (!use_sendfile)
+			rc = syscall(__NR_copy_file_range, fd_src, NULL,
+				     fd_dest, NULL, LR_COPY_CHUNK, 0);
+		else
+#endif
+			rc = sendfile(fd_dest, fd_src, NULL, LR_COPY_CHUNK);
+		if (rc == 0)
+			return 0;
+		if (rc > 0) {
+			copied = true;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		if (copied || (errno != ENOSYS && errno != EXDEV &&
+			       errno != EINVAL && errno != EOPNOTSUPP))
+			return -errno;
+		if (use_sendfile)
+			return -EOPNOTSUPP;
+		use_sendfile = true;
+	}
+}
+
 int lr_copy_data(struct lr_info *info)
 {
         int fd_src = -1;
@@ -371,6 +423,13 @@ int lr_copy_data(struct lr_info *info)
                 rc = -errno;
                 goto out;
         }
+
+	/* Let the kernel move the data without bouncing it through
+	 * userspace, falling back to read/write if it cannot. */
+	rc = lr_copy_range(fd_src, fd_dest);
+	if (rc != -EOPNOTSUPP)
+		goto out_sync;
+
         bufsize = st_dest.st_blksize;
 
         if (info->bufsize < bufsize) {
@@ -407,6 +466,7 @@ int lr_copy_data(struct lr_info *info)
 			buf += wsize;
 		} while (rsize > 0);
 	}
+out_sync:
 	fsync(fd_dest);
 
 out:
@@ -502,7 +562,9 @@ int lr_copy_xattr(struct lr_info *info)
 			"cannot replicate xattrs from '%s' to '%s': %s\n",
 						info->src, info->dest,
 						strerror(errno));
-                                        errors++;
+					/* may run on a pipeline thread */
+					__atomic_add_fetch(&errors, 1,
+							   __ATOMIC_RELAXED);
                                 }
                                 rc = 0;
                         }
@@ -612,6 +674,11 @@ int lr_mkfile(struct lr_info *info)
 			return -errno;
 	}
 
+	/* The pipeline copies data and attributes of new files on its own
+	 * threads, see lr_pipeline_copy(). */
+	if (info->type == CL_CREATE && lr_threads > 0)
+		return rc;
+
         /* Sync data and attributes */
         if (info->type == CL_CREATE || info->type == CL_MKDIR) {
                 lr_debug(DTRACE, "Syncing data and attributes %s\n",
@@ -1525,6 +1592,530 @@ void lr_print_failure(struct lr_info *info, int rc)
                 info->pfid, info->name);
 }
 
+/* Read the next operation from the changelog into info. A rename logged
+ * by an old MDT as two records is merged into one extended record, ext is
+ * used as scratch space for that. */
+int lr_read_rec(void *priv, struct lr_info *info, struct lr_info *ext)
+{
+	int rc;
+
+	rc = lr_parse_line(priv, info);
+	if (rc != 0)
+		return rc;
+
+	if (info->type == CL_RENAME && !info->is_extended) {
+		/* Newer rename operations extends changelog to store
+		 * source file information, but old changelog has
+		 * another record.
+		 */
+		rc = lr_parse_line(priv, ext);
+		if (rc != 0)
+			return rc;
+		memcpy(info->sfid, info->tfid, sizeof(info->sfid));
+		memcpy(info->spfid, info->pfid, sizeof(info->spfid));
+		memcpy(info->tfid, ext->tfid, sizeof(info->tfid));
+		memcpy(info->pfid, ext->pfid, sizeof(info->pfid));
+		snprintf(info->sname, sizeof(info->sname), "%s",
+			 info->name);
+		snprintf(info->name, sizeof(info->name), "%s",
+			 ext->name);
+		info->is_extended = 1;
+		info->recno = ext->recno; /* For lr_clear_cl(). */
+	}
+
+	return 0;
+}
+
+/* Replicate a single changelog operation */
+int lr_replicate_rec(struct lr_info *info)
+{
+	int rc = 0;
+
+	lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name);
+
+	switch (info->type) {
+	case CL_CREATE:
+	case CL_MKDIR:
+	case CL_MKNOD:
+	case CL_SOFTLINK:
+		rc = lr_create(info);
+		break;
+	case CL_RMDIR:
+	case CL_UNLINK:
+		rc = lr_remove(info);
+		break;
+	case CL_RENAME:
+		rc = lr_move(info);
+		break;
+	case CL_HARDLINK:
+		rc = lr_link(info);
+		break;
+	case CL_TRUNC:
+	case CL_SETATTR:
+		rc = lr_setattr(info);
+		break;
+	case CL_SETXATTR:
+		rc = lr_setxattr(info);
+		break;
+	case CL_CLOSE:
+	case CL_EXT:
+	case CL_OPEN:
+	case CL_GETXATTR:
+	case CL_DN_OPEN:
+	case CL_LAYOUT:
+	case CL_MARK:
+		/* Nothing needs to be done for these entries */
+		/* fallthrough */
+	default:
+		break;
+	}
+
+	lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
+		 info->recno, changelog_type2str(info->type),
+		 info->type, info->tfid, info->pfid, info->name, rc);
+
+	return rc;
+}
+
+/* Replicate the changelog one record at a time */
+void lr_replicate_serial(void *priv, struct lr_info *info, struct lr_info *ext)
+{
+	int rc;
+
+	while (!quit && lr_read_rec(priv, info, ext) == 0) {
+		if (dryrun)
+			continue;
+
+		rc = lr_replicate_rec(info);
+		if (rc && rc != -ENOENT) {
+			lr_print_failure(info, rc);
+			errors++;
+			if (abort_on_err)
+				break;
+		}
+		lr_clear_cl(info, 0);
+	}
+}
+
+/*
+ * Pipelined replication.
+ *
+ * Records are consumed in batches of lr_batch records. Each batch goes
+ * through three stages:
+ * 1. the main thread parses the records and replays namespace operations
+ *    (create, unlink, rename, ...) in changelog order, since each of them
+ *    depends on the previous ones. Data and attribute updates are not
+ *    replayed but merged into one copy job per FID, so a file closed or
+ *    modified many times in a batch is only copied once.
+ * 2. lr_resolve_threads threads look up the current path of each job with
+ *    llapi_fid2path() and pass it on to
+ * 3. lr_threads threads which copy data, attributes and xattrs to the
+ *    targets.
+ * Stages 2 and 3 overlap. Once all the jobs of a batch are done, the
+ * changelog is cleared and the status log written up to its last record,
+ * so a restart never replays less than a whole batch.
+ */
+
+/* What needs to be copied for a FID */
+enum lr_job_flags {
+	LR_JOB_DATA	= 0x1,
+	LR_JOB_ATTR	= 0x2,
+	LR_JOB_XATTR	= 0x4,
+};
+
+struct lr_job {
+	char			lj_tfid[LR_FID_STR_LEN];
+	char			lj_path[PATH_MAX + 1];
+	/* Last record merged into this job, for error reporting */
+	long long		lj_recno;
+	enum changelog_rec_type	lj_type;
+	enum lr_job_flags	lj_flags;
+	/* Next job in the same hash bucket, or -1 */
+	int			lj_next;
+};
+
+struct lr_pipeline {
+	struct lr_job	*lp_jobs;
+	int		 lp_njobs;
+	/* Heads of the FID hash chains, indexes in lp_jobs */
+	int		*lp_hash;
+	/* Next job to resolve */
+	int		 lp_resolve_next;
+	/* Resolved jobs waiting to be copied, in lp_jobs */
+	int		*lp_ready;
+	int		 lp_ready_head;
+	int		 lp_ready_tail;
+	/* Resolve threads still running */
+	int		 lp_resolving;
+	/* Set when a job failed with abort_on_err */
+	bool		 lp_abort;
+	pthread_mutex_t	 lp_lock;
+	pthread_cond_t	 lp_cond;
+	/* Per-thread scratch state, resolvers first */
+	struct lr_info	**lp_infos;
+	pthread_t	*lp_threads;
+};
+
+struct lr_pipeline_thread {
+	struct lr_pipeline	*lpt_pipeline;
+	struct lr_info		*lpt_info;
+};
+
+/* Copy work for a record, 0 if it is replayed by the main thread */
+static enum lr_job_flags lr_job_flags(enum changelog_rec_type type)
+{
+	switch (type) {
+	case CL_TRUNC:
+	case CL_SETATTR:
+	case CL_CLOSE:
+	case CL_MTIME:
+		return LR_JOB_DATA | LR_JOB_ATTR;
+	case CL_SETXATTR:
+		return LR_JOB_XATTR;
+	default:
+		return 0;
+	}
+}
+
+static unsigned int lr_fid_hash(const char *fid)
+{
+	unsigned int hash = 5381;
+
+	while (*fid != '\0')
+		hash = hash * 33 + *fid++;
+
+	return hash & ((1 << LR_HASH_BITS) - 1);
+}
+
+/* Add copy work for info->tfid, merging it with a pending job for the
+ * same FID */
+static void lr_pipeline_add(struct lr_pipeline *lp, struct lr_info *info,
+			    enum lr_job_flags flags)
+{
+	unsigned int hash = lr_fid_hash(info->tfid);
+	struct lr_job *job;
+	int i;
+
+	for (i = lp->lp_hash[hash]; i != -1; i = lp->lp_jobs[i].lj_next) {
+		job = &lp->lp_jobs[i];
+		if (strcmp(job->lj_tfid, info->tfid) == 0) {
+			job->lj_flags |= flags;
+			job->lj_recno = info->recno;
+			job->lj_type = info->type;
+			collapsed++;
+			return;
+		}
+	}
+
+	/* one job per record at most, so there is always room */
+	job = &lp->lp_jobs[lp->lp_njobs];
+	snprintf(job->lj_tfid, sizeof(job->lj_tfid), "%s", info->tfid);
+	job->lj_recno = info->recno;
+	job->lj_type = info->type;
+	job->lj_flags = flags;
+	job->lj_next = lp->lp_hash[hash];
+	lp->lp_hash[hash] = lp->lp_njobs++;
+}
+
+static void lr_pipeline_fail(struct lr_pipeline *lp, struct lr_info *info,
+			     struct lr_job *job, int rc)
+{
+	info->recno = job->lj_recno;
+	info->type = job->lj_type;
+	snprintf(info->tfid, sizeof(info->tfid), "%s", job->lj_tfid);
+	info->pfid[0] = '\0';
+	info->name[0] = '\0';
+	lr_print_failure(info, rc);
+
+	__atomic_add_fetch(&errors, 1, __ATOMIC_RELAXED);
+	if (abort_on_err)
+		lp->lp_abort = true;
+}
+
+/* Stage 2: resolve the current source path of each job */
+static void *lr_pipeline_resolve(void *arg)
+{
+	struct lr_pipeline_thread *lpt = arg;
+	struct lr_pipeline *lp = lpt->lpt_pipeline;
+	struct lr_info *info = lpt->lpt_info;
+	struct lr_job *job;
+	int rc;
+	int i;
+
+	while ((i = __atomic_fetch_add(&lp->lp_resolve_next, 1,
+				       __ATOMIC_RELAXED)) < lp->lp_njobs) {
+		job = &lp->lp_jobs[i];
+		rc = lr_get_path(info, job->lj_tfid);
+		if (rc == -ENOENT) {
+			/* Removed since, nothing left to copy */
+			lr_debug(DINFO, "copy: %s not present on source-fs\n",
+				 job->lj_tfid);
+			continue;
+		}
+		if (rc < 0) {
+			lr_pipeline_fail(lp, info, job, rc);
+			continue;
+		}
+		snprintf(job->lj_path, sizeof(job->lj_path), "%s", info->path);
+
+		pthread_mutex_lock(&lp->lp_lock);
+		lp->lp_ready[lp->lp_ready_tail++] = i;
+		pthread_cond_signal(&lp->lp_cond);
+		pthread_mutex_unlock(&lp->lp_lock);
+	}
+
+	pthread_mutex_lock(&lp->lp_lock);
+	lp->lp_resolving--;
+	pthread_cond_broadcast(&lp->lp_cond);
+	pthread_mutex_unlock(&lp->lp_lock);
+
+	return NULL;
+}
+
+/* Stage 3: copy data, attributes and xattrs of resolved jobs */
+static void *lr_pipeline_copy(void *arg)
+{
+	struct lr_pipeline_thread *lpt = arg;
+	struct lr_pipeline *lp = lpt->lpt_pipeline;
+	struct lr_info *info = lpt->lpt_info;
+	struct lr_job *job;
+	int rc;
+	int rc1;
+
+	while (1) {
+		pthread_mutex_lock(&lp->lp_lock);
+		while (lp->lp_ready_head == lp->lp_ready_tail &&
+		       lp->lp_resolving > 0)
+			pthread_cond_wait(&lp->lp_cond, &lp->lp_lock);
+		if (lp->lp_ready_head == lp->lp_ready_tail) {
+			pthread_mutex_unlock(&lp->lp_lock);
+			break;
+		}
+		job = &lp->lp_jobs[lp->lp_ready[lp->lp_ready_head++]];
+		pthread_mutex_unlock(&lp->lp_lock);
+
+		snprintf(info->tfid, sizeof(info->tfid), "%s", job->lj_tfid);
+		snprintf(info->path, sizeof(info->path), "%s", job->lj_path);
+		lr_get_FID_PATH(status->ls_source, info->tfid, info->src,
+				PATH_MAX);
+
+		rc = 0;
+		for (info->target_no = 0;
+		     info->target_no < status->ls_num_targets;
+		     info->target_no++) {
+			if (lr_set_dest_for_attr(info) < 0)
+				continue;
+
+			lr_debug(DINFO, "copy(%#x): %s %s %s\n", job->lj_flags,
+				 info->src, info->dest, info->tfid);
+
+			rc1 = 0;
+			if (job->lj_flags & LR_JOB_XATTR)
+				rc1 = lr_copy_xattr(info);
+			if (!rc1 && job->lj_flags & LR_JOB_DATA)
+				rc1 = lr_sync_data(info);
+			if (!rc1 && job->lj_flags & LR_JOB_ATTR)
+				rc1 = lr_copy_attr(info->src, info->dest);
+			if (rc1)
+				rc = rc1;
+		}
+
+		if (rc && rc != -ENOENT)
+			lr_pipeline_fail(lp, info, job, rc);
+	}
+
+	return NULL;
+}
+
+/* Run stages 2 and 3 on the jobs of the current batch */
+static int lr_pipeline_run(struct lr_pipeline *lp)
+{
+	struct lr_pipeline_thread *lpt;
+	int nthreads = lr_resolve_threads + lr_threads;
+	int started;
+	int rc = 0;
+
+	if (lp->lp_njobs == 0)
+		return 0;
+
+	lpt = calloc(nthreads, sizeof(*lpt));
+	if (lpt == NULL)
+		return -ENOMEM;
+
+	lp->lp_resolve_next = 0;
+	lp->lp_ready_head = 0;
+	lp->lp_ready_tail = 0;
+	lp->lp_resolving = lr_resolve_threads;
+
+	for (started = 0; started < nthreads; started++) {
+		lpt[started].lpt_pipeline = lp;
+		lpt[started].lpt_info = lp->lp_infos[started];
+		rc = pthread_create(&lp->lp_threads[started], NULL,
+				    started < lr_resolve_threads ?
+				    lr_pipeline_resolve : lr_pipeline_copy,
+				    &lpt[started]);
+		if (rc != 0) {
+			rc = -rc;
+			break;
+		}
+	}
+
+	if (rc != 0 && started <= lr_resolve_threads) {
+		/* Without copy threads nothing drains the resolved jobs,
+		 * let the running resolvers finish and give up. */
+		pthread_mutex_lock(&lp->lp_lock);
+		lp->lp_resolving -= lr_resolve_threads - started;
+		pthread_mutex_unlock(&lp->lp_lock);
+	} else if (rc != 0) {
+		/* Fewer copy threads than wanted is still correct */
+		rc = 0;
+	}
+
+	while (started-- > 0)
+		pthread_join(lp->lp_threads[started], NULL);
+
+	free(lpt);
+
+	return rc;
+}
+
+static void lr_pipeline_fini(struct lr_pipeline *lp)
+{
+	int i;
+
+	if (lp->lp_infos != NULL) {
+		for (i = 0; i < lr_resolve_threads + lr_threads; i++) {
+			struct lr_info *info = lp->lp_infos[i];
+
+			if (info == NULL)
+				continue;
+			free(info->buf);
+			free(info->xlist);
+			free(info->xvalue);
+			free(info);
+		}
+	}
+	free(lp->lp_infos);
+	free(lp->lp_threads);
+	free(lp->lp_ready);
+	free(lp->lp_hash);
+	free(lp->lp_jobs);
+	pthread_mutex_destroy(&lp->lp_lock);
+	pthread_cond_destroy(&lp->lp_cond);
+}
+
+static int lr_pipeline_init(struct lr_pipeline *lp)
+{
+	int nthreads = lr_resolve_threads + lr_threads;
+	int i;
+
+	memset(lp, 0, sizeof(*lp));
+	pthread_mutex_init(&lp->lp_lock, NULL);
+	pthread_cond_init(&lp->lp_cond, NULL);
+
+	lp->lp_jobs = calloc(lr_batch, sizeof(*lp->lp_jobs));
+	lp->lp_hash = calloc(1 << LR_HASH_BITS, sizeof(*lp->lp_hash));
+	lp->lp_ready = calloc(lr_batch, sizeof(*lp->lp_ready));
+	lp->lp_threads = calloc(nthreads, sizeof(*lp->lp_threads));
+	lp->lp_infos = calloc(nthreads, sizeof(*lp->lp_infos));
+	if (lp->lp_jobs == NULL || lp->lp_hash == NULL ||
+	    lp->lp_ready == NULL || lp->lp_threads == NULL ||
+	    lp->lp_infos == NULL)
+		goto out_nomem;
+
+	for (i = 0; i < nthreads; i++) {
+		lp->lp_infos[i] = calloc(1, sizeof(struct lr_info));
+		if (lp->lp_infos[i] == NULL)
+			goto out_nomem;
+	}
+
+	return 0;
+
+out_nomem:
+	lr_pipeline_fini(lp);
+	return -ENOMEM;
+}
+
+static void lr_pipeline_reset(struct lr_pipeline *lp)
+{
+	lp->lp_njobs = 0;
+	memset(lp->lp_hash, 0xff, (1 << LR_HASH_BITS) * sizeof(*lp->lp_hash));
+}
+
+/* Replicate the changelog through the pipeline described above */
+void lr_replicate_pipeline(void *priv, struct lr_info *info,
+			   struct lr_info *ext)
+{
+	struct lr_pipeline lp;
+	enum lr_job_flags flags;
+	long long last_recno;
+	bool stop = false;
+	int nrecs;
+	int rc;
+
+	rc = lr_pipeline_init(&lp);
+	if (rc < 0) {
+		fprintf(stderr, "Error setting up the replication pipeline: %s\n",
+			strerror(-rc));
+		errors++;
+		return;
+	}
+
+	while (!quit && !stop) {
+		lr_pipeline_reset(&lp);
+		last_recno = -1;
+
+		/* Stage 1 */
+		for (nrecs = 0; nrecs < lr_batch && !quit; nrecs++) {
+			if (lr_read_rec(priv, info, ext) != 0) {
+				stop = true;
+				break;
+			}
+			last_recno = info->recno;
+			if (dryrun)
+				continue;
+
+			flags = lr_job_flags(info->type);
+			if (flags != 0) {
+				lr_pipeline_add(&lp, info, flags);
+				continue;
+			}
+
+			rc = lr_replicate_rec(info);
+			if (rc && rc != -ENOENT) {
+				lr_print_failure(info, rc);
+				errors++;
+				if (abort_on_err) {
+					lp.lp_abort = true;
+					break;
+				}
+			} else if (rc == 0 && info->type == CL_CREATE) {
+				lr_pipeline_add(&lp, info, LR_JOB_DATA |
+						LR_JOB_ATTR | LR_JOB_XATTR);
+			}
+		}
+
+		/* Stages 2 and 3 */
+		rc = lr_pipeline_run(&lp);
+		if (rc < 0) {
+			fprintf(stderr, "Error running the replication pipeline: %s\n",
+				strerror(-rc));
+			errors++;
+			break;
+		}
+		if (lp.lp_abort || last_recno == -1)
+			break;
+
+		/* Checkpoint the whole batch */
+		info->recno = last_recno;
+		lr_clear_cl(info, 1);
+	}
+
+	lr_pipeline_fini(&lp);
+}
+
 /* Replicate filesystem operations from src_path to target_path */
 int lr_replicate()
 {
@@ -1613,95 +2204,27 @@ int lr_replicate()
 		goto out;
 	}
 
-        while (!quit && lr_parse_line(changelog_priv, info) == 0) {
-                rc = 0;
-		if (info->type == CL_RENAME && !info->is_extended) {
-			/* Newer rename operations extends changelog to store
-			 * source file information, but old changelog has
-			 * another record.
-			 */
-			if (lr_parse_line(changelog_priv, ext) != 0)
-				break;
-			memcpy(info->sfid, info->tfid, sizeof(info->sfid));
-			memcpy(info->spfid, info->pfid, sizeof(info->spfid));
-			memcpy(info->tfid, ext->tfid, sizeof(info->tfid));
-			memcpy(info->pfid, ext->pfid, sizeof(info->pfid));
-			snprintf(info->sname, sizeof(info->sname), "%s",
-				 info->name);
-			snprintf(info->name, sizeof(info->name), "%s",
-				 ext->name);
-			info->is_extended = 1;
-			info->recno = ext->recno; /* For lr_clear_cl(). */
-		}
-
-                if (dryrun)
-                        continue;
-
-		lr_debug(DTRACE, "***** Start %lld %s (%d) %s %s %s *****\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name);
-
-                switch(info->type) {
-                case CL_CREATE:
-                case CL_MKDIR:
-                case CL_MKNOD:
-                case CL_SOFTLINK:
-                        rc = lr_create(info);
-                        break;
-                case CL_RMDIR:
-                case CL_UNLINK:
-                        rc = lr_remove(info);
-                        break;
-                case CL_RENAME:
-			rc = lr_move(info);
-                        break;
-                case CL_HARDLINK:
-                        rc = lr_link(info);
-                        break;
-                case CL_TRUNC:
-                case CL_SETATTR:
-                        rc = lr_setattr(info);
-                        break;
-		case CL_SETXATTR:
-                        rc = lr_setxattr(info);
-                        break;
-		case CL_CLOSE:
-		case CL_EXT:
-		case CL_OPEN:
-		case CL_GETXATTR:
-		case CL_DN_OPEN:
-		case CL_LAYOUT:
-		case CL_MARK:
-			/* Nothing needs to be done for these entries */
-			/* fallthrough */
-		default:
-			break;
-		}
-
-		lr_debug(DTRACE, "##### End %lld %s (%d) %s %s %s rc=%d #####\n",
-			 info->recno, changelog_type2str(info->type),
-			 info->type, info->tfid, info->pfid, info->name, rc);
-
-                if (rc && rc != -ENOENT) {
-                        lr_print_failure(info, rc);
-                        errors++;
-                        if (abort_on_err)
-                                break;
-                }
-                lr_clear_cl(info, 0);
-        }
+	if (lr_threads > 0)
+		lr_replicate_pipeline(changelog_priv, info, ext);
+	else
+		lr_replicate_serial(changelog_priv, info, ext);
 
         llapi_changelog_fini(&changelog_priv);
 
         if (errors || verbose)
                 printf("Errors: %d\n", errors);
 
-        /* Clear changelog records used so far */
-        lr_clear_cl(info, 1);
+	/* Clear changelog records used so far. The pipeline has already
+	 * cleared every batch it completed, and nothing after them. */
+	if (lr_threads == 0)
+		lr_clear_cl(info, 1);
 
         if (verbose) {
                 printf("lustre_rsync took %ld seconds\n", time(NULL) - start);
                 printf("Changelog records consumed: %lld\n", rec_count);
+		if (lr_threads > 0)
+			printf("Changelog records collapsed: %lld\n",
+			       collapsed);
         }
 
 	rc = 0;
@@ -1732,7 +2255,7 @@ int main(int argc, char *argv[])
         if ((rc = lr_init_status()) != 0)
                 return rc;
 
-	while ((rc = getopt_long(argc, argv, "as:t:m:u:l:vx:zc:ry:n:d:D:",
+	while ((rc = getopt_long(argc, argv, "ab:p:R:s:t:m:u:l:vx:zc:ry:n:d:D:",
 				 long_opts, NULL)) >= 0) {
                 switch (rc) {
                 case 'a':
@@ -1826,6 +2349,26 @@ int main(int argc, char *argv[])
                         if (debug < 0 || debug > 2)
                                 debug = 0;
                         break;
+		case 'p':
+			lr_threads = atoi(optarg);
+			if (lr_threads < 0) {
+				printf("Invalid number of threads %s\n",
+				       optarg);
+				return -1;
+			}
+			break;
+		case 'R':
+			/* Undocumented option resolve-threads */
+			lr_resolve_threads = atoi(optarg);
+			break;
+		case 'b':
+			/* Undocumented option batch */
+			lr_batch = atoi(optarg);
+			if (lr_batch <= 0) {
+				printf("Invalid batch size %s\n", optarg);
+				return -1;
+			}
+			break;
 		case 'D':
 			/* Undocumented option debug log file */
 			if (debug_log != NULL)
@@ -1847,6 +2390,8 @@ int main(int argc, char *argv[])
 
         if (status->ls_last_recno == -1)
                 status->ls_last_recno = 0;
+	if (lr_threads > 0 && lr_resolve_threads <= 0)
+		lr_resolve_threads = (lr_threads + 1) / 2;
         if (strnlen(status->ls_registration, LR_NAME_MAXLEN) == 0) {
                 /* No registration ID was passed in. */
                 printf("Please specify changelog consumer registration id.\n");
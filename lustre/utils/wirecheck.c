@@ -623,6 +623,8 @@ check_obd_connect_data(void)
 	CHECK_DEFINE_64X(OBD_CONNECT2_CRUSH);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ASYNC_DISCARD);
 	CHECK_DEFINE_64X(OBD_CONNECT2_ENCRYPT);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_GETATTR);
+	CHECK_DEFINE_64X(OBD_CONNECT2_BATCH_BL_AST);
 
 	CHECK_VALUE_X(OBD_CKSUM_CRC32);
 	CHECK_VALUE_X(OBD_CKSUM_ADLER);
@@ -2758,6 +2760,7 @@ main(int argc, char **argv)
 	CHECK_VALUE(MDS_HSM_CT_UNREGISTER);
 	CHECK_VALUE(MDS_SWAP_LAYOUTS);
 	CHECK_VALUE(MDS_RMFID);
+	CHECK_VALUE(MDS_BATCH_GETATTR);
 	CHECK_VALUE(MDS_LAST_OPC);
 
 	CHECK_VALUE(REINT_SETATTR);